@@ -0,0 +1,70 @@
+// Compares the previous Buffer.concat based reassembly with the shared framer
+// on the same chunked H4 stream: node bench/framer.js [chunkSize] [packets]
+const { createFramer, JsHciFramer, isNative } = require('../lib/framer');
+
+const chunkSize = parseInt(process.argv[2], 10) || 16;
+const packetCount = parseInt(process.argv[3], 10) || 200000;
+
+// Advertising reports interleaved with ACL data, as seen on a busy controller
+function buildStream () {
+  const adv = Buffer.from('043e2902010000112233445566' + '1f' + '02010611ff4c000215' + 'aa'.repeat(20) + 'c5', 'hex');
+  const acl = Buffer.from('024020' + '1b00' + '17000400' + '1b2a00' + 'bb'.repeat(20), 'hex');
+  // Large L2CAP frames (e.g. firmware or log transfer) are where re-concatenation hurts most
+  const bulk = Buffer.from('024020' + 'f903' + 'f5034000' + 'cc'.repeat(1013), 'hex');
+  const packets = [];
+  for (let i = 0; i < packetCount; i++) {
+    packets.push(i % 16 === 15 ? bulk : i % 4 === 3 ? acl : adv);
+  }
+  return Buffer.concat(packets);
+}
+
+// The reassembly previously done by HciSerialParser._transform
+class LegacyFramer {
+  constructor () {
+    this.packetData = Buffer.alloc(0);
+  }
+
+  push (chunk) {
+    const packets = [];
+    this.packetData = Buffer.concat([this.packetData, chunk]);
+    while (this.packetData.length > 0) {
+      const type = this.packetData.readUInt8(0);
+      let pre, size;
+      if (type === 0x04 && this.packetData.length >= 3) {
+        pre = 3; size = this.packetData.readUInt8(2);
+      } else if (type === 0x02 && this.packetData.length >= 5) {
+        pre = 5; size = this.packetData.readUInt16LE(3);
+      } else {
+        break;
+      }
+      if (this.packetData.length < pre + size) {
+        break;
+      }
+      packets.push(this.packetData.slice(0, pre + size));
+      this.packetData = this.packetData.slice(pre + size);
+    }
+    return packets;
+  }
+}
+
+function run (name, framer, stream) {
+  const start = process.hrtime.bigint();
+  let count = 0;
+  for (let offset = 0; offset < stream.length; offset += chunkSize) {
+    count += framer.push(stream.subarray(offset, offset + chunkSize)).length;
+  }
+  const ns = Number(process.hrtime.bigint() - start);
+  console.log(`${name.padEnd(12)} ${count} packets  ${(ns / 1e6).toFixed(1)} ms  ${(ns / count).toFixed(0)} ns/packet`);
+  return count;
+}
+
+const stream = buildStream();
+console.log(`${packetCount} packets, ${stream.length} bytes, ${chunkSize} byte chunks`);
+
+run('legacy', new LegacyFramer(), stream);
+run('js', new JsHciFramer(), stream);
+if (isNative) {
+  run('native', createFramer(), stream);
+} else {
+  console.log('native       addon not built, skipped');
+}
@@ -0,0 +1,1070 @@
+// Native benchmark of the per-packet parsing paths, built without Node.
+//
+//   BLUETOOTH_HCI_SOCKET_BENCH=1 node-gyp rebuild && build/Release/hci_bench [options]
+//
+//   --corpus <file>     replay a btsnoop capture (H4 or HCI UART datalink) instead of
+//                       the built-in synthetic mix
+//   --iterations <n>    passes over the corpus per stage (default 200)
+//   --check             exit with status 1 if a stage allocates more per packet than its budget,
+//                       the layout-based parsers disagree with the hand-indexed reference,
+//                       the RPA resolver's backends disagree with each other or the spec's ah(),
+//                       the AD pattern matcher disagrees with a brute force search,
+//                       the observation store reads back other advertisements than it was given,
+//                       the connect scheduler leaves a simulated fleet unsettled or settles it slower
+//                       than connecting one device at a time, or a shared ring consumer reads a torn
+//                       record or miscounts the packets it lost to wraparound
+//
+// Prints ns/packet and heap allocations/packet for every stage.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "BluetoothHciAcceptList.h"
+#include "BluetoothHciAdMatcher.h"
+#include "BluetoothHciAdvertising.h"
+#include "BluetoothHciAdvertisingColumns.h"
+#include "BluetoothHciAttRouter.h"
+#include "BluetoothHciConnectScheduler.h"
+#include "BluetoothHciConnectionRouter.h"
+#include "BluetoothHciIso.h"
+#include "BluetoothHciLinkParser.h"
+#include "BluetoothHciObservationStore.h"
+#include "BluetoothHciPacketFramer.h"
+#include "BluetoothHciRpaResolver.h"
+#include "BluetoothHciScanTable.h"
+#ifdef __linux__
+#include "BluetoothHciSharedRing.h"
+#endif
+
+// Every heap allocation of the process goes through here
+static size_t g_allocations = 0;
+
+// Keeps results of otherwise unused parses alive
+static volatile size_t g_sink = 0;
+
+void* operator new(size_t size) {
+  g_allocations++;
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+typedef std::vector<std::string> Corpus;
+
+static std::string Hex(const char* hex) {
+  std::string bytes;
+  for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+    char pair[3] = { hex[i], hex[i + 1], 0 };
+    bytes.push_back(static_cast<char>(strtoul(pair, nullptr, 16)));
+  }
+  return bytes;
+}
+
+static std::string Event(uint8_t code, const std::string& params) {
+  return std::string("\x04", 1) + static_cast<char>(code) + static_cast<char>(params.length()) + params;
+}
+
+static std::string LeMeta(uint8_t subevent, const std::string& params) {
+  return Event(HCI_EV_LE_META, static_cast<char>(subevent) + params);
+}
+
+static std::string U16(uint16_t value) {
+  return std::string(1, static_cast<char>(value & 0xFF)) + static_cast<char>(value >> 8);
+}
+
+// Busy scanner with a few connections: mostly advertising, some ATT and ISO traffic
+static Corpus SyntheticCorpus() {
+  Corpus corpus;
+  std::string adData = Hex("0201061aff4c000215aabbccddeeff00112233445566778899aabbccddeeff");
+
+  // Connection to 11:22:33:44:55:66 on handle 0x0040
+  std::string peer = Hex("665544332211");
+  corpus.push_back(std::string("\x01", 1) + U16(HCI_LE_CREATE_CONN) + static_cast<char>(0x19) +
+                   Hex("600030000000") + peer + Hex("00") + U16(0x0018) + U16(0x0028) + U16(0) + U16(0x01F4) + U16(0) + U16(0));
+  corpus.push_back(LeMeta(HCI_EV_LE_CONN_COMPLETE, Hex("00") + U16(0x0040) + Hex("0000") + peer + U16(0x0028) + U16(0) + U16(0x01F4) + Hex("00")));
+
+  // Extended connection to 11:22:33:44:55:67 on handle 0x0041, one initiating PHY
+  std::string peer2 = Hex("675544332211");
+  corpus.push_back(std::string("\x01", 1) + U16(HCI_LE_EXT_CREATE_CONN) + static_cast<char>(0x1A) + Hex("000000") + peer2 + Hex("01") +
+                   U16(0x0060) + U16(0x0030) + U16(0x0018) + U16(0x0028) + U16(0) + U16(0x01F4) + U16(0) + U16(0));
+  corpus.push_back(LeMeta(HCI_EV_LE_ENH_CONN_COMPLETE, Hex("00") + U16(0x0041) + Hex("0000") + peer2 + std::string(12, '\0') +
+                          U16(0x0028) + U16(0) + U16(0x01F4) + Hex("00")));
+
+  for (int i = 0; i < 64; i++) {
+    std::string address = Hex("a0b0c0d0e0") + static_cast<char>(i);
+
+    // Legacy report
+    corpus.push_back(LeMeta(HCI_EV_LE_ADVERTISING_REPORT, Hex("0100") + Hex("00") + address +
+                            static_cast<char>(adData.length()) + adData + static_cast<char>(-40 - (i % 30))));
+
+    // Extended report in two fragments
+    std::string ext = Hex("01") + U16(0x0020 | 0x0001) + Hex("01") + address + Hex("010000") + Hex("7f") +
+                      static_cast<char>(-50 - (i % 20)) + U16(0) + Hex("00000000000000");
+    corpus.push_back(LeMeta(HCI_EV_LE_EXT_ADVERTISING_REPORT, ext + static_cast<char>(adData.length()) + adData));
+    ext[1] = 0x01;
+    corpus.push_back(LeMeta(HCI_EV_LE_EXT_ADVERTISING_REPORT, ext + static_cast<char>(adData.length()) + adData));
+
+    // Notification on the subscribed attribute, then flow control
+    if (i % 4 == 0) {
+      std::string att = Hex("1b") + U16(0x002a) + Hex("0102030405060708");
+      corpus.push_back(std::string("\x02", 1) + U16(0x2040) + U16(att.length() + 4) + U16(att.length()) + U16(0x0004) + att);
+      corpus.push_back(Event(HCI_EV_NUM_COMP_PKTS, Hex("01") + U16(0x0040) + U16(1)));
+    }
+
+    // Complete ISO SDU on a CIS
+    if (i % 8 == 0) {
+      std::string sdu(40, static_cast<char>(i));
+      corpus.push_back(std::string("\x05", 1) + U16(0x2060) + U16(sdu.length() + 4) + U16(i) + U16(sdu.length()) + sdu);
+    }
+  }
+
+  corpus.push_back(Event(HCI_EV_DISCONN_COMPLETE, Hex("00") + U16(0x0040) + Hex("13")));
+  corpus.push_back(Event(HCI_EV_DISCONN_COMPLETE, Hex("00") + U16(0x0041) + Hex("13")));
+  return corpus;
+}
+
+// Layout sizes are the spec's parameter lengths plus the H4 and event or command headers
+static_assert(HciLeConnCompleteLayout::size == 3 + 19, "LE Connection Complete");
+static_assert(HciLeEnhConnCompleteLayout::size == 3 + 31, "LE Enhanced Connection Complete");
+static_assert(HciDisconnCompleteLayout::size == 3 + 4, "Disconnection Complete");
+static_assert(HciLeAdvReportLayout::size == 3 + 10, "LE Advertising Report, first report's address");
+static_assert(HciLeExtAdvReportLayout::size == 3 + 11, "LE Extended Advertising Report, first report's address");
+static_assert(HciLeDirectAdvReportLayout::size == 3 + 10, "LE Directed Advertising Report, first report's address");
+static_assert(HciLeCreateConnLayout::size == 4 + 25, "LE Create Connection");
+static_assert(HciLeExtCreateConnLayout::size == 4 + 26, "LE Extended Create Connection, one PHY");
+
+static uint16_t RawU16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+// Hand-indexed parsers the layouts replaced, kept as the reference for parity and speed.
+// Not inlined, so they are called like the library's parsers in their own translation unit.
+__attribute__((noinline)) static bool RawParseLinkEvent(const uint8_t* data, size_t length, HciLinkEvent& event) {
+  if (length < 4 || data[0] != HCI_EVENT_PKT || length < 3u + data[2]) {
+    return false;
+  }
+  uint8_t plen = data[2];
+  if (data[1] == HCI_EV_LE_META && plen >= 3) {
+    if ((data[3] == HCI_EV_LE_CONN_COMPLETE && plen >= 19 && data[4] == HCI_SUCCESS) ||
+        (data[3] == HCI_EV_LE_ENH_CONN_COMPLETE && plen >= 31 && data[4] == HCI_SUCCESS)) {
+      event.type = HciLinkEvent::Connected;
+      event.handle = RawU16(data + 5) & 0x0FFF;
+      event.peerType = data[8];
+      memcpy(event.peer.b, data + 9, sizeof(event.peer.b));
+      return true;
+    }
+  } else if (data[1] == HCI_EV_DISCONN_COMPLETE && plen >= 4 && data[3] == HCI_SUCCESS) {
+    event.type = HciLinkEvent::Disconnected;
+    event.handle = RawU16(data + 4) & 0x0FFF;
+    event.peerType = 0;
+    memset(event.peer.b, 0, sizeof(event.peer.b));
+    return true;
+  }
+  return false;
+}
+
+__attribute__((noinline)) static bool RawParseCreateConnection(const uint8_t* data, size_t length, HciCreateConnection& command) {
+  if (length < 4 || data[0] != HCI_COMMAND_PKT || length < 4u + data[3]) {
+    return false;
+  }
+  uint16_t opcode = RawU16(data + 1);
+  if (opcode == HCI_LE_CREATE_CONN && data[3] >= 0x19) {
+    command.peerType = data[9];
+    memcpy(command.peer.b, data + 10, sizeof(command.peer.b));
+    command.filterPolicy = data[8];
+    command.connMinInterval = RawU16(data + 17);
+    command.connMaxInterval = RawU16(data + 19);
+    command.connLatency = RawU16(data + 21);
+    command.supervisionTimeout = RawU16(data + 23);
+    return true;
+  }
+  if (opcode == HCI_LE_EXT_CREATE_CONN && data[3] >= 0x1A) {
+    command.peerType = data[6];
+    memcpy(command.peer.b, data + 7, sizeof(command.peer.b));
+    command.filterPolicy = data[4];
+    command.connMinInterval = RawU16(data + 18);
+    command.connMaxInterval = RawU16(data + 20);
+    command.connLatency = RawU16(data + 22);
+    command.supervisionTimeout = RawU16(data + 24);
+    return true;
+  }
+  return false;
+}
+
+// Compares both parsers on every packet and every truncation of it; returns the mismatches
+static size_t CheckLinkParserParity(const Corpus& corpus, size_t& cases) {
+  size_t mismatches = 0;
+  for (const std::string& packet : corpus) {
+    for (size_t length = 0; length <= packet.length(); length++) {
+      // An exact-size copy, so a read past the end is caught by sanitizers
+      std::vector<uint8_t> bytes(packet.begin(), packet.begin() + length);
+      HciLinkEvent event = {}, rawEvent = {};
+      HciCreateConnection command = {}, rawCommand = {};
+
+      bool linked = BluetoothHciLinkParser::ParseLinkEvent(bytes.data(), length, event);
+      bool rawLinked = RawParseLinkEvent(bytes.data(), length, rawEvent);
+      bool created = BluetoothHciLinkParser::ParseCreateConnection(bytes.data(), length, command);
+      bool rawCreated = RawParseCreateConnection(bytes.data(), length, rawCommand);
+
+      mismatches += linked != rawLinked || (linked && (event.type != rawEvent.type || event.handle != rawEvent.handle ||
+        event.peerType != rawEvent.peerType || memcmp(event.peer.b, rawEvent.peer.b, 6)));
+      mismatches += created != rawCreated || (created && (command.peerType != rawCommand.peerType ||
+        command.filterPolicy != rawCommand.filterPolicy ||
+        memcmp(command.peer.b, rawCommand.peer.b, 6) || command.connMinInterval != rawCommand.connMinInterval ||
+        command.connMaxInterval != rawCommand.connMaxInterval || command.connLatency != rawCommand.connLatency ||
+        command.supervisionTimeout != rawCommand.supervisionTimeout));
+      cases++;
+    }
+  }
+  return mismatches;
+}
+
+static uint32_t ReadU32BE(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// btsnoop: 16 byte header, then records of original length, included length, flags, drops, time stamp
+static bool LoadBtsnoop(const char* path, Corpus& corpus) {
+  std::ifstream file(path, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(content.data());
+
+  if (content.length() < 16 || memcmp(p, "btsnoop\0", 8) != 0) {
+    fprintf(stderr, "%s: not a btsnoop file\n", path);
+    return false;
+  }
+
+  uint32_t datalink = ReadU32BE(p + 12);
+  if (datalink != 1001 && datalink != 1002) {
+    fprintf(stderr, "%s: unsupported datalink %u\n", path, datalink);
+    return false;
+  }
+
+  for (size_t offset = 16; offset + 24 <= content.length();) {
+    uint32_t included = ReadU32BE(p + offset + 4);
+    uint32_t flags = ReadU32BE(p + offset + 8);
+    offset += 24;
+    if (offset + included > content.length()) {
+      break;
+    }
+
+    std::string packet(reinterpret_cast<const char*>(p + offset), included);
+    if (datalink == 1001) {
+      // Unencapsulated: bit 1 marks commands and events, bit 0 the direction
+      char type = (flags & 0x02) ? ((flags & 0x01) ? HCI_EVENT_PKT : HCI_COMMAND_PKT) : HCI_ACLDATA_PKT;
+      packet.insert(packet.begin(), type);
+    }
+    if (!packet.empty()) {
+      corpus.push_back(std::move(packet));
+    }
+    offset += included;
+  }
+  return true;
+}
+
+// IRK list and addresses of the resolver stages; a "packet" is one uncached address
+static constexpr size_t kRpaKeys = 1024;
+static constexpr size_t kRpaAddresses = 32;
+
+static std::vector<BluetoothHciRpaResolver::Key> RpaKeys() {
+  std::vector<BluetoothHciRpaResolver::Key> keys(kRpaKeys);
+  uint32_t state = 0x2545F491;
+  for (BluetoothHciRpaResolver::Key& key : keys) {
+    for (uint8_t& octet : key) {
+      state = state * 1664525 + 1013904223;
+      octet = static_cast<uint8_t>(state >> 24);
+    }
+  }
+  return keys;
+}
+
+// Every other address resolves, to a key spread over the list; the rest scan it all
+static std::vector<bdaddr_t> RpaAddresses(const std::vector<BluetoothHciRpaResolver::Key>& keys) {
+  std::vector<bdaddr_t> addresses(kRpaAddresses);
+  for (size_t i = 0; i < addresses.size(); i++) {
+    uint32_t prand = 0x400000 | ((i * 0x9E3779u) & 0x3FFFFF);
+    uint32_t hash = i % 2 ? BluetoothHciRpaResolver::Ah(keys[(i * 97) % keys.size()], prand) : (i * 0x51ED27u) & 0xFFFFFF;
+    uint8_t* b = addresses[i].b;
+    b[0] = hash; b[1] = hash >> 8; b[2] = hash >> 16;
+    b[3] = prand; b[4] = prand >> 8; b[5] = prand >> 16;
+  }
+  return addresses;
+}
+
+// The spec's sample data (Core Vol 3 Part H D.7), then backend parity over the address set
+static size_t CheckRpaResolver(const std::vector<BluetoothHciRpaResolver::Key>& keys, const std::vector<bdaddr_t>& addresses) {
+  size_t mismatches = 0;
+  BluetoothHciRpaResolver::Key irk = { 0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05, 0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b };
+  mismatches += BluetoothHciRpaResolver::Ah(irk, 0x708194) != 0x0dfbaa;
+
+  BluetoothHciRpaResolver accelerated(true);
+  BluetoothHciRpaResolver portable(false);
+  accelerated.setKeys(keys, 0, 0);
+  portable.setKeys(keys, 0, 0);
+  for (size_t i = 0; i < addresses.size(); i++) {
+    HciRpaMatch a = accelerated.resolve(addresses[i], 0);
+    HciRpaMatch p = portable.resolve(addresses[i], 0);
+    mismatches += a.index != p.index;
+    mismatches += (i % 2 == 1) && p.index != static_cast<int32_t>((i * 97) % keys.size());
+  }
+  return mismatches;
+}
+
+struct Stage {
+  const char* name;
+  double allocationBudget;   ///< Allowed allocations per packet in --check mode, < 0 for none
+  std::function<size_t()> pass;  ///< One pass over the corpus, returns packets processed
+};
+
+static const uint8_t* Bytes(const std::string& s) {
+  return reinterpret_cast<const uint8_t*>(s.data());
+}
+
+// Catalog of the matcher stage: decoys that never match, plus slices of the corpus's AD structures
+static constexpr size_t kAdDecoys = 4096;
+
+// Advertising data of every report of a legacy or extended advertising report event
+static std::vector<std::string> ReportData(const std::string& packet) {
+  std::vector<std::string> reports;
+  const uint8_t* p = Bytes(packet);
+  if (packet.length() < 5 || p[0] != HCI_EVENT_PKT || p[1] != HCI_EV_LE_META) {
+    return reports;
+  }
+  size_t header = p[3] == HCI_EV_LE_ADVERTISING_REPORT ? 9 : p[3] == HCI_EV_LE_EXT_ADVERTISING_REPORT ? 24 : 0;
+  size_t offset = 5;
+  for (uint8_t i = 0; header && i < p[4] && offset + header <= packet.length(); i++) {
+    size_t length = p[offset + header - 1];
+    if (offset + header + length > packet.length()) {
+      break;
+    }
+    reports.push_back(packet.substr(offset + header, length));
+    offset += header + length + (header == 9 ? 1 : 0);
+  }
+  return reports;
+}
+
+static std::vector<HciAdPattern> AdPatterns(const Corpus& corpus) {
+  std::vector<HciAdPattern> patterns;
+  uint32_t state = 0x6B8B4567;
+  for (size_t i = 0; i < kAdDecoys; i++) {
+    // iBeacon proximity UUIDs and 16-bit service data UUIDs
+    HciAdPattern pattern = { static_cast<uint32_t>(i), static_cast<uint8_t>(i % 2 ? 0xFF : 0x16), i % 2 ? Hex("4c000215") : "", 0 };
+    for (size_t j = 0; j < (i % 2 ? 16 : 2); j++) {
+      state = state * 1664525 + 1013904223;
+      pattern.value.push_back(static_cast<char>(0xF0 | (state >> 28)));
+    }
+    patterns.push_back(pattern);
+  }
+
+  uint32_t id = kAdDecoys;
+  for (const std::string& packet : corpus) {
+    for (const std::string& adv : ReportData(packet)) {
+      for (size_t i = 0; i + 2 < adv.length() && adv[i] != 0; i += 1 + static_cast<uint8_t>(adv[i])) {
+        std::string value = adv.substr(i + 2, static_cast<uint8_t>(adv[i]) - 1);
+        patterns.push_back({ id++, static_cast<uint8_t>(adv[i + 1]), value.substr(0, 4), 0 });
+        if (value.length() > 2) {
+          patterns.push_back({ id++, static_cast<uint8_t>(adv[i + 1]), value.substr(1, 2), -1 });
+        }
+      }
+    }
+    if (id > kAdDecoys) {
+      break;  // The synthetic reports all carry the same data
+    }
+  }
+  return patterns;
+}
+
+// Every pattern tried at every offset of every AD structure of the same type
+static std::vector<uint32_t> AdReference(const std::vector<HciAdPattern>& patterns, const std::string& adv) {
+  std::vector<uint32_t> ids;
+  for (size_t i = 0; i < adv.length() && adv[i] != 0 && i + 1 + static_cast<uint8_t>(adv[i]) <= adv.length();
+       i += 1 + static_cast<uint8_t>(adv[i])) {
+    std::string value = adv.substr(i + 2, static_cast<uint8_t>(adv[i]) - 1);
+    for (const HciAdPattern& pattern : patterns) {
+      if (pattern.type != static_cast<uint8_t>(adv[i + 1])) {
+        continue;
+      }
+      bool anchored = pattern.offset >= 0;
+      if (anchored ? static_cast<size_t>(pattern.offset) + pattern.value.length() <= value.length() &&
+                     value.compare(pattern.offset, pattern.value.length(), pattern.value) == 0
+                   : value.find(pattern.value) != std::string::npos) {
+        ids.push_back(pattern.id);
+      }
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return ids;
+}
+
+// The corpus's reports, then random AD structures over a small alphabet so patterns overlap
+static size_t CheckAdMatcher(const Corpus& corpus, const std::vector<HciAdPattern>& patterns, size_t& cases) {
+  BluetoothHciAdMatcher matcher(patterns);
+  std::vector<uint32_t> ids;
+  size_t mismatches = 0;
+
+  for (const std::string& packet : corpus) {
+    for (const std::string& adv : ReportData(packet)) {
+      matcher.match(Bytes(adv), adv.length(), ids);
+      mismatches += ids != AdReference(patterns, adv);
+      cases++;
+    }
+  }
+
+  std::vector<HciAdPattern> small;
+  uint32_t state = 0x2F6B5A71;
+  auto next = [&state]() { state = state * 1664525 + 1013904223; return state >> 16; };
+  for (uint32_t i = 0; i < 300; i++) {
+    HciAdPattern pattern = { i % 200, static_cast<uint8_t>(next() % 3), "", next() % 3 == 0 ? -1 : static_cast<int32_t>(next() % 5) };
+    for (uint32_t j = 0, length = 1 + next() % 4; j < length; j++) {
+      pattern.value.push_back("ab\x01\x02"[next() % 4]);
+    }
+    small.push_back(pattern);
+  }
+  BluetoothHciAdMatcher smallMatcher(small);
+  for (int i = 0; i < 2000; i++) {
+    std::string adv;
+    while (adv.length() < 40) {
+      size_t length = next() % 10;
+      adv.push_back(static_cast<char>(length + 1));
+      adv.push_back(static_cast<char>(next() % 3));
+      for (size_t j = 0; j < length; j++) {
+        adv.push_back("ab\x01\x02x"[next() % 5]);
+      }
+    }
+    smallMatcher.match(Bytes(adv), adv.length(), ids);
+    mismatches += ids != AdReference(small, adv);
+    cases++;
+  }
+  return mismatches;
+}
+
+// Fields of an encoded advertisement as the observation store keeps them
+static bool SameObservation(const HciObservation& observation, const std::string& advertisement, uint64_t time) {
+  const uint8_t* e = Bytes(advertisement);
+  size_t dataOffset = HciAdvertisementLayout::HeaderLength + e[HciAdvertisementLayout::AdCount] * HciAdvertisementLayout::EntryLength;
+  return observation.time == time && observation.addressType == e[HciAdvertisementLayout::AddressType] &&
+         !memcmp(observation.address, e + HciAdvertisementLayout::Address, 6) &&
+         observation.rssi == static_cast<int8_t>(e[HciAdvertisementLayout::Rssi]) &&
+         observation.data == advertisement.substr(dataOffset);
+}
+
+// Appends the advertisements across many small segments, then reads them back whole and per device, before and after reopening
+static size_t CheckObservationStore(const Corpus& encoded, const std::string& directory, size_t& cases) {
+  BluetoothHciObservationStore::Options options;
+  options.segmentDuration = 1000;
+  options.segmentSize = 64 << 10;
+  BluetoothHciObservationStore store;
+  if (store.open(directory, options, 0) != 0) {
+    return 1;
+  }
+
+  std::vector<std::pair<uint64_t, const std::string*>> appended;
+  for (int round = 0; round < 40; round++) {
+    for (const std::string& advertisement : encoded) {
+      uint64_t time = 1000000 + appended.size() * 7;
+      store.append(advertisement, time);
+      appended.push_back({ time, &advertisement });
+    }
+  }
+
+  size_t mismatches = 0;
+  std::vector<HciObservation> observations;
+  for (int reopened = 0; reopened < 2; reopened++) {
+    HciObservationQuery all;
+    store.query(all, observations);
+    mismatches += observations.size() != appended.size();
+    for (size_t i = 0; i < observations.size() && i < appended.size(); i++) {
+      mismatches += !SameObservation(observations[i], *appended[i].second, appended[i].first);
+    }
+    cases += appended.size();
+
+    // One device over the middle third
+    HciObservationQuery device;
+    memcpy(device.address, Bytes(encoded[0]) + HciAdvertisementLayout::Address, 6);
+    device.byAddress = true;
+    device.from = appended[appended.size() / 3].first;
+    device.to = appended[2 * appended.size() / 3].first;
+    store.query(device, observations);
+    size_t expected = 0;
+    for (const auto& entry : appended) {
+      if (entry.first >= device.from && entry.first < device.to &&
+          !memcmp(Bytes(*entry.second) + HciAdvertisementLayout::Address, device.address, 6)) {
+        mismatches += expected >= observations.size() || !SameObservation(observations[expected], *entry.second, entry.first);
+        expected++;
+      }
+    }
+    mismatches += observations.size() != expected;
+    cases += expected;
+
+    store.close();
+    store.open(directory, options, 0);
+  }
+  store.close();
+  return mismatches;
+}
+
+// Device of the simulated connect storm, advertising every interval ms from its phase
+struct StormDevice {
+  bdaddr_t address;
+  uint64_t interval;
+  uint64_t phase;
+  bool present;     ///< Whether it advertises at all
+  bool advertises(uint64_t now) const { return this->present && now >= this->phase && (now - this->phase) % this->interval == 0; }
+};
+
+// Connects to a fleet through a simulated controller holding one pending initiation and an 8 entry accept list,
+// answering each command a ms later; compares the time to settle the fleet with direct connects one at a time
+static size_t CheckConnectScheduler(size_t& devices, uint64_t& fleetTime, uint64_t& sequentialTime) {
+  std::vector<StormDevice> fleet(60);
+  uint32_t seed = 49;
+  auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7FFF; };
+  std::vector<HciConnectTarget> targets;
+  for (size_t i = 0; i < fleet.size(); i++) {
+    StormDevice& device = fleet[i];
+    memcpy(device.address.b, "\x00\x00\x00\x00\xc1", 5);
+    device.address.b[5] = static_cast<uint8_t>(i);
+    device.interval = 100 + next() % 900;
+    device.phase = 1000 + next() % device.interval;
+    device.present = i % 15 != 7;
+    targets.push_back({ 0x00, device.address, 0, 0 });
+  }
+  devices = fleet.size();
+
+  BluetoothHciConnectScheduler::Options options;
+  options.timeout = 2000;
+  options.attempts = 2;
+  BluetoothHciConnectScheduler scheduler;
+  scheduler.connect(targets, options, 1000);
+
+  std::vector<uint64_t> list;
+  bool initiating = false;
+  std::vector<std::pair<uint64_t, std::string>> events;   // Due time, event
+  std::vector<std::string> commands;
+  std::vector<HciConnectResult> results;
+  std::vector<bool> connected(fleet.size(), false);
+  uint16_t handle = 0x0040;
+  auto key = [](const uint8_t* address) {
+    uint64_t k = 0;
+    memcpy(&k, address, 6);
+    return k;
+  };
+
+  uint64_t now = 1000;
+  for (; now < 120000 && results.size() < fleet.size(); now++) {
+    // Events due now, in the order they were raised
+    for (size_t i = 0; i < events.size();) {
+      if (events[i].first <= now) {
+        scheduler.observeEvent(Bytes(events[i].second), events[i].second.length(), now);
+        events.erase(events.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    commands.clear();
+    scheduler.take(commands, now);
+    for (const std::string& command : commands) {
+      const uint8_t* c = Bytes(command);
+      uint16_t opcode = RawU16(c + 1);
+      uint8_t status = HCI_SUCCESS;
+      std::string params;
+      if (opcode == HCI_LE_CREATE_CONN) {
+        status = initiating ? HCI_ERR_COMMAND_DISALLOWED : HCI_SUCCESS;
+        initiating = true;
+        events.push_back({ now + 1, Event(HCI_EV_CMD_STATUS, std::string(1, static_cast<char>(status)) + "\x01" + U16(opcode)) });
+        continue;
+      }
+      if (opcode == HCI_LE_READ_ACCEPT_LIST_SIZE) {
+        params = "\x08";
+      } else if (opcode == HCI_LE_CLEAR_ACCEPT_LIST) {
+        list.clear();
+      } else if (opcode == HCI_LE_ADD_TO_ACCEPT_LIST) {
+        status = list.size() >= 8 ? HCI_ERR_MEMORY_EXCEEDED : HCI_SUCCESS;
+        if (status == HCI_SUCCESS && std::find(list.begin(), list.end(), key(c + 5)) == list.end()) {
+          list.push_back(key(c + 5));
+        }
+      } else if (opcode == HCI_LE_DEL_FROM_ACCEPT_LIST) {
+        list.erase(std::remove(list.begin(), list.end(), key(c + 5)), list.end());
+      } else if (opcode == HCI_LE_CREATE_CONN_CANCEL) {
+        status = initiating ? HCI_SUCCESS : HCI_ERR_COMMAND_DISALLOWED;
+      }
+      events.push_back({ now + 1, Event(HCI_EV_CMD_COMPLETE, "\x01" + U16(opcode) + static_cast<char>(status) + params) });
+      if (opcode == HCI_LE_CREATE_CONN_CANCEL && initiating) {
+        initiating = false;
+        events.push_back({ now + 1, LeMeta(HCI_EV_LE_CONN_COMPLETE, std::string(1, HCI_ERR_UNKNOWN_CONN_ID) + std::string(17, '\0')) });
+      }
+    }
+
+    // The first listed device advertising connects
+    for (size_t i = 0; initiating && i < fleet.size(); i++) {
+      if (!connected[i] && fleet[i].advertises(now) &&
+          std::find(list.begin(), list.end(), key(fleet[i].address.b)) != list.end()) {
+        connected[i] = true;
+        initiating = false;
+        events.push_back({ now + 2, LeMeta(HCI_EV_LE_CONN_COMPLETE, Hex("00") + U16(handle++) + Hex("0000") +
+                                             std::string(reinterpret_cast<const char*>(fleet[i].address.b), 6) +
+                                             U16(0x0006) + U16(0) + U16(0x00C8) + Hex("00")) });
+      }
+    }
+    scheduler.results(results);
+  }
+  fleetTime = now - 1000;
+
+  // Present devices connect, absent ones time out on every attempt
+  size_t mismatches = results.size() != fleet.size();
+  for (const HciConnectResult& result : results) {
+    const StormDevice& device = fleet[result.address.b[5]];
+    mismatches += device.present ? result.outcome != HciConnectResult::Connected :
+                                   result.outcome != HciConnectResult::Timeout || result.attempts != options.attempts;
+  }
+
+  // One at a time: a create and its completion, then the device's next advertisement or the timeouts
+  uint64_t t = 1000;
+  for (const StormDevice& device : fleet) {
+    for (uint32_t attempt = 0; attempt < options.attempts; attempt++) {
+      t += 2;
+      if (device.present) {
+        uint64_t wait = t < device.phase ? device.phase - t : (device.interval - (t - device.phase) % device.interval) % device.interval;
+        if (wait < options.timeout) {
+          t += wait + 2;
+          break;
+        }
+      }
+      t += options.timeout + 2;
+    }
+  }
+  sequentialTime = t - 1000;
+  return mismatches + (fleetTime >= sequentialTime);
+}
+
+#ifdef __linux__
+// One producer and two consumers on the smallest ring, one reading flat out and one in bursts the producer
+// laps; every record read must be intact and every packet published either read or counted lost
+static size_t CheckSharedRing(size_t& published, uint64_t (&lost)[2]) {
+  int error = 0;
+  std::unique_ptr<BluetoothHciSharedRing> broker = BluetoothHciSharedRing::Create(BluetoothHciSharedRing::kMinSize, error);
+  std::unique_ptr<BluetoothHciSharedRing> consumers[2];
+  HciRingCursor cursors[2];
+  int slots[2];
+  for (size_t i = 0; i < 2; i++) {
+    consumers[i] = broker ? BluetoothHciSharedRing::Attach(dup(broker->fd()), error) : nullptr;
+    slots[i] = consumers[i] ? consumers[i]->join(cursors[i]) : -1;
+    if (slots[i] < 0) {
+      return 1;
+    }
+  }
+
+  // Packet n carries n, then bytes derived from it; lengths vary so records end at every offset of a lap
+  const size_t packets = 200000;
+  auto length = [](uint64_t n) { return static_cast<size_t>(8 + (n * 37) % 300); };
+  auto byte = [](uint64_t n, size_t i) { return static_cast<uint8_t>(n * 131 + i * 7); };
+
+  struct Tally {
+    uint64_t expected = 0;  ///< Packet expected next
+    uint64_t read = 0;      ///< Intact packets read
+    uint64_t gaps = 0;      ///< Packets skipped over
+    size_t torn = 0;        ///< Records that were not a packet as published
+  };
+  Tally tallies[2];
+  std::function<bool(const uint8_t*, size_t)> verify[2];
+  for (size_t i = 0; i < 2; i++) {
+    Tally& tally = tallies[i];
+    verify[i] = [&tally, &length, &byte](const uint8_t* data, size_t size) {
+      uint64_t n = 0;
+      bool intact = size >= 8;
+      if (intact) {
+        memcpy(&n, data, 8);
+        intact = n >= tally.expected && size == length(n);
+      }
+      for (size_t j = 8; intact && j < size; j++) {
+        intact = data[j] == byte(n, j);
+      }
+      if (!intact) {
+        tally.torn++;
+        return true;
+      }
+      tally.gaps += n - tally.expected;
+      tally.expected = n + 1;
+      tally.read++;
+      return true;
+    };
+  }
+
+  auto consume = [&](size_t i) {
+    while (true) {
+      // Checked before reading, so everything published before the close is drained
+      bool closed = consumers[i]->closed();
+      size_t read = consumers[i]->read(slots[i], cursors[i], verify[i], i == 0 ? SIZE_MAX : 64);
+      if (read == 0 && closed) {
+        break;
+      }
+      if (read == 0) {
+        consumers[i]->waitPackets(cursors[i], 10);
+      } else if (i == 1) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+  };
+  std::thread fast(consume, 0);
+  std::thread bursty(consume, 1);
+
+  uint8_t packet[8 + 300];
+  for (uint64_t n = 0; n < packets; n++) {
+    memcpy(packet, &n, 8);
+    for (size_t j = 8; j < length(n); j++) {
+      packet[j] = byte(n, j);
+    }
+    broker->publish(packet, length(n));
+  }
+  broker->close();
+  fast.join();
+  bursty.join();
+
+  // The ring's own counters must agree with what the consumers saw
+  published = broker->published();
+  size_t mismatches = published != packets;
+  std::vector<HciRingConsumerInfo> infos = broker->consumers();
+  for (size_t i = 0; i < 2; i++) {
+    auto info = std::find_if(infos.begin(), infos.end(), [&](const HciRingConsumerInfo& c) { return c.slot == static_cast<uint32_t>(slots[i]); });
+    lost[i] = info != infos.end() ? info->lost : 0;
+    mismatches += tallies[i].torn;
+    mismatches += info == infos.end() || info->delivered != tallies[i].read || info->lost != tallies[i].gaps ||
+                  tallies[i].read + info->lost != packets;
+    consumers[i]->leave(slots[i]);
+  }
+
+  // The bursty consumer must have been lapped, or wraparound went untested
+  return mismatches + (lost[1] == 0);
+}
+#endif
+
+int main(int argc, char** argv) {
+  const char* corpusPath = nullptr;
+  int iterations = 200;
+  bool check = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+      corpusPath = argv[++i];
+    } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = true;
+    } else {
+      fprintf(stderr, "usage: %s [--corpus file.btsnoop] [--iterations n] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  Corpus corpus;
+  if (corpusPath == nullptr) {
+    corpus = SyntheticCorpus();
+  } else if (!LoadBtsnoop(corpusPath, corpus)) {
+    return 2;
+  }
+  if (corpus.empty() || iterations <= 0) {
+    fprintf(stderr, "nothing to run\n");
+    return 2;
+  }
+
+  // Inputs prepared outside the timed passes
+  std::string stream;
+  for (const std::string& packet : corpus) {
+    stream += packet;
+  }
+  Corpus encoded;
+  {
+    BluetoothHciAdvertisingAssembler assembler;
+    for (const std::string& packet : corpus) {
+      assembler.observe(Bytes(packet), packet.length(), [&](std::string advertisement) {
+        encoded.push_back(std::move(advertisement));
+      });
+    }
+  }
+
+  BluetoothHciPacketFramer framer;
+  BluetoothHciConnectionRouter router;
+  BluetoothHciAdvertisingAssembler assembler;
+  BluetoothHciScanTable scanTable;
+  BluetoothHciScanTable::Options scanOptions;
+  scanTable.enable(scanOptions);
+  BluetoothHciAdvertisingColumns columns;
+  std::vector<uint8_t> columnBuffer;
+  BluetoothHciAttRouter attRouter;
+  attRouter.subscribe(0x0040, 0x002a);
+  std::vector<HciAttValue> attValues;
+  BluetoothHciIsoAssembler iso;
+  std::vector<BluetoothHciRpaResolver::Key> rpaKeys = RpaKeys();
+  std::vector<bdaddr_t> rpaAddresses = RpaAddresses(rpaKeys);
+  BluetoothHciRpaResolver rpaAccelerated(true);
+  BluetoothHciRpaResolver rpaPortable(false);
+  BluetoothHciRpaResolver rpaCached(true);
+  rpaAccelerated.setKeys(rpaKeys, 0, 0);   // No cache: every lookup scans the list
+  rpaPortable.setKeys(rpaKeys, 0, 0);
+  rpaCached.setKeys(rpaKeys, kRpaAddresses, 60000);
+  // Every other synthetic advertiser is a target, among decoys that are never seen
+  BluetoothHciAcceptList acceptList;
+  std::vector<HciAcceptTarget> acceptTargets(256);
+  for (size_t i = 0; i < acceptTargets.size(); i++) {
+    HciAcceptTarget& target = acceptTargets[i];
+    memcpy(target.address.b, i < 32 ? "\xa0\xb0\xc0\xd0\xe0" : "\x00\x00\x00\x00\xc0", 5);
+    target.address.b[5] = static_cast<uint8_t>(i < 32 ? i * 2 : i);
+    target.type = 0x00;
+    target.priority = 0;
+  }
+  acceptList.setTargets(acceptTargets, BluetoothHciAcceptList::Options(), 0);
+  std::vector<HciAdPattern> adPatterns = AdPatterns(corpus);
+  BluetoothHciAdMatcher adMatcher(adPatterns);
+  std::vector<uint32_t> adIds;
+  adIds.reserve(64);
+  // Segments go to a scratch directory, removed on exit
+  char scratch[] = "/tmp/hci_bench.XXXXXX";
+  std::string storeDirectory = mkdtemp(scratch) != nullptr ? scratch : "";
+  BluetoothHciObservationStore observations;
+  uint64_t observationTime = 1000000;
+  if (!storeDirectory.empty()) {
+    observations.open(storeDirectory + "/append", BluetoothHciObservationStore::Options(), 0);
+  }
+  std::vector<HciObservation> observed;
+  HciObservationQuery deviceQuery;
+  if (!encoded.empty()) {
+    memcpy(deviceQuery.address, Bytes(encoded[0]) + HciAdvertisementLayout::Address, 6);
+    deviceQuery.byAddress = true;
+    deviceQuery.limit = 64;
+  }
+
+  std::vector<Stage> stages = {
+    { "framer", 0, [&]() {
+      // Chunked like USB bulk transfers
+      size_t packets = 0;
+      for (size_t offset = 0; offset < stream.length(); offset += 64) {
+        size_t chunk = std::min<size_t>(64, stream.length() - offset);
+        packets += framer.push(Bytes(stream) + offset, chunk, [](uint8_t, const uint8_t*, size_t) {});
+      }
+      return packets;
+    } },
+    { "link-parser", 0, [&]() {
+      size_t links = 0;
+      for (const std::string& packet : corpus) {
+        HciLinkEvent event;
+        HciCreateConnection command;
+        links += BluetoothHciLinkParser::ParseLinkEvent(Bytes(packet), packet.length(), event);
+        links += BluetoothHciLinkParser::ParseCreateConnection(Bytes(packet), packet.length(), command);
+      }
+      g_sink = g_sink + links;
+      return corpus.size();
+    } },
+    { "link-parser-raw", 0, [&]() {
+      size_t links = 0;
+      for (const std::string& packet : corpus) {
+        HciLinkEvent event;
+        HciCreateConnection command;
+        links += RawParseLinkEvent(Bytes(packet), packet.length(), event);
+        links += RawParseCreateConnection(Bytes(packet), packet.length(), command);
+      }
+      g_sink = g_sink + links;
+      return corpus.size();
+    } },
+    { "connection-router", -1, [&]() {
+      for (const std::string& packet : corpus) {
+        router.observe(0, packet[0] == HCI_COMMAND_PKT, Bytes(packet), packet.length());
+      }
+      return corpus.size();
+    } },
+    { "advertising", -1, [&]() {
+      for (const std::string& packet : corpus) {
+        assembler.observe(Bytes(packet), packet.length(), [](std::string) {});
+      }
+      return corpus.size();
+    } },
+    { "scan-table", -1, [&]() {
+      for (const std::string& advertisement : encoded) {
+        scanTable.observe(advertisement);
+      }
+      return encoded.size();
+    } },
+    { "columns", -1, [&]() {
+      for (const std::string& advertisement : encoded) {
+        columns.append(advertisement);
+      }
+      columns.take([&](size_t size) {
+        columnBuffer.resize(size);
+        return columnBuffer.data();
+      });
+      return encoded.size();
+    } },
+    { "att-router", -1, [&]() {
+      for (const std::string& packet : corpus) {
+        attValues.clear();
+        attRouter.observe(Bytes(packet), packet.length(), attValues);
+        for (HciAttValue& value : attValues) {
+          attRouter.stage(std::move(value));
+        }
+      }
+      attRouter.take(1);
+      return corpus.size();
+    } },
+    { "iso", 0, [&]() {
+      for (const std::string& packet : corpus) {
+        iso.observe(Bytes(packet), packet.length(), [](HciIsoSdu&) {});
+      }
+      return corpus.size();
+    } },
+    { rpaAccelerated.backend()[0] == 'a' ? "rpa-scan-aesni" : "rpa-scan (no aes)", 0, [&]() {
+      size_t resolved = 0;
+      for (const bdaddr_t& address : rpaAddresses) {
+        resolved += static_cast<bool>(rpaAccelerated.resolve(address, 0));
+      }
+      g_sink = g_sink + resolved;
+      return rpaAddresses.size();
+    } },
+    { "rpa-scan-portable", 0, [&]() {
+      size_t resolved = 0;
+      for (const bdaddr_t& address : rpaAddresses) {
+        resolved += static_cast<bool>(rpaPortable.resolve(address, 0));
+      }
+      g_sink = g_sink + resolved;
+      return rpaAddresses.size();
+    } },
+    { "accept-list", 0, [&]() {
+      for (const std::string& packet : corpus) {
+        g_sink = g_sink + acceptList.observeEvent(Bytes(packet), packet.length(), 1);
+      }
+      return corpus.size();
+    } },
+    { "obs-append", 0.05, [&]() {
+      for (const std::string& advertisement : encoded) {
+        observations.append(advertisement, observationTime++);
+      }
+      return observations.isOpen() ? encoded.size() : 0;
+    } },
+    { "obs-query", -1, [&]() {
+      // Up to 64 of one device's observations from the recent ones, timed per observation returned
+      deviceQuery.from = observationTime > 100000 ? observationTime - 100000 : 0;
+      observations.query(deviceQuery, observed);
+      g_sink = g_sink + observed.size();
+      return observations.isOpen() ? observed.size() : 0;
+    } },
+    { "ad-match", 0, [&]() {
+      for (const std::string& packet : corpus) {
+        adMatcher.matchReports(Bytes(packet), packet.length(), adIds);
+        g_sink = g_sink + adIds.size();
+      }
+      return corpus.size();
+    } },
+    { "rpa-cached", 0, [&]() {
+      size_t resolved = 0;
+      for (const bdaddr_t& address : rpaAddresses) {
+        resolved += static_cast<bool>(rpaCached.resolve(address, 1));
+      }
+      g_sink = g_sink + resolved;
+      return rpaAddresses.size();
+    } }
+  };
+
+  printf("%zu packets (%s), %d iterations\n\n", corpus.size(), corpusPath ? corpusPath : "synthetic", iterations);
+
+  int failures = 0;
+  if (check) {
+    size_t cases = 0;
+    size_t mismatches = CheckLinkParserParity(corpus, cases);
+    printf("%-18s %zu truncations, %zu mismatches%s\n\n", "layout parity", cases, mismatches, mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+
+    cases = 0;
+    mismatches = CheckAdMatcher(corpus, adPatterns, cases);
+    printf("%-18s %zu patterns, %zu states, %zu cases, %zu mismatches%s\n\n", "ad-match parity", adMatcher.patterns(),
+           adMatcher.states(), cases, mismatches, mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+
+    mismatches = CheckRpaResolver(rpaKeys, rpaAddresses);
+    printf("%-18s %zu addresses x %zu irks (%s), %zu mismatches%s\n\n", "rpa parity", rpaAddresses.size(), rpaKeys.size(),
+           rpaAccelerated.backend(), mismatches, mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+
+    cases = 0;
+    mismatches = storeDirectory.empty() ? 1 : CheckObservationStore(encoded, storeDirectory + "/check", cases);
+    printf("%-18s %zu observations, %zu mismatches%s\n\n", "obs parity", cases, mismatches, mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+
+    uint64_t fleetTime = 0, sequentialTime = 0;
+    mismatches = CheckConnectScheduler(cases, fleetTime, sequentialTime);
+    printf("%-18s %zu devices settled in %llu ms, %llu ms one at a time, %zu mismatches%s\n\n", "connect storm", cases,
+           static_cast<unsigned long long>(fleetTime), static_cast<unsigned long long>(sequentialTime), mismatches,
+           mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+
+#ifdef __linux__
+    uint64_t lost[2] = { 0, 0 };
+    mismatches = CheckSharedRing(cases, lost);
+    printf("%-18s %zu packets, %llu and %llu lost by 2 consumers, %zu mismatches%s\n\n", "ring wraparound", cases,
+           static_cast<unsigned long long>(lost[0]), static_cast<unsigned long long>(lost[1]), mismatches,
+           mismatches ? "  FAILED" : "");
+    failures += mismatches != 0;
+#endif
+  }
+  printf("%-18s %12s %12s\n", "stage", "ns/packet", "allocs/pkt");
+
+  for (Stage& stage : stages) {
+    // One untimed pass so buffers and tables reach their steady state
+    if (stage.pass() == 0) {
+      printf("%-18s %12s %12s\n", stage.name, "-", "-");
+      continue;
+    }
+
+    size_t packets = 0;
+    size_t allocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      packets += stage.pass();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    double perPacket = static_cast<double>(g_allocations - allocations) / packets;
+
+    bool failed = check && stage.allocationBudget >= 0 && perPacket > stage.allocationBudget;
+    failures += failed;
+    printf("%-18s %12.1f %12.3f%s\n", stage.name, static_cast<double>(elapsed) / packets, perPacket, failed ? "  OVER BUDGET" : "");
+  }
+
+  observations.close();
+  if (!storeDirectory.empty()) {
+    std::error_code ignored;
+    std::filesystem::remove_all(storeDirectory, ignored);
+  }
+  return failures ? 1 : 0;
+}
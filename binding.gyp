@@ -1,6 +1,8 @@
 {
   'variables': {
-    'openssl_fips' : '' 
+    'openssl_fips' : '',
+    # BLUETOOTH_HCI_SOCKET_BENCH=1 also builds the native parser benchmark (bench/hci_bench.cpp)
+    'bench%': '<!(node -p "process.env.BLUETOOTH_HCI_SOCKET_BENCH || 0")'
   },
   "targets": [
     {
@@ -26,9 +28,17 @@
       },
       'conditions': [
         ['OS=="linux" or OS=="android" or OS=="freebsd"', {
+          'defines': [
+            'BLUETOOTH_HCI_SOCKET_NATIVE=1'
+          ],
           "sources": [ 
             "<!@(node -p \"require('fs').readdirSync('src').map(f=>'src/'+f).join(' ')\")"
           ]
+        }, { # other platforms only get the portable helpers used by the USB and UART drivers
+          "sources": [
+            "src/BluetoothHciAddon.cpp",
+            "src/BluetoothHciFramer.cpp"
+          ]
         }],
         ['OS=="win"', {
           'defines': [
@@ -46,6 +56,50 @@
           ],
         }]
       ],
-    }
+    },
+  ],
+  'conditions': [
+    ['bench==1 and OS!="win"', {
+      'targets': [
+        {
+          # Standalone executable: the pure parsers only, no Node or N-API
+          "target_name": "hci_bench",
+          "type": "executable",
+          "sources": [
+            "bench/hci_bench.cpp",
+            "src/BluetoothHciAcceptList.cpp",
+            "src/BluetoothHciAcceptListSync.cpp",
+            "src/BluetoothHciAdMatcher.cpp",
+            "src/BluetoothHciAdvertising.cpp",
+            "src/BluetoothHciAdvertisingColumns.cpp",
+            "src/BluetoothHciAttRouter.cpp",
+            "src/BluetoothHciConnectionRouter.cpp",
+            "src/BluetoothHciConnectScheduler.cpp",
+            "src/BluetoothHciIso.cpp",
+            "src/BluetoothHciLinkParser.cpp",
+            "src/BluetoothHciObservationStore.cpp",
+            "src/BluetoothHciRpaResolver.cpp",
+            "src/BluetoothHciScanTable.cpp"
+          ],
+          'include_dirs': [
+            "include"
+          ],
+          'conditions': [
+            ['OS=="linux" or OS=="android"', {
+              # memfd and futexes
+              "sources": [ "src/BluetoothHciSharedRing.cpp" ]
+            }]
+          ],
+          'cflags!': [ '-fno-exceptions' ],
+          'cflags_cc!': [ '-fno-exceptions' ],
+          'cflags_cc': [ '-O2' ],
+          'xcode_settings': {
+            'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',
+            'CLANG_CXX_LANGUAGE_STANDARD': 'c++20',
+            'MACOSX_DEPLOYMENT_TARGET': '12'
+          }
+        }
+      ]
+    }]
   ]
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+const BluetoothHciSocket = require('../index');
+
+const bluetoothHciSocket = new BluetoothHciSocket();
+
+// Extended advertising reports are reassembled and decoded natively
+bluetoothHciSocket.on('advertisement', function (adv) {
+  console.log('Advertisement');
+  console.log('\t' + adv.address + ' (' + adv.addressType + ')');
+  console.log('\tsid = ' + adv.sid + ', rssi = ' + adv.rssi + ', fragments = ' + adv.fragments + (adv.truncated ? ' (truncated)' : ''));
+  console.log('\tname = ' + adv.localName);
+  console.log('\tservices = ' + adv.serviceUuids.join(', '));
+  if (adv.manufacturerData) {
+    console.log('\tmanufacturer = ' + adv.manufacturerData.toString('hex'));
+  }
+});
+
+bluetoothHciSocket.on('error', function (error) {
+  console.error(error);
+});
+
+const HCI_COMMAND_PKT = 0x01;
+const OGF_HOST_CTL = 0x03;
+const OGF_LE_CTL = 0x08;
+
+const OCF_SET_EVENT_MASK = 0x0001;
+const OCF_LE_SET_EVENT_MASK = 0x0001;
+const OCF_LE_SET_EXT_SCAN_PARAMETERS = 0x0041;
+const OCF_LE_SET_EXT_SCAN_ENABLE = 0x0042;
+
+const SET_EVENT_MASK_CMD = OCF_SET_EVENT_MASK | (OGF_HOST_CTL << 10);
+const LE_SET_EVENT_MASK_CMD = OCF_LE_SET_EVENT_MASK | (OGF_LE_CTL << 10);
+const LE_SET_EXT_SCAN_PARAMETERS_CMD = OCF_LE_SET_EXT_SCAN_PARAMETERS | (OGF_LE_CTL << 10);
+const LE_SET_EXT_SCAN_ENABLE_CMD = OCF_LE_SET_EXT_SCAN_ENABLE | (OGF_LE_CTL << 10);
+
+function writeCommand (opcode, params) {
+  const cmd = Buffer.alloc(4 + params.length);
+
+  // header
+  cmd.writeUInt8(HCI_COMMAND_PKT, 0);
+  cmd.writeUInt16LE(opcode, 1);
+
+  // length
+  cmd.writeUInt8(params.length, 3);
+
+  params.copy(cmd, 4);
+  bluetoothHciSocket.write(cmd);
+}
+
+function setExtScanParameters () {
+  const params = Buffer.alloc(8);
+  params.writeUInt8(0x00, 0); // own address type: public
+  params.writeUInt8(0x00, 1); // filter: accept all
+  params.writeUInt8(0x01, 2); // scanning PHYs: LE 1M
+  params.writeUInt8(0x01, 3); // type: active
+  params.writeUInt16LE(0x0010, 4); // interval, ms * 1.6
+  params.writeUInt16LE(0x0010, 6); // window, ms * 1.6
+  writeCommand(LE_SET_EXT_SCAN_PARAMETERS_CMD, params);
+}
+
+function setExtScanEnable (enabled) {
+  const params = Buffer.alloc(6);
+  params.writeUInt8(enabled ? 0x01 : 0x00, 0);
+  params.writeUInt8(0x00, 1); // report duplicates
+  params.writeUInt16LE(0, 2); // duration: until disabled
+  params.writeUInt16LE(0, 4); // period
+  writeCommand(LE_SET_EXT_SCAN_ENABLE_CMD, params);
+}
+
+bluetoothHciSocket.bindRaw();
+bluetoothHciSocket.start();
+
+writeCommand(SET_EVENT_MASK_CMD, Buffer.from('fffffbff07f8bf3d', 'hex'));
+writeCommand(LE_SET_EVENT_MASK_CMD, Buffer.from('1fff000000000000', 'hex'));
+
+setExtScanEnable(false);
+setExtScanParameters();
+setExtScanEnable(true);
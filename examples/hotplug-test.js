@@ -0,0 +1,24 @@
+const BluetoothHciSocket = require('../index');
+
+const bluetoothHciSocket = new BluetoothHciSocket();
+
+bluetoothHciSocket.on('deviceAdded', function (device) {
+  console.log('added -> hci' + device.devId + ' ' + device.address + ' up = ' + device.devUp);
+});
+
+bluetoothHciSocket.on('deviceChanged', function (device) {
+  console.log('changed -> hci' + device.devId + ' up = ' + device.devUp);
+});
+
+bluetoothHciSocket.on('deviceRemoved', function (device) {
+  console.log('removed -> hci' + device.devId);
+});
+
+bluetoothHciSocket.on('error', function (error) {
+  console.log('on -> error: ' + error.message);
+});
+
+bluetoothHciSocket.bindControl();
+bluetoothHciSocket.start();
+
+console.log('devices: ', bluetoothHciSocket.getDeviceList());
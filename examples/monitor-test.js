@@ -0,0 +1,29 @@
+const BluetoothHciSocket = require('../index');
+
+const bluetoothHciSocket = new BluetoothHciSocket();
+
+const HCI_COMMAND_PKT = 0x01;
+const HCI_ACLDATA_PKT = 0x02;
+const HCI_EVENT_PKT = 0x04;
+
+const PACKET_TYPES = {
+  [HCI_COMMAND_PKT]: 'command',
+  [HCI_ACLDATA_PKT]: 'acl',
+  [HCI_EVENT_PKT]: 'event'
+};
+
+bluetoothHciSocket.on('data', function (data, meta) {
+  const type = PACKET_TYPES[data.readUInt8(0)] || 'other';
+  console.log('hci' + meta.devId + ' ' + meta.direction + ' ' + type + ': ' + data.toString('hex'));
+});
+
+bluetoothHciSocket.on('index', function (event) {
+  console.log('index -> ' + event.type + ' hci' + event.devId);
+});
+
+bluetoothHciSocket.on('error', function (error) {
+  console.log('on -> error: ' + error.message);
+});
+
+bluetoothHciSocket.bindMonitor();
+bluetoothHciSocket.start();
@@ -0,0 +1,16 @@
+const BluetoothHciSocket = require('../index');
+
+const monitor = new BluetoothHciSocket();
+
+monitor.on('error', function (error) {
+  console.log('on -> error: ' + error.message);
+});
+
+monitor.bindMonitor();
+monitor.start();
+
+setInterval(function () {
+  console.log('load: ', monitor.getAdapterLoad());
+  console.log('least-connections -> hci' + monitor.pickAdapter('least-connections'));
+  console.log('round-robin -> hci' + monitor.pickAdapter('round-robin'));
+}, 5000);
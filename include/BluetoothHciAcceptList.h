@@ -0,0 +1,189 @@
+#ifndef BLUETOOTH_HCI_ACCEPT_LIST_H
+#define BLUETOOTH_HCI_ACCEPT_LIST_H
+
+// Include necessary headers
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <string>         // For std::string
+#include <unordered_map>  // For std::unordered_map
+#include <vector>         // For std::vector
+#include "BluetoothHciAcceptListSync.h"
+
+/**
+ * @brief Device the controller's filter accept list should let through.
+ */
+struct HciAcceptTarget {
+  uint8_t type;         ///< HCI address type: 0x00 public, 0x01 random
+  bdaddr_t address;     ///< Address, little endian
+  int32_t priority;     ///< Higher priorities are kept in the list when it is full
+};
+
+/**
+ * @brief Counters of a BluetoothHciAcceptList.
+ */
+struct HciAcceptListStats {
+  size_t targets;           ///< Targets set
+  size_t installed;         ///< Entries in the controller's list
+  size_t capacity;          ///< Entries used, 0 until read from the controller
+  size_t rejected;          ///< Targets the controller refused
+  uint64_t rotations;       ///< Rotations of the entries beyond the capacity
+  uint64_t commands;        ///< Commands sent
+  uint64_t commandsNaive;   ///< Commands clearing and refilling the list on every change would have sent
+  uint64_t deferred;        ///< Syncs held back while initiating or refused by the controller
+  uint64_t targetReports;   ///< Advertising reports from targets
+  uint64_t otherReports;    ///< Advertising reports from other devices
+  uint64_t filteredTime;    ///< Ms scanned through the list
+  uint64_t unfilteredTime;  ///< Ms scanned without it
+  double reportsSaved;      ///< Reports from other devices the list kept away, estimated from the unfiltered rate
+};
+
+/**
+ * @brief Keeps the controller's LE filter accept list in sync with a target set.
+ *
+ * Fed the commands the host writes and the events the controller sends, so
+ * it knows when the list may not be changed: while a scan or a connection
+ * attempt is using it. A scan using the list is paused around the changes;
+ * a connection attempt is waited for.
+ *
+ * When the targets outnumber the list, a quarter of the entries rotate
+ * through the targets that do not fit, ranked by priority or by how recently
+ * they were seen; the rest hold the best ranked ones. Not thread safe.
+ */
+class BluetoothHciAcceptList {
+ public:
+  /// How targets are ranked for the entries that do not rotate.
+  enum Policy : uint8_t {
+    Priority,   ///< Priority, then last seen
+    Recency     ///< Last seen, then priority
+  };
+
+  /// Manager tuning.
+  struct Options {
+    Policy policy = Priority;       ///< Ranking of the targets
+    size_t capacity = 0;            ///< Entries to use at most, 0 for the controller's size
+    uint64_t rotateInterval = 5000; ///< Ms between rotations
+    bool pauseScan = true;          ///< Whether a scan using the list is paused to change it
+  };
+
+  BluetoothHciAcceptList();
+
+  /**
+   * @brief Replaces the targets.
+   * @param targets Targets; duplicates keep the first.
+   * @param options Tuning.
+   * @param now Monotonic time in milliseconds.
+   */
+  void setTargets(const std::vector<HciAcceptTarget>& targets, const Options& options, uint64_t now);
+
+  /// Whether there are targets, or entries left to remove.
+  bool active() const { return !_targets.empty() || !_list.installed().empty() || !_list.known() || _list.inFlight() != 0; }
+
+  /**
+   * @brief Inspects a command the host wrote.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @param now Monotonic time in milliseconds.
+   */
+  void observeCommand(const uint8_t* data, size_t length, uint64_t now);
+
+  /**
+   * @brief Inspects an event from the controller.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @param now Monotonic time in milliseconds.
+   * @return True if the event completed one of the manager's commands; it is not delivered.
+   */
+  bool observeEvent(const uint8_t* data, size_t length, uint64_t now);
+
+  /**
+   * @brief Takes the next command to send, if the list may be changed now.
+   * @param commands Receives H4 framed commands.
+   * @param now Monotonic time in milliseconds.
+   */
+  void take(std::vector<std::string>& commands, uint64_t now);
+
+  /**
+   * @brief Gives up on the command last taken, which could not be written; changes are retried later.
+   * @param now Monotonic time in milliseconds.
+   */
+  void writeFailed(uint64_t now);
+
+  /**
+   * @brief Counters, with the scan time up to now.
+   * @param now Monotonic time in milliseconds.
+   */
+  HciAcceptListStats stats(uint64_t now) const;
+
+ private:
+  /// Milliseconds before a change the controller disallowed is retried.
+  static constexpr uint64_t kRetryDelay = 1000;
+
+  struct Target {
+    uint64_t key;         ///< Key(type, address)
+    int32_t priority;     ///< Priority
+    uint64_t lastSeen;    ///< Monotonic ms of the last report, 0 if never
+    bool rejected;        ///< Refused by the controller
+  };
+
+  enum ScanMode : uint8_t { Idle, Unfiltered, Filtered };
+
+  /**
+   * @brief Picks the wanted entries from the targets.
+   */
+  void select();
+
+  /**
+   * @brief Records a report's address.
+   * @param type Address type from the report.
+   * @param address Address.
+   * @param now Monotonic time in milliseconds.
+   */
+  void observeReport(uint8_t type, const uint8_t* address, uint64_t now);
+
+  /**
+   * @brief Completes the command in flight.
+   * @param completion Outcome, already applied to the list.
+   * @param now Monotonic time in milliseconds.
+   */
+  void complete(const BluetoothHciAcceptListSync::Completion& completion, uint64_t now);
+
+  /**
+   * @brief Moves the scan time accounting to a new mode.
+   * @param mode Mode from now on.
+   * @param now Monotonic time in milliseconds.
+   */
+  void setScanMode(ScanMode mode, uint64_t now);
+
+  Options _options;                             ///< Tuning
+  std::vector<Target> _targets;                 ///< Targets in the order set
+  std::unordered_map<uint64_t, size_t> _index;  ///< Targets by key
+  BluetoothHciAcceptListSync _list;             ///< Controller's list and the command in flight
+  bool _dirty;                                  ///< Whether the wanted entries must be picked again
+  bool _syncing;                                ///< Whether a difference is being applied
+  bool _waiting;                                ///< Whether a sync waits for the list to be free
+  size_t _cursor;                               ///< First target of the rotating entries
+  uint64_t _nextRotation;                       ///< Monotonic ms of the next rotation
+
+  uint64_t _blockedUntil;                       ///< Monotonic ms before which no change is tried
+
+  bool _scanning;                               ///< Whether the host enabled scanning
+  bool _scanExtended;                           ///< Whether through the extended commands
+  bool _scanUsesList;                           ///< Whether the scan filter policy uses the list
+  bool _paused;                                 ///< Whether the manager disabled the scan
+  std::string _scanEnable;                      ///< Host's last enabling command, replayed to resume
+  bool _initiating;                             ///< Whether a connection attempt uses the list
+
+  ScanMode _scanMode;                           ///< Current scan time accounting
+  uint64_t _scanModeSince;                      ///< Monotonic ms it started
+  uint64_t _filteredTime;                       ///< Ms scanned through the list
+  uint64_t _unfilteredTime;                     ///< Ms scanned without it
+  uint64_t _unfilteredOtherReports;             ///< Reports from other devices while unfiltered
+
+  uint64_t _rotations;                          ///< Rotations
+  uint64_t _commandsNaive;                      ///< Commands a clear and refill would have sent
+  uint64_t _deferred;                           ///< Syncs held back
+  uint64_t _targetReports;                      ///< Reports from targets
+  uint64_t _otherReports;                       ///< Reports from other devices
+};
+
+#endif // BLUETOOTH_HCI_ACCEPT_LIST_H
@@ -0,0 +1,137 @@
+#ifndef BLUETOOTH_HCI_ACCEPT_LIST_SYNC_H
+#define BLUETOOTH_HCI_ACCEPT_LIST_SYNC_H
+
+// Include necessary headers
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <string>         // For std::string
+#include <unordered_set>  // For std::unordered_set
+#include <vector>         // For std::vector
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Brings the controller's LE filter accept list to a wanted set of entries.
+ *
+ * Shared by the accept list manager and the connection scheduler, which pick
+ * the wanted entries and decide when the list may change. Changes are the
+ * smallest difference between the installed entries and the wanted ones, one
+ * command at a time, falling back to a clear when that is shorter. One
+ * command of the owner's is in flight at a time, list command or not. Not
+ * thread safe.
+ */
+class BluetoothHciAcceptListSync {
+ public:
+  /// A command of the owner's that completed.
+  struct Completion {
+    uint16_t opcode;      ///< Command opcode
+    uint8_t status;       ///< HCI status
+    uint64_t key;         ///< Entry of an add or remove
+    bool resized;         ///< Whether the list size changed, so the wanted entries must be picked again
+  };
+
+  BluetoothHciAcceptListSync();
+
+  /// Entry key: address type in the top bits, address below.
+  static uint64_t Key(uint8_t type, const uint8_t* address);
+
+  /// H4 command with the given parameters.
+  static std::string Command(uint16_t opcode, const uint8_t* params, size_t length);
+
+  /// Entries to use at most, 0 for the controller's size.
+  void setLimit(size_t limit) { _limit = limit; }
+
+  /// Entries used, 0 until the controller's size is read.
+  size_t capacity() const;
+
+  /// Whether the controller's size is known.
+  bool sized() const { return _controllerSize != 0; }
+
+  /// Entries picked for the controller; the owner fills them.
+  std::unordered_set<uint64_t>& wanted() { return _wanted; }
+
+  /// Entries in the controller's list.
+  const std::unordered_set<uint64_t>& installed() const { return _installed; }
+
+  /// Whether the installed entries are known to be exact.
+  bool known() const { return _installedKnown; }
+
+  /// Whether the list holds the wanted entries.
+  bool synced() const;
+
+  /// Opcode of the command awaiting completion, 0 if none.
+  uint16_t inFlight() const { return _inFlight; }
+
+  /// Whether a command awaits a completion that may still come.
+  bool waiting(uint64_t now) const { return _inFlight != 0 && now - _sentAt < kCommandTimeout; }
+
+  /**
+   * @brief Gives up on the command in flight, whose completion was lost or that was never written.
+   * @return Its opcode, 0 if none; the list is then unknown.
+   */
+  uint16_t drop();
+
+  /// Commands sent.
+  uint64_t commands() const { return _commands; }
+
+  /**
+   * @brief Queues a command and marks it in flight.
+   * @param commands Receives the H4 framed command.
+   * @param command Command.
+   * @param now Monotonic time in milliseconds.
+   */
+  void send(std::vector<std::string>& commands, std::string command, uint64_t now);
+
+  /**
+   * @brief Sends the next command towards the wanted entries: the size read first, then the difference.
+   * @param commands Receives the H4 framed command.
+   * @param now Monotonic time in milliseconds.
+   */
+  void update(std::vector<std::string>& commands, uint64_t now);
+
+  /**
+   * @brief Inspects a command the host wrote: a reset empties the list, list changes make it unknown.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   */
+  void observeCommand(const uint8_t* data, size_t length);
+
+  /**
+   * @brief Completes the command in flight from its Command Complete or Command Status.
+   *
+   * The installed entries and the size follow the list commands' outcomes; a
+   * command the controller disallowed changed nothing.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @param completion Receives the outcome.
+   * @return True if the event completed the command in flight.
+   */
+  bool observeEvent(const uint8_t* data, size_t length, Completion& completion);
+
+ private:
+  /// Milliseconds after which a command without a completion is given up on.
+  static constexpr uint64_t kCommandTimeout = 2000;
+
+  /// LE Add/Remove Device command for an entry.
+  static std::string EntryCommand(uint16_t opcode, uint64_t key);
+
+  /**
+   * @brief Applies a completed list command.
+   * @param completion Outcome; resized is set.
+   * @param params Return parameters after the status, or nullptr.
+   * @param paramsLength Length of the return parameters.
+   */
+  void complete(Completion& completion, const uint8_t* params, size_t paramsLength);
+
+  std::unordered_set<uint64_t> _wanted;         ///< Entries picked for the controller
+  std::unordered_set<uint64_t> _installed;      ///< Entries in the controller's list
+  bool _installedKnown;                         ///< Whether _installed is known to be exact
+  size_t _controllerSize;                       ///< Controller's list size, 0 until read
+  size_t _limit;                                ///< Entries to use at most, 0 for no limit
+
+  uint16_t _inFlight;                           ///< Opcode of the command awaiting completion, 0 if none
+  uint64_t _inFlightKey;                        ///< Entry of an add or remove in flight
+  uint64_t _sentAt;                             ///< Monotonic ms it was sent
+  uint64_t _commands;                           ///< Commands sent
+};
+
+#endif // BLUETOOTH_HCI_ACCEPT_LIST_SYNC_H
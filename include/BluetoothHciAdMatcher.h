@@ -0,0 +1,118 @@
+#ifndef BLUETOOTH_HCI_AD_MATCHER_H
+#define BLUETOOTH_HCI_AD_MATCHER_H
+
+// Include necessary headers
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+#include "BluetoothStructs.h"
+
+/**
+ * @brief One pattern of a catalog.
+ */
+struct HciAdPattern {
+  uint32_t id;          ///< Reported when the pattern matches; several patterns may share one
+  uint8_t type;         ///< AD type whose value is searched
+  std::string value;    ///< Bytes to find, not empty
+  int32_t offset;       ///< Offset in the value the bytes must start at, or negative for anywhere
+};
+
+/**
+ * @brief Matches advertising data against a catalog of byte patterns.
+ *
+ * Built once per catalog into one Aho-Corasick automaton per AD type, so
+ * each AD structure's value is scanned once whatever the number of patterns.
+ * Roots have a dense transition table; deeper states keep their edges
+ * sorted. A type whose patterns are all anchored stops scanning past the
+ * furthest one. Immutable once built, so one instance may be shared by any
+ * number of threads.
+ */
+class BluetoothHciAdMatcher {
+ public:
+  /**
+   * @brief Builds the automata.
+   * @param patterns Catalog; patterns with an empty value are ignored.
+   */
+  explicit BluetoothHciAdMatcher(const std::vector<HciAdPattern>& patterns);
+
+  /**
+   * @brief Matches advertising data.
+   * @param adv AD structures: length, type, value.
+   * @param length Length of the data.
+   * @param ids Receives the ids of the patterns found, sorted and unique.
+   * @return Number of ids.
+   */
+  size_t match(const uint8_t* adv, size_t length, std::vector<uint32_t>& ids) const;
+
+  /**
+   * @brief Matches the data of every report of an advertising report event.
+   *
+   * Legacy and extended reports are matched as the controller delivered
+   * them; extended fragments are not reassembled.
+   * @param data Packet bytes, starting with the H4 packet type.
+   * @param length Length of the packet.
+   * @param ids Receives the ids of the patterns found in any report, sorted and unique.
+   * @return Number of reports, 0 for packets that are not advertising reports.
+   */
+  size_t matchReports(const uint8_t* data, size_t length, std::vector<uint32_t>& ids) const;
+
+  /// Patterns in the catalog.
+  size_t patterns() const { return _patterns; }
+
+  /// States of all automata.
+  size_t states() const { return _states.size(); }
+
+ private:
+  struct State {
+    uint32_t fail;        ///< State of the longest proper suffix
+    uint32_t edges;       ///< First edge in _edges
+    uint32_t outputs;     ///< First output in _outputs, own and inherited
+    uint32_t edgeCount;   ///< Edges, sorted by byte
+    uint32_t outputCount; ///< Outputs
+  };
+
+  struct Edge {
+    uint8_t byte;         ///< Input byte
+    uint32_t next;        ///< State reached
+  };
+
+  struct Output {
+    uint32_t id;          ///< Pattern id
+    uint32_t length;      ///< Pattern length
+    int32_t offset;       ///< Required start, or negative for anywhere
+  };
+
+  struct Root {
+    uint32_t state;       ///< Root state
+    uint32_t table;       ///< First of the root's 256 transitions in _rootNext
+    size_t limit;         ///< Value bytes worth scanning
+  };
+
+  /**
+   * @brief Appends the ids found in advertising data, unsorted.
+   * @param adv AD structures.
+   * @param length Length of the data.
+   * @param ids Receives the ids found.
+   */
+  void collect(const uint8_t* adv, size_t length, std::vector<uint32_t>& ids) const;
+
+  /**
+   * @brief Runs the automaton of one AD type over a value.
+   * @param root Automaton.
+   * @param value Value bytes.
+   * @param length Length of the value.
+   * @param ids Receives the ids found.
+   */
+  void scan(const Root& root, const uint8_t* value, size_t length, std::vector<uint32_t>& ids) const;
+
+  size_t _patterns;               ///< Patterns built
+  int16_t _roots[256];            ///< Index in _rootList by AD type, -1 if the type has no patterns
+  std::vector<Root> _rootList;    ///< Automata
+  std::vector<uint32_t> _rootNext; ///< Dense transitions of the roots
+  std::vector<State> _states;     ///< States of all automata
+  std::vector<Edge> _edges;       ///< Edges of all states
+  std::vector<Output> _outputs;   ///< Outputs of all states
+};
+
+#endif // BLUETOOTH_HCI_AD_MATCHER_H
@@ -0,0 +1,117 @@
+#ifndef BLUETOOTH_HCI_ADVERTISING_H
+#define BLUETOOTH_HCI_ADVERTISING_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Offsets of the encoded advertisement handed to JS.
+ *
+ * An encoded advertisement is a fixed header, followed by one 4 byte index
+ * entry per AD structure (type, length, offset into the data), followed by
+ * the reassembled advertising data. lib/advertisement.js reads the same
+ * layout; both must change together.
+ */
+namespace HciAdvertisementLayout {
+  constexpr size_t EventType     = 0;   ///< u16 event type (report bits, data status cleared)
+  constexpr size_t AddressType   = 2;   ///< u8 address type
+  constexpr size_t Address       = 3;   ///< u8[6] address, little endian as on the wire
+  constexpr size_t PrimaryPhy    = 9;   ///< u8 primary PHY (0 for legacy reports)
+  constexpr size_t SecondaryPhy  = 10;  ///< u8 secondary PHY
+  constexpr size_t Sid           = 11;  ///< u8 advertising SID (0xFF if none)
+  constexpr size_t TxPower       = 12;  ///< i8 TX power from the report (127 if unavailable)
+  constexpr size_t Rssi          = 13;  ///< i8 RSSI
+  constexpr size_t DataStatus    = 14;  ///< u8 HCI_ADV_DATA_COMPLETE or HCI_ADV_DATA_TRUNCATED
+  constexpr size_t AdCount       = 15;  ///< u8 number of index entries
+  constexpr size_t Flags         = 16;  ///< u8 AD flags value
+  constexpr size_t Present       = 17;  ///< u8 Present* bits
+  constexpr size_t TxPowerLevel  = 18;  ///< i8 TX power level AD value
+  constexpr size_t Fragments     = 19;  ///< u8 reports the data was reassembled from
+  constexpr size_t DataLength    = 20;  ///< u16 length of the advertising data
+  constexpr size_t HeaderLength  = 24;  ///< Index entries start here
+  constexpr size_t EntryLength   = 4;   ///< u8 type, u8 data length, u16 data offset
+
+  constexpr uint8_t PresentFlags        = 0x01;
+  constexpr uint8_t PresentTxPowerLevel = 0x02;
+  constexpr uint8_t PresentName         = 0x04;  ///< Complete or shortened local name
+  constexpr uint8_t PresentServices     = 0x08;  ///< Any service UUID list
+  constexpr uint8_t PresentManufacturer = 0x10;
+  constexpr uint8_t PresentServiceData  = 0x20;
+  constexpr uint8_t PresentMalformed    = 0x80;  ///< AD structures overran the data
+}
+
+/**
+ * @brief Reassembles advertising reports and indexes their AD structures.
+ *
+ * Fed every incoming HCI event on the polling thread. Legacy reports are
+ * complete on arrival; extended reports are chained per (address, SID) until
+ * the controller marks the data complete or truncated. Each finished
+ * advertisement is walked once and handed on in the encoded layout above.
+ * Not thread safe; owned by a single reader thread.
+ */
+class BluetoothHciAdvertisingAssembler {
+ public:
+  /// Receives one encoded advertisement.
+  typedef std::function<void(std::string)> Callback;
+
+  BluetoothHciAdvertisingAssembler();
+
+  /**
+   * @brief Feeds one H4 packet; advertising reports produce callbacks.
+   * @param data Packet bytes, starting with the H4 packet type.
+   * @param length Length of the packet.
+   * @param onAdvertisement Called for every complete or truncated advertisement.
+   * @return Number of advertisements produced.
+   */
+  size_t observe(const uint8_t* data, size_t length, const Callback& onAdvertisement);
+
+  /// Drops all partially reassembled chains.
+  void reset();
+
+  /// Number of chains awaiting further fragments.
+  size_t pending() const { return _chains.size(); }
+
+  /// Chains dropped because the table was full or a fragment overran the limit.
+  uint64_t dropped() const { return _dropped; }
+
+  /**
+   * @brief Encodes one advertisement: header, AD index and data.
+   * @param report Report header fields, in extended report order (24 bytes).
+   * @param adv Advertising data.
+   * @param advLength Length of the advertising data.
+   * @param dataStatus HCI_ADV_DATA_COMPLETE or HCI_ADV_DATA_TRUNCATED.
+   * @param fragments Number of reports the data was reassembled from.
+   * @return The encoded advertisement.
+   */
+  static std::string encode(const uint8_t* report, const uint8_t* adv, size_t advLength,
+                            uint8_t dataStatus, uint8_t fragments);
+
+ private:
+  /// Maximum chains reassembled at once; the oldest is dropped beyond this.
+  static constexpr size_t kMaxChains = 16;
+
+  /// Extended advertising report header length (up to and including data length).
+  static constexpr size_t kExtReportLength = 24;
+
+  /// Fragments of one advertiser's chain.
+  struct Chain {
+    uint8_t key[9];           ///< Address type, address, SID, scan response bit
+    uint8_t report[kExtReportLength]; ///< Header of the latest fragment
+    std::string data;         ///< Data gathered so far
+    uint8_t fragments;        ///< Fragments gathered so far
+  };
+
+  size_t onLegacyReports(const uint8_t* data, size_t length, const Callback& onAdvertisement);
+  size_t onExtendedReports(const uint8_t* data, size_t length, const Callback& onAdvertisement);
+  std::list<Chain>::iterator find(const uint8_t* key);
+
+  std::list<Chain> _chains;   ///< Chains in arrival order, oldest first
+  uint64_t _dropped;          ///< Chains dropped
+};
+
+#endif // BLUETOOTH_HCI_ADVERTISING_H
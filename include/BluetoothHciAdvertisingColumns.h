@@ -0,0 +1,95 @@
+#ifndef BLUETOOTH_HCI_ADVERTISING_COLUMNS_H
+#define BLUETOOTH_HCI_ADVERTISING_COLUMNS_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Column layout of one advertisement batch inside a single buffer.
+ *
+ * Every column starts at an offset aligned for its element type so typed
+ * array views can be created over one ArrayBuffer.
+ */
+struct HciAdvertisingColumnLayout {
+  size_t count;          ///< Rows in the batch
+  size_t address;        ///< u8[count * 6]
+  size_t addressType;    ///< u8[count]
+  size_t eventType;      ///< u16[count]
+  size_t rssi;           ///< i8[count]
+  size_t txPower;        ///< i8[count]
+  size_t sid;            ///< u8[count]
+  size_t primaryPhy;     ///< u8[count]
+  size_t secondaryPhy;   ///< u8[count]
+  size_t dataOffset;     ///< u32[count], into the data column
+  size_t dataLength;     ///< u32[count]
+  size_t data;           ///< u8[dataBytes]
+  size_t dataBytes;      ///< Length of the data column
+  size_t total;          ///< Bytes needed for the whole batch
+
+  /**
+   * @brief Computes the layout for a batch.
+   * @param count Rows in the batch.
+   * @param dataBytes Total advertising data bytes.
+   */
+  static HciAdvertisingColumnLayout For(size_t count, size_t dataBytes);
+};
+
+/**
+ * @brief Accumulates decoded advertisements into struct-of-arrays batches.
+ *
+ * The polling thread appends advertisements in the HciAdvertisementLayout
+ * encoding; only the fixed header and the data are staged. The JS thread
+ * takes the whole batch and transposes the staged headers into columns in
+ * one pass per column, which keeps the per-advertisement work on the
+ * polling thread to two copies.
+ */
+class BluetoothHciAdvertisingColumns {
+ public:
+  /// Rows staged before further advertisements are dropped.
+  static constexpr size_t kMaxRows = 65536;
+
+  BluetoothHciAdvertisingColumns();
+
+  /**
+   * @brief Stages one advertisement.
+   * @param encoded Advertisement in the HciAdvertisementLayout encoding.
+   * @return True if this is the first row of a new batch.
+   */
+  bool append(const std::string& encoded);
+
+  /**
+   * @brief Takes the staged batch and writes its columns into a new buffer.
+   * @param allocate Returns a zeroed buffer of the requested size (e.g. an ArrayBuffer).
+   * @return Layout of the columns in the buffer.
+   */
+  HciAdvertisingColumnLayout take(const std::function<uint8_t*(size_t)>& allocate);
+
+  /// Drops the staged batch.
+  void clear();
+
+  /// Advertisements dropped because a batch was full.
+  uint64_t dropped() const { return _dropped; }
+
+  /**
+   * @brief Transposes staged headers into columns.
+   * @param headers Headers, HciAdvertisementLayout::HeaderLength bytes each.
+   * @param count Number of headers.
+   * @param layout Column layout.
+   * @param out Column buffer of layout.total bytes.
+   */
+  static void Transpose(const uint8_t* headers, size_t count, const HciAdvertisingColumnLayout& layout, uint8_t* out);
+
+ private:
+  std::mutex _mutex;               ///< Guards the staged batch
+  std::vector<uint8_t> _headers;   ///< Staged fixed headers
+  std::vector<uint32_t> _lengths;  ///< Data length per staged row
+  std::vector<uint8_t> _data;      ///< Staged data, contiguous
+  uint64_t _dropped;               ///< Dropped advertisements
+};
+
+#endif // BLUETOOTH_HCI_ADVERTISING_COLUMNS_H
@@ -0,0 +1,112 @@
+#ifndef BLUETOOTH_HCI_ATT_ROUTER_H
+#define BLUETOOTH_HCI_ATT_ROUTER_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One attribute value taken off the ACL stream.
+ */
+struct HciAttValue {
+  uint32_t subscription;  ///< Subscription the value matched.
+  uint16_t connHandle;    ///< Connection handle.
+  uint16_t attrHandle;    ///< Attribute handle.
+  bool indication;        ///< Whether a Handle Value Confirmation is owed.
+  std::string value;      ///< Attribute value.
+};
+
+/**
+ * @brief Routes ATT notifications and indications to subscriptions natively.
+ *
+ * Fed every incoming ACL packet on the polling thread. Handle Value
+ * Notifications and Indications on the ATT channel whose (connection handle,
+ * attribute handle) has a subscription are consumed, reassembled across ACL
+ * fragments if needed, and their values staged per subscription until the JS
+ * thread takes them. Indications are only consumed for subscriptions that
+ * confirm natively, as the confirmation is then owed by the caller; otherwise
+ * they are left for the host's ATT layer to confirm. Everything else is left
+ * for the regular data path.
+ */
+class BluetoothHciAttRouter {
+ public:
+  BluetoothHciAttRouter();
+
+  /**
+   * @brief Adds a subscription.
+   * @param connHandle Connection handle.
+   * @param attrHandle Attribute handle (value handle of the characteristic).
+   * @param confirm Whether indications are consumed too, to be confirmed by the caller.
+   * @return Subscription ID, or 0 if (connHandle, attrHandle) is already subscribed.
+   */
+  uint32_t subscribe(uint16_t connHandle, uint16_t attrHandle, bool confirm = false);
+
+  /**
+   * @brief Removes a subscription and drops its staged values.
+   * @return True if the subscription existed.
+   */
+  bool unsubscribe(uint32_t subscription);
+
+  /**
+   * @brief Forgets a connection (disconnected); its handle may be reused.
+   * @param connHandle Connection handle.
+   * @return IDs of the subscriptions that were removed.
+   */
+  std::vector<uint32_t> removeConnection(uint16_t connHandle);
+
+  /// Removes every subscription and all reassembly state.
+  void clear();
+
+  /**
+   * @brief Inspects one incoming H4 ACL packet.
+   * @param data Packet bytes, starting with the H4 packet type.
+   * @param length Length of the packet.
+   * @param completed Receives values completed by this packet.
+   * @return True if the packet was consumed and must not be delivered as data.
+   */
+  bool observe(const uint8_t* data, size_t length, std::vector<HciAttValue>& completed);
+
+  /**
+   * @brief Stages a completed value for its subscription.
+   * @return True if it is the first staged value, i.e. a delivery must be scheduled.
+   */
+  bool stage(HciAttValue value);
+
+  /**
+   * @brief Takes the values staged for a subscription.
+   */
+  std::vector<std::string> take(uint32_t subscription);
+
+  /**
+   * @brief Builds the H4 Handle Value Confirmation for a connection.
+   */
+  static std::string Confirmation(uint16_t connHandle);
+
+ private:
+  /// Reassembly state of one connection handle.
+  struct Reassembly {
+    bool active;            ///< An L2CAP PDU is in progress
+    bool consume;           ///< The PDU matched a subscription
+    size_t remaining;       ///< L2CAP payload bytes still expected
+    HciAttValue value;      ///< Value being gathered when consuming
+  };
+
+  static uint32_t key(uint16_t connHandle, uint16_t attrHandle) {
+    return (static_cast<uint32_t>(connHandle) << 16) | attrHandle;
+  }
+
+  std::mutex _mutex;                                  ///< Guards all state
+  uint32_t _nextId;                                   ///< Next subscription ID
+  std::map<uint32_t, uint32_t> _byKey;                ///< Subscription ID by (conn, attr)
+  std::map<uint32_t, uint32_t> _keys;                 ///< (conn, attr) by subscription ID
+  std::set<uint32_t> _confirming;                     ///< Subscriptions that consume indications
+  std::map<uint16_t, Reassembly> _reassembly;         ///< PDUs in progress by connection
+  std::map<uint32_t, std::vector<std::string>> _staged; ///< Values awaiting delivery
+};
+
+#endif // BLUETOOTH_HCI_ATT_ROUTER_H
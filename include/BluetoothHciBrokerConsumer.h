@@ -0,0 +1,134 @@
+#ifndef BLUETOOTH_HCI_BROKER_CONSUMER_H
+#define BLUETOOTH_HCI_BROKER_CONSUMER_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include <atomic>         // For std::atomic
+#include <memory>         // For std::unique_ptr
+#include <mutex>          // For std::mutex
+#include <thread>         // For std::thread
+#include "BluetoothHciDelivery.h"   // Header for BluetoothHciDelivery class
+#include "BluetoothHciSharedRing.h" // Header for BluetoothHciSharedRing class
+#include "BluetoothHciThread.h"     // Header for BluetoothHciThread helpers
+#include "BluetoothStructs.h"       // For struct hci_filter
+
+/**
+ * @brief Class representing one process attached to a socket broker.
+ *
+ * Reads the packets a BluetoothHciSocket in another process publishes to its
+ * shared ring, filters them natively with the kernel's HCI filter semantics
+ * and delivers them through BluetoothHciDelivery like a socket would. Writes
+ * are queued to the broker, which sends them on its socket.
+ */
+class BluetoothHciBrokerConsumer : public Napi::ObjectWrap<BluetoothHciBrokerConsumer> {
+ public:
+  /**
+   * @brief Initializes the BluetoothHciBrokerConsumer class and sets up exports to Node.js.
+   * @param env The N-API environment.
+   * @param exports The exports object to which the class is added.
+   * @return The modified exports object.
+   */
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  /**
+   * @brief Constructor for BluetoothHciBrokerConsumer.
+   * @param info Callback information from N-API.
+   */
+  BluetoothHciBrokerConsumer(const Napi::CallbackInfo& info);
+
+  /// Destructor
+  ~BluetoothHciBrokerConsumer();
+
+  /**
+   * @brief Maps a broker ring and claims a consumer slot.
+   * @param info Callback information from N-API (ring path or inherited descriptor).
+   */
+  void Attach(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets the HCI filter applied to the packets read.
+   * @param info Callback information from N-API (struct hci_filter buffer, or null for all packets).
+   */
+  void SetFilter(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Starts the reader thread.
+   * @param info Callback information from N-API.
+   */
+  void Start(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Stops the reader thread.
+   * @param info Callback information from N-API.
+   */
+  void Stop(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Queues a packet for the broker to write.
+   * @param info Callback information from N-API (packet buffer).
+   * @return Napi::Value false if the broker's command queue is full.
+   */
+  Napi::Value Write(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Registers direct packet handlers that bypass the "data" event.
+   * @param info Callback information from N-API ({ event, acl, iso, command }, or null).
+   */
+  void OnPacket(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets affinity, nice or SCHED_FIFO priority and name of the reader thread.
+   * @param info Callback information from N-API ({ cpus, nice, priority, name }, or null).
+   */
+  void SetThreadOptions(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves this consumer's lag and counters.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { slot, lag, delivered, filtered, lost, closed }, or null if detached.
+   */
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Stops the reader thread, releases the slot and unmaps the ring.
+   * @param info Callback information from N-API.
+   */
+  void Close(const Napi::CallbackInfo& info);
+
+ private:
+  /**
+   * @brief Reads and filters packets in a separate thread.
+   */
+  void ReadLoop();
+
+  /**
+   * @brief Joins the reader thread.
+   */
+  void StopThread();
+
+  /**
+   * @brief Applies the kernel's HCI socket filter to a packet.
+   * @param filter Filter to apply.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @return True if the packet passes.
+   */
+  static bool Passes(const hci_filter& filter, const uint8_t* data, size_t length);
+
+  std::unique_ptr<BluetoothHciSharedRing> _ring; ///< Mapped broker ring
+  int _slot;                        ///< Claimed consumer slot, or -1
+  HciRingCursor _cursor;            ///< Read position (reader thread only)
+
+  std::mutex _filterMutex;          ///< Guards the filter
+  hci_filter _filter;               ///< Filter applied by the reader thread
+  bool _hasFilter;                  ///< Whether a filter was set
+
+  std::atomic<bool> stopFlag;       ///< Atomic flag to signal the thread to stop
+  std::thread readerThread;         ///< Thread reading the ring
+  HciThreadOptions _threadOptions;  ///< Applied by the reader thread when it starts
+
+  BluetoothHciDelivery _delivery;   ///< Batched thread-safe delivery to `emit`
+};
+
+#endif // BLUETOOTH_HCI_BROKER_CONSUMER_H
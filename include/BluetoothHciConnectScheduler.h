@@ -0,0 +1,224 @@
+#ifndef BLUETOOTH_HCI_CONNECT_SCHEDULER_H
+#define BLUETOOTH_HCI_CONNECT_SCHEDULER_H
+
+// Include necessary headers
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <string>         // For std::string
+#include <unordered_map>  // For std::unordered_map
+#include <vector>         // For std::vector
+#include "BluetoothHciAcceptListSync.h"
+
+/**
+ * @brief Device to connect to.
+ */
+struct HciConnectTarget {
+  uint8_t type;         ///< HCI address type: 0x00 public, 0x01 random
+  bdaddr_t address;     ///< Address, little endian
+  int32_t priority;     ///< Higher priorities get the accept list entries first
+  uint64_t timeout;     ///< Ms an attempt may take, 0 for the scheduler's default
+};
+
+/**
+ * @brief How a queued device left the queue.
+ */
+struct HciConnectResult {
+  /// Outcome.
+  enum Outcome : uint8_t {
+    Connected,    ///< Connection established
+    Timeout,      ///< Every attempt timed out
+    Rejected,     ///< The controller refused its accept list entry
+    Failed,       ///< The controller failed the connection; see status
+    Cancelled     ///< Removed from the queue by the host
+  };
+
+  uint8_t type;         ///< HCI address type as queued
+  bdaddr_t address;     ///< Address, little endian
+  Outcome outcome;      ///< Outcome
+  uint8_t status;       ///< HCI status of the last attempt, 0 if none failed
+  uint16_t handle;      ///< Connection handle, if connected
+  uint32_t attempts;    ///< Attempts made
+  uint64_t latency;     ///< Ms from being queued to leaving the queue
+};
+
+/**
+ * @brief Counters of a BluetoothHciConnectScheduler.
+ */
+struct HciConnectStats {
+  size_t queued;            ///< Devices waiting for a connection
+  size_t installed;         ///< Of which in the controller's accept list
+  size_t capacity;          ///< Entries used, 0 until read from the controller
+  uint64_t connected;       ///< Devices connected
+  uint64_t failed;          ///< Devices given up on, cancelled ones included
+  uint64_t initiations;     ///< Create Connection commands sent
+  uint64_t cancels;         ///< Initiations cancelled by a timeout
+  uint64_t commands;        ///< Commands sent
+  uint64_t deferred;        ///< Initiations held back by the host's own or refused by the controller
+  uint64_t latencyTotal;    ///< Sum of the connected devices' latencies, ms
+  uint64_t latencyMax;      ///< Longest of them, ms
+};
+
+/**
+ * @brief Connects to a queue of devices through filter accept list initiation.
+ *
+ * The controller has one connection attempt pending at a time. Rather than
+ * one attempt per device, the best ranked queued devices are put in the
+ * filter accept list and a single LE Create Connection using the list
+ * connects to whichever of them advertises first; the list is then updated
+ * and initiating starts again. A device whose attempt outlasts its timeout
+ * has the initiation cancelled (LE Create Connection Cancel) and is ranked
+ * behind the devices that waited less, until it runs out of attempts.
+ *
+ * Fed the commands the host writes and the events the controller sends, so
+ * an attempt of the host's own is waited for. The connection events are
+ * left for the host; completions of the scheduler's commands and the failed
+ * attempts it started are not. Not thread safe.
+ */
+class BluetoothHciConnectScheduler {
+ public:
+  /// Scheduler tuning; the connection parameters are those of LE Create Connection.
+  struct Options {
+    size_t capacity = 0;                  ///< Entries to use at most, 0 for the controller's size
+    uint64_t timeout = 10000;             ///< Default ms an attempt may take
+    uint32_t attempts = 3;                ///< Attempts per device before it is given up on
+    bool extended = false;                ///< Whether LE Extended Create Connection is used, on the 1M PHY
+    uint8_t ownAddressType = 0x00;        ///< Own address type
+    uint16_t scanInterval = 0x0060;       ///< Initiator scan interval, 0.625 ms units
+    uint16_t scanWindow = 0x0060;         ///< Initiator scan window, 0.625 ms units
+    uint16_t connMinInterval = 0x0006;    ///< Minimum connection interval, 1.25 ms units
+    uint16_t connMaxInterval = 0x000C;    ///< Maximum connection interval, 1.25 ms units
+    uint16_t connLatency = 0x0000;        ///< Peripheral latency
+    uint16_t supervisionTimeout = 0x00C8; ///< Supervision timeout, 10 ms units
+  };
+
+  BluetoothHciConnectScheduler();
+
+  /**
+   * @brief Queues devices; devices already queued take the new priority and timeout.
+   * @param targets Devices; duplicates keep the first.
+   * @param options Tuning, from the next initiation on.
+   * @param now Monotonic time in milliseconds.
+   */
+  void connect(const std::vector<HciConnectTarget>& targets, const Options& options, uint64_t now);
+
+  /**
+   * @brief Removes every queued device; each is reported cancelled.
+   * @param now Monotonic time in milliseconds.
+   */
+  void cancel(uint64_t now);
+
+  /// Whether devices are queued, or an initiation or a command is still pending.
+  bool active() const { return !this->_targets.empty() || this->_initiating || this->_list.inFlight() != 0; }
+
+  /**
+   * @brief Inspects a command the host wrote.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @param now Monotonic time in milliseconds.
+   */
+  void observeCommand(const uint8_t* data, size_t length, uint64_t now);
+
+  /**
+   * @brief Inspects an event from the controller.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @param now Monotonic time in milliseconds.
+   * @return True if the event only concerns the scheduler's own commands; it is not delivered.
+   */
+  bool observeEvent(const uint8_t* data, size_t length, uint64_t now);
+
+  /**
+   * @brief Takes the next command to send, if any is due now.
+   * @param commands Receives H4 framed commands.
+   * @param now Monotonic time in milliseconds.
+   */
+  void take(std::vector<std::string>& commands, uint64_t now);
+
+  /**
+   * @brief Gives up on the command last taken, which could not be written; it is retried later.
+   * @param now Monotonic time in milliseconds.
+   */
+  void writeFailed(uint64_t now);
+
+  /**
+   * @brief Takes the devices that left the queue since the last call.
+   * @param results Receives the results, in the order they happened.
+   */
+  void results(std::vector<HciConnectResult>& results);
+
+  /// Counters.
+  HciConnectStats stats() const;
+
+ private:
+  /// Milliseconds before a command the controller disallowed is retried.
+  static constexpr uint64_t kRetryDelay = 1000;
+
+  struct Target {
+    uint64_t key;         ///< Key(type, address)
+    int32_t priority;     ///< Priority
+    uint64_t timeout;     ///< Ms an attempt may take, 0 for the default
+    uint64_t queuedAt;    ///< Monotonic ms it was queued
+    uint64_t attemptAt;   ///< Monotonic ms its current attempt started, 0 if none
+    uint32_t attempts;    ///< Attempts ended
+    uint8_t status;       ///< HCI status of the last failed attempt
+    size_t order;         ///< Queue order, for ties
+  };
+
+  /// LE (Extended) Create Connection through the accept list.
+  std::string CreateCommand() const;
+
+  /// Picks the wanted entries from the queue.
+  void select();
+
+  /**
+   * @brief Removes a device from the queue and reports it.
+   * @param key Device.
+   * @param outcome Outcome.
+   * @param handle Connection handle, if connected.
+   * @param now Monotonic time in milliseconds.
+   */
+  void finish(uint64_t key, HciConnectResult::Outcome outcome, uint16_t handle, uint64_t now);
+
+  /**
+   * @brief Ends the attempts of the installed devices.
+   * @param status HCI status they failed with.
+   * @param expiredOnly Whether only the devices past their timeout are ended.
+   * @param now Monotonic time in milliseconds.
+   */
+  void endAttempts(uint8_t status, bool expiredOnly, uint64_t now);
+
+  /// Monotonic ms the first installed device's attempt times out at, or UINT64_MAX.
+  uint64_t deadline() const;
+
+  /**
+   * @brief Completes the command in flight.
+   * @param completion Outcome, already applied to the list.
+   * @param now Monotonic time in milliseconds.
+   */
+  void complete(const BluetoothHciAcceptListSync::Completion& completion, uint64_t now);
+
+  Options _options;                             ///< Tuning
+  std::unordered_map<uint64_t, Target> _targets; ///< Queued devices by key
+  BluetoothHciAcceptListSync _list;             ///< Controller's list and the command in flight
+  bool _dirty;                                  ///< Whether the wanted entries must be picked again
+  size_t _order;                                ///< Next queue order
+
+  uint64_t _blockedUntil;                       ///< Monotonic ms before which no command is tried
+
+  bool _initiating;                             ///< Whether the scheduler's initiation is pending
+  bool _cancelling;                             ///< Whether it is being cancelled
+  bool _hostInitiating;                         ///< Whether an attempt of the host's own is pending
+  bool _waiting;                                ///< Whether an initiation waits for the host's
+
+  std::vector<HciConnectResult> _results;       ///< Results not taken yet
+
+  uint64_t _connected;                          ///< Devices connected
+  uint64_t _failed;                             ///< Devices given up on
+  uint64_t _initiations;                        ///< Initiations
+  uint64_t _cancels;                            ///< Initiations cancelled
+  uint64_t _deferred;                           ///< Initiations held back
+  uint64_t _latencyTotal;                       ///< Sum of the connected latencies
+  uint64_t _latencyMax;                         ///< Longest connected latency
+};
+
+#endif // BLUETOOTH_HCI_CONNECT_SCHEDULER_H
@@ -0,0 +1,100 @@
+#ifndef BLUETOOTH_HCI_CONNECTION_ROUTER_H
+#define BLUETOOTH_HCI_CONNECTION_ROUTER_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Connection load of a single adapter as observed on the HCI stream.
+ */
+struct HciAdapterLoad {
+  uint16_t devId;           ///< HCI device ID.
+  uint32_t connections;     ///< Live LE connections.
+  uint32_t pending;         ///< Create connection attempts awaiting completion.
+  uint32_t maxConnections;  ///< Learned link limit (0 if never hit).
+  uint16_t aclMtu;          ///< Controller ACL buffer size.
+  uint16_t aclBuffers;      ///< Controller ACL buffer count.
+  uint32_t aclInFlight;     ///< ACL packets sent but not yet completed.
+  uint64_t connectsTotal;   ///< Successful connections since tracking began.
+  uint64_t failuresTotal;   ///< Failed connection attempts since tracking began.
+};
+
+/**
+ * @brief Tracks per-adapter connection load and picks adapters for new connections.
+ *
+ * The router is fed every H4 packet crossing an adapter (commands and outgoing
+ * ACL as "tx", events and incoming ACL as "rx") and derives live connections,
+ * pending LE Create Connection attempts and controller buffer usage from them.
+ * It performs no I/O of its own.
+ */
+class BluetoothHciConnectionRouter {
+ public:
+  /// Adapter selection policies.
+  enum Policy {
+    LeastConnections,  ///< Fewest live + pending connections
+    RoundRobin,        ///< Rotate through candidates
+    Sticky             ///< Adapter that last connected to the address, else least connections
+  };
+
+  BluetoothHciConnectionRouter();
+
+  /**
+   * @brief Feeds one H4 packet seen on an adapter.
+   * @param devId HCI device ID the packet belongs to.
+   * @param outgoing True for host to controller traffic.
+   * @param data Packet bytes, starting with the H4 packet type.
+   * @param length Length of the packet.
+   */
+  void observe(uint16_t devId, bool outgoing, const uint8_t* data, size_t length);
+
+  /**
+   * @brief Forgets all state of an adapter (reset or removal).
+   * @param devId HCI device ID.
+   */
+  void reset(uint16_t devId);
+
+  /**
+   * @brief Picks the adapter for a new connection.
+   * @param candidates Adapters that are up and may be used.
+   * @param policy Selection policy.
+   * @param address Peer address for the sticky policy, or nullptr.
+   * @param devId Receives the chosen adapter.
+   * @return False if no candidate has capacity left.
+   */
+  bool pick(const std::vector<uint16_t>& candidates, Policy policy, const bdaddr_t* address, uint16_t* devId);
+
+  /**
+   * @brief Returns the load of every adapter seen so far.
+   */
+  std::vector<HciAdapterLoad> load();
+
+ private:
+  /// Connection tracked by handle.
+  struct Connection {
+    bdaddr_t address;  ///< Peer address.
+  };
+
+  /// Per-adapter state.
+  struct Adapter {
+    HciAdapterLoad load;                        ///< Reported counters
+    std::map<uint16_t, Connection> connections; ///< Live connections by handle
+  };
+
+  Adapter& adapter(uint16_t devId);
+  void onCommand(Adapter& a, const uint8_t* data, size_t length);
+  void onEvent(Adapter& a, const uint8_t* data, size_t length);
+  void onConnectionComplete(Adapter& a, uint8_t status, uint16_t handle, const uint8_t* address);
+  bool hasCapacity(const Adapter& a) const;
+
+  std::mutex _mutex;                      ///< Guards all state (fed from the polling thread)
+  std::map<uint16_t, Adapter> _adapters;  ///< Adapters by device ID
+  std::map<bdaddr_t, uint16_t> _sticky;   ///< Last adapter used per peer address
+  size_t _roundRobin;                     ///< Round-robin cursor
+};
+
+#endif // BLUETOOTH_HCI_CONNECTION_ROUTER_H
@@ -0,0 +1,82 @@
+#ifndef BLUETOOTH_HCI_CONTROLLER_PROBE_H
+#define BLUETOOTH_HCI_CONTROLLER_PROBE_H
+
+// Include necessary headers
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <map>            // For std::map
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Issues the controller's informational read commands and collects the results.
+ *
+ * Commands are sent as soon as the controller grants a command credit (the
+ * Num_HCI_Command_Packets of each Command Complete or Command Status), from the
+ * thread that reads the events, so a probe costs no JS round trips. Reads that
+ * depend on the supported commands bitmask are queued once it is known.
+ */
+class BluetoothHciControllerProbe {
+ public:
+  /**
+   * @brief Creates a probe.
+   * @param identityOnly Only read the address and version, which key the capability cache.
+   */
+  explicit BluetoothHciControllerProbe(bool identityOnly);
+
+  /**
+   * @brief Takes the commands that may be sent now.
+   * @param commands Receives H4 framed commands.
+   */
+  void take(std::vector<std::string>& commands);
+
+  /**
+   * @brief Inspects an event for the completion of a probe command.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @return True if the event belonged to the probe.
+   */
+  bool observe(const uint8_t* data, size_t length);
+
+  /**
+   * @brief Inspects a command the host wrote while the probe runs.
+   *
+   * The controller completes commands in order, so a host read of an opcode the
+   * probe also issues completes ahead of the probe's own and is left to the host.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   */
+  void observeCommand(const uint8_t* data, size_t length);
+
+  /// Whether every command completed or failed.
+  bool done() const;
+
+  /// Return parameters (status stripped) of the commands that succeeded, by opcode.
+  const std::map<uint16_t, std::string>& results() const { return _results; }
+
+ private:
+  struct Step {
+    uint16_t opcode;    ///< Command opcode
+    bool sent;          ///< Whether it was written
+    bool complete;      ///< Whether it completed or failed
+    uint32_t hostAhead; ///< Host commands of the same opcode that complete before it
+  };
+
+  /**
+   * @brief Queues the reads the supported commands bitmask allows.
+   * @param commands Supported commands bitmask (64 octets).
+   */
+  void queueSupported(const std::string& commands);
+
+  /// Whether the probe may issue a command with this opcode.
+  static bool issues(uint16_t opcode);
+
+  std::vector<Step> _steps;                   ///< Commands in issue order
+  std::map<uint16_t, std::string> _results;   ///< Successful return parameters
+  std::map<uint16_t, uint32_t> _hostPending;  ///< Host commands awaiting completion, by opcode
+  uint8_t _credits;                           ///< Commands the controller accepts now
+  bool _identityOnly;                         ///< Whether only identity reads are issued
+};
+
+#endif // BLUETOOTH_HCI_CONTROLLER_PROBE_H
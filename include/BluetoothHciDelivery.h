@@ -0,0 +1,262 @@
+#ifndef BLUETOOTH_HCI_DELIVERY_H
+#define BLUETOOTH_HCI_DELIVERY_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include <atomic>         // For std::atomic
+#include <condition_variable> // For std::condition_variable
+#include <cstdint>        // For fixed-width integer types
+#include <deque>          // For std::deque
+#include <functional>     // For std::function
+#include <mutex>          // For std::mutex
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+#include "BluetoothHciRpaResolver.h" // For HciRpaMatch
+
+/**
+ * @brief Item queued for delivery on the JS thread.
+ *
+ * Either an H4 packet emitted as a "data" event, or an arbitrary event built
+ * by the emit callback. Items of one lane are delivered in the order queued.
+ */
+struct HciDeliveryItem {
+  std::string data;        ///< Packet bytes (H4 framed)
+  uint16_t devId;          ///< Adapter index (monitor channel), HCI_DEV_NONE otherwise
+  const char* direction;   ///< "rx"/"tx" for monitor packets, nullptr otherwise
+  HciRpaMatch identity;    ///< Identity the packet's address resolved to, if any
+  std::vector<uint32_t> matches; ///< Ids of the catalog patterns the packet's reports matched
+  std::function<void(Napi::Env, Napi::Object)> emit; ///< Custom event, or empty for packets
+  uint8_t lane;            ///< Priority lane (BluetoothHciDelivery::Lane)
+  uint8_t flags;           ///< BluetoothHciDelivery::Droppable / Barrier / Counted
+  uint64_t enqueued;       ///< Monotonic time queued, in nanoseconds
+};
+
+/**
+ * @brief Queueing statistics of one delivery lane.
+ */
+struct HciDeliveryLaneStats {
+  uint64_t delivered;      ///< Items delivered since start
+  uint64_t dropped;        ///< Items dropped by the depth limit since start
+  uint64_t delayTotal;     ///< Sum of queueing delays since the last read, in ns
+  uint64_t delayCount;     ///< Items behind delayTotal
+  uint64_t delayMax;       ///< Largest queueing delay since the last read, in ns
+};
+
+/**
+ * @brief Batched delivery of packets from a native I/O thread to JS.
+ *
+ * I/O threads push items into a queue; the first push into an empty queue
+ * schedules one thread-safe function call which drains up to a batch of
+ * items on the JS thread. This replaces one cross-thread call per packet with
+ * one per batch and is shared by every native transport.
+ *
+ * Items are sorted into priority lanes so a flood of advertising reports
+ * cannot hold back command completions or connection events. Each drain takes
+ * up to `weight` items from every lane in priority order, round after round,
+ * until the batch is full. Lanes are unbounded by default; a lane given a
+ * depth limit drops new droppable items instead of growing past it.
+ *
+ * Optionally the packets queued for "data" events are bounded by a credit the
+ * JS consumer grants as it takes them; the I/O thread stops reading while it
+ * is used up, so the backlog stays in the kernel. Packets that never become a
+ * "data" event (shed by a full lane, or passed to a direct handler) give their
+ * credit back.
+ */
+class BluetoothHciDelivery {
+ public:
+  /// Priority lanes, highest first.
+  enum Lane : uint8_t {
+    Control = 0,  ///< Commands, command completions, other events
+    Data = 1,     ///< ACL, SCO and ISO data, and the connection events ordered with it
+    Bulk = 2      ///< Advertising and inquiry reports
+  };
+
+  /// Item flags.
+  enum Flags : uint8_t {
+    Droppable = 0x01,  ///< May be dropped when its lane is over its depth limit
+    Barrier = 0x02,    ///< Delivered only once every other lane is empty
+    Counted = 0x04     ///< Took a credit (set by the queue)
+  };
+
+  static constexpr size_t kLanes = 3;
+
+  BluetoothHciDelivery();
+
+  /**
+   * @brief Binds delivery to a JS object whose emit() receives the events.
+   * @param env The N-API environment.
+   * @param target Object (an EventEmitter) to emit on.
+   * @param resourceName Resource name for debugging.
+   */
+  void start(Napi::Env env, Napi::Object target, const char* resourceName);
+
+  /**
+   * @brief Releases the thread-safe function; queued items are still delivered.
+   *
+   * Must be called once by the I/O thread when it exits.
+   */
+  void stop();
+
+  /**
+   * @brief Queues a packet for a "data" event, in the lane it classifies to.
+   * @param data Packet bytes (H4 framed).
+   * @param devId Adapter index (monitor channel only).
+   * @param direction "rx" or "tx" for monitor packets, nullptr otherwise.
+   * @param identity Identity the packet's address resolved to, passed as meta.identity.
+   * @param matches Ids of the catalog patterns matched, passed as meta.matches.
+   */
+  void push(std::string data, uint16_t devId = 0xFFFF, const char* direction = nullptr, HciRpaMatch identity = {},
+            std::vector<uint32_t> matches = {});
+
+  /**
+   * @brief Queues a custom event, delivered in order with the items of its lane.
+   * @param emit Called on the JS thread with the target object.
+   * @param lane Lane to queue in.
+   * @param flags Droppable and/or Barrier.
+   */
+  void push(std::function<void(Napi::Env, Napi::Object)> emit, Lane lane = Control, uint8_t flags = 0);
+
+  /**
+   * @brief Picks the lane of an H4 packet.
+   *
+   * Connection lifecycle events (connection and disconnection complete,
+   * encryption, LTK requests, completed packets, link updates, CIS/BIG setup)
+   * share the data lane, so none overtakes another or the data it frames.
+   * @param data Packet bytes (H4 framed).
+   * @return The packet's lane.
+   */
+  static Lane Classify(const std::string& data);
+
+  /**
+   * @brief Sets lane weights and depth limits (JS thread only).
+   * @param options Object with optional control, data and bulk entries, each
+   *                { weight, limit }; a limit of 0 means unbounded.
+   */
+  void setLanes(Napi::Object options);
+
+  /**
+   * @brief Reports per-lane depth, counters and queueing delay (JS thread only).
+   *
+   * Delay figures cover the items delivered since the previous call.
+   * @param env The N-API environment.
+   * @return Object with control, data and bulk entries.
+   */
+  Napi::Object stats(Napi::Env env);
+
+  /**
+   * @brief Bounds the packets queued for "data" events by a credit (JS thread only).
+   * @param credit Packets that may be queued before the I/O thread pauses, or negative to stop bounding.
+   */
+  void setCredit(int64_t credit);
+
+  /**
+   * @brief Returns credit for packets the consumer took (JS thread only).
+   * @param packets Packets taken.
+   */
+  void grant(int64_t packets);
+
+  /// Whether the I/O thread may read a packet now.
+  bool hasCredit() const {
+    return !_bounded.load(std::memory_order_relaxed) || _credit.load(std::memory_order_relaxed) > 0;
+  }
+
+  /**
+   * @brief Waits until the I/O thread may read a packet (I/O thread).
+   * @param timeoutMs Longest wait, so the caller can check its stop flag.
+   */
+  void waitCredit(int timeoutMs);
+
+  /**
+   * @brief Reports the credit, how often it ran out and how long reading waited for it.
+   * @param env The N-API environment.
+   * @param stats Object receiving credit (null if unbounded), stalls and stalledTime (ms).
+   */
+  void creditStats(Napi::Env env, Napi::Object stats);
+
+  /**
+   * @brief Registers direct per-type packet handlers (JS thread only).
+   *
+   * A packet whose H4 type has a handler is passed to it as (buffer[, meta])
+   * instead of being emitted as a "data" event.
+   * @param handlers Object with optional event, acl, iso and command functions,
+   *                 or a non-object to remove all handlers.
+   */
+  void setHandlers(Napi::Value handlers);
+
+  /**
+   * @brief Sets the identities resolved addresses are annotated with (JS thread only).
+   * @param identities Array indexed like the resolver's IRK list, or a non-array to clear.
+   * @param generation Resolver generation the array belongs to.
+   */
+  void setIdentities(Napi::Value identities, uint32_t generation);
+
+  /**
+   * @brief Looks up the identity of a match (JS thread only).
+   * @param env The N-API environment.
+   * @param match Resolver match.
+   * @return The identity, or undefined if unresolved or resolved against a replaced list.
+   */
+  Napi::Value identity(Napi::Env env, HciRpaMatch match);
+
+  /**
+   * @brief Converts catalog pattern ids to a JS array.
+   * @param env The N-API environment.
+   * @param ids Pattern ids.
+   * @return Array of numbers.
+   */
+  static Napi::Array Ids(Napi::Env env, const std::vector<uint32_t>& ids);
+
+  /**
+   * @brief Calls target.emit(...args); for use inside custom events.
+   * @param target Object to emit on.
+   * @param args Event name followed by its arguments.
+   */
+  static void Emit(Napi::Object target, const std::initializer_list<napi_value>& args);
+
+ private:
+  /// Maximum items delivered per JS callback before yielding to the event loop.
+  static constexpr size_t kMaxBatch = 256;
+
+  void enqueue(HciDeliveryItem item);
+  void schedule();
+  void drain(Napi::Env env);
+
+  /// Handler slots, indexed by H4 packet type.
+  static constexpr size_t kHandlerSlots = 6;
+
+  /// Lane names, as used by setLanes() and stats().
+  static const char* const kLaneNames[kLanes];
+
+  size_t queued() const;
+
+  Napi::ThreadSafeFunction _tsfn;   ///< Thread-safe function for callbacks
+  Napi::ObjectReference _target;    ///< Reference to the JavaScript object
+  Napi::FunctionReference _emit;    ///< The target's emit, looked up once
+  Napi::Reference<Napi::String> _dataEvent; ///< Interned "data" event name
+  Napi::FunctionReference _handlers[kHandlerSlots]; ///< Direct handlers by packet type
+  Napi::Reference<Napi::Array> _identities; ///< Identities by IRK index (JS thread only)
+  uint32_t _identityGeneration;     ///< Resolver generation of _identities
+  bool _started;                    ///< Whether the thread-safe function is live
+
+  std::mutex _mutex;                ///< Guards the lanes, their settings and the scheduled flag
+  std::deque<HciDeliveryItem> _lanes[kLanes]; ///< Items awaiting delivery, by lane
+  size_t _weights[kLanes];          ///< Items taken from each lane per round
+  size_t _limits[kLanes];           ///< Depth limit per lane, 0 for unbounded
+  HciDeliveryLaneStats _stats[kLanes]; ///< Counters per lane
+  bool _scheduled;                  ///< Whether a drain call is in flight
+  std::vector<HciDeliveryItem> _batch; ///< Items being delivered (JS thread only)
+
+  std::mutex _creditMutex;          ///< Pairs with _creditCondition
+  std::condition_variable _creditCondition; ///< Signalled when credit is granted or unbounded
+  std::atomic<bool> _bounded;       ///< Whether packets are bounded by credit
+  std::atomic<int64_t> _credit;     ///< Packets that may still be queued
+  std::atomic<uint64_t> _stalls;    ///< Times the credit ran out
+  std::atomic<uint64_t> _stalledNanos; ///< Time spent waiting for credit
+
+  // Disable copy constructor and assignment operator
+  BluetoothHciDelivery(const BluetoothHciDelivery&) = delete;
+  BluetoothHciDelivery& operator=(const BluetoothHciDelivery&) = delete;
+};
+
+#endif // BLUETOOTH_HCI_DELIVERY_H
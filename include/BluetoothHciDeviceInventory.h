@@ -0,0 +1,118 @@
+#ifndef BLUETOOTH_HCI_DEVICE_INVENTORY_H
+#define BLUETOOTH_HCI_DEVICE_INVENTORY_H
+
+// Include necessary headers
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Snapshot of a single HCI adapter as reported by HCIGETDEVINFO.
+ */
+struct HciDeviceEntry {
+  uint16_t devId;     ///< HCI device ID.
+  char     name[9];   ///< HCI device name (NUL terminated).
+  bdaddr_t address;   ///< Adapter address (little-endian).
+  uint8_t  bus;       ///< Bus type (USB, UART, ...).
+  uint8_t  type;      ///< Controller type (primary, AMP).
+  uint32_t flags;     ///< Device flags (HCI_UP, HCI_RUNNING, ...).
+  uint16_t aclMtu;    ///< ACL MTU.
+  uint16_t aclPkts;   ///< Number of ACL buffers.
+  uint16_t scoMtu;    ///< SCO MTU.
+  uint16_t scoPkts;   ///< Number of SCO buffers.
+
+  /// Checks if the device is up.
+  bool isUp() const { return (flags & (1 << HCI_UP)) != 0; }
+
+  /// Checks if anything but the statistics differs from another snapshot.
+  bool operator!=(const HciDeviceEntry& r) const {
+    return flags != r.flags || bus != r.bus || type != r.type ||
+           memcmp(address.b, r.address.b, sizeof(address.b)) != 0 ||
+           aclMtu != r.aclMtu || aclPkts != r.aclPkts ||
+           scoMtu != r.scoMtu || scoPkts != r.scoPkts;
+  }
+};
+
+/**
+ * @brief Cached inventory of the HCI adapters present on the system.
+ *
+ * The inventory is filled with HCIGETDEVLIST/HCIGETDEVINFO. While the owner
+ * is live, feeding it index added/removed/changed notifications from the
+ * monitor or management channel, it is filled once and kept current by them;
+ * otherwise every read queries the kernel again, so hotplug is never missed.
+ * Device ioctls are only accepted on raw channel sockets, so the inventory
+ * owns a private unbound HCI socket.
+ */
+class BluetoothHciDeviceInventory {
+ public:
+  /// Kind of change reported by update().
+  enum Change {
+    None,     ///< Nothing changed
+    Added,    ///< Device appeared
+    Removed,  ///< Device disappeared
+    Changed   ///< Device state or properties changed
+  };
+
+  BluetoothHciDeviceInventory();
+
+  /// Destructor
+  ~BluetoothHciDeviceInventory();
+
+  /**
+   * @brief Fills the inventory, unless it is loaded and index notifications keep it current.
+   * @return True if the inventory is loaded.
+   */
+  bool ensureLoaded();
+
+  /**
+   * @brief Sets whether index notifications are being fed.
+   * @param live True while the owner's monitor or management channel is polled.
+   */
+  void setLive(bool live);
+
+  /**
+   * @brief Re-reads a single device after an index notification.
+   * @param devId HCI device ID.
+   * @param entry Receives the current snapshot of the device.
+   * @return Kind of change compared to the cached snapshot.
+   */
+  Change update(uint16_t devId, HciDeviceEntry* entry);
+
+  /**
+   * @brief Drops a device after a removal notification.
+   * @param devId HCI device ID.
+   * @return Removed if the device was known, None otherwise.
+   */
+  Change remove(uint16_t devId);
+
+  /**
+   * @brief Returns all cached devices ordered by device ID.
+   */
+  std::vector<HciDeviceEntry> list();
+
+  /**
+   * @brief Finds the first device whose up-state matches.
+   * @param isUp Requested up-state.
+   * @param devId Receives the device ID.
+   * @return True if a device was found.
+   */
+  bool firstMatching(bool isUp, uint16_t* devId);
+
+ private:
+  /// Issues HCIGETDEVINFO for one device.
+  bool readDeviceInfo(uint16_t devId, HciDeviceEntry* entry);
+
+  int _socket;                                ///< Unbound HCI socket used for ioctls
+  bool _loaded;                               ///< Whether the initial scan completed
+  std::atomic<bool> _live;                    ///< Whether index notifications keep the devices current
+  std::mutex _mutex;                          ///< Guards the device map
+  std::map<uint16_t, HciDeviceEntry> _devices; ///< Devices by ID
+
+  // Disable copy constructor and assignment operator
+  BluetoothHciDeviceInventory(const BluetoothHciDeviceInventory&) = delete;
+  BluetoothHciDeviceInventory& operator=(const BluetoothHciDeviceInventory&) = delete;
+};
+
+#endif // BLUETOOTH_HCI_DEVICE_INVENTORY_H
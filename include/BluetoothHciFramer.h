@@ -0,0 +1,55 @@
+#ifndef BLUETOOTH_HCI_FRAMER_H
+#define BLUETOOTH_HCI_FRAMER_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include "BluetoothHciPacketFramer.h" // Header for BluetoothHciPacketFramer class
+
+/**
+ * @brief JS binding of the streaming H4 packet framer.
+ *
+ * Shared by the USB and UART drivers to split transport chunks into packets.
+ * Unlike the socket classes it is built on every platform.
+ */
+class BluetoothHciFramer : public Napi::ObjectWrap<BluetoothHciFramer> {
+ public:
+  /**
+   * @brief Initializes the BluetoothHciFramer class and sets up exports to Node.js.
+   * @param env The N-API environment.
+   * @param exports The exports object to which the class is added.
+   * @return The modified exports object.
+   */
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  /**
+   * @brief Constructor for BluetoothHciFramer.
+   * @param info Callback information from N-API (optional fixed packet type).
+   */
+  BluetoothHciFramer(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Pushes a chunk and returns every packet it completes.
+   * @param info Callback information from N-API (chunk buffer).
+   * @return Napi::Value containing an array of H4 packets.
+   */
+  Napi::Value Push(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Drops any partially received packet.
+   * @param info Callback information from N-API.
+   */
+  void Reset(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the number of buffered and skipped bytes.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the framer statistics.
+   */
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+ private:
+  BluetoothHciPacketFramer _framer; ///< Framing state
+};
+
+#endif // BLUETOOTH_HCI_FRAMER_H
@@ -0,0 +1,99 @@
+#ifndef BLUETOOTH_HCI_ISO_H
+#define BLUETOOTH_HCI_ISO_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One reassembled ISO SDU.
+ */
+struct HciIsoSdu {
+  uint16_t connHandle;      ///< CIS or BIS connection handle.
+  bool hasTimestamp;        ///< Whether the controller supplied a timestamp.
+  uint32_t timestamp;       ///< Time stamp in microseconds.
+  uint16_t sequenceNumber;  ///< Packet sequence number.
+  uint8_t status;           ///< Packet status flag: 0 valid, 1 possibly invalid, 2 lost.
+  std::string data;         ///< SDU bytes, in a buffer taken from the pool.
+};
+
+/**
+ * @brief Reassembles incoming ISO SDUs and fragments outgoing ones.
+ *
+ * Fed every incoming H4 packet on the polling thread. ISO data packets are
+ * reassembled per connection handle; the controller's ISO buffer size is
+ * learned from the LE Read Buffer Size [v2] Command Complete event. SDU
+ * buffers come from a small pool and are returned once delivered, so a
+ * steady stream reuses the same allocations.
+ */
+class BluetoothHciIsoAssembler {
+ public:
+  /// Receives one reassembled SDU.
+  typedef std::function<void(HciIsoSdu&)> Callback;
+
+  BluetoothHciIsoAssembler();
+
+  /**
+   * @brief Feeds one incoming H4 packet.
+   * @param data Packet bytes, starting with the H4 packet type.
+   * @param length Length of the packet.
+   * @param onSdu Called for every completed SDU.
+   * @return True if the packet was ISO data.
+   */
+  bool observe(const uint8_t* data, size_t length, const Callback& onSdu);
+
+  /// Drops partial SDUs; the learned buffer size is kept.
+  void reset();
+
+  /// Returns an SDU buffer to the pool.
+  void release(std::string buffer);
+
+  /// Controller ISO data packet length, 0 until learned.
+  uint16_t mtu() const { return _mtu; }
+
+  /// SDUs dropped because fragments were missing.
+  uint64_t dropped() const { return _dropped; }
+
+  /**
+   * @brief Splits an SDU into H4 ISO data packets.
+   * @param connHandle Connection handle.
+   * @param sdu SDU bytes.
+   * @param length SDU length (at most 4095).
+   * @param sequenceNumber Packet sequence number.
+   * @param hasTimestamp Whether to include a time stamp.
+   * @param timestamp Time stamp in microseconds.
+   * @param mtu Maximum ISO data load per packet.
+   * @return The packets, in order.
+   */
+  static std::vector<std::string> Fragment(uint16_t connHandle, const uint8_t* sdu, size_t length,
+                                           uint16_t sequenceNumber, bool hasTimestamp, uint32_t timestamp,
+                                           uint16_t mtu);
+
+ private:
+  /// Buffers kept in the pool.
+  static constexpr size_t kPoolSize = 32;
+
+  /// SDU in progress on one connection handle.
+  struct Partial {
+    HciIsoSdu sdu;        ///< Header fields and data gathered so far
+    size_t expected;      ///< ISO_SDU_Length from the first fragment
+    bool overrun;         ///< Longer than expected: dropped, fragments skipped until the last
+  };
+
+  std::string acquire();
+  void learnMtu(const uint8_t* data, size_t length);
+
+  std::map<uint16_t, Partial> _partial;  ///< Partial SDUs by handle (polling thread only)
+  uint16_t _mtu;                         ///< Controller ISO buffer size
+  uint64_t _dropped;                     ///< Incomplete SDUs dropped
+
+  std::mutex _poolMutex;                 ///< Guards the pool (released from the JS thread)
+  std::vector<std::string> _pool;        ///< Reusable SDU buffers
+};
+
+#endif // BLUETOOTH_HCI_ISO_H
@@ -0,0 +1,279 @@
+#ifndef BLUETOOTH_HCI_L2_CHANNEL_H
+#define BLUETOOTH_HCI_L2_CHANNEL_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include <atomic>         // For std::atomic
+#include <chrono>         // For write latency
+#include <cstdint>        // For fixed-width integer types
+#include <deque>          // For std::deque
+#include <map>            // For std::map
+#include <memory>         // For std::shared_ptr
+#include <mutex>          // For std::mutex
+#include <string>         // For std::string
+#include <thread>         // For std::thread
+#include <vector>         // For std::vector
+#include "BluetoothHciDelivery.h"   // Header for BluetoothHciDelivery class
+#include "BluetoothHciThread.h"     // Header for BluetoothHciThread helpers
+#include "BluetoothStructs.h"       // For struct sockaddr_l2
+
+/**
+ * @brief Receive buffers of one channel, handed to JS without a copy.
+ *
+ * SDUs are read straight into a buffer taken from the pool, which becomes the
+ * backing store of the "data" event's Buffer; the Buffer's finalizer returns
+ * it. The pool outlives the channel while any of its buffers is referenced.
+ */
+class BluetoothHciL2SduPool : public std::enable_shared_from_this<BluetoothHciL2SduPool> {
+ public:
+  struct Block {
+    std::unique_ptr<char[]> data;                  ///< Capacity of the pool's buffer size
+    size_t length = 0;                             ///< Length of the SDU read into it
+    std::shared_ptr<BluetoothHciL2SduPool> owner;  ///< Set while handed out
+  };
+
+  /**
+   * @brief Creates a pool.
+   * @param size Size of each buffer, the channel's receive MTU.
+   */
+  explicit BluetoothHciL2SduPool(size_t size) : _size(size) {}
+
+  /// Takes a buffer, allocating one if the pool is empty.
+  Block* take();
+
+  /// Returns a buffer; called from the Buffer's finalizer.
+  static void give(Block* block);
+
+  /// Size of each buffer.
+  size_t size() const { return _size; }
+
+ private:
+  /// Buffers kept in the pool.
+  static constexpr size_t kPoolSize = 64;
+
+  size_t _size;                                 ///< Size of each buffer
+  std::mutex _mutex;                            ///< Guards the free list (returned from the JS thread)
+  std::vector<std::unique_ptr<Block>> _free;    ///< Reusable buffers
+};
+
+/**
+ * @brief Class representing an LE credit based L2CAP channel.
+ *
+ * Connects to or listens on a PSM through the kernel's L2CAP sockets, so the
+ * kernel does the segmentation, reassembly and credit accounting. A single
+ * thread per channel polls the socket: it reads SDUs in batches (recvmmsg)
+ * into pooled buffers delivered through BluetoothHciDelivery without a copy,
+ * and sends the write queue in batches (sendmmsg), waiting for the socket to
+ * be writable again whenever its send buffer is full.
+ *
+ * The thread is per channel rather than one poll loop shared by all, like the
+ * HCI socket's: each channel has its own scheduling options (a bulk transfer
+ * can be pinned and prioritised apart from the others) and its own delivery,
+ * whose thread-safe function the thread releases when it exits.
+ */
+class BluetoothHciL2Channel : public Napi::ObjectWrap<BluetoothHciL2Channel> {
+ public:
+  /**
+   * @brief Initializes the BluetoothHciL2Channel class and sets up exports to Node.js.
+   * @param env The N-API environment.
+   * @param exports The exports object to which the class is added.
+   * @return The modified exports object.
+   */
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  /**
+   * @brief Constructor for BluetoothHciL2Channel.
+   * @param info Callback information from N-API.
+   */
+  BluetoothHciL2Channel(const Napi::CallbackInfo& info);
+
+  /// Destructor
+  ~BluetoothHciL2Channel();
+
+  /**
+   * @brief Connects to a PSM of a peer; "connect" is emitted once the channel is open.
+   * @param info Callback information from N-API ({ address, addressType, psm, mtu, security, source, highWaterMark }).
+   */
+  void Connect(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Listens on a PSM; each accepted channel is emitted as "accept" with its descriptor.
+   * @param info Callback information from N-API ({ psm, mtu, security, source, backlog }).
+   * @return Napi::Value containing the PSM listened on (allocated by the kernel for 0).
+   */
+  Napi::Value Listen(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Takes over an accepted channel's descriptor.
+   * @param info Callback information from N-API (descriptor, { highWaterMark }).
+   */
+  void Adopt(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Queues an SDU.
+   * @param info Callback information from N-API (SDU buffer).
+   * @return Napi::Value false once the queued bytes reach the high water mark; "drain" follows.
+   */
+  Napi::Value Write(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets affinity, nice or SCHED_FIFO priority and name of the channel's thread.
+   * @param info Callback information from N-API ({ cpus, nice, priority, name }, or null).
+   */
+  void SetThreadOptions(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the channel's counters, and its throughput and latencies since the previous call.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the stats object.
+   */
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Stops the channel's thread and closes the socket.
+   * @param info Callback information from N-API.
+   */
+  void Close(const Napi::CallbackInfo& info);
+
+ private:
+  enum State : uint8_t {
+    Idle,         ///< No socket
+    Connecting,   ///< Waiting for the connection to complete
+    Listening,    ///< Accepting channels
+    Open          ///< Transferring SDUs
+  };
+
+  struct PendingSdu {
+    std::string data;                                ///< SDU bytes
+    std::chrono::steady_clock::time_point queued;    ///< When write() queued it
+  };
+
+  struct Counters {
+    uint64_t rxBytes = 0;            ///< Bytes received
+    uint64_t rxSdus = 0;             ///< SDUs received
+    uint64_t txBytes = 0;            ///< Bytes sent
+    uint64_t txSdus = 0;             ///< SDUs sent
+    uint64_t intervalRx = 0;         ///< Bytes received since the previous stats
+    uint64_t intervalTx = 0;         ///< Bytes sent since the previous stats
+    uint64_t writes = 0;             ///< SDUs sent since the previous stats
+    uint64_t writeLatency = 0;       ///< Sum of their queue to send latencies, in microseconds
+    uint64_t maxWriteLatency = 0;    ///< Largest of them
+    uint64_t deliveries = 0;         ///< Batches delivered since the previous stats
+    uint64_t deliveryLatency = 0;    ///< Sum of their read to emit latencies, in microseconds
+    uint64_t maxDeliveryLatency = 0; ///< Largest of them
+  };
+
+  /**
+   * @brief Creates a non-blocking L2CAP socket bound to the source address, with the options applied.
+   * @param env The N-API environment; errors are thrown to it.
+   * @param options Options object of connect() or listen().
+   * @param psm PSM to bind (0 for connect).
+   * @return The descriptor, or -1 with an exception pending.
+   */
+  int OpenSocket(Napi::Env env, Napi::Object options, uint16_t psm);
+
+  /**
+   * @brief Starts the delivery and the channel's thread.
+   * @param info Callback information from N-API.
+   * @param state State the thread starts in.
+   */
+  void StartThread(const Napi::CallbackInfo& info, State state);
+
+  /**
+   * @brief Joins the channel's thread and closes the socket, and the accepted channels not yet emitted.
+   */
+  void StopThread();
+
+  /**
+   * @brief Polls the socket in a separate thread.
+   */
+  void PollLoop();
+
+  /**
+   * @brief Completes a non-blocking connect.
+   * @return False if the connection failed.
+   */
+  bool FinishConnect();
+
+  /**
+   * @brief Accepts the pending channels.
+   */
+  void AcceptChannels();
+
+  /**
+   * @brief Reads a batch of SDUs and delivers them.
+   * @return False if the peer closed the channel or reading failed.
+   */
+  bool ReadSdus();
+
+  /**
+   * @brief Sends queued SDUs until the queue is empty or the send buffer is full.
+   * @param blocked Set when the socket takes no more, until it polls writable.
+   * @return False if sending failed.
+   */
+  bool SendQueued(bool& blocked);
+
+  /**
+   * @brief Reads the negotiated MTUs of the open channel.
+   */
+  void ReadMtus();
+
+  /**
+   * @brief Emits an error for a failed system call through the delivery.
+   * @param syscall Name of the system call.
+   * @param error errno value.
+   */
+  void PushError(const char* syscall, int error);
+
+  /**
+   * @brief Wakes the channel's thread from poll().
+   */
+  void Wake();
+
+  /**
+   * @brief Parses a "xx:xx:xx:xx:xx:xx" address.
+   * @param str Address string.
+   * @param address Receives the address.
+   * @return True if the string is an address.
+   */
+  static bool ParseAddress(const std::string& str, bdaddr_t* address);
+
+  /**
+   * @brief Formats an address as "xx:xx:xx:xx:xx:xx".
+   * @param address Address.
+   * @return The string.
+   */
+  static std::string FormatAddress(const bdaddr_t& address);
+
+  int _socket;                      ///< L2CAP socket, or -1
+  int _wake;                        ///< eventfd waking the thread, or -1
+  State _state;                     ///< State (channel thread once started)
+  sockaddr_l2 _peer;                ///< Address connected to
+
+  std::atomic<uint16_t> _rxMtu;     ///< Receive MTU of the open channel
+  std::atomic<uint16_t> _txMtu;     ///< Send MTU of the open channel
+  std::shared_ptr<BluetoothHciL2SduPool> _pool; ///< Receive buffers
+
+  std::mutex _queueMutex;           ///< Guards the write queue and its counters
+  std::deque<PendingSdu> _queue;    ///< SDUs not yet accepted by the socket
+  size_t _queuedBytes;              ///< Bytes in the queue
+  size_t _highWaterMark;            ///< Queued bytes at which write() returns false
+  bool _needDrain;                  ///< Whether write() returned false since the last "drain"
+
+  std::mutex _statsMutex;           ///< Guards the counters (read from the JS thread)
+  Counters _counters;               ///< Traffic counters
+  std::chrono::steady_clock::time_point _statsSince; ///< Start of the stats interval
+
+  std::mutex _acceptedMutex;        ///< Guards _accepted and _acceptSequence
+  std::map<uint64_t, int> _accepted; ///< Accepted descriptors not yet emitted, by sequence; closed on stop
+  uint64_t _acceptSequence;         ///< Sequence of the next accepted descriptor
+
+  std::atomic<bool> stopFlag;       ///< Atomic flag to signal the thread to stop
+  std::thread pollingThread;        ///< Thread polling the socket
+  HciThreadOptions _threadOptions;  ///< Applied by the channel's thread when it starts
+
+  BluetoothHciDelivery _delivery;   ///< Batched thread-safe delivery to `emit`
+};
+
+#endif // BLUETOOTH_HCI_L2_CHANNEL_H
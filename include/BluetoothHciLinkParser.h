@@ -0,0 +1,64 @@
+#ifndef BLUETOOTH_HCI_LINK_PARSER_H
+#define BLUETOOTH_HCI_LINK_PARSER_H
+
+// Include necessary headers
+#include <cstddef>
+#include <cstdint>
+#include "BluetoothStructs.h"
+
+/**
+ * @brief LE link established or torn down, taken from an HCI event.
+ */
+struct HciLinkEvent {
+  enum Type : uint8_t {
+    Connected,     ///< LE (Enhanced) Connection Complete, success
+    Disconnected   ///< Disconnection Complete, success
+  };
+
+  Type type;          ///< What happened to the link
+  uint16_t handle;    ///< Connection handle
+  bdaddr_t peer;      ///< Peer address (Connected only)
+  uint8_t peerType;   ///< Peer address type as in the event (Connected only)
+};
+
+/**
+ * @brief LE (Extended) Create Connection, taken from an HCI command.
+ */
+struct HciCreateConnection {
+  bdaddr_t peer;                ///< Peer address
+  uint8_t peerType;             ///< Peer address type as in the command
+  uint8_t filterPolicy;         ///< Initiator filter policy; bit 0 set connects through the accept list
+  uint16_t connMinInterval;     ///< Minimum connection interval
+  uint16_t connMaxInterval;     ///< Maximum connection interval
+  uint16_t connLatency;         ///< Peripheral latency
+  uint16_t supervisionTimeout;  ///< Supervision timeout
+};
+
+/**
+ * @brief Parses the packets the raw channel kernel workarounds act on.
+ *
+ * Kept free of sockets and locks so the per-packet checks are cheap and can
+ * be exercised without an adapter (see bench/hci_bench.cpp).
+ */
+class BluetoothHciLinkParser {
+ public:
+  /**
+   * @brief Parses a successful LE connection or disconnection event.
+   * @param data Packet bytes (H4 framed).
+   * @param length Packet length.
+   * @param event Receives the link event.
+   * @return true if the packet is one.
+   */
+  static bool ParseLinkEvent(const uint8_t* data, size_t length, HciLinkEvent& event);
+
+  /**
+   * @brief Parses an LE Create Connection or LE Extended Create Connection command.
+   * @param data Packet bytes (H4 framed).
+   * @param length Packet length.
+   * @param command Receives the peer and its (first PHY's) connection parameters.
+   * @return true if the packet is one.
+   */
+  static bool ParseCreateConnection(const uint8_t* data, size_t length, HciCreateConnection& command);
+};
+
+#endif // BLUETOOTH_HCI_LINK_PARSER_H
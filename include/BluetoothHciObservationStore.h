@@ -0,0 +1,196 @@
+#ifndef BLUETOOTH_HCI_OBSERVATION_STORE_H
+#define BLUETOOTH_HCI_OBSERVATION_STORE_H
+
+// Include necessary headers
+#include <atomic>         // For std::atomic
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <mutex>          // For std::mutex
+#include <string>         // For std::string
+#include <string_view>    // For std::string_view
+#include <unordered_map>  // For std::unordered_map
+#include <vector>         // For std::vector
+
+/**
+ * @brief One stored advertisement.
+ */
+struct HciObservation {
+  uint64_t time;            ///< Wall clock time, in ms since the epoch
+  uint8_t addressType;      ///< Address type from the report
+  uint8_t address[6];       ///< Address, little endian
+  int8_t rssi;              ///< RSSI
+  uint16_t eventType;       ///< Report event type
+  std::string data;         ///< Advertising data
+};
+
+/**
+ * @brief Observations to read back.
+ */
+struct HciObservationQuery {
+  uint64_t from = 0;                ///< First time included, ms since the epoch
+  uint64_t to = UINT64_MAX;         ///< First time excluded
+  bool byAddress = false;           ///< Whether only one device is wanted
+  int16_t addressType = -1;         ///< Its address type, or negative for either
+  uint8_t address[6] = {};          ///< Its address, little endian
+  size_t limit = SIZE_MAX;          ///< Oldest observations returned at most
+};
+
+/**
+ * @brief Counters of a BluetoothHciObservationStore.
+ */
+struct HciObservationStoreStats {
+  size_t segments;          ///< Segment files, the open one included
+  uint64_t bytes;           ///< Bytes used by them
+  uint64_t records;         ///< Observations in them
+  uint64_t appended;        ///< Observations appended since opened
+  uint64_t deduplicated;    ///< Of which referenced a payload already stored
+  uint64_t dropped;         ///< Observations lost to a segment that could not be created
+  uint64_t pruned;          ///< Segments deleted by the retention limits
+};
+
+/**
+ * @brief Appends advertisements to memory-mapped, time partitioned segment files.
+ *
+ * Each segment holds the observations of one partition of time (segments
+ * start at multiples of the segment duration; a full one is continued in a
+ * next part) as fixed 20 byte records pointing into a payload area, where
+ * identical advertising data is stored once. The open segment is a file
+ * reserved up front and mapped, so appending is a copy into the mapping.
+ * Sealing compacts it and appends an index of record numbers by address;
+ * queries map sealed segments read only and touch only the index and the
+ * records they return. Segments left open by a crash are sealed when the
+ * directory is opened again.
+ *
+ * Oldest segments are deleted past a total size or an age. Times never go
+ * back within a segment: a wall clock stepped back is clamped. Thread safe;
+ * the polling thread appends while the JS thread queries.
+ */
+class BluetoothHciObservationStore {
+ public:
+  /// Store tuning.
+  struct Options {
+    uint64_t segmentDuration = 3600000;   ///< Ms of observations per segment
+    size_t segmentSize = 16 << 20;        ///< Bytes reserved for the open segment
+    uint64_t maxBytes = 0;                ///< Bytes kept at most, 0 for no limit
+    uint64_t maxAge = 0;                  ///< Ms observations are kept, 0 for no limit
+  };
+
+  BluetoothHciObservationStore();
+  ~BluetoothHciObservationStore();
+
+  /**
+   * @brief Opens a directory, creating it if needed, and closes any previous one.
+   * @param directory Directory of the segment files.
+   * @param options Tuning.
+   * @param now Wall clock time in ms, for the retention limits.
+   * @return 0, or errno.
+   */
+  int open(const std::string& directory, const Options& options, uint64_t now);
+
+  /// Seals the open segment and stops appending.
+  void close();
+
+  /// Whether a directory is open.
+  bool isOpen() const { return _isOpen.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Appends one advertisement.
+   * @param encoded Advertisement in the HciAdvertisementLayout encoding.
+   * @param now Wall clock time in ms.
+   * @return 0, or errno the first time a segment cannot be created after succeeding.
+   */
+  int append(const std::string& encoded, uint64_t now);
+
+  /**
+   * @brief Reads observations back, oldest first.
+   * @param query Time range, device and limit.
+   * @param observations Receives the observations.
+   * @return Number of observations.
+   */
+  size_t query(const HciObservationQuery& query, std::vector<HciObservation>& observations);
+
+  /// Counters.
+  HciObservationStoreStats stats();
+
+ private:
+  struct Header;
+  struct Record;
+  struct IndexEntry;
+
+  /// Sealed segment.
+  struct Segment {
+    std::string path;     ///< File
+    uint64_t start;       ///< Partition start, ms
+    uint32_t part;        ///< Part within the partition
+    uint64_t end;         ///< Time of the last record
+    uint64_t bytes;       ///< File size
+    uint32_t records;     ///< Records
+  };
+
+  /// Segment being appended to.
+  struct OpenSegment {
+    int fd = -1;                                       ///< File
+    uint8_t* base = nullptr;                           ///< Mapping
+    size_t mapped = 0;                                 ///< Mapping length
+    Segment info;                                      ///< Name and counters
+    std::unordered_map<std::string_view, uint32_t> payloads; ///< Stored payloads, viewing the mapping
+    std::unordered_map<uint64_t, std::vector<uint32_t>> index; ///< Record numbers by address
+  };
+
+  /// Index key of an address; either address type shares it.
+  static uint64_t Key(const uint8_t* address);
+
+  /**
+   * @brief Validates a mapped segment.
+   * @return The header, or nullptr if the file is not a segment.
+   */
+  static const Header* Validate(const uint8_t* base, size_t length);
+
+  /**
+   * @brief Reads matching records of a segment.
+   * @param base Mapping.
+   * @param index Index of the open segment, or nullptr to use the sealed one.
+   * @param query Query.
+   * @param observations Receives the observations, up to the query's limit.
+   */
+  static void Query(const uint8_t* base, const std::unordered_map<uint64_t, std::vector<uint32_t>>* index,
+                    const HciObservationQuery& query, std::vector<HciObservation>& observations);
+
+  /**
+   * @brief Compacts a mapped segment and writes its index; the mapping and file are released.
+   * @param fd File.
+   * @param base Mapping.
+   * @param mapped Mapping length.
+   * @param info Receives the sealed size.
+   * @return 0, or errno.
+   */
+  static int Seal(int fd, uint8_t* base, size_t mapped, Segment& info);
+
+  /**
+   * @brief Creates the segment an observation at a time goes to.
+   * @return 0, or errno.
+   */
+  int create(uint64_t time);
+
+  /// Seals the open segment, if any.
+  void seal();
+
+  /// Deletes the oldest sealed segments beyond the retention limits.
+  void prune(uint64_t now);
+
+  std::mutex _mutex;                  ///< Guards all state
+  std::atomic<bool> _isOpen;          ///< Whether a directory is open
+  std::string _directory;             ///< Directory of the segments
+  Options _options;                   ///< Current tuning
+  std::vector<Segment> _segments;     ///< Sealed segments, oldest first
+  OpenSegment _open;                  ///< Segment being appended to, fd -1 if none
+  bool _failing;                      ///< Whether the last segment creation failed
+  uint64_t _retryAt;                  ///< Wall clock ms before which it is not retried
+
+  uint64_t _appended;                 ///< Observations appended
+  uint64_t _deduplicated;             ///< Of which with a payload already stored
+  uint64_t _dropped;                  ///< Observations lost
+  uint64_t _pruned;                   ///< Segments deleted
+};
+
+#endif // BLUETOOTH_HCI_OBSERVATION_STORE_H
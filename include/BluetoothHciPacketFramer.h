@@ -0,0 +1,204 @@
+#ifndef BLUETOOTH_HCI_PACKET_FRAMER_H
+#define BLUETOOTH_HCI_PACKET_FRAMER_H
+
+// Include necessary headers
+#include <cstddef>       // For size_t
+#include <cstdint>       // For fixed-width integer types
+#include <cstring>       // For memcpy
+#include <vector>        // For std::vector
+
+/**
+ * @brief Streaming H4 packet framer.
+ *
+ * Splits a byte stream (UART, USB endpoints) into complete HCI packets. Whole
+ * packets are handed out as pointers into the pushed chunk; only a packet that
+ * straddles two chunks is staged, in a buffer that is reused for the lifetime
+ * of the framer, so the cost is linear in the input regardless of chunking.
+ *
+ * This header is portable (it is also built for the USB and UART drivers on
+ * Windows and macOS) and must not depend on Linux socket headers.
+ */
+class BluetoothHciPacketFramer {
+ public:
+  /// H4 packet types understood by the framer.
+  enum PacketType : uint8_t {
+    Command = 0x01,  ///< HCI command
+    AclData = 0x02,  ///< ACL data
+    ScoData = 0x03,  ///< SCO data
+    Event   = 0x04,  ///< HCI event
+    IsoData = 0x05   ///< ISO data
+  };
+
+  /**
+   * @brief Constructor for BluetoothHciPacketFramer.
+   * @param packetType 0 for an H4 stream where every packet starts with its
+   *        type, or the fixed type of a stream without type bytes (e.g. the
+   *        USB event or ACL endpoint).
+   */
+  explicit BluetoothHciPacketFramer(uint8_t packetType = 0) :
+    _packetType(packetType),
+    _desyncs(0)
+  {
+    _pending.reserve(kInitialPendingCapacity);
+  }
+
+  /**
+   * @brief Pushes a chunk and hands out every packet it completes.
+   * @param data Chunk bytes.
+   * @param length Length of the chunk.
+   * @param onPacket Called as onPacket(type, body, bodyLength) for each packet,
+   *        body excluding the H4 type byte. The pointer is only valid during the call.
+   * @return Number of packets handed out.
+   */
+  template <typename F>
+  size_t push(const uint8_t* data, size_t length, F&& onPacket) {
+    size_t count = 0;
+
+    // Finish the packet left over from the previous chunk first
+    if (!_pending.empty()) {
+      size_t used = this->completePending(data, length);
+      data += used;
+      length -= used;
+
+      size_t total = this->frameLength(_pending.data(), _pending.size());
+      if (total == 0 || _pending.size() < total) {
+        return 0;  // Chunk exhausted before the packet completed
+      }
+
+      size_t skip = _packetType ? 0 : 1;
+      onPacket(this->typeOf(_pending.data()), _pending.data() + skip, total - skip);
+      _pending.clear();
+      count++;
+    }
+
+    // Whole packets are handed out in place
+    while (length > 0) {
+      if (_packetType == 0 && headerLength(data[0]) == 0) {
+        // Not a packet start; skip a byte and try to resynchronise
+        _desyncs++;
+        data++;
+        length--;
+        continue;
+      }
+
+      size_t total = this->frameLength(data, length);
+      if (total == 0 || length < total) {
+        _pending.assign(data, data + length);
+        break;
+      }
+
+      size_t skip = _packetType ? 0 : 1;
+      onPacket(this->typeOf(data), data + skip, total - skip);
+      data += total;
+      length -= total;
+      count++;
+    }
+
+    return count;
+  }
+
+  /// Drops any partially received packet.
+  void reset() {
+    _pending.clear();
+  }
+
+  /// Returns the number of bytes held for an incomplete packet.
+  size_t buffered() const {
+    return _pending.size();
+  }
+
+  /// Returns the number of bytes skipped because they could not start a packet.
+  uint64_t desyncs() const {
+    return _desyncs;
+  }
+
+  /**
+   * @brief Returns the header length of a packet type, excluding the type byte.
+   * @param type H4 packet type.
+   * @return Header length, or 0 for unknown types.
+   */
+  static size_t headerLength(uint8_t type) {
+    switch (type) {
+      case Command: return 3;  // opcode (2), length (1)
+      case AclData: return 4;  // handle (2), length (2)
+      case ScoData: return 3;  // handle (2), length (1)
+      case Event:   return 2;  // event code (1), length (1)
+      case IsoData: return 4;  // handle (2), length (14 bits)
+      default:      return 0;
+    }
+  }
+
+  /**
+   * @brief Returns the payload length announced by a complete header.
+   * @param type H4 packet type.
+   * @param header Header bytes, excluding the type byte.
+   * @return Payload length.
+   */
+  static size_t payloadLength(uint8_t type, const uint8_t* header) {
+    switch (type) {
+      case Command: return header[2];
+      case AclData: return header[2] | (header[3] << 8);
+      case ScoData: return header[2];
+      case Event:   return header[1];
+      case IsoData: return (header[2] | (header[3] << 8)) & 0x3FFF;
+      default:      return 0;
+    }
+  }
+
+ private:
+  static constexpr size_t kInitialPendingCapacity = 1024;
+
+  /// Returns the type of the packet starting at data.
+  uint8_t typeOf(const uint8_t* data) const {
+    return _packetType ? _packetType : data[0];
+  }
+
+  /**
+   * @brief Returns the full length of the packet starting at data.
+   * @return Length including type byte and header, or 0 if the header is incomplete.
+   */
+  size_t frameLength(const uint8_t* data, size_t length) const {
+    size_t skip = _packetType ? 0 : 1;
+    uint8_t type = this->typeOf(data);
+    size_t header = headerLength(type);
+
+    if (length < skip + header) {
+      return 0;
+    }
+    return skip + header + payloadLength(type, data + skip);
+  }
+
+  /**
+   * @brief Moves bytes from a chunk into the pending packet.
+   * @return Number of bytes consumed from the chunk.
+   */
+  size_t completePending(const uint8_t* data, size_t length) {
+    size_t used = 0;
+
+    // Complete the header first so the total length is known
+    size_t skip = _packetType ? 0 : 1;
+    size_t header = skip + headerLength(this->typeOf(_pending.data()));
+    if (_pending.size() < header) {
+      size_t n = header - _pending.size();
+      if (n > length) n = length;
+      _pending.insert(_pending.end(), data, data + n);
+      used += n;
+    }
+
+    size_t total = this->frameLength(_pending.data(), _pending.size());
+    if (total > _pending.size()) {
+      size_t n = total - _pending.size();
+      if (n > length - used) n = length - used;
+      _pending.insert(_pending.end(), data + used, data + used + n);
+      used += n;
+    }
+
+    return used;
+  }
+
+  uint8_t _packetType;            ///< Fixed packet type, or 0 for H4 streams
+  uint64_t _desyncs;              ///< Bytes skipped while resynchronising
+  std::vector<uint8_t> _pending;  ///< Partially received packet (reused)
+};
+
+#endif // BLUETOOTH_HCI_PACKET_FRAMER_H
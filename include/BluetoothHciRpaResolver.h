@@ -0,0 +1,129 @@
+#ifndef BLUETOOTH_HCI_RPA_RESOLVER_H
+#define BLUETOOTH_HCI_RPA_RESOLVER_H
+
+// Include necessary headers
+#include <array>          // For std::array
+#include <atomic>         // For std::atomic
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <list>           // For std::list
+#include <mutex>          // For std::mutex
+#include <unordered_map>  // For std::unordered_map
+#include <vector>         // For std::vector
+#include "BluetoothStructs.h"
+
+/**
+ * @brief Identity a resolvable private address resolved to.
+ *
+ * The index is only meaningful within the generation of the IRK list it was
+ * resolved against; setKeys() starts a new generation.
+ */
+struct HciRpaMatch {
+  uint32_t generation = 0;  ///< Generation of the IRK list
+  int32_t index = -1;       ///< Index of the IRK in the list, -1 if unresolved
+
+  explicit operator bool() const { return index >= 0; }
+};
+
+/**
+ * @brief Counters of a BluetoothHciRpaResolver.
+ */
+struct HciRpaResolverStats {
+  size_t keys;            ///< IRKs in the list
+  size_t cached;          ///< Addresses in the cache
+  uint64_t hits;          ///< Lookups answered by the cache
+  uint64_t misses;        ///< Lookups that scanned the IRK list
+  uint64_t resolved;      ///< Scans that found the address's IRK
+};
+
+/**
+ * @brief Resolves resolvable private addresses against a list of IRKs.
+ *
+ * An address resolves to the IRK whose ah(irk, prand) equals its hash. The
+ * key schedules are expanded once per list, and the list is scanned with
+ * AES-NI, eight keys in flight, when the CPU has it; otherwise with a table
+ * based AES. Results, including addresses no IRK resolves, are kept in an
+ * LRU cache with expiry so a device is scanned for once per address.
+ */
+class BluetoothHciRpaResolver {
+ public:
+  using Key = std::array<uint8_t, 16>;  ///< IRK, most significant octet first
+
+  /**
+   * @brief Creates a resolver.
+   * @param accelerate Use AES-NI when the CPU has it.
+   */
+  explicit BluetoothHciRpaResolver(bool accelerate = true);
+
+  /**
+   * @brief Replaces the IRK list and clears the cache.
+   * @param keys IRKs, most significant octet first.
+   * @param cacheSize Addresses kept in the cache.
+   * @param cacheTtl Milliseconds a cached result is kept.
+   * @return Generation of the new list.
+   */
+  uint32_t setKeys(const std::vector<Key>& keys, size_t cacheSize, uint64_t cacheTtl);
+
+  /// Whether the list is empty, without locking.
+  bool empty() const { return _count.load(std::memory_order_relaxed) == 0; }
+
+  /**
+   * @brief Resolves an address.
+   * @param address Address, little endian as on the wire.
+   * @param now Monotonic time in milliseconds.
+   * @return The match; unresolved for addresses that are not resolvable private.
+   */
+  HciRpaMatch resolve(const bdaddr_t& address, uint64_t now);
+
+  /// Counters since the list was set.
+  HciRpaResolverStats stats() const;
+
+  /// Name of the AES implementation in use: "aes-ni" or "portable".
+  const char* backend() const;
+
+  /// Whether an address is resolvable private (random, top bits 0b01).
+  static bool IsResolvable(const bdaddr_t& address) { return (address.b[5] & 0xC0) == 0x40; }
+
+  /**
+   * @brief The random address hash function ah (Core Vol 3 Part H 2.2.2).
+   * @param irk IRK, most significant octet first.
+   * @param prand 24-bit prand.
+   * @return 24-bit hash.
+   */
+  static uint32_t Ah(const Key& irk, uint32_t prand);
+
+  /// AES-128 key schedule, in FIPS-197 byte order.
+  struct alignas(16) RoundKeys {
+    uint8_t bytes[176];
+  };
+
+ private:
+  struct CacheEntry {
+    int32_t index;                      ///< Match, or -1
+    uint64_t expires;                   ///< Monotonic ms
+    std::list<uint64_t>::iterator lru;  ///< Position in _lru
+  };
+
+  /**
+   * @brief Scans the IRK list.
+   * @param address Resolvable private address.
+   * @return Index of the IRK that resolves it, or -1.
+   */
+  int32_t scan(const bdaddr_t& address) const;
+
+  bool _accelerated;                    ///< Whether AES-NI is used
+  std::atomic<size_t> _count;           ///< Keys in the list, read without the lock
+
+  mutable std::mutex _mutex;            ///< Guards the list, the cache and the counters
+  std::vector<RoundKeys> _keys;         ///< Expanded IRKs
+  uint32_t _generation;                 ///< Generation of the list
+  size_t _cacheSize;                    ///< Cache capacity
+  uint64_t _cacheTtl;                   ///< Cache expiry, in ms
+  std::unordered_map<uint64_t, CacheEntry> _cache; ///< Results by address
+  std::list<uint64_t> _lru;             ///< Cached addresses, most recently used first
+  uint64_t _hits;                       ///< Lookups answered by the cache
+  uint64_t _misses;                     ///< Lookups that scanned the list
+  uint64_t _resolved;                   ///< Scans that found a key
+};
+
+#endif // BLUETOOTH_HCI_RPA_RESOLVER_H
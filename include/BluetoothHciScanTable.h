@@ -0,0 +1,115 @@
+#ifndef BLUETOOTH_HCI_SCAN_TABLE_H
+#define BLUETOOTH_HCI_SCAN_TABLE_H
+
+// Include necessary headers
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief State of one nearby device as reported in a snapshot.
+ */
+struct HciScanDevice {
+  uint8_t addressType;      ///< Address type from the report.
+  uint8_t address[6];       ///< Address, little endian.
+  std::string data;         ///< Last advertising data.
+  int8_t rssi;              ///< Last RSSI.
+  float rssiSmoothed;       ///< Exponentially weighted moving average of RSSI.
+  int8_t rssiMedian;        ///< Median of the recent RSSI samples.
+  uint64_t firstSeen;       ///< Wall clock time first seen, in ms since the epoch.
+  uint64_t lastSeen;        ///< Wall clock time last seen, in ms since the epoch.
+  uint64_t count;           ///< Advertisements received.
+};
+
+/**
+ * @brief Changes since the previous snapshot.
+ */
+struct HciScanSnapshot {
+  std::vector<HciScanDevice> added;    ///< Devices seen for the first time.
+  std::vector<HciScanDevice> changed;  ///< Devices whose payload or smoothed RSSI changed.
+  std::vector<HciScanDevice> lost;     ///< Devices timed out or evicted (address fields only).
+};
+
+/**
+ * @brief Table of nearby devices fed by decoded advertisements.
+ *
+ * Keeps one entry per address with the last payload and filtered RSSI,
+ * bounded by a capacity with least recently seen eviction. The polling
+ * thread observes advertisements; the JS thread takes diffed snapshots.
+ */
+class BluetoothHciScanTable {
+ public:
+  /// Table tuning.
+  struct Options {
+    size_t capacity = 1024;       ///< Maximum devices tracked.
+    uint32_t lostTimeout = 10000; ///< Ms without advertisements before a device is lost.
+    float alpha = 0.25f;          ///< EWMA weight of a new RSSI sample.
+    size_t medianWindow = 5;      ///< RSSI samples in the median filter (1-15).
+    float rssiThreshold = 2.0f;   ///< Smoothed RSSI movement (dB) reported as a change.
+  };
+
+  BluetoothHciScanTable();
+
+  /**
+   * @brief Enables the table with the given options, clearing it.
+   */
+  void enable(const Options& options);
+
+  /// Disables and clears the table.
+  void disable();
+
+  /// Whether advertisements are being tracked.
+  bool enabled() const { return _enabled; }
+
+  /**
+   * @brief Records one advertisement.
+   * @param encoded Advertisement in the HciAdvertisementLayout encoding.
+   */
+  void observe(const std::string& encoded);
+
+  /**
+   * @brief Returns the changes since the previous snapshot and expires lost devices.
+   */
+  HciScanSnapshot snapshot();
+
+  /// Number of devices tracked.
+  size_t size();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  /// Maximum RSSI samples kept for the median filter.
+  static constexpr size_t kMaxMedianWindow = 15;
+
+  /// Tracked device.
+  struct Entry {
+    HciScanDevice device;                  ///< Reported state
+    Clock::time_point seen;                ///< Last seen, for expiry
+    int8_t samples[kMaxMedianWindow];      ///< Recent RSSI samples (ring)
+    size_t sampleCount;                    ///< Valid samples
+    size_t sampleNext;                     ///< Next ring slot
+    float reportedRssi;                    ///< Smoothed RSSI in the last snapshot
+    bool added;                            ///< Not reported yet
+    bool dirty;                            ///< Changed since the last snapshot
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  static uint64_t key(uint8_t addressType, const uint8_t* address);
+  uint64_t wallClock(Clock::time_point t, Clock::time_point now, uint64_t epochNow) const;
+
+  std::mutex _mutex;                         ///< Guards all state
+  std::atomic<bool> _enabled;                ///< Whether observe() records; read without the lock
+  Options _options;                          ///< Current options
+  EntryList _entries;                        ///< Most recently seen first
+  std::map<uint64_t, EntryList::iterator> _index; ///< Entries by address
+  std::vector<HciScanDevice> _evicted;       ///< Evicted since the last snapshot
+};
+
+#endif // BLUETOOTH_HCI_SCAN_TABLE_H
@@ -0,0 +1,179 @@
+#ifndef BLUETOOTH_HCI_SHARED_RING_H
+#define BLUETOOTH_HCI_SHARED_RING_H
+
+// Include necessary headers
+#include <atomic>         // For std::atomic
+#include <cstddef>        // For size_t
+#include <cstdint>        // For fixed-width integer types
+#include <functional>     // For std::function
+#include <memory>         // For std::unique_ptr
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+
+/**
+ * @brief A consumer attached to a shared ring, as seen by the broker.
+ */
+struct HciRingConsumerInfo {
+  uint32_t slot;        ///< Consumer slot
+  uint32_t pid;         ///< Process that attached
+  uint64_t lag;         ///< Packets published but not yet read
+  uint64_t delivered;   ///< Packets read and passed by its filter
+  uint64_t filtered;    ///< Packets read and rejected by its filter
+  uint64_t lost;        ///< Packets overwritten before it read them
+};
+
+/**
+ * @brief Read position of one consumer (consumer process only).
+ */
+struct HciRingCursor {
+  uint64_t position = 0;        ///< Byte position of the next record
+  uint64_t sequence = 0;        ///< Sequence number expected next
+  std::vector<uint8_t> buffer;  ///< Copy of the record being read
+};
+
+/**
+ * @brief Packet ring and command queue in memfd-backed shared memory.
+ *
+ * The broker process owns an HCI socket, publishes every packet it reads into
+ * the ring and executes the commands consumers queue. Consumers in other
+ * processes map the same memfd (inherited, or opened through
+ * /proc/<pid>/fd/<fd>) and read at their own cursor.
+ *
+ * The ring has a single writer and never waits for readers: a consumer that
+ * falls a full ring behind loses the overwritten packets, which is counted.
+ * Each record is validated after it is copied out (seqlock style) so a torn
+ * read is detected and discarded. Waiting on either side uses futexes on the
+ * shared mapping, so nothing is polled.
+ *
+ * The mapping only contains lock-free atomics, which are address-free and
+ * safe to share between processes. Consumers map it writable, so the layout
+ * and positions each side relies on are private copies, and records read
+ * back from the ring are bounds checked before they are followed.
+ */
+class BluetoothHciSharedRing {
+ public:
+  static constexpr size_t kMaxConsumers = 16;          ///< Consumer slots
+  static constexpr size_t kCommandSlots = 64;          ///< Queued commands
+  static constexpr size_t kDefaultSize = 4 << 20;      ///< Default packet ring size
+  static constexpr size_t kMinSize = 64 << 10;         ///< Smallest packet ring
+
+  ~BluetoothHciSharedRing();
+
+  /**
+   * @brief Creates and maps a new ring (broker).
+   * @param size Packet ring size in bytes, rounded up to a page.
+   * @param error Receives errno on failure.
+   * @return The ring, or nullptr.
+   */
+  static std::unique_ptr<BluetoothHciSharedRing> Create(size_t size, int& error);
+
+  /**
+   * @brief Maps an existing ring (consumer); the descriptor is owned afterwards.
+   * @param fd Descriptor of the memfd.
+   * @param error Receives errno on failure (EINVAL if it is not a ring).
+   * @return The ring, or nullptr.
+   */
+  static std::unique_ptr<BluetoothHciSharedRing> Attach(int fd, int& error);
+
+  /// Descriptor of the memfd.
+  int fd() const { return _fd; }
+
+  // Broker side
+
+  /**
+   * @brief Appends a packet, overwriting the oldest ones if needed.
+   * @return false if the packet is too large for the ring.
+   */
+  bool publish(const uint8_t* data, size_t length);
+
+  /**
+   * @brief Takes the oldest queued command.
+   * @param command Receives the packet.
+   * @return false if the queue is empty.
+   */
+  bool takeCommand(std::string& command);
+
+  /**
+   * @brief Waits until a command is queued, the ring is closed or the timeout passes.
+   */
+  void waitCommand(int timeoutMs);
+
+  /**
+   * @brief Marks the ring closed and wakes every waiter.
+   */
+  void close();
+
+  /**
+   * @brief Lists attached consumers; slots of processes that no longer exist are freed.
+   */
+  std::vector<HciRingConsumerInfo> consumers();
+
+  /// Packets published since creation.
+  uint64_t published() const;
+
+  // Consumer side
+
+  /**
+   * @brief Claims a consumer slot for this process.
+   * @param cursor Receives a cursor at the newest packet.
+   * @return Slot index, or -1 if all slots are taken.
+   */
+  int join(HciRingCursor& cursor);
+
+  /// Releases a consumer slot.
+  void leave(int slot);
+
+  /**
+   * @brief Reads the packets published since the cursor.
+   * @param slot Consumer slot, whose counters are updated.
+   * @param cursor Read position.
+   * @param onPacket Called per packet; returns false if its filter rejected it.
+   *        The pointer is only valid during the call.
+   * @param maxPackets Maximum packets read.
+   * @return Number of packets read.
+   */
+  size_t read(int slot, HciRingCursor& cursor, const std::function<bool(const uint8_t*, size_t)>& onPacket, size_t maxPackets);
+
+  /**
+   * @brief Waits until a packet follows the cursor, the ring is closed or the timeout passes.
+   */
+  void waitPackets(const HciRingCursor& cursor, int timeoutMs);
+
+  /**
+   * @brief Queues a packet for the broker to write.
+   * @return false if the queue is full or the packet too large.
+   */
+  bool submit(const uint8_t* data, size_t length);
+
+  /// Whether the broker closed the ring.
+  bool closed() const;
+
+ private:
+  struct Header;
+  struct ConsumerSlot;
+  struct CommandSlot;
+  struct Record;
+
+  BluetoothHciSharedRing(int fd, uint8_t* base, size_t mapped);
+
+  static size_t Layout(size_t size, size_t& dataOffset);
+
+  Header* header() const;
+  ConsumerSlot* slot(size_t index) const;
+  CommandSlot* command(size_t index) const;
+  uint8_t* data() const;
+
+  int _fd;            ///< memfd
+  uint8_t* _base;     ///< Start of the mapping
+  size_t _mapped;     ///< Mapping length
+  size_t _size;       ///< Packet ring bytes, as created or validated on attach
+  size_t _dataOffset; ///< Packet ring offset in the mapping, likewise
+  uint64_t _head;     ///< Position of the next record (broker)
+  uint64_t _tail;     ///< Position of the oldest intact record (broker)
+
+  // Disable copy constructor and assignment operator
+  BluetoothHciSharedRing(const BluetoothHciSharedRing&) = delete;
+  BluetoothHciSharedRing& operator=(const BluetoothHciSharedRing&) = delete;
+};
+
+#endif // BLUETOOTH_HCI_SHARED_RING_H
@@ -8,7 +8,25 @@
 #include <thread>         // For std::thread
 #include <map>            // For std::map
 #include <memory>         // For smart pointers
+#include <string>         // For std::string
 #include "BluetoothHciL2Socket.h" // Header for BluetoothHciL2Socket class
+#include "BluetoothHciDeviceInventory.h" // Header for BluetoothHciDeviceInventory class
+#include "BluetoothHciConnectionRouter.h" // Header for BluetoothHciConnectionRouter class
+#include "BluetoothHciDelivery.h" // Header for BluetoothHciDelivery class
+#include "BluetoothHciAdvertising.h" // Header for BluetoothHciAdvertisingAssembler class
+#include "BluetoothHciScanTable.h" // Header for BluetoothHciScanTable class
+#include "BluetoothHciAdvertisingColumns.h" // Header for BluetoothHciAdvertisingColumns class
+#include "BluetoothHciAttRouter.h" // Header for BluetoothHciAttRouter class
+#include "BluetoothHciIso.h" // Header for BluetoothHciIsoAssembler class
+#include "BluetoothHciThread.h" // Header for BluetoothHciThread helpers
+#include "BluetoothHciLinkParser.h" // Header for BluetoothHciLinkParser class
+#include "BluetoothHciSharedRing.h" // Header for BluetoothHciSharedRing class
+#include "BluetoothHciControllerProbe.h" // Header for BluetoothHciControllerProbe class
+#include "BluetoothHciRpaResolver.h" // Header for BluetoothHciRpaResolver class
+#include "BluetoothHciAdMatcher.h" // Header for BluetoothHciAdMatcher class
+#include "BluetoothHciAcceptList.h" // Header for BluetoothHciAcceptList class
+#include "BluetoothHciConnectScheduler.h" // Header for BluetoothHciConnectScheduler class
+#include "BluetoothHciObservationStore.h" // Header for BluetoothHciObservationStore class
 
 /**
  * @brief Class representing a Bluetooth HCI (Host Controller Interface) socket.
@@ -58,6 +76,12 @@ class BluetoothHciSocket : public Napi::ObjectWrap<BluetoothHciSocket> {
    */
   void BindControl(const Napi::CallbackInfo& info);
 
+  /**
+   * @brief Binds the socket to the monitor channel of all adapters.
+   * @param info Callback information from N-API.
+   */
+  void BindMonitor(const Napi::CallbackInfo& info);
+
   // Device methods
   /**
    * @brief Checks if the Bluetooth device is up.
@@ -99,18 +123,441 @@ class BluetoothHciSocket : public Napi::ObjectWrap<BluetoothHciSocket> {
    */
   void Write(const Napi::CallbackInfo& info);
 
+  /**
+   * @brief Registers direct packet handlers that bypass the "data" event.
+   * @param info Callback information from N-API ({ event, acl, iso, command }, or null).
+   */
+  void OnPacket(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets delivery lane weights and depth limits.
+   * @param info Callback information from N-API ({ control, data, bulk } of { weight, limit }).
+   */
+  void SetDeliveryLanes(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Gets per-lane delivery depth, counters and queueing delay.
+   * @param info Callback information from N-API.
+   * @return Object with control, data and bulk lane statistics.
+   */
+  Napi::Value GetDeliveryStats(const Napi::CallbackInfo& info);
+
   /**
    * @brief Cleans up resources used by the socket.
    * @param info Callback information from N-API.
    */
   void Cleanup(const Napi::CallbackInfo& info);
 
+  // Multi-adapter methods
+  /**
+   * @brief Picks the adapter for a new LE connection.
+   * @param info Callback information from N-API (policy, optional peer address).
+   * @return Napi::Value containing the device ID, or null if all adapters are saturated.
+   */
+  Napi::Value PickAdapter(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the connection load observed on every adapter.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the per-adapter load.
+   */
+  Napi::Value GetAdapterLoad(const Napi::CallbackInfo& info);
+
+  // Controller methods
+  /**
+   * @brief Reads the controller's version, features, supported commands and buffer sizes.
+   * @param info Callback information from N-API ({ identityOnly }, callback(error, capabilities)), or null to cancel.
+   */
+  void ProbeController(const Napi::CallbackInfo& info);
+
+  // Threading methods
+  /**
+   * @brief Sets affinity, nice or SCHED_FIFO priority and name of the polling thread.
+   * @param info Callback information from N-API ({ cpus, nice, priority, name }, or null).
+   */
+  void SetThreadOptions(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves read counters and the kernel-receive-to-read latency.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the read statistics.
+   */
+  Napi::Value GetReadStats(const Napi::CallbackInfo& info);
+
+  // Pull-based flow control
+  /**
+   * @brief Bounds the packets queued for "data" events by a credit, or stops bounding them.
+   * @param info Callback information from N-API (credit in packets, or null).
+   */
+  void SetFlowControl(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Returns credit for packets the consumer took.
+   * @param info Callback information from N-API (packets).
+   */
+  void GrantCredit(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets the kernel receive buffer size (SO_RCVBUFFORCE, or SO_RCVBUF without the privilege).
+   * @param info Callback information from N-API (bytes).
+   * @return Napi::Value containing the size the kernel applied.
+   */
+  Napi::Value SetReceiveBuffer(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the kernel receive queue's size, backlog and drops, and the credit.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { receiveBuffer, queued, drops, credit, stalls, stalledTime }.
+   */
+  Napi::Value GetReceiveQueueStats(const Napi::CallbackInfo& info);
+
+  // Private address resolution
+  /**
+   * @brief Sets the IRKs resolvable private addresses are resolved against by the polling thread.
+   * @param info Callback information from N-API ([{ irk, ... }] or null, { cacheSize, cacheTtl }).
+   */
+  void SetIrks(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the resolver's backend and counters.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { irks, backend, cached, hits, misses, resolved }.
+   */
+  Napi::Value GetResolverStats(const Napi::CallbackInfo& info);
+
+  // Advertising pattern matching
+  /**
+   * @brief Replaces the catalog advertising reports are matched against by the polling thread.
+   * @param info Callback information from N-API ([{ id, type, data, offset }] or null, { filter }).
+   */
+  void SetAdPatterns(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the size of the catalog and the reports matched and dropped.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { patterns, states, matched, dropped }.
+   */
+  Napi::Value GetAdPatternStats(const Napi::CallbackInfo& info);
+
+  // Filter accept list management
+  /**
+   * @brief Sets the devices the controller's filter accept list is kept in sync with.
+   * @param info Callback information from N-API ([{ address, addressType, priority }] or null,
+   *             { policy, capacity, rotateInterval, pauseScan }).
+   */
+  void SetAcceptList(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the accept list manager's counters and the traffic the list saved.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the stats object.
+   */
+  Napi::Value GetAcceptListStats(const Napi::CallbackInfo& info);
+
+  // Connection scheduling
+  /**
+   * @brief Queues devices to connect to through the filter accept list, or cancels the queue.
+   * @param info Callback information from N-API ([{ address, addressType, priority, timeout }] or null,
+   *             { capacity, timeout, attempts, extended, ownAddressType, scanInterval, scanWindow,
+   *               connMinInterval, connMaxInterval, connLatency, supervisionTimeout }).
+   */
+  void ConnectDevices(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the connect scheduler's queue and counters.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the stats object.
+   */
+  Napi::Value GetConnectStats(const Napi::CallbackInfo& info);
+
+  // Observation store
+  /**
+   * @brief Opens the directory advertisements are stored into, or closes it.
+   * @param info Callback information from N-API (directory or null,
+   *             { segmentDuration, segmentSize, maxBytes, maxAge }).
+   */
+  void SetObservationStore(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Reads stored advertisements back, oldest first.
+   * @param info Callback information from N-API ({ from, to, address, addressType, limit }).
+   * @return Napi::Value containing [{ time, address, addressType, rssi, eventType, data }].
+   */
+  Napi::Value QueryObservations(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Retrieves the observation store's size and counters.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the stats object.
+   */
+  Napi::Value GetObservationStoreStats(const Napi::CallbackInfo& info);
+
+  // Broker methods
+  /**
+   * @brief Shares this socket with other processes through a shared memory ring.
+   * @param info Callback information from N-API ({ size }).
+   * @return Napi::Value containing { fd, path } of the ring.
+   */
+  Napi::Value StartBroker(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Closes the ring; attached consumers see it closed.
+   * @param info Callback information from N-API.
+   */
+  void StopBroker(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Lists the attached consumers with their lag and counters.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing the consumer list.
+   */
+  Napi::Value GetBrokerConsumers(const Napi::CallbackInfo& info);
+
+  // Advertising methods
+  /**
+   * @brief Enables or disables native advertisement decoding.
+   * @param info Callback information from N-API (view constructor, or null to disable).
+   */
+  void DecodeAdvertisements(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Enables or disables columnar advertisement batches.
+   * @param info Callback information from N-API (boolean).
+   */
+  void BatchAdvertisements(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Enables or disables the scan device table.
+   * @param info Callback information from N-API (options object, or null to disable).
+   */
+  void ConfigureScanTable(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Takes the scan table changes since the previous snapshot.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { added, changed, lost }.
+   */
+  Napi::Value TakeScanSnapshot(const Napi::CallbackInfo& info);
+
+  // ATT methods
+  /**
+   * @brief Routes notifications/indications of one attribute to a callback natively.
+   * @param info Callback information from N-API (connection handle, attribute handle, callback, options).
+   * @return Napi::Value containing the subscription ID.
+   */
+  Napi::Value SubscribeAtt(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Removes an ATT subscription.
+   * @param info Callback information from N-API (subscription ID).
+   * @return Napi::Value indicating whether the subscription existed.
+   */
+  Napi::Value UnsubscribeAtt(const Napi::CallbackInfo& info);
+
+  // ISO methods
+  /**
+   * @brief Enables or disables native ISO SDU reassembly.
+   * @param info Callback information from N-API (boolean).
+   */
+  void ReassembleIso(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Writes an ISO SDU, fragmented to the controller's ISO buffer size.
+   * @param info Callback information from N-API (connection handle, SDU, { sequenceNumber, timestamp, mtu }).
+   */
+  void WriteIsoSdu(const Napi::CallbackInfo& info);
+
  private:
   /**
    * @brief Polls the socket for events in a separate thread.
    */
   void PollSocket();
 
+  /**
+   * @brief Writes the commands queued by broker consumers in a separate thread.
+   */
+  void RunBroker();
+
+  /**
+   * @brief Stops the broker thread and closes the ring.
+   */
+  void stopBroker();
+
+  /**
+   * @brief Passes an event to a running controller probe and sends the commands it allows.
+   * @param data Pointer to the packet (H4 framed).
+   * @param length Length of the packet.
+   * @return True if the event belonged to the probe and must not be delivered as data.
+   */
+  bool observeProbe(const char* data, int length);
+
+  /**
+   * @brief Converts the results of a controller probe to the JS capabilities object.
+   * @param env The N-API environment.
+   * @param results Return parameters by opcode.
+   * @return Capabilities object.
+   */
+  static Napi::Object CapabilitiesToObject(Napi::Env env, const std::map<uint16_t, std::string>& results);
+
+  /**
+   * @brief Asks the kernel to time stamp received packets.
+   */
+  void enableReadTimestamps();
+
+  /**
+   * @brief Records the latency of one read from its receive time stamp.
+   * @param msg Message returned by recvmsg().
+   */
+  void recordReadLatency(struct msghdr* msg);
+
+  /**
+   * @brief Records the kernel's drop counter from a read's SO_RXQ_OVFL control message.
+   * @param msg Message returned by recvmsg().
+   */
+  void recordKernelDrops(struct msghdr* msg);
+
+  /**
+   * @brief Queues a packet for delivery as a "data" event on the JS thread.
+   * @param message Packet bytes (H4 framed).
+   * @param devId Adapter index the packet belongs to (monitor channel only).
+   * @param direction "rx" or "tx" for monitor packets, nullptr otherwise.
+   * @param identity Identity the packet's address resolved to.
+   * @param matches Ids of the catalog patterns found in the packet's reports.
+   */
+  void emitPacket(std::string message, uint16_t devId, const char* direction, HciRpaMatch identity = {},
+                  std::vector<uint32_t> matches = {});
+
+  /**
+   * @brief Queues an encoded advertisement for an "advertisement" event.
+   * @param encoded Advertisement in the HciAdvertisementLayout encoding.
+   * @param identity Identity the advertiser's address resolved to.
+   * @param matched Whether it was matched against a catalog.
+   * @param matches Ids of the catalog patterns found in its data.
+   */
+  void emitAdvertisement(std::string encoded, HciRpaMatch identity, bool matched, std::vector<uint32_t> matches);
+
+  /**
+   * @brief Feeds an event to the accept list manager and sends the commands it takes.
+   * @param data Packet (H4 framed), or nullptr to only send due commands.
+   * @param length Length of the packet.
+   * @return True if the event completed one of the manager's commands.
+   */
+  bool syncAcceptList(const char* data, int length);
+
+  /**
+   * @brief Feeds a packet to the connect scheduler, sends the commands it takes and emits its results.
+   * @param data Packet (H4 framed), or nullptr to only send due commands.
+   * @param length Length of the packet.
+   * @return True if the event only concerned the scheduler's own commands.
+   */
+  bool syncConnect(const char* data, int length);
+
+  /**
+   * @brief Shows a packet written to the controller to the native trackers, then syncs the accept list.
+   *
+   * Shared by local writes and broker consumer commands so neither bypasses them.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   */
+  void observeWrite(const char* data, int length);
+
+  /**
+   * @brief Takes a reference to the current pattern catalog.
+   * @return The matcher, or null if no catalog is set.
+   */
+  std::shared_ptr<const BluetoothHciAdMatcher> adMatcher();
+
+  /**
+   * @brief Resolves the address of an advertising report or connection event.
+   * @param data Packet (H4 framed).
+   * @param length Length of the packet.
+   * @return The match; unresolved for other packets and addresses.
+   */
+  HciRpaMatch resolvePacket(const uint8_t* data, size_t length);
+
+  /**
+   * @brief Resolves an address if it is a random one.
+   * @param type HCI address type.
+   * @param address Address, little endian.
+   * @return The match.
+   */
+  HciRpaMatch resolveAddress(uint8_t type, const bdaddr_t& address);
+
+  /**
+   * @brief Delivers the staged columnar batch as an "advertisementBatch" event.
+   * @param env The N-API environment.
+   * @param target Object to emit on.
+   */
+  void emitAdvertisementBatch(Napi::Env env, Napi::Object target);
+
+  /**
+   * @brief Takes subscribed ATT values off the ACL stream.
+   * @param data Pointer to the packet (H4 framed).
+   * @param length Length of the packet.
+   * @return True if the packet was consumed and must not be delivered as data.
+   */
+  bool routeAtt(const char* data, int length);
+
+  /**
+   * @brief Queues a reassembled SDU for an "isoSdu" event.
+   * @param sdu SDU; its buffer is returned to the pool once delivered.
+   */
+  void emitIsoSdu(HciIsoSdu& sdu);
+
+  /**
+   * @brief Unwraps a monitor channel frame and delivers its contents.
+   * @param data Pointer to the frame including the monitor header.
+   * @param length Length of the frame.
+   */
+  void handleMonitorFrame(const char* data, int length);
+
+  /**
+   * @brief Delivers an adapter index change as an "index" event.
+   * @param opcode Monitor opcode (HCI_MON_*_INDEX or HCI_MON_INDEX_INFO).
+   * @param devId Adapter index.
+   * @param payload Raw monitor payload.
+   */
+  void emitIndexEvent(uint16_t opcode, uint16_t devId, std::string payload);
+
+  /**
+   * @brief Inspects a management channel frame for index events.
+   * @param data Pointer to the frame including the management header.
+   * @param length Length of the frame.
+   */
+  void handleManagementFrame(const char* data, int length);
+
+  /**
+   * @brief Refreshes one inventory entry and emits the resulting device event.
+   * @param devId HCI device ID.
+   * @param removed Whether the device was unregistered.
+   */
+  void updateInventory(uint16_t devId, bool removed);
+
+  /**
+   * @brief Converts an inventory entry to the JS device object.
+   * @param env The N-API environment.
+   * @param entry Inventory entry.
+   * @return Device object as returned by getDeviceList().
+   */
+  static Napi::Object DeviceToObject(Napi::Env env, const HciDeviceEntry& entry);
+
+  /**
+   * @brief Parses an "aa:bb:cc:dd:ee:ff" address into little-endian order.
+   * @param str Address string.
+   * @param address Receives the parsed address.
+   * @return True if the string is a valid address.
+   */
+  static bool ParseAddress(const std::string& str, bdaddr_t* address);
+
+  /**
+   * @brief Converts a scan table device to the JS snapshot entry.
+   * @param env The N-API environment.
+   * @param device Scan table device.
+   * @param full Whether to include more than the address.
+   * @return Snapshot entry object.
+   */
+  static Napi::Object ScanDeviceToObject(Napi::Env env, const HciScanDevice& device, bool full);
+
   /**
    * @brief Emits an error event based on errno.
    * @param info Callback information from N-API.
@@ -118,6 +565,13 @@ class BluetoothHciSocket : public Napi::ObjectWrap<BluetoothHciSocket> {
    */
   void EmitError(const Napi::CallbackInfo& info, const char* syscall);
 
+  /**
+   * @brief Emits an error for a failed system call through the delivery, from any thread.
+   * @param syscall Name of the system call.
+   * @param error errno value.
+   */
+  void PushError(const char* syscall, int error);
+
   /**
    * @brief Retrieves the device ID for a given device.
    * @param devId Pointer to the device ID.
@@ -151,13 +605,36 @@ class BluetoothHciSocket : public Napi::ObjectWrap<BluetoothHciSocket> {
    */
   void setConnectionParameters(uint16_t connMinInterval, uint16_t connMaxInterval, uint16_t connLatency, uint16_t supervisionTimeout);
 
-  // N-API thread-safe function and object reference
-  Napi::ThreadSafeFunction tsfn;  ///< Thread-safe function for callbacks
-  Napi::ObjectReference thisObj;  ///< Reference to the JavaScript object
+  // Delivery of packets and events to JS
+  BluetoothHciDelivery _delivery; ///< Batched thread-safe delivery to `emit`
 
   // Threading and synchronization
   std::atomic<bool> stopFlag;     ///< Atomic flag to signal the polling thread to stop
   std::thread pollingThread;      ///< Thread for polling the socket
+  HciThreadOptions _threadOptions; ///< Applied by the polling thread when it starts
+
+  // Read latency, from the kernel receive time stamp to the read returning
+  std::atomic<uint64_t> _reads;              ///< Packets read since start
+  std::atomic<uint64_t> _readLatencyCount;   ///< Time stamped reads since the last report
+  std::atomic<uint64_t> _readLatencyTotal;   ///< Sum of their latency in ns
+  std::atomic<uint64_t> _readLatencyMax;     ///< Largest of their latency in ns
+
+  // Kernel receive queue overflow
+  std::atomic<bool> _rxqOverflow;            ///< Whether SO_RXQ_OVFL is enabled
+  std::atomic<uint32_t> _rxqDrops;           ///< Last drop counter it reported
+
+  // Multi-process broker
+  std::mutex _brokerMutex;                         ///< Guards _broker against the polling thread
+  std::unique_ptr<BluetoothHciSharedRing> _broker; ///< Ring packets are published to
+  std::atomic<bool> _brokerActive;                 ///< Whether packets are published
+  std::atomic<bool> _brokerStop;                   ///< Signals the broker thread to stop
+  std::thread _brokerThread;                       ///< Writes queued consumer commands
+
+  // Controller probe
+  std::mutex _probeMutex;                                ///< Guards _probe against the polling thread
+  std::unique_ptr<BluetoothHciControllerProbe> _probe;   ///< Running probe
+  std::atomic<bool> _probeActive;                        ///< Whether a probe is running
+  Napi::FunctionReference _probeCallback;                ///< Completion callback (JS thread only)
 
   // Internal state
   int _mode;                  ///< Operating mode of the socket
@@ -167,11 +644,54 @@ class BluetoothHciSocket : public Napi::ObjectWrap<BluetoothHciSocket> {
   uint8_t _address[6];        ///< Local Bluetooth device address
   uint8_t _addressType;       ///< Address type (public or random)
 
+  BluetoothHciDeviceInventory _inventory; ///< Cached adapter inventory
+  BluetoothHciConnectionRouter _router;   ///< Per-adapter connection load
+
+  // Advertisement decoding
+  BluetoothHciAdvertisingAssembler _advertising; ///< Report reassembly (polling thread only)
+  std::atomic<bool> _decodeAdvertisements;       ///< Whether reports are decoded
+  Napi::FunctionReference _advertisementView;    ///< JS view constructor (JS thread only)
+  BluetoothHciScanTable _scanTable;              ///< Nearby devices for snapshots
+  BluetoothHciAdvertisingColumns _advertisingColumns; ///< Staged columnar batch
+  std::atomic<bool> _batchAdvertisements;        ///< Whether batches are staged
+  BluetoothHciRpaResolver _rpa;                  ///< IRKs and cached resolutions
+
+  // Advertising pattern matching
+  std::mutex _adMatcherMutex;                    ///< Guards _adMatcher against the polling thread
+  std::shared_ptr<const BluetoothHciAdMatcher> _adMatcher; ///< Current catalog, swapped whole
+  std::atomic<bool> _adMatcherActive;            ///< Whether a catalog is set
+  std::atomic<bool> _adFilter;                   ///< Whether reports matching nothing are dropped
+  std::atomic<uint64_t> _adMatched;              ///< Reports and advertisements that matched
+  std::atomic<uint64_t> _adDropped;              ///< Events and advertisements dropped by the filter
+
+  // Filter accept list management
+  std::mutex _acceptListMutex;                   ///< Guards _acceptList against the polling thread
+  BluetoothHciAcceptList _acceptList;            ///< Sees every written command; syncs while active
+  std::atomic<bool> _acceptListActive;           ///< Whether the list is being kept in sync
+
+  // Connection scheduling
+  std::mutex _connectMutex;                      ///< Guards _connect against the polling thread
+  BluetoothHciConnectScheduler _connect;         ///< Sees every written command; initiates while active
+  std::atomic<bool> _connectActive;              ///< Whether devices are queued; the accept list manager holds off
+
+  // Observation store
+  BluetoothHciObservationStore _observations;    ///< Segment files advertisements are appended to
+
+  // ATT notification routing
+  BluetoothHciAttRouter _attRouter;              ///< Subscriptions and reassembly
+  std::map<uint32_t, Napi::FunctionReference> _attCallbacks; ///< Callbacks by subscription (JS thread only)
+
+  // ISO data
+  BluetoothHciIsoAssembler _iso;                 ///< SDU reassembly (polling thread) and buffer pool
+  std::atomic<bool> _reassembleIso;              ///< Whether ISO data is reassembled
+
   // Maps to manage connected and connecting L2CAP sockets
   std::mutex _mapMutex;
   std::map<bdaddr_t, std::weak_ptr<BluetoothHciL2Socket>> _l2sockets_connected;    ///< Connected L2CAP sockets
   std::map<bdaddr_t, std::shared_ptr<BluetoothHciL2Socket>> _l2sockets_connecting; ///< Connecting L2CAP sockets
   std::map<uint16_t, std::shared_ptr<BluetoothHciL2Socket>> _l2sockets_handles;    ///< L2CAP sockets by handle
+  uint16_t _connectionParameters[4];  ///< Values last written to debugfs (guarded by _mapMutex)
+  bool _connectionParametersSet;      ///< Whether they were written
 
   /**
    * @brief Ensures the socket is created.
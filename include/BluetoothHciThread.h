@@ -0,0 +1,65 @@
+#ifndef BLUETOOTH_HCI_THREAD_H
+#define BLUETOOTH_HCI_THREAD_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+
+#include "BluetoothHciDelivery.h"
+
+/**
+ * @brief Scheduling settings for a native I/O thread.
+ */
+struct HciThreadOptions {
+  std::vector<int> cpus;   ///< CPUs the thread may run on, empty to inherit
+  bool hasNice = false;    ///< Whether nice is set
+  int nice = 0;            ///< Nice value (-20..19)
+  int priority = 0;        ///< SCHED_FIFO priority (1..99), 0 to keep SCHED_OTHER
+  std::string name;        ///< Thread name, empty to inherit
+};
+
+/**
+ * @brief A scheduling setting the thread could not apply.
+ */
+struct HciThreadFailure {
+  const char* syscall;     ///< Failing call
+  int error;               ///< errno
+};
+
+/**
+ * @brief Applies HciThreadOptions to native I/O threads.
+ *
+ * Options are parsed on the JS thread and applied by each thread to itself
+ * when it starts. Missing privileges (CAP_SYS_NICE for SCHED_FIFO or a
+ * negative nice) are not fatal: the thread keeps running with what it has
+ * and the failures are emitted as "warning" events.
+ */
+class BluetoothHciThread {
+ public:
+  /**
+   * @brief Parses { cpus, nice, priority, name } (JS thread only).
+   * @param value Options object, or undefined/null for defaults.
+   * @param options Receives the parsed options.
+   * @return false after throwing a TypeError on invalid options.
+   */
+  static bool Parse(Napi::Value value, HciThreadOptions& options);
+
+  /**
+   * @brief Applies options to the calling thread.
+   * @param options Settings to apply.
+   * @param suffix Appended to the thread name, e.g. to tell a writer apart.
+   * @return The settings that failed, empty if all were applied.
+   */
+  static std::vector<HciThreadFailure> Apply(const HciThreadOptions& options, const char* suffix = "");
+
+  /**
+   * @brief Queues a "warning" event per failure, as errors with syscall and errno.
+   * @param delivery Delivery of the object owning the thread.
+   * @param failures Failures returned by Apply().
+   */
+  static void Report(BluetoothHciDelivery& delivery, const std::vector<HciThreadFailure>& failures);
+};
+
+#endif // BLUETOOTH_HCI_THREAD_H
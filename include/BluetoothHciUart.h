@@ -0,0 +1,147 @@
+#ifndef BLUETOOTH_HCI_UART_H
+#define BLUETOOTH_HCI_UART_H
+
+// Include necessary headers
+#include <napi.h>         // N-API for Node.js addons
+
+#include <atomic>             // For std::atomic
+#include <condition_variable> // For std::condition_variable
+#include <deque>              // For std::deque
+#include <mutex>              // For std::mutex
+#include <string>             // For std::string
+#include <thread>             // For std::thread
+#include "BluetoothHciDelivery.h"     // Header for BluetoothHciDelivery class
+#include "BluetoothHciPacketFramer.h" // Header for BluetoothHciPacketFramer class
+#include "BluetoothHciThread.h"       // Header for BluetoothHciThread helpers
+
+/**
+ * @brief Class representing an H4 UART transport opened with termios.
+ *
+ * Reads on a polling thread in the same style as BluetoothHciSocket, frames
+ * H4 packets natively and delivers them through BluetoothHciDelivery. Writes
+ * go through a native queue drained by a writer thread.
+ */
+class BluetoothHciUart : public Napi::ObjectWrap<BluetoothHciUart> {
+ public:
+  /**
+   * @brief Initializes the BluetoothHciUart class and sets up exports to Node.js.
+   * @param env The N-API environment.
+   * @param exports The exports object to which the class is added.
+   * @return The modified exports object.
+   */
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  /**
+   * @brief Constructor for BluetoothHciUart.
+   * @param info Callback information from N-API.
+   */
+  BluetoothHciUart(const Napi::CallbackInfo& info);
+
+  /// Destructor
+  ~BluetoothHciUart();
+
+  /**
+   * @brief Opens and configures the tty.
+   * @param info Callback information from N-API (path, { baudRate, flowControl }).
+   */
+  void Open(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Starts the reader and writer threads.
+   * @param info Callback information from N-API.
+   */
+  void Start(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Stops the reader and writer threads.
+   * @param info Callback information from N-API.
+   */
+  void Stop(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Registers direct packet handlers that bypass the "data" event.
+   * @param info Callback information from N-API ({ event, acl, iso, command }, or null).
+   */
+  void OnPacket(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets delivery lane weights and depth limits.
+   * @param info Callback information from N-API ({ control, data, bulk } of { weight, limit }).
+   */
+  void SetDeliveryLanes(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Gets per-lane delivery depth, counters and queueing delay.
+   * @param info Callback information from N-API.
+   * @return Object with control, data and bulk lane statistics.
+   */
+  Napi::Value GetDeliveryStats(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Sets affinity, nice or SCHED_FIFO priority and name of the reader and writer threads.
+   * @param info Callback information from N-API ({ cpus, nice, priority, name }, or null).
+   */
+  void SetThreadOptions(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Queues an H4 packet for writing.
+   * @param info Callback information from N-API (packet buffer).
+   */
+  void Write(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Stops the threads and closes the tty.
+   * @param info Callback information from N-API.
+   */
+  void Close(const Napi::CallbackInfo& info);
+
+  /**
+   * @brief Opens a pseudo-terminal pair for end-to-end testing.
+   * @param info Callback information from N-API.
+   * @return Napi::Value containing { fd, path } of the non-blocking master fd and slave path.
+   */
+  static Napi::Value OpenPseudoTerminal(const Napi::CallbackInfo& info);
+
+ private:
+  /**
+   * @brief Reads and frames packets in a separate thread.
+   */
+  void ReadLoop();
+
+  /**
+   * @brief Drains the write queue in a separate thread.
+   */
+  void WriteLoop();
+
+  /**
+   * @brief Writes a whole buffer, waiting for the tty when it is full.
+   * @return True on success.
+   */
+  bool WriteAll(const std::string& data);
+
+  /**
+   * @brief Applies raw mode, flow control and the baud rate to the tty.
+   * @return True on success, errno is set otherwise.
+   */
+  bool Configure(uint32_t baudRate, bool flowControl);
+
+  /**
+   * @brief Joins the threads and clears the write queue.
+   */
+  void StopThreads();
+
+  int _fd;                          ///< File descriptor of the tty
+  std::atomic<bool> stopFlag;       ///< Atomic flag to signal the threads to stop
+  std::thread readerThread;         ///< Thread reading the tty
+  std::thread writerThread;         ///< Thread writing the tty
+  HciThreadOptions _threadOptions;  ///< Applied by both threads when they start
+
+  BluetoothHciPacketFramer _framer; ///< H4 framing state (reader thread only)
+  BluetoothHciDelivery _delivery;   ///< Batched thread-safe delivery to `emit`
+
+  std::mutex _writeMutex;                ///< Guards the write queue
+  std::condition_variable _writeCond;    ///< Signals queued writes and stop
+  std::deque<std::string> _writeQueue;   ///< Packets awaiting the writer thread
+};
+
+#endif // BLUETOOTH_HCI_UART_H
@@ -2,10 +2,12 @@
 #define BLUETOOTH_STRUCTS_H
 
 // Include necessary headers
+#include <cstddef>       // For size_t
 #include <cstdint>       // For fixed-width integer types
 #include <cstring>
 #include <map>
 #include <memory>
+#include <type_traits>   // For the packet layout loads
 #include <sys/socket.h>  // For sa_family_t
 
 // Bluetooth Protocols
@@ -15,6 +17,18 @@
 // Socket options and levels
 #define SOL_HCI       0   ///< Socket level for HCI
 #define HCI_FILTER    2   ///< Option name for HCI filter
+#define HCI_TIME_STAMP 3  ///< Option name for receive time stamps (raw channel)
+#define HCI_CMSG_TSTAMP 0x0002 ///< Control message carrying the receive time stamp
+#define SOL_BLUETOOTH 274 ///< Socket level for L2CAP channel options
+#define BT_SECURITY   4   ///< Option name for the channel's security level (struct bt_security)
+#define BT_SNDMTU     12  ///< Option name for the send MTU
+#define BT_RCVMTU     13  ///< Option name for the receive MTU
+
+// L2CAP channel security levels
+#define BT_SECURITY_LOW    1  ///< No encryption
+#define BT_SECURITY_MEDIUM 2  ///< Encrypted, unauthenticated pairing allowed
+#define BT_SECURITY_HIGH   3  ///< Encrypted, authenticated pairing
+#define BT_SECURITY_FIPS   4  ///< Encrypted, authenticated LE Secure Connections pairing
 
 // HCI ioctl commands
 #define HCIGETDEVLIST _IOR('H', 210, int) ///< Get HCI device list
@@ -23,33 +37,148 @@
 // HCI Channel types
 #define HCI_CHANNEL_RAW     0 ///< Raw HCI channel
 #define HCI_CHANNEL_USER    1 ///< User HCI channel
+#define HCI_CHANNEL_MONITOR 2 ///< Monitor HCI channel (all adapters)
 #define HCI_CHANNEL_CONTROL 3 ///< Control HCI channel
 
 // HCI device constants
 #define HCI_DEV_NONE  0xFFFF  ///< No HCI device
 #define HCI_MAX_DEV   16      ///< Maximum number of HCI devices
+#define HCI_MAX_FRAME_SIZE 4096 ///< Read buffer size, large enough for any framed packet
+
+// Management Channel Events
+#define MGMT_EV_INDEX_ADDED       0x0004 ///< Controller registered
+#define MGMT_EV_INDEX_REMOVED     0x0005 ///< Controller unregistered
+#define MGMT_EV_NEW_SETTINGS      0x0006 ///< Controller settings (powered, ...) changed
+#define MGMT_EV_EXT_INDEX_ADDED   0x0020 ///< Controller registered (extended)
+#define MGMT_EV_EXT_INDEX_REMOVED 0x0021 ///< Controller unregistered (extended)
 
 // HCI Event Packet Type
 #define HCI_EVENT_PKT 0x04
 
+// HCI Monitor Channel Opcodes
+#define HCI_MON_NEW_INDEX     0   ///< Adapter registered
+#define HCI_MON_DEL_INDEX     1   ///< Adapter unregistered
+#define HCI_MON_COMMAND_PKT   2   ///< HCI command sent to the controller
+#define HCI_MON_EVENT_PKT     3   ///< HCI event received from the controller
+#define HCI_MON_ACL_TX_PKT    4   ///< ACL data sent to the controller
+#define HCI_MON_ACL_RX_PKT    5   ///< ACL data received from the controller
+#define HCI_MON_SCO_TX_PKT    6   ///< SCO data sent to the controller
+#define HCI_MON_SCO_RX_PKT    7   ///< SCO data received from the controller
+#define HCI_MON_OPEN_INDEX    8   ///< Adapter opened
+#define HCI_MON_CLOSE_INDEX   9   ///< Adapter closed
+#define HCI_MON_INDEX_INFO    10  ///< Adapter address and manufacturer
+#define HCI_MON_ISO_TX_PKT    18  ///< ISO data sent to the controller
+#define HCI_MON_ISO_RX_PKT    19  ///< ISO data received from the controller
+
 // HCI Event Codes
 #define HCI_EV_LE_META 0x3E
+#define HCI_EV_CONN_COMPLETE 0x03
 #define HCI_EV_DISCONN_COMPLETE 0x05
+#define HCI_EV_ENCRYPT_CHANGE 0x08
+#define HCI_EV_ENCRYPT_KEY_REFRESH 0x30
+#define HCI_EV_ENCRYPT_CHANGE_V2 0x59
+#define HCI_EV_CMD_COMPLETE 0x0E
+#define HCI_EV_CMD_STATUS 0x0F
+#define HCI_EV_NUM_COMP_PKTS 0x13
+#define HCI_EV_INQUIRY_RESULT 0x02
+#define HCI_EV_INQUIRY_RESULT_WITH_RSSI 0x22
+#define HCI_EV_EXTENDED_INQUIRY_RESULT 0x2F
 
 // HCI LE Meta Event Subevent Codes
 #define HCI_EV_LE_CONN_COMPLETE 0x01
+#define HCI_EV_LE_CONN_UPDATE_COMPLETE 0x03
+#define HCI_EV_LE_REMOTE_FEATURES 0x04
+#define HCI_EV_LE_LTK_REQUEST 0x05
+#define HCI_EV_LE_DATA_LENGTH_CHANGE 0x07
 #define HCI_EV_LE_ENH_CONN_COMPLETE 0x0A
+#define HCI_EV_LE_PHY_UPDATE_COMPLETE 0x0C
+#define HCI_EV_LE_CIS_ESTABLISHED 0x19
+#define HCI_EV_LE_CREATE_BIG_COMPLETE 0x1B
+#define HCI_EV_LE_TERMINATE_BIG_COMPLETE 0x1C
+#define HCI_EV_LE_BIG_SYNC_ESTABLISHED 0x1D
+#define HCI_EV_LE_BIG_SYNC_LOST 0x1E
+#define HCI_EV_LE_ENH_CONN_COMPLETE_V2 0x29
+#define HCI_EV_LE_ADVERTISING_REPORT 0x02
+#define HCI_EV_LE_DIRECT_ADVERTISING_REPORT 0x0B
+#define HCI_EV_LE_EXT_ADVERTISING_REPORT 0x0D
+#define HCI_EV_LE_PERIODIC_ADVERTISING_REPORT 0x0F
+
+// Extended advertising report data status (event type bits 5-6)
+#define HCI_ADV_DATA_COMPLETE   0x00  ///< Complete, or last fragment of a chain
+#define HCI_ADV_DATA_INCOMPLETE 0x01  ///< Incomplete, more fragments to come
+#define HCI_ADV_DATA_TRUNCATED  0x02  ///< Incomplete, no further fragments
+
+#define HCI_MAX_EXT_ADV_DATA 1650     ///< Maximum reassembled advertising data length
+
+// Advertising data (AD) types
+#define AD_TYPE_FLAGS            0x01
+#define AD_TYPE_UUID16_SOME      0x02
+#define AD_TYPE_UUID16_ALL       0x03
+#define AD_TYPE_UUID32_SOME      0x04
+#define AD_TYPE_UUID32_ALL       0x05
+#define AD_TYPE_UUID128_SOME     0x06
+#define AD_TYPE_UUID128_ALL      0x07
+#define AD_TYPE_NAME_SHORT       0x08
+#define AD_TYPE_NAME_COMPLETE    0x09
+#define AD_TYPE_TX_POWER         0x0A
+#define AD_TYPE_SERVICE_DATA16   0x16
+#define AD_TYPE_SERVICE_DATA32   0x20
+#define AD_TYPE_SERVICE_DATA128  0x21
+#define AD_TYPE_MANUFACTURER     0xFF
 
 // Status Codes
 #define HCI_SUCCESS 0x00
+#define HCI_ERR_UNKNOWN_CONN_ID 0x02
+#define HCI_ERR_MEMORY_EXCEEDED 0x07
+#define HCI_ERR_CONN_LIMIT_EXCEEDED 0x09
+#define HCI_ERR_COMMAND_DISALLOWED 0x0C
+#define HCI_ERR_LIMITED_RESOURCES 0x0D
 
 // 
 #define HCI_COMMAND_PKT 0x01
+#define HCI_ACLDATA_PKT 0x02
+#define HCI_SCODATA_PKT 0x03
+#define HCI_ISODATA_PKT 0x05
 #define HCI_LE_CREATE_CONN 0x200D
+#define HCI_LE_CREATE_CONN_CANCEL 0x200E
 #define HCI_LE_EXT_CREATE_CONN 0x2043
+#define HCI_LE_SET_SCAN_PARAMETERS 0x200B
+#define HCI_LE_SET_SCAN_ENABLE 0x200C
+#define HCI_LE_SET_EXT_SCAN_PARAMETERS 0x2041
+#define HCI_LE_SET_EXT_SCAN_ENABLE 0x2042
+#define HCI_LE_CLEAR_ACCEPT_LIST 0x2010
+#define HCI_LE_ADD_TO_ACCEPT_LIST 0x2011
+#define HCI_LE_DEL_FROM_ACCEPT_LIST 0x2012
+#define HCI_RESET 0x0C03
+#define HCI_READ_BUFFER_SIZE 0x1005
+#define HCI_LE_READ_BUFFER_SIZE 0x2002
+#define HCI_LE_READ_BUFFER_SIZE_V2 0x2060
+#define HCI_READ_LOCAL_VERSION 0x1001
+#define HCI_READ_LOCAL_COMMANDS 0x1002
+#define HCI_READ_LOCAL_FEATURES 0x1003
+#define HCI_READ_BD_ADDR 0x1009
+#define HCI_LE_READ_LOCAL_FEATURES 0x2003
+#define HCI_LE_READ_ACCEPT_LIST_SIZE 0x200F
+#define HCI_LE_READ_SUPPORTED_STATES 0x201C
+#define HCI_LE_READ_RESOLV_LIST_SIZE 0x202A
+#define HCI_LE_READ_MAX_DATA_LEN 0x202F
+#define HCI_LE_READ_MAX_ADV_DATA_LEN 0x203A
+#define HCI_LE_READ_NUM_ADV_SETS 0x203B
+#define HCI_LE_READ_TX_POWER 0x204B
 
 // L2CAP constants
 #define ATT_CID 4 ///< Attribute Protocol CID (Channel Identifier)
+#define L2CAP_LE_MIN_MTU 23       ///< Smallest MTU of an LE credit based channel
+#define L2CAP_LE_DEFAULT_MTU 672  ///< Kernel's default MTU of an LE credit based channel
+
+// Socket address types
+#define BDADDR_LE_PUBLIC 0x01 ///< LE public address
+#define BDADDR_LE_RANDOM 0x02 ///< LE random address
+
+// ATT opcodes
+#define ATT_OP_HANDLE_NOTIFY 0x1B ///< Handle Value Notification
+#define ATT_OP_HANDLE_IND    0x1D ///< Handle Value Indication
+#define ATT_OP_HANDLE_CNF    0x1E ///< Handle Value Confirmation
 
 // 1 minute in nanoseconds
 #define L2_CONNECT_TIMEOUT 60000000000
@@ -109,6 +238,14 @@ struct sockaddr_l2 {
   uint8_t     l2_bdaddr_type; ///< Bluetooth address type (public or random).
 };
 
+/**
+ * @brief L2CAP channel security option (BT_SECURITY).
+ */
+struct bt_security {
+  uint8_t level;     ///< BT_SECURITY_LOW to BT_SECURITY_FIPS
+  uint8_t key_size;  ///< Encryption key size (read only)
+};
+
 /**
  * @brief HCI socket address structure.
  *
@@ -120,6 +257,30 @@ struct sockaddr_hci {
   uint16_t    hci_channel;  ///< HCI channel.
 };
 
+/**
+ * @brief HCI monitor channel header.
+ *
+ * Prefixes every frame read from a socket bound to HCI_CHANNEL_MONITOR.
+ * All fields are little-endian.
+ */
+struct __attribute__((packed)) hci_mon_hdr {
+  uint16_t opcode;  ///< Monitor opcode (HCI_MON_*).
+  uint16_t index;   ///< HCI device index the frame belongs to.
+  uint16_t len;     ///< Length of the payload following the header.
+};
+
+/**
+ * @brief Management channel header.
+ *
+ * Prefixes every frame exchanged on HCI_CHANNEL_CONTROL.
+ * All fields are little-endian.
+ */
+struct __attribute__((packed)) mgmt_hdr {
+  uint16_t opcode;  ///< Command opcode or event code.
+  uint16_t index;   ///< Controller index, or HCI_DEV_NONE.
+  uint16_t len;     ///< Length of the parameters following the header.
+};
+
 /**
  * @brief HCI device request structure.
  *
@@ -190,4 +351,296 @@ struct hci_dev_info {
   uint32_t byte_tx;  ///< Bytes transmitted.
 };
 
+/**
+ * @brief Field of an HCI packet layout.
+ *
+ * Offset is counted from the H4 packet type byte. Integers are little-endian;
+ * other types (bdaddr_t) are copied as they appear on the wire.
+ */
+template <size_t Offset, typename T>
+struct HciField {
+  static constexpr size_t offset = Offset;  ///< Offset from the H4 type byte
+  using Type = T;                           ///< Value type
+};
+
+/**
+ * @brief Loads a field value from a packet.
+ * @param p Pointer to the first byte of the field.
+ * @return The value, converted from little-endian for integers.
+ */
+template <typename T>
+inline T HciLoad(const uint8_t* p) {
+  if constexpr (std::is_integral_v<T>) {
+    // Byte-wise so it is endian and alignment independent; compilers fold it into one load
+    using U = std::make_unsigned_t<T>;
+    U value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      value |= static_cast<U>(static_cast<U>(p[i]) << (8 * i));
+    }
+    return static_cast<T>(value);
+  } else {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+  }
+}
+
+/**
+ * @brief Identifies a packet by H4 type and event code, LE subevent code or opcode.
+ * @param data Packet (H4 framed).
+ * @param length Length of the packet.
+ * @return The key layouts are dispatched on, or 0 if the packet is too short to tell.
+ */
+inline uint32_t HciPacketKey(const uint8_t* data, size_t length) {
+  if (length >= 4 && data[0] == HCI_EVENT_PKT) {
+    return (HCI_EVENT_PKT << 24) | (data[1] << 8) | (data[1] == HCI_EV_LE_META ? data[3] : 0);
+  }
+  if (length >= 4 && data[0] == HCI_COMMAND_PKT) {
+    return (HCI_COMMAND_PKT << 24) | HciLoad<uint16_t>(data + 1);
+  }
+  return 0;
+}
+
+/**
+ * @brief Layout base of an HCI event: type, event code, parameter length.
+ * @tparam Code Event code.
+ * @tparam MinParams Parameter bytes every field of the layout lies within.
+ */
+template <uint8_t Code, size_t MinParams>
+struct HciEventLayout {
+  static constexpr size_t size = 3 + MinParams;  ///< Bytes every field lies within
+  static constexpr uint32_t key = (HCI_EVENT_PKT << 24) | (Code << 8);  ///< HciPacketKey of the event
+  static constexpr uint8_t packetType = HCI_EVENT_PKT;                  ///< H4 packet type
+
+  /// Whether a packet known to be this event is complete and long enough for every field.
+  static bool fits(const uint8_t* data, size_t length) {
+    return length >= size && data[2] >= MinParams && length >= 3u + data[2];
+  }
+
+  /// Whether the packet is this event, complete and long enough for every field.
+  static bool matches(const uint8_t* data, size_t length) {
+    return length >= size && data[0] == HCI_EVENT_PKT && data[1] == Code && fits(data, length);
+  }
+};
+
+/**
+ * @brief Layout base of an LE meta event; the parameters start with the subevent code.
+ * @tparam Subevent LE subevent code.
+ * @tparam MinParams Parameter bytes, including the subevent code, every field lies within.
+ */
+template <uint8_t Subevent, size_t MinParams>
+struct HciLeEventLayout {
+  static constexpr size_t size = 3 + MinParams;  ///< Bytes every field lies within
+  static constexpr uint32_t key = (HCI_EVENT_PKT << 24) | (HCI_EV_LE_META << 8) | Subevent;  ///< HciPacketKey of the event
+  static constexpr uint8_t packetType = HCI_EVENT_PKT;                                        ///< H4 packet type
+
+  /// Whether a packet known to be this LE event is complete and long enough for every field.
+  static bool fits(const uint8_t* data, size_t length) {
+    return HciEventLayout<HCI_EV_LE_META, MinParams>::fits(data, length);
+  }
+
+  /// Whether the packet is this LE event, complete and long enough for every field.
+  static bool matches(const uint8_t* data, size_t length) {
+    return HciEventLayout<HCI_EV_LE_META, MinParams>::matches(data, length) && data[3] == Subevent;
+  }
+};
+
+/**
+ * @brief Layout base of an HCI command: type, opcode, parameter length.
+ * @tparam Opcode Command opcode.
+ * @tparam MinParams Parameter bytes every field of the layout lies within.
+ */
+template <uint16_t Opcode, size_t MinParams>
+struct HciCommandLayout {
+  static constexpr size_t size = 4 + MinParams;  ///< Bytes every field lies within
+  static constexpr uint32_t key = (HCI_COMMAND_PKT << 24) | Opcode;  ///< HciPacketKey of the command
+  static constexpr uint8_t packetType = HCI_COMMAND_PKT;              ///< H4 packet type
+
+  /// Whether a packet known to be this command is complete and long enough for every field.
+  static bool fits(const uint8_t* data, size_t length) {
+    return length >= size && data[3] >= MinParams && length >= 4u + data[3];
+  }
+
+  /// Whether the packet is this command, complete and long enough for every field.
+  static bool matches(const uint8_t* data, size_t length) {
+    return length >= size && data[0] == HCI_COMMAND_PKT && HciLoad<uint16_t>(data + 1) == Opcode && fits(data, length);
+  }
+};
+
+/**
+ * @brief Packet checked once against a layout, with unchecked constant-offset field reads.
+ *
+ * Reading a field that lies beyond the layout's size does not compile, so a
+ * view that converts to true can be read without further bounds checks.
+ */
+template <typename L>
+class HciView {
+ public:
+  using Layout = L;  ///< Layout of the packet
+
+  HciView(const uint8_t* data, size_t length) : _data(Layout::matches(data, length) ? data : nullptr) {}
+
+  /// View of a packet whose HciPacketKey is already known to be the layout's.
+  static HciView Keyed(const uint8_t* data, size_t length) {
+    HciView view(nullptr);
+    view._data = Layout::fits(data, length) ? data : nullptr;
+    return view;
+  }
+
+  /// Whether the packet matched the layout.
+  explicit operator bool() const { return _data != nullptr; }
+
+  /// Reads a field of the layout.
+  template <size_t Offset, typename T>
+  T operator[](HciField<Offset, T>) const {
+    static_assert(Offset + sizeof(T) <= Layout::size, "field lies beyond the layout's minimum length");
+    return HciLoad<T>(_data + Offset);
+  }
+
+ private:
+  explicit HciView(std::nullptr_t) : _data(nullptr) {}
+
+  const uint8_t* _data;  ///< Packet, or nullptr if it did not match
+};
+
+/// HciDispatch step for one layout; returns whether the packet has the layout's key.
+template <typename Layout, typename Handler>
+inline bool HciDispatchOne(uint32_t key, const uint8_t* data, size_t length, Handler& handler, bool& handled) {
+  if (key != Layout::key) {
+    return false;
+  }
+  HciView<Layout> view = HciView<Layout>::Keyed(data, length);
+  handled = view && handler(view);
+  return true;
+}
+
+/**
+ * @brief Hands a packet to the handler as a view of the layout it matches.
+ *
+ * The packet's key is computed once and compared against each layout's
+ * constant key. Only the layout with that key checks the lengths.
+ *
+ * @param data Packet (H4 framed).
+ * @param length Length of the packet.
+ * @param handler Called with an HciView; returns bool.
+ * @return The handler's result, or false if no layout matched.
+ */
+template <typename... Layouts, typename Handler>
+inline bool HciDispatch(const uint8_t* data, size_t length, Handler&& handler) {
+  // Packets of a type no layout has are rejected before the key is built
+  if (length < 4 || ((data[0] != Layouts::packetType) && ...)) {
+    return false;
+  }
+
+  uint32_t key = HciPacketKey(data, length);
+  bool handled = false;
+  (void)(HciDispatchOne<Layouts>(key, data, length, handler, handled) || ...);
+  return handled;
+}
+
+// Layouts of the packets parsed natively
+
+/// Command Complete: credits, opcode, then the command's return parameters (status first).
+struct HciCmdCompleteLayout : HciEventLayout<HCI_EV_CMD_COMPLETE, 4> {
+  static constexpr HciField<3, uint8_t> credits{};
+  static constexpr HciField<4, uint16_t> opcode{};
+  static constexpr HciField<6, uint8_t> status{};
+  static constexpr size_t returnParams = 7;  ///< Offset of the return parameters after the status
+};
+
+/// Command Status: status, credits, opcode.
+struct HciCmdStatusLayout : HciEventLayout<HCI_EV_CMD_STATUS, 4> {
+  static constexpr HciField<3, uint8_t> status{};
+  static constexpr HciField<4, uint8_t> credits{};
+  static constexpr HciField<5, uint16_t> opcode{};
+};
+
+/// Disconnection Complete.
+struct HciDisconnCompleteLayout : HciEventLayout<HCI_EV_DISCONN_COMPLETE, 4> {
+  static constexpr HciField<3, uint8_t> status{};
+  static constexpr HciField<4, uint16_t> handle{};
+  static constexpr HciField<6, uint8_t> reason{};
+};
+
+/// LE Connection Complete.
+struct HciLeConnCompleteLayout : HciLeEventLayout<HCI_EV_LE_CONN_COMPLETE, 19> {
+  static constexpr HciField<4, uint8_t> status{};
+  static constexpr HciField<5, uint16_t> handle{};
+  static constexpr HciField<7, uint8_t> role{};
+  static constexpr HciField<8, uint8_t> peerType{};
+  static constexpr HciField<9, bdaddr_t> peer{};
+  static constexpr HciField<15, uint16_t> interval{};
+  static constexpr HciField<17, uint16_t> latency{};
+  static constexpr HciField<19, uint16_t> supervisionTimeout{};
+  static constexpr HciField<21, uint8_t> clockAccuracy{};
+};
+
+/// LE Enhanced Connection Complete; shares the fields up to the peer address.
+struct HciLeEnhConnCompleteLayout : HciLeEventLayout<HCI_EV_LE_ENH_CONN_COMPLETE, 31> {
+  static constexpr HciField<4, uint8_t> status{};
+  static constexpr HciField<5, uint16_t> handle{};
+  static constexpr HciField<7, uint8_t> role{};
+  static constexpr HciField<8, uint8_t> peerType{};
+  static constexpr HciField<9, bdaddr_t> peer{};
+  static constexpr HciField<15, bdaddr_t> localRpa{};
+  static constexpr HciField<21, bdaddr_t> peerRpa{};
+  static constexpr HciField<27, uint16_t> interval{};
+  static constexpr HciField<29, uint16_t> latency{};
+  static constexpr HciField<31, uint16_t> supervisionTimeout{};
+  static constexpr HciField<33, uint8_t> clockAccuracy{};
+};
+
+/// LE Advertising Report, up to the address of the first report.
+struct HciLeAdvReportLayout : HciLeEventLayout<HCI_EV_LE_ADVERTISING_REPORT, 10> {
+  static constexpr HciField<4, uint8_t> numReports{};
+  static constexpr HciField<5, uint8_t> eventType{};
+  static constexpr HciField<6, uint8_t> peerType{};
+  static constexpr HciField<7, bdaddr_t> peer{};
+};
+
+/// LE Extended Advertising Report, up to the address of the first report.
+struct HciLeExtAdvReportLayout : HciLeEventLayout<HCI_EV_LE_EXT_ADVERTISING_REPORT, 11> {
+  static constexpr HciField<4, uint8_t> numReports{};
+  static constexpr HciField<5, uint16_t> eventType{};
+  static constexpr HciField<7, uint8_t> peerType{};
+  static constexpr HciField<8, bdaddr_t> peer{};
+};
+
+/// LE Directed Advertising Report, up to the address of the first report.
+struct HciLeDirectAdvReportLayout : HciLeEventLayout<HCI_EV_LE_DIRECT_ADVERTISING_REPORT, 10> {
+  static constexpr HciField<4, uint8_t> numReports{};
+  static constexpr HciField<5, uint8_t> eventType{};
+  static constexpr HciField<6, uint8_t> peerType{};
+  static constexpr HciField<7, bdaddr_t> peer{};
+};
+
+/// LE Create Connection.
+struct HciLeCreateConnLayout : HciCommandLayout<HCI_LE_CREATE_CONN, 0x19> {
+  static constexpr HciField<4, uint16_t> scanInterval{};
+  static constexpr HciField<6, uint16_t> scanWindow{};
+  static constexpr HciField<8, uint8_t> filterPolicy{};
+  static constexpr HciField<9, uint8_t> peerType{};
+  static constexpr HciField<10, bdaddr_t> peer{};
+  static constexpr HciField<16, uint8_t> ownAddressType{};
+  static constexpr HciField<17, uint16_t> connMinInterval{};
+  static constexpr HciField<19, uint16_t> connMaxInterval{};
+  static constexpr HciField<21, uint16_t> connLatency{};
+  static constexpr HciField<23, uint16_t> supervisionTimeout{};
+};
+
+/// LE Extended Create Connection, with the parameters of the first initiating PHY.
+struct HciLeExtCreateConnLayout : HciCommandLayout<HCI_LE_EXT_CREATE_CONN, 0x1A> {
+  static constexpr HciField<4, uint8_t> filterPolicy{};
+  static constexpr HciField<5, uint8_t> ownAddressType{};
+  static constexpr HciField<6, uint8_t> peerType{};
+  static constexpr HciField<7, bdaddr_t> peer{};
+  static constexpr HciField<13, uint8_t> phys{};
+  static constexpr HciField<14, uint16_t> scanInterval{};
+  static constexpr HciField<16, uint16_t> scanWindow{};
+  static constexpr HciField<18, uint16_t> connMinInterval{};
+  static constexpr HciField<20, uint16_t> connMaxInterval{};
+  static constexpr HciField<22, uint16_t> connLatency{};
+  static constexpr HciField<24, uint16_t> supervisionTimeout{};
+};
+
 #endif // BLUETOOTH_STRUCTS_H
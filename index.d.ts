@@ -18,6 +18,24 @@ declare module '@stoprocent/bluetooth-hci-socket' {
         deviceAddress: number | null;
         /** Device path (UART) */
         path: string | null;
+        /** HCI device name, e.g. hci0 (native) */
+        name?: string;
+        /** Adapter address (native) */
+        address?: string;
+        /** Bus type (native) */
+        bus?: number;
+        /** Controller type (native) */
+        type?: number;
+        /** HCI device flags (native) */
+        flags?: number;
+        /** ACL MTU (native) */
+        aclMtu?: number;
+        /** Number of ACL buffers (native) */
+        aclPackets?: number;
+        /** SCO MTU (native) */
+        scoMtu?: number;
+        /** Number of SCO buffers (native) */
+        scoPackets?: number;
     }
 
     export interface BindParams {
@@ -32,7 +50,647 @@ declare module '@stoprocent/bluetooth-hci-socket' {
             baudRate: number;
             retryConnection?: number;
             flowControl?: boolean;
+            /** Use the native termios transport instead of serialport (Linux, Android, FreeBSD) */
+            native?: boolean;
+            /** Scheduling of the native reader and writer threads */
+            threads?: ThreadOptions;
         } | undefined;
+        broker?: {
+            /** Ring path returned by startBroker(), or an inherited descriptor */
+            path: string | number;
+        };
+    }
+
+    export interface PacketMeta {
+        /** Adapter the packet belongs to (monitor channel) */
+        devId?: number;
+        /** Packet direction relative to the host (monitor channel) */
+        direction?: 'rx' | 'tx';
+        /** Entry of setIrks() the packet's resolvable private address resolved to */
+        identity?: IrkEntry | Buffer;
+        /** Ids of the setAdPatterns() patterns found in the packet's advertising reports */
+        matches?: number[];
+    }
+
+    export interface IrkEntry {
+        /** IRK, most significant octet first: 16 bytes or 32 hex digits */
+        irk: Buffer | string;
+        /** Anything else, e.g. the identity address, is handed back as is */
+        [key: string]: any;
+    }
+
+    export interface IrkOptions {
+        /** Addresses whose result is cached (default 4096) */
+        cacheSize?: number;
+        /** ms a cached result is kept (default 900000) */
+        cacheTtl?: number;
+    }
+
+    export interface AdPattern {
+        /** Reported in matches (default the pattern's index); patterns may share one */
+        id?: number;
+        /** AD type whose value is searched, e.g. 0xFF manufacturer data, 0x16 service data */
+        type: number;
+        /** Bytes to find: a Buffer or hex digits */
+        data: Buffer | string;
+        /** Offset in the value the bytes must start at (default 0); negative matches anywhere */
+        offset?: number;
+    }
+
+    export interface AdPatternOptions {
+        /** Drop advertising reports that match no pattern instead of delivering them untagged */
+        filter?: boolean;
+    }
+
+    export interface AdPatternStats {
+        patterns: number;
+        /** States of the automata built from the catalog */
+        states: number;
+        /** Advertising report events that matched */
+        matched: number;
+        /** Advertising report events dropped by the filter */
+        dropped: number;
+    }
+
+    export interface AcceptTarget {
+        address: string;
+        /** 'public' or 'random' (default 'public') */
+        addressType?: 'public' | 'random';
+        /** Higher priorities are kept in the list when the targets outnumber it (default 0) */
+        priority?: number;
+    }
+
+    export interface AcceptListOptions {
+        /** Ranking of the targets kept in the list: 'priority' (default) or 'recency' */
+        policy?: 'priority' | 'recency';
+        /** Entries to use at most (default the controller's list size) */
+        capacity?: number;
+        /** ms between rotations of the targets that do not fit (default 5000) */
+        rotateInterval?: number;
+        /** Pause a scan that filters through the list to change it (default true) */
+        pauseScan?: boolean;
+    }
+
+    export interface AcceptListStats {
+        targets: number;
+        /** Entries in the controller's list */
+        installed: number;
+        /** Entries used, 0 until the controller's list size is read */
+        capacity: number;
+        /** Targets the controller refused */
+        rejected: number;
+        rotations: number;
+        /** Commands sent to the controller */
+        commands: number;
+        /** Commands saved over clearing and refilling the list on every change */
+        commandsSaved: number;
+        /** Syncs held back by a connection attempt or refused by the controller */
+        deferred: number;
+        /** Advertising reports from targets */
+        targetReports: number;
+        /** Advertising reports from other devices */
+        otherReports: number;
+        /** ms scanned through the list */
+        filteredTime: number;
+        /** ms scanned without it */
+        unfilteredTime: number;
+        /** Reports from other devices kept away by the list, estimated from the unfiltered rate */
+        reportsSaved: number;
+    }
+
+    export interface ConnectTarget {
+        address: string;
+        /** 'public' or 'random' (default 'public') */
+        addressType?: 'public' | 'random';
+        /** Higher priorities get the accept list entries first (default 0) */
+        priority?: number;
+        /** ms an attempt may take (default the options' timeout) */
+        timeout?: number;
+    }
+
+    export interface ConnectOptions {
+        /** Accept list entries to use at most (default the controller's list size) */
+        capacity?: number;
+        /** Default ms an attempt may take before the initiation is cancelled (default 10000) */
+        timeout?: number;
+        /** Attempts per device before it is given up on (default 3) */
+        attempts?: number;
+        /** Use LE Extended Create Connection on the 1M PHY (default false) */
+        extended?: boolean;
+        ownAddressType?: number;
+        /** Connection parameters in the controller's units, as in LE Create Connection */
+        scanInterval?: number;
+        scanWindow?: number;
+        connMinInterval?: number;
+        connMaxInterval?: number;
+        connLatency?: number;
+        supervisionTimeout?: number;
+    }
+
+    export interface ConnectResult {
+        address: string;
+        addressType: 'public' | 'random';
+        outcome: 'connected' | 'timeout' | 'rejected' | 'failed' | 'cancelled';
+        /** HCI status of the last failed attempt, 0 if none failed */
+        status: number;
+        /** Connection handle, if connected */
+        handle?: number;
+        attempts: number;
+        /** ms from being queued to the outcome */
+        latency: number;
+    }
+
+    export interface ConnectStats {
+        /** Devices waiting for a connection */
+        queued: number;
+        /** Of which in the controller's accept list */
+        installed: number;
+        /** Entries used, 0 until the controller's list size is read */
+        capacity: number;
+        connected: number;
+        /** Devices given up on, cancelled ones included */
+        failed: number;
+        /** Create Connection commands sent */
+        initiations: number;
+        /** Initiations cancelled by a timeout */
+        cancels: number;
+        /** Commands sent to the controller */
+        commands: number;
+        /** Initiations held back by the host's own or refused by the controller */
+        deferred: number;
+        /** ms from being queued to connected, over the connected devices */
+        latencyMean: number;
+        latencyMax: number;
+    }
+
+    export interface ObservationStoreOptions {
+        /** ms of observations per segment file; segments start at multiples of it (default 3600000) */
+        segmentDuration?: number;
+        /** Bytes reserved for the segment being written (default 16 MiB) */
+        segmentSize?: number;
+        /** Bytes kept at most, the oldest segments are deleted first (default no limit) */
+        maxBytes?: number;
+        /** ms observations are kept (default no limit) */
+        maxAge?: number;
+    }
+
+    export interface ObservationQuery {
+        /** First time included, ms since the epoch */
+        from?: number;
+        /** First time excluded */
+        to?: number;
+        /** Only this device, looked up in the segments' address index */
+        address?: string;
+        addressType?: 'public' | 'random';
+        /** Oldest observations returned at most (default 10000) */
+        limit?: number;
+    }
+
+    export interface Observation {
+        /** ms since the epoch */
+        time: number;
+        address: string;
+        addressType: 'public' | 'random';
+        rssi: number;
+        eventType: number;
+        /** Advertising data */
+        data: Buffer;
+    }
+
+    export interface ObservationStoreStats {
+        open: boolean;
+        /** Segment files, the one being written included */
+        segments: number;
+        bytes: number;
+        records: number;
+        /** Advertisements appended since the store was opened */
+        appended: number;
+        /** Of which shared advertising data already stored in the segment */
+        deduplicated: number;
+        /** Advertisements lost because a segment could not be created */
+        dropped: number;
+        /** Segments deleted by maxBytes or maxAge */
+        pruned: number;
+    }
+
+    export interface ResolverStats {
+        irks: number;
+        /** AES implementation: 'aes-ni' or 'portable' */
+        backend: string;
+        cached: number;
+        /** Lookups answered by the cache */
+        hits: number;
+        /** Lookups that scanned the IRK list */
+        misses: number;
+        /** Scans that found an IRK */
+        resolved: number;
+    }
+
+    export interface IndexEvent {
+        /** Kind of adapter change */
+        type: 'new' | 'del' | 'open' | 'close' | 'info';
+        /** Adapter index */
+        devId: number;
+        /** Bus type (new) */
+        busType?: number;
+        /** Adapter address, little-endian (new, info) */
+        address?: Buffer;
+        /** Adapter name, e.g. hci0 (new) */
+        name?: string;
+        /** Company identifier (info) */
+        manufacturer?: number;
+    }
+
+    export type AdapterPolicy = 'least-connections' | 'round-robin' | 'sticky';
+
+    export interface AdapterLoad {
+        /** Adapter index */
+        devId: number;
+        /** Live LE connections */
+        connections: number;
+        /** Create connection attempts awaiting completion */
+        pending: number;
+        /** Learned link limit, 0 if never reached */
+        maxConnections: number;
+        /** Controller ACL buffer size */
+        aclMtu: number;
+        /** Controller ACL buffer count */
+        aclBuffers: number;
+        /** ACL packets sent but not yet completed */
+        aclInFlight: number;
+        /** Successful connections since tracking began */
+        connectsTotal: number;
+        /** Failed connection attempts since tracking began */
+        failuresTotal: number;
+    }
+
+    export interface ServiceData {
+        /** Service UUID, lowercase hex without dashes */
+        uuid: string;
+        /** Service data following the UUID */
+        data: Buffer;
+    }
+
+    /** Natively reassembled and decoded advertisement (native driver). Fields are read on access. */
+    export interface Advertisement {
+        /** Encoded advertisement backing the view */
+        readonly buffer: Buffer;
+        /** Extended advertising report event type (data status bits cleared) */
+        readonly eventType: number;
+        readonly connectable: boolean;
+        readonly scannable: boolean;
+        readonly scanResponse: boolean;
+        /** Reported from a legacy advertising PDU */
+        readonly legacy: boolean;
+        readonly address: string;
+        readonly addressType: 'public' | 'random';
+        readonly primaryPhy: number;
+        readonly secondaryPhy: number;
+        /** Advertising SID, null for legacy reports */
+        readonly sid: number | null;
+        readonly rssi: number;
+        /** TX power from the report, null if unavailable */
+        readonly txPower: number | null;
+        /** The controller gave up before the chain was complete */
+        readonly truncated: boolean;
+        /** AD structures overran the data; the ones before were kept */
+        readonly malformed: boolean;
+        /** Number of reports the data was reassembled from */
+        readonly fragments: number;
+        readonly flags: number | null;
+        /** TX power level AD structure */
+        readonly txPowerLevel: number | null;
+        readonly localName: string | null;
+        readonly serviceUuids: string[];
+        readonly serviceData: ServiceData[];
+        readonly manufacturerData: Buffer | null;
+        /** Reassembled advertising data */
+        readonly data: Buffer;
+        /** Value of the first AD structure of the given type */
+        get(type: number): Buffer | null;
+        /** Entry of setIrks() the address resolved to */
+        readonly identity: IrkEntry | Buffer | null;
+        /** Ids of the setAdPatterns() patterns found in the data, null without a catalog */
+        readonly matches: number[] | null;
+    }
+
+    /** Advertisements of one delivery batch in columns (native driver). Row i spans every column. */
+    export interface AdvertisementBatch {
+        count: number;
+        /** 6 bytes per row, little endian */
+        address: Uint8Array;
+        addressType: Uint8Array;
+        /** Extended advertising report event type (data status bits cleared) */
+        eventType: Uint16Array;
+        rssi: Int8Array;
+        /** 127 if unavailable */
+        txPower: Int8Array;
+        /** 0xff for legacy reports */
+        sid: Uint8Array;
+        primaryPhy: Uint8Array;
+        secondaryPhy: Uint8Array;
+        /** Start of each row's advertising data in `data` */
+        dataOffset: Uint32Array;
+        dataLength: Uint32Array;
+        /** Advertising data of all rows, contiguous */
+        data: Uint8Array;
+    }
+
+    export interface IsoSduMeta {
+        connHandle: number;
+        sequenceNumber: number;
+        /** Time stamp in microseconds, null if the controller supplied none */
+        timestamp: number | null;
+        /** Packet status flag: 0 valid, 1 possibly invalid, 2 lost */
+        status: number;
+    }
+
+    export interface IsoSduOptions {
+        sequenceNumber?: number;
+        /** Time stamp in microseconds */
+        timestamp?: number;
+        /** ISO data load per packet; defaults to the size read with LE Read Buffer Size [v2] */
+        mtu?: number;
+    }
+
+    export type PacketHandler = (packet: Buffer, meta?: PacketMeta) => void;
+
+    export interface PacketHandlers {
+        event?: PacketHandler;
+        acl?: PacketHandler;
+        iso?: PacketHandler;
+        command?: PacketHandler;
+    }
+
+    export interface ThreadOptions {
+        /** CPUs the native I/O threads may run on */
+        cpus?: number[];
+        /** Nice value, -20 to 19 */
+        nice?: number;
+        /** SCHED_FIFO priority, 1 to 99; 0 keeps the default scheduler */
+        priority?: number;
+        /** Thread name, at most 15 characters */
+        name?: string;
+    }
+
+    export interface ReadStats {
+        /** Packets read since start */
+        reads: number;
+        /** Reads with a kernel receive time stamp since the previous call */
+        timestamped: number;
+        /** Kernel receive to read latency in microseconds, since the previous call */
+        averageLatency: number;
+        maxLatency: number;
+    }
+
+    export interface DeliveryLaneOptions {
+        /** Packets taken from the lane per round of a delivery batch */
+        weight?: number;
+        /** Queued packets beyond which new packets of the lane are dropped; 0 (the default) for unbounded */
+        limit?: number;
+    }
+
+    export interface DeliveryLanes {
+        /** Commands, command completions and other events (default weight 256, unbounded) */
+        control?: DeliveryLaneOptions;
+        /** ACL, SCO and ISO data and the connection lifecycle events (default weight 16, unbounded) */
+        data?: DeliveryLaneOptions;
+        /** Advertising and inquiry reports (default weight 4, unbounded) */
+        bulk?: DeliveryLaneOptions;
+    }
+
+    export interface DeliveryLaneStats {
+        depth: number;
+        weight: number;
+        limit: number;
+        delivered: number;
+        dropped: number;
+        /** Queueing delay in microseconds, over the packets delivered since the previous call */
+        averageDelay: number;
+        maxDelay: number;
+    }
+
+    export interface DeliveryStats {
+        control: DeliveryLaneStats;
+        data: DeliveryLaneStats;
+        bulk: DeliveryLaneStats;
+    }
+
+    export interface PacketsOptions {
+        /** Packets read ahead of the consumer before reading pauses (default 1024) */
+        highWaterMark?: number;
+        /** Packets per batch at most (default 256) */
+        batchSize?: number;
+        /** Kernel receive buffer size in bytes, see setReceiveBuffer() */
+        receiveBuffer?: number;
+    }
+
+    export interface PacketBatch {
+        packets: Buffer[];
+        /** Packets the kernel dropped since the previous batch because the receive buffer was full */
+        dropped: number;
+        /** Bytes waiting in the kernel receive buffer */
+        queued: number;
+    }
+
+    export interface ReceiveQueueStats {
+        /** Kernel receive buffer size in bytes */
+        receiveBuffer: number;
+        /** Bytes waiting in it */
+        queued: number;
+        /** Packets the kernel dropped because it was full, since the socket was opened */
+        drops: number;
+        /** Packets that may still be read, null without flow control */
+        credit: number | null;
+        /** Times the credit ran out */
+        stalls: number;
+        /** ms reading waited for credit */
+        stalledTime: number;
+    }
+
+    export interface ProbeOptions {
+        /** Cache file, or false to always probe (default ~/.cache/bluetooth-hci-socket/controllers.json) */
+        cache?: string | false;
+        /** Ms each probe round may take (default 2000) */
+        timeout?: number;
+    }
+
+    export interface ControllerCapabilities {
+        /** Controller address */
+        address?: string;
+        version?: {
+            hci: number;
+            hciRevision: number;
+            lmp: number;
+            lmpSubversion: number;
+            /** Company identifier */
+            manufacturer: number;
+        };
+        /** Supported commands bitmask (64 octets) */
+        commands?: Buffer;
+        /** LMP features (8 octets) */
+        features?: Buffer;
+        /** LE features (8 octets) */
+        leFeatures?: Buffer;
+        /** LE supported states (8 octets) */
+        leStates?: Buffer;
+        aclMtu?: number;
+        aclPackets?: number;
+        scoMtu?: number;
+        scoPackets?: number;
+        leAclMtu?: number;
+        leAclPackets?: number;
+        isoMtu?: number;
+        isoPackets?: number;
+        maxDataLength?: { txOctets: number; txTime: number; rxOctets: number; rxTime: number };
+        maxAdvertisingDataLength?: number;
+        advertisingSets?: number;
+        acceptListSize?: number;
+        resolvingListSize?: number;
+        /** Supported transmit power range in dBm */
+        txPower?: { min: number; max: number };
+        /** Whether the capabilities came from the cache */
+        cached: boolean;
+    }
+
+    export interface BrokerOptions {
+        /** Packet ring size in bytes, 64 KiB to 1 GiB (default 4 MiB) */
+        size?: number;
+    }
+
+    export interface BrokerRing {
+        /** Descriptor of the ring's memfd in the broker process */
+        fd: number;
+        /** Path other processes attach with */
+        path: string;
+    }
+
+    export interface BrokerConsumerStats {
+        slot: number;
+        /** Packets published but not yet read */
+        lag: number;
+        /** Packets read that passed the consumer's filter */
+        delivered: number;
+        /** Packets read that the consumer's filter rejected */
+        filtered: number;
+        /** Packets overwritten before the consumer read them */
+        lost: number;
+    }
+
+    export interface BrokerConsumer extends BrokerConsumerStats {
+        pid: number;
+    }
+
+    export type L2CapSecurity = 'low' | 'medium' | 'high' | 'fips';
+
+    export interface L2CapSource {
+        /** Adapter address (default any) */
+        address?: string;
+        addressType?: 'public' | 'random';
+    }
+
+    export interface L2CapConnectOptions {
+        address: string;
+        addressType?: 'public' | 'random';
+        /** LE PSM, 1-255 */
+        psm: number;
+        /** Receive MTU, 23-65535 (kernel default 672) */
+        mtu?: number;
+        security?: L2CapSecurity;
+        source?: L2CapSource;
+        /** Queued bytes at which write() returns false (default 65536) */
+        highWaterMark?: number;
+    }
+
+    export interface L2CapListenOptions {
+        /** LE PSM, 0-255; 0 lets the kernel pick a free dynamic PSM */
+        psm?: number;
+        mtu?: number;
+        security?: L2CapSecurity;
+        source?: L2CapSource;
+        backlog?: number;
+        /** highWaterMark of the accepted channels */
+        highWaterMark?: number;
+    }
+
+    export interface L2CapChannelStats {
+        rxBytes: number;
+        rxSdus: number;
+        txBytes: number;
+        txSdus: number;
+        /** Bytes per second since the previous call */
+        rxThroughput: number;
+        txThroughput: number;
+        /** From write() to the socket taking the SDU, in microseconds, since the previous call */
+        averageWriteLatency: number;
+        maxWriteLatency: number;
+        /** From reading a batch of SDUs to emitting it, in microseconds, since the previous call */
+        averageDeliveryLatency: number;
+        maxDeliveryLatency: number;
+        queuedSdus: number;
+        queuedBytes: number;
+        rxMtu: number;
+        txMtu: number;
+    }
+
+    export interface L2CapChannel extends EventEmitter {
+        connect(options: L2CapConnectOptions): void;
+        /** Returns the PSM listened on */
+        listen(options?: L2CapListenOptions): number;
+        /** False once the queued bytes reach highWaterMark; wait for "drain" */
+        write(sdu: Buffer): boolean;
+        setThreadOptions(options: ThreadOptions | null): void;
+        getStats(): L2CapChannelStats;
+        close(): void;
+
+        on(event: "connect", cb: (mtu: { rxMtu: number; txMtu: number }) => void): this;
+        on(event: "connection", cb: (channel: L2CapChannel, peer: { address: string; addressType: 'public' | 'random' }) => void): this;
+        on(event: "data", cb: (sdu: Buffer) => void): this;
+        on(event: "drain" | "close", cb: () => void): this;
+        on(event: "warning" | "error", cb: (error: NodeJS.ErrnoException) => void): this;
+    }
+
+    /** Native driver platforms only (Linux); null elsewhere */
+    export const L2CapChannel: (new () => L2CapChannel) | null;
+
+    export interface ScanTableOptions {
+        /** Snapshot interval in ms (default 250) */
+        interval?: number;
+        /** Maximum devices tracked; the least recently seen is evicted (default 1024) */
+        capacity?: number;
+        /** Ms without advertisements before a device is lost (default 10000) */
+        lostTimeout?: number;
+        /** EWMA weight of a new RSSI sample (default 0.25) */
+        alpha?: number;
+        /** RSSI samples in the median filter, 1-15 (default 5) */
+        medianWindow?: number;
+        /** Smoothed RSSI movement in dB reported as a change (default 2) */
+        rssiThreshold?: number;
+    }
+
+    export interface ScanDevice {
+        address: string;
+        addressType: 'public' | 'random';
+        /** Last RSSI */
+        rssi: number;
+        /** Exponentially weighted moving average of RSSI */
+        rssiSmoothed: number;
+        /** Median of the recent RSSI samples */
+        rssiMedian: number;
+        /** ms since the epoch */
+        firstSeen: number;
+        /** ms since the epoch */
+        lastSeen: number;
+        /** Advertisements received */
+        count: number;
+        /** Last advertising data */
+        data: Buffer;
+    }
+
+    export interface ScanSnapshot {
+        added: ScanDevice[];
+        changed: ScanDevice[];
+        lost: Pick<ScanDevice, 'address' | 'addressType'>[];
     }
 
     export class BluetoothHciSocket extends EventEmitter {
@@ -46,15 +704,91 @@ declare module '@stoprocent/bluetooth-hci-socket' {
         bindRaw(devId: number, params?: BindParams): number;
         bindUser(devId: number, params?: BindParams): number;
         bindControl(): number;
+        bindMonitor(): void;
+
+        pickAdapter(policy?: AdapterPolicy, address?: string): number | null;
+        getAdapterLoad(): AdapterLoad[];
+
+        /** Native driver only. Capabilities of the started controller, cached by address and firmware version. */
+        probeController(options?: ProbeOptions): Promise<ControllerCapabilities>;
+
+        /** Native driver only. Scheduling of the polling thread, applied at the next start(); failures are emitted as "warning". */
+        setThreadOptions(options: ThreadOptions | null): void;
+        getReadStats(): ReadStats;
+
+        /** Native driver only. Shares the socket with other processes using the broker driver. */
+        startBroker(options?: BrokerOptions): BrokerRing;
+        stopBroker(): void;
+        getBrokerConsumers(): BrokerConsumer[];
+
+        /** Broker driver only */
+        getStats(): (BrokerConsumerStats & { closed: boolean }) | null;
+
+        /** Native driver only. Resolves private addresses of advertising and connection events against the list; null clears it. */
+        setIrks(list: (IrkEntry | Buffer)[] | null, options?: IrkOptions): void;
+        getResolverStats(): ResolverStats;
+
+        /** Native driver only. Matches advertising reports against the catalog; null removes it. Takes effect with the next packet. */
+        setAdPatterns(patterns: AdPattern[] | null, options?: AdPatternOptions): void;
+        getAdPatternStats(): AdPatternStats;
+
+        /** Native driver only. Keeps the controller's filter accept list in sync with the targets; null empties it. */
+        setAcceptList(targets: AcceptTarget[] | null, options?: AcceptListOptions): void;
+        getAcceptListStats(): AcceptListStats;
+
+        /** Native driver only. Connects to the queued devices through the filter accept list, reporting each as "connectResult"; null cancels the queue. */
+        connectDevices(targets: ConnectTarget[] | null, options?: ConnectOptions): void;
+        getConnectStats(): ConnectStats;
+
+        /** Native driver only. Appends every advertisement to segment files in the directory; null closes it. */
+        setObservationStore(directory: string | null, options?: ObservationStoreOptions): void;
+        queryObservations(query?: ObservationQuery): Observation[];
+        getObservationStoreStats(): ObservationStoreStats;
+
+        /** Native driver only */
+        startScanTable(options?: ScanTableOptions): void;
+        stopScanTable(): void;
+
+        /** Native driver only. Values of notifications/indications of the attribute, batched; the subscription ends on disconnect. */
+        subscribeAtt(connHandle: number, attrHandle: number, callback: (values: Buffer[]) => void, options?: { confirm?: boolean }): number;
+        unsubscribeAtt(subscription: number): boolean;
+
+        /** Native driver only. Fragments the SDU to the controller's ISO buffer size. */
+        writeIsoSdu(connHandle: number, sdu: Buffer, options?: IsoSduOptions): void;
 
         setFilter(filter: Buffer): void;
         write(data: Buffer): void;
 
-        on(event: "data", cb: (data: Buffer) => void): this;
+        /** Native driver only. Packets of a type with a handler skip the "data" event; null removes all handlers. */
+        onPacket(handlers: PacketHandlers | null): void;
+
+        /** Native driver only. Weights and depth limits of the delivery priority lanes. */
+        setDeliveryLanes(lanes: DeliveryLanes): void;
+        getDeliveryStats(): DeliveryStats;
+
+        /** Native driver only. Batches of packets, read from the socket only as fast as they are consumed. One iterator at a time; stop() ends it. */
+        packets(options?: PacketsOptions): AsyncIterableIterator<PacketBatch>;
+        /** Native driver only. Bounds the packets queued for "data" events to a credit; null removes the bound. */
+        setFlowControl(credit: number | null): void;
+        grantCredit(packets: number): void;
+        /** Native driver only. Returns the size the kernel applied, which is doubled and may be capped by net.core.rmem_max. */
+        setReceiveBuffer(bytes: number): number;
+        getReceiveQueueStats(): ReceiveQueueStats;
+
+        on(event: "data", cb: (data: Buffer, meta?: PacketMeta) => void): this;
+        on(event: "index", cb: (event: IndexEvent) => void): this;
+        on(event: "advertisement", cb: (advertisement: Advertisement) => void): this;
+        on(event: "advertisementBatch", cb: (batch: AdvertisementBatch) => void): this;
+        on(event: "isoSdu", cb: (sdu: Buffer, meta: IsoSduMeta) => void): this;
+        on(event: "scanSnapshot", cb: (snapshot: ScanSnapshot) => void): this;
+        on(event: "deviceAdded" | "deviceChanged", cb: (device: Device) => void): this;
+        on(event: "deviceRemoved", cb: (device: { devId: number }) => void): this;
+        on(event: "connectResult", cb: (result: ConnectResult) => void): this;
+        on(event: "warning", cb: (error: NodeJS.ErrnoException) => void): this;
         on(event: "error", cb: (error: NodeJS.ErrnoException) => void): this;
     }
 
-    export type DriverType = 'default' | 'uart' | 'usb' | 'native';
+    export type DriverType = 'default' | 'uart' | 'usb' | 'native' | 'broker';
 
     export function loadDriver(driverType: DriverType): typeof BluetoothHciSocket;
     
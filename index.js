@@ -9,6 +9,8 @@ function loadDriver (driverType) {
       return require('./lib/usb.js');
     case 'native':
       return require('./lib/native.js');
+    case 'broker':
+      return require('./lib/broker.js');
     case 'default':
       return getDefaultDriver();
     default:
@@ -18,7 +20,9 @@ function loadDriver (driverType) {
 
 // Default driver selection logic
 function getDefaultDriver () {
-  if (process.env.BLUETOOTH_HCI_SOCKET_UART_PORT || process.env.BLUETOOTH_HCI_SOCKET_FORCE_UART) {
+  if (process.env.BLUETOOTH_HCI_SOCKET_BROKER) {
+    return loadDriver('broker');
+  } else if (process.env.BLUETOOTH_HCI_SOCKET_UART_PORT || process.env.BLUETOOTH_HCI_SOCKET_FORCE_UART) {
     return loadDriver('uart');
   } else if (process.env.BLUETOOTH_HCI_SOCKET_FORCE_USB || platform === 'win32' || platform === 'freebsd') {
     return loadDriver('usb');
@@ -30,4 +34,5 @@ function getDefaultDriver () {
 }
 
 module.exports = loadDriver('default');
-module.exports.loadDriver = loadDriver;
\ No newline at end of file
+module.exports.loadDriver = loadDriver;
+module.exports.L2CapChannel = require('./lib/l2cap.js');
\ No newline at end of file
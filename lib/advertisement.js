@@ -0,0 +1,177 @@
+// Layout of the encoded advertisement produced by BluetoothHciAdvertisingAssembler
+// (include/BluetoothHciAdvertising.h); both must change together.
+const EVENT_TYPE = 0;
+const ADDRESS_TYPE = 2;
+const ADDRESS = 3;
+const PRIMARY_PHY = 9;
+const SECONDARY_PHY = 10;
+const SID = 11;
+const TX_POWER = 12;
+const RSSI = 13;
+const DATA_STATUS = 14;
+const AD_COUNT = 15;
+const FLAGS = 16;
+const PRESENT = 17;
+const TX_POWER_LEVEL = 18;
+const FRAGMENTS = 19;
+const DATA_LENGTH = 20;
+const HEADER_LENGTH = 24;
+const ENTRY_LENGTH = 4;
+
+const PRESENT_FLAGS = 0x01;
+const PRESENT_TX_POWER_LEVEL = 0x02;
+const PRESENT_MALFORMED = 0x80;
+
+const AD_TYPE_UUID16_SOME = 0x02;
+const AD_TYPE_UUID16_ALL = 0x03;
+const AD_TYPE_UUID32_SOME = 0x04;
+const AD_TYPE_UUID32_ALL = 0x05;
+const AD_TYPE_UUID128_SOME = 0x06;
+const AD_TYPE_UUID128_ALL = 0x07;
+const AD_TYPE_NAME_SHORT = 0x08;
+const AD_TYPE_NAME_COMPLETE = 0x09;
+const AD_TYPE_SERVICE_DATA16 = 0x16;
+const AD_TYPE_SERVICE_DATA32 = 0x20;
+const AD_TYPE_SERVICE_DATA128 = 0x21;
+const AD_TYPE_MANUFACTURER = 0xff;
+
+const DATA_STATUS_TRUNCATED = 0x02;
+const TX_POWER_UNAVAILABLE = 127;
+
+// Little endian UUID bytes to the lowercase hex form used by noble
+function uuidString (buffer, offset, length) {
+  return Buffer.from(buffer.subarray(offset, offset + length)).reverse().toString('hex');
+}
+
+/**
+ * Thin view over one natively decoded advertisement. The AD structures were
+ * walked once in the addon; every getter reads the index or slices the data
+ * on access, so unused fields cost nothing.
+ */
+class Advertisement {
+  constructor (buffer, identity, matches) {
+    this.buffer = buffer;
+    // Entry of setIrks() the advertiser's private address resolved to
+    this.identity = identity === undefined ? null : identity;
+    // Ids of the setAdPatterns() patterns found in the data, null without a catalog
+    this.matches = matches === undefined ? null : matches;
+    this._dataOffset = HEADER_LENGTH + buffer[AD_COUNT] * ENTRY_LENGTH;
+  }
+
+  get eventType () { return this.buffer.readUInt16LE(EVENT_TYPE); }
+  get connectable () { return (this.eventType & 0x01) !== 0; }
+  get scannable () { return (this.eventType & 0x02) !== 0; }
+  get scanResponse () { return (this.eventType & 0x08) !== 0; }
+  get legacy () { return (this.eventType & 0x10) !== 0; }
+
+  get addressType () { return this.buffer[ADDRESS_TYPE] & 0x01 ? 'random' : 'public'; }
+
+  get address () {
+    const b = this.buffer;
+    const parts = [];
+    for (let i = 5; i >= 0; i--) {
+      parts.push(b[ADDRESS + i].toString(16).padStart(2, '0'));
+    }
+    return parts.join(':');
+  }
+
+  get primaryPhy () { return this.buffer[PRIMARY_PHY]; }
+  get secondaryPhy () { return this.buffer[SECONDARY_PHY]; }
+  get sid () { return this.buffer[SID] === 0xff ? null : this.buffer[SID]; }
+  get rssi () { return this.buffer.readInt8(RSSI); }
+
+  get txPower () {
+    const value = this.buffer.readInt8(TX_POWER);
+    return value === TX_POWER_UNAVAILABLE ? null : value;
+  }
+
+  get truncated () { return this.buffer[DATA_STATUS] === DATA_STATUS_TRUNCATED; }
+  get malformed () { return (this.buffer[PRESENT] & PRESENT_MALFORMED) !== 0; }
+  get fragments () { return this.buffer[FRAGMENTS]; }
+
+  get flags () {
+    return this.buffer[PRESENT] & PRESENT_FLAGS ? this.buffer[FLAGS] : null;
+  }
+
+  get txPowerLevel () {
+    return this.buffer[PRESENT] & PRESENT_TX_POWER_LEVEL ? this.buffer.readInt8(TX_POWER_LEVEL) : null;
+  }
+
+  /** Reassembled advertising data as received. */
+  get data () {
+    return this.buffer.subarray(this._dataOffset, this._dataOffset + this.buffer.readUInt16LE(DATA_LENGTH));
+  }
+
+  /** Value of the first AD structure of the given type, or null. */
+  get (type) {
+    const entry = this._find(type, 0);
+    return entry < 0 ? null : this._value(entry);
+  }
+
+  get localName () {
+    let entry = this._find(AD_TYPE_NAME_COMPLETE, 0);
+    if (entry < 0) {
+      entry = this._find(AD_TYPE_NAME_SHORT, 0);
+    }
+    return entry < 0 ? null : this._value(entry).toString('utf8');
+  }
+
+  get serviceUuids () {
+    const uuids = [];
+    this._each((type, value) => {
+      let size = 0;
+      if (type === AD_TYPE_UUID16_SOME || type === AD_TYPE_UUID16_ALL) size = 2;
+      else if (type === AD_TYPE_UUID32_SOME || type === AD_TYPE_UUID32_ALL) size = 4;
+      else if (type === AD_TYPE_UUID128_SOME || type === AD_TYPE_UUID128_ALL) size = 16;
+      for (let i = 0; size && i + size <= value.length; i += size) {
+        uuids.push(uuidString(value, i, size));
+      }
+    });
+    return uuids;
+  }
+
+  get serviceData () {
+    const entries = [];
+    this._each((type, value) => {
+      let size = 0;
+      if (type === AD_TYPE_SERVICE_DATA16) size = 2;
+      else if (type === AD_TYPE_SERVICE_DATA32) size = 4;
+      else if (type === AD_TYPE_SERVICE_DATA128) size = 16;
+      if (size && value.length >= size) {
+        entries.push({ uuid: uuidString(value, 0, size), data: value.subarray(size) });
+      }
+    });
+    return entries;
+  }
+
+  get manufacturerData () {
+    return this.get(AD_TYPE_MANUFACTURER);
+  }
+
+  _find (type, from) {
+    const b = this.buffer;
+    const count = b[AD_COUNT];
+    for (let i = from; i < count; i++) {
+      if (b[HEADER_LENGTH + i * ENTRY_LENGTH] === type) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  _value (entry) {
+    const b = this.buffer;
+    const at = HEADER_LENGTH + entry * ENTRY_LENGTH;
+    const start = this._dataOffset + b.readUInt16LE(at + 2);
+    return b.subarray(start, start + b[at + 1]);
+  }
+
+  _each (callback) {
+    const count = this.buffer[AD_COUNT];
+    for (let i = 0; i < count; i++) {
+      callback(this.buffer[HEADER_LENGTH + i * ENTRY_LENGTH], this._value(i));
+    }
+  }
+}
+
+module.exports = Advertisement;
@@ -0,0 +1,81 @@
+const events = require('events');
+const os = require('os');
+const { resolve } = require('path');
+const dir = resolve(__dirname, '..');
+const { BluetoothHciBrokerConsumer } = require('node-gyp-build')(dir);
+
+inherits(BluetoothHciBrokerConsumer, events.EventEmitter);
+
+// Shares the adapter of a native socket in another process; see startBroker()
+class BluetoothHciSocketBroker extends BluetoothHciBrokerConsumer {
+  bindRaw (devId, params) {
+    return this._bindBroker(devId, params);
+  }
+
+  bindUser (devId, params) {
+    return this._bindBroker(devId, params);
+  }
+
+  _bindBroker (devId, params) {
+    let ring = process.env.BLUETOOTH_HCI_SOCKET_BROKER;
+    if (params && params.broker && params.broker.path !== undefined) {
+      ring = params.broker.path;
+    }
+    if (ring === undefined) {
+      throw new Error('No broker ring: pass { broker: { path } } or set BLUETOOTH_HCI_SOCKET_BROKER');
+    }
+
+    // A number is a descriptor inherited from the broker process
+    this.attach(/^\d+$/.test(String(ring)) ? Number(ring) : String(ring));
+    this._devId = devId === undefined || devId === null ? 0 : devId;
+    return this._devId;
+  }
+
+  bindControl () {
+    throw new Error('Control channel is not supported by the broker driver');
+  }
+
+  bindMonitor () {
+    throw new Error('Monitor channel is not supported by the broker driver');
+  }
+
+  isDevUp () {
+    const stats = this.getStats();
+    return stats !== null && !stats.closed;
+  }
+
+  getDeviceList () {
+    return Promise.resolve([{
+      devId: this._devId === undefined ? 0 : this._devId,
+      devUp: this.isDevUp(),
+      idVendor: null,
+      idProduct: null,
+      busNumber: null,
+      deviceAddress: null,
+      path: null
+    }]);
+  }
+
+  write (data) {
+    // The broker's command queue is bounded; a full queue is reported like a failed write
+    if (!super.write(data)) {
+      const error = new Error('Broker command queue is full or the packet is too large');
+      error.syscall = 'write';
+      error.errno = os.constants.errno.EAGAIN;
+      this.emit('error', error);
+    }
+  }
+
+  reset () {
+    // The adapter is shared: resetting it is left to the broker process
+  }
+}
+
+// extend prototype
+function inherits (target, source) {
+  for (const k in source.prototype) {
+    target.prototype[k] = source.prototype[k];
+  }
+}
+
+module.exports = BluetoothHciSocketBroker;
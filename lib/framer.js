@@ -0,0 +1,106 @@
+const { resolve } = require('path');
+
+const HCI_COMMAND_PKT = 0x01;
+const HCI_ACLDATA_PKT = 0x02;
+const HCI_SCODATA_PKT = 0x03;
+const HCI_EVENT_PKT = 0x04;
+const HCI_ISODATA_PKT = 0x05;
+
+// Header length (excluding the type byte) and payload length reader per packet type
+const HEADERS = {
+  [HCI_COMMAND_PKT]: { length: 3, payload: (b, o) => b.readUInt8(o + 2) },
+  [HCI_ACLDATA_PKT]: { length: 4, payload: (b, o) => b.readUInt16LE(o + 2) },
+  [HCI_SCODATA_PKT]: { length: 3, payload: (b, o) => b.readUInt8(o + 2) },
+  [HCI_EVENT_PKT]: { length: 2, payload: (b, o) => b.readUInt8(o + 1) },
+  [HCI_ISODATA_PKT]: { length: 4, payload: (b, o) => b.readUInt16LE(o + 2) & 0x3fff }
+};
+
+/**
+ * Fallback used when the addon could not be loaded. Same contract as the
+ * native BluetoothHciFramer: push() returns every packet a chunk completes.
+ */
+class JsHciFramer {
+  constructor (packetType = 0) {
+    if (packetType !== 0 && !HEADERS[packetType]) {
+      throw new TypeError('packetType must be 0 (H4 stream) or an HCI packet type 1-5');
+    }
+    this._packetType = packetType;
+    this._desyncs = 0;
+    this.reset();
+  }
+
+  push (chunk) {
+    const packets = [];
+    const skip = this._packetType ? 0 : 1;
+
+    // A straddling packet is joined once, when its last chunk arrives
+    if (this._pendingLength) {
+      this._pending.push(chunk);
+      this._pendingLength += chunk.length;
+      if (this._pendingLength < this._pendingNeed) {
+        return packets;
+      }
+      chunk = Buffer.concat(this._pending, this._pendingLength);
+      this.reset();
+    }
+
+    let offset = 0;
+
+    while (offset < chunk.length) {
+      const type = this._packetType || chunk[offset];
+      const header = HEADERS[type];
+
+      if (!header) {
+        this._desyncs++;
+        offset++;
+        continue;
+      }
+
+      const remaining = chunk.length - offset;
+      const total = remaining < skip + header.length ? 0 : skip + header.length + header.payload(chunk, offset + skip);
+      if (total === 0 || remaining < total) {
+        // Header incomplete (need unknown) or body incomplete
+        this._pending = [chunk.subarray(offset)];
+        this._pendingLength = remaining;
+        this._pendingNeed = total;
+        break;
+      }
+
+      packets.push(skip ? chunk.subarray(offset, offset + total) : Buffer.concat([Buffer.from([type]), chunk.subarray(offset, offset + total)]));
+      offset += total;
+    }
+
+    return packets;
+  }
+
+  reset () {
+    this._pending = [];
+    this._pendingLength = 0;
+    this._pendingNeed = 0;
+  }
+
+  getStats () {
+    return { buffered: this._pendingLength, desyncs: this._desyncs };
+  }
+}
+
+let NativeHciFramer = null;
+try {
+  NativeHciFramer = require('node-gyp-build')(resolve(__dirname, '..')).BluetoothHciFramer || null;
+} catch (err) {
+  NativeHciFramer = null;
+}
+
+/**
+ * Creates a streaming H4 framer.
+ * @param {number} [packetType] fixed type of a stream without type bytes (USB endpoints), 0 for H4 streams
+ */
+function createFramer (packetType = 0) {
+  return NativeHciFramer ? new NativeHciFramer(packetType) : new JsHciFramer(packetType);
+}
+
+module.exports = {
+  createFramer,
+  JsHciFramer,
+  isNative: NativeHciFramer !== null
+};
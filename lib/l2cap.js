@@ -0,0 +1,52 @@
+const events = require('events');
+const { resolve } = require('path');
+
+// LE credit based channels from the addon; only built where the HCI socket is (Linux, Android, FreeBSD)
+let BluetoothHciL2Channel = null;
+try {
+  BluetoothHciL2Channel = require('node-gyp-build')(resolve(__dirname, '..')).BluetoothHciL2Channel || null;
+} catch (err) {
+  BluetoothHciL2Channel = null;
+}
+
+let L2CapChannel = null;
+
+if (BluetoothHciL2Channel) {
+  inherits(BluetoothHciL2Channel, events.EventEmitter);
+
+  L2CapChannel = class L2CapChannel extends BluetoothHciL2Channel {
+    constructor () {
+      super();
+
+      // Accepted channels arrive as descriptors, adopted by a channel of their own
+      this.on('accept', (fd, peer) => {
+        const channel = new L2CapChannel();
+        channel.setThreadOptions(this._threadOptions || null);
+        channel.adopt(fd, { highWaterMark: this._highWaterMark });
+        this.emit('connection', channel, peer);
+      });
+
+      // The channel's thread has exited; release the socket
+      this.on('close', () => super.close());
+    }
+
+    listen (options = {}) {
+      this._highWaterMark = options.highWaterMark;
+      return super.listen(options);
+    }
+
+    setThreadOptions (options) {
+      this._threadOptions = options;
+      super.setThreadOptions(options);
+    }
+  };
+}
+
+// extend prototype
+function inherits (target, source) {
+  for (const k in source.prototype) {
+    target.prototype[k] = source.prototype[k];
+  }
+}
+
+module.exports = L2CapChannel;
@@ -1,7 +1,10 @@
 const events = require('events');
-const { resolve } = require('path');
+const fs = require('fs');
+const os = require('os');
+const { dirname, join, resolve } = require('path');
 const dir = resolve(__dirname, '..');
 const { BluetoothHciSocket } = require('node-gyp-build')(dir);
+const Advertisement = require('./advertisement');
 
 inherits(BluetoothHciSocket, events.EventEmitter);
 
@@ -9,7 +12,34 @@ const HCI_COMMAND_PKT = 0x01;
 const OGF_HOST_CTL = 0x03;
 const OCF_RESET = 0x0003;
 
+// Capability fields kept as buffers, stored as hex in the probe cache
+const PROBE_BUFFERS = ['commands', 'features', 'leFeatures', 'leStates'];
+
 class BluetoothHciSocketWrapped extends BluetoothHciSocket {
+  constructor (...args) {
+    super(...args);
+
+    // Advertisements are only decoded natively while someone listens for them
+    this.on('newListener', (event) => {
+      if (event === 'advertisement' && this.listenerCount('advertisement') === 0) {
+        this.decodeAdvertisements(Advertisement);
+      } else if (event === 'advertisementBatch' && this.listenerCount('advertisementBatch') === 0) {
+        this.batchAdvertisements(true);
+      } else if (event === 'isoSdu' && this.listenerCount('isoSdu') === 0) {
+        this.reassembleIso(true);
+      }
+    });
+    this.on('removeListener', (event) => {
+      if (event === 'advertisement' && this.listenerCount('advertisement') === 0) {
+        this.decodeAdvertisements(null);
+      } else if (event === 'advertisementBatch' && this.listenerCount('advertisementBatch') === 0) {
+        this.batchAdvertisements(false);
+      } else if (event === 'isoSdu' && this.listenerCount('isoSdu') === 0) {
+        this.reassembleIso(false);
+      }
+    });
+  }
+
   start () {
     if (this._timer) {
       clearInterval(this._timer);
@@ -19,14 +49,168 @@ class BluetoothHciSocketWrapped extends BluetoothHciSocket {
       this.cleanup();
     }, 60 * 1000);
     this._timer.unref();
+    this._startScanTimer();
     return super.start();
   }
 
   stop () {
     clearInterval(this._timer);
+    clearInterval(this._scanTimer);
+    if (this._endPackets) {
+      this._endPackets();
+    }
     return super.stop();
   }
 
+  // Batches of packets, read from the socket only as fast as they are consumed
+  packets (options = {}) {
+    if (this._endPackets) {
+      throw new Error('packets(): another iterator is active');
+    }
+    const highWaterMark = options.highWaterMark || 1024;
+    const batchSize = options.batchSize || 256;
+    if (options.receiveBuffer) {
+      this.setReceiveBuffer(options.receiveBuffer);
+    }
+
+    const queue = [];
+    let wake = null;
+    let done = false;
+    let drops = this.getReceiveQueueStats().drops;
+    const notify = () => {
+      if (wake) {
+        wake();
+        wake = null;
+      }
+    };
+    const onData = (data) => {
+      queue.push(data);
+      notify();
+    };
+    const end = () => {
+      if (!done) {
+        done = true;
+        this._endPackets = null;
+        this.removeListener('data', onData);
+        this.setFlowControl(null);
+        notify();
+      }
+    };
+
+    // At most highWaterMark packets are read ahead of the consumer; the rest wait in the kernel
+    this._endPackets = end;
+    this.on('data', onData);
+    this.setFlowControl(highWaterMark);
+
+    const socket = this;
+    return {
+      [Symbol.asyncIterator] () {
+        return this;
+      },
+      async next () {
+        while (!done && queue.length === 0) {
+          await new Promise((resolve) => { wake = resolve; });
+        }
+        if (done && queue.length === 0) {
+          return { done: true, value: undefined };
+        }
+        const packets = queue.splice(0, batchSize);
+        if (!done) {
+          socket.grantCredit(packets.length);
+        }
+        // Drops the kernel counted since the previous batch, when the receive buffer overflowed
+        const stats = socket.getReceiveQueueStats();
+        const batch = { packets, dropped: stats.drops - drops, queued: stats.queued };
+        drops = stats.drops;
+        return { done: false, value: batch };
+      },
+      async return () {
+        end();
+        return { done: true, value: undefined };
+      }
+    };
+  }
+
+  startScanTable (options = {}) {
+    this._scanTableOptions = Object.assign({ interval: 250 }, options);
+    this.configureScanTable(this._scanTableOptions);
+    this._startScanTimer();
+  }
+
+  stopScanTable () {
+    clearInterval(this._scanTimer);
+    this._scanTableOptions = null;
+    this.configureScanTable(null);
+  }
+
+  _startScanTimer () {
+    clearInterval(this._scanTimer);
+    if (!this._scanTableOptions) {
+      return;
+    }
+    // Diffed snapshots at a fixed rate replace per-advertisement events
+    this._scanTimer = setInterval(() => {
+      const snapshot = this.takeScanSnapshot();
+      if (snapshot.added.length || snapshot.changed.length || snapshot.lost.length) {
+        this.emit('scanSnapshot', snapshot);
+      }
+    }, this._scanTableOptions.interval);
+    this._scanTimer.unref();
+  }
+
+  // Reads the controller's capabilities, or takes them from the cache when its address and firmware are known
+  async probeController (options = {}) {
+    const timeout = options.timeout || 2000;
+    let file = process.env.BLUETOOTH_HCI_SOCKET_PROBE_CACHE || join(os.homedir(), '.cache', 'bluetooth-hci-socket', 'controllers.json');
+    if (options.cache !== undefined) {
+      file = options.cache;
+    }
+
+    if (!file) {
+      return this._probe({ identityOnly: false }, timeout);
+    }
+
+    const cache = readProbeCache(file);
+    const identity = await this._probe({ identityOnly: true }, timeout);
+    const cached = cache[probeCacheKey(identity)];
+    if (cached) {
+      const capabilities = Object.assign({}, cached, { cached: true });
+      PROBE_BUFFERS.filter((k) => typeof cached[k] === 'string').forEach((k) => {
+        capabilities[k] = Buffer.from(cached[k], 'hex');
+      });
+      return capabilities;
+    }
+
+    const capabilities = await this._probe({ identityOnly: false }, timeout);
+    const entry = Object.assign({}, capabilities);
+    PROBE_BUFFERS.filter((k) => Buffer.isBuffer(capabilities[k])).forEach((k) => {
+      entry[k] = capabilities[k].toString('hex');
+    });
+    cache[probeCacheKey(capabilities)] = entry;
+    try {
+      // Written to a temporary file and renamed, so concurrent readers never see a partial cache
+      fs.mkdirSync(dirname(file), { recursive: true });
+      fs.writeFileSync(`${file}.${process.pid}`, JSON.stringify(cache, null, 2));
+      fs.renameSync(`${file}.${process.pid}`, file);
+    } catch (err) {
+      this.emit('warning', err);
+    }
+    return Object.assign(capabilities, { cached: false });
+  }
+
+  _probe (options, timeout) {
+    return new Promise((resolve, reject) => {
+      const timer = setTimeout(() => {
+        super.probeController(null);
+        reject(new Error('Controller probe timed out'));
+      }, timeout);
+      super.probeController(options, (err, capabilities) => {
+        clearTimeout(timer);
+        return err ? reject(err) : resolve(capabilities);
+      });
+    });
+  }
+
   reset () {
     const cmd = Buffer.alloc(4);
     cmd.writeUInt8(HCI_COMMAND_PKT, 0);
@@ -36,6 +220,19 @@ class BluetoothHciSocketWrapped extends BluetoothHciSocket {
   }
 }
 
+function probeCacheKey (capabilities) {
+  const v = capabilities.version || {};
+  return [capabilities.address, v.manufacturer, v.hci, v.hciRevision, v.lmp, v.lmpSubversion].join('/');
+}
+
+function readProbeCache (file) {
+  try {
+    return JSON.parse(fs.readFileSync(file, 'utf8'));
+  } catch (err) {
+    return {};
+  }
+}
+
 // extend prototype
 function inherits (target, source) {
   for (const k in source.prototype) {
@@ -4,6 +4,7 @@ const EventEmitter = require('events');
 const debug = require('debug')('hci-uart');
 const { SerialPort } = require('serialport');
 const HciSerialParser = require('./uart/hci-serial-parser');
+const NativeUart = require('./uart/native-uart');
 const async = require('async');
 
 const HCI_COMMAND_PKT = 0x01;
@@ -22,6 +23,8 @@ class BluetoothHciSocket extends EventEmitter {
     this._useFilter = useFilter;
     this._mode = null;
     this._serialDevice = null;
+    this._nativeUart = null;
+    this._pendingWrites = [];
     this._queue = null;
     this._parser = null;
     this._exitHandler = this.reset.bind(this);
@@ -49,13 +52,19 @@ class BluetoothHciSocket extends EventEmitter {
   bindUser (devId, params = {}, mode = 'user') {
     this._mode = mode;
     const uartParams = this._getSerialParams(params);
-    const { port, baudRate, retryConnection = 10, flowControl = true } = uartParams.uart;
+    const { port, baudRate, retryConnection = 10, flowControl = true, native = false, threads = null } = uartParams.uart;
 
     if (typeof port !== 'string' || !Number.isInteger(baudRate)) {
         throw new Error('Invalid UART parameters');
     }
 
     debug(`Using UART PORT = ${port}, BAUD RATE = ${baudRate}`);
+
+    if (native) {
+      this._threadOptions = threads;
+      this._bindNative(devId, params, mode, port, baudRate, flowControl, retryConnection);
+      return;
+    }
     
     this._serialDevice = new SerialPort({
         path: port,
@@ -88,6 +97,54 @@ class BluetoothHciSocket extends EventEmitter {
     });
   }
 
+  _bindNative (devId, params, mode, port, baudRate, flowControl, retryConnection) {
+    if (!NativeUart) {
+      throw new Error('Native UART transport is not available on this platform');
+    }
+
+    debug('Using native termios transport');
+
+    this._serialDevice = null;
+    this._pendingWrites = [];
+    this._nativeUart = new NativeUart();
+    this._nativeUart.open(port, { baudRate, flowControl });
+    this._nativeUart.setThreadOptions(this._threadOptions);
+
+    this._nativeUart.on('data', (data) => this._onNativeData(data));
+    this._nativeUart.on('error', (error) => this.emit('error', error));
+    this._nativeUart.on('warning', (error) => this.emit('warning', error));
+    this._nativeUart.on('close', () => {
+      this._nativeUart.close();
+      this._isUp = false;
+      this._isReconnectionCancelled = false;
+      this.emit('state', this._isUp);
+      this._handleReconnection(devId, params, mode, port, retryConnection);
+    });
+  }
+
+  _onNativeData (data) {
+    if (this._isUp) {
+      this.emit('data', data);
+      return;
+    }
+
+    // Packets arrive already framed, so the reset pattern is an exact match
+    if (this._mode === 'raw' && data.length === 7 && data[0] === 0x04 && data[1] === 0x0e &&
+        data.readUInt16LE(4) === RESET_CMD && data[6] === 0x00) {
+      debug('Reset complete');
+      this._isUp = true;
+      this.emit('state', this._isUp);
+
+      const pending = this._pendingWrites;
+      this._pendingWrites = [];
+      pending.forEach((packet) => this._nativeUart.write(packet));
+    }
+  }
+
+  bindMonitor () {
+    throw new Error('Monitor channel is not supported by the UART driver');
+  }
+
   getDeviceList () {
     return SerialPort.list().then(ports => ports.map(port => ({
       devId: null,
@@ -138,6 +195,8 @@ class BluetoothHciSocket extends EventEmitter {
   _getSerialParams (params) {
     let port;
     let baudRate = 1000000; // Default baud rate
+    let native = false;
+    let threads = null;
 
     // Check for UART port in environment variables
     if (process.env.BLUETOOTH_HCI_SOCKET_UART_PORT) {
@@ -152,6 +211,11 @@ class BluetoothHciSocket extends EventEmitter {
       }
     }
 
+    // Opt in to the native termios transport
+    if (process.env.BLUETOOTH_HCI_SOCKET_UART_NATIVE) {
+      native = process.env.BLUETOOTH_HCI_SOCKET_UART_NATIVE !== '0';
+    }
+
     // Override with params if provided
     if (params && params.uart) {
       if (params.uart.port && typeof params.uart.port === 'string') {
@@ -160,9 +224,15 @@ class BluetoothHciSocket extends EventEmitter {
       if (params.uart.baudRate && typeof params.uart.baudRate === 'number' && isFinite(params.uart.baudRate)) {
         baudRate = params.uart.baudRate;
       }
+      if (typeof params.uart.native === 'boolean') {
+        native = params.uart.native;
+      }
+      if (params.uart.threads && typeof params.uart.threads === 'object') {
+        threads = params.uart.threads;
+      }
     }
 
-    return { uart: { port, baudRate } };
+    return { uart: { port, baudRate, native, threads } };
   }
 
   bindControl () {
@@ -198,6 +268,12 @@ class BluetoothHciSocket extends EventEmitter {
     if (this._mode !== 'raw' && this._mode !== 'user') {
       return;
     }
+
+    if (this._nativeUart) {
+      this._nativeUart.start();
+      process.on('exit', this._exitHandler);
+      return;
+    }
     
     if (!this._serialDevice) {
       throw new Error('Serial device is not initialized');
@@ -223,6 +299,14 @@ class BluetoothHciSocket extends EventEmitter {
     if (this._mode !== 'raw' && this._mode !== 'user') {
       return;
     }
+
+    if (this._nativeUart) {
+      this._isReconnectionCancelled = true;
+      this._nativeUart.removeAllListeners();
+      this._nativeUart.close();
+      this._nativeUart = null;
+      return;
+    }
     
     if (this._serialDevice.isOpen) {
       this._serialDevice.close();
@@ -235,13 +319,22 @@ class BluetoothHciSocket extends EventEmitter {
 
   write (data) {
     debug(`Write: ${data.toString('hex')}`);
+    if ((this._mode === 'raw' || this._mode === 'user') && this._nativeUart) {
+      // Held until the controller answers the reset, like the paused serialport queue
+      if (this._isUp) {
+        this._nativeUart.write(data);
+      } else {
+        this._pendingWrites.push(data);
+      }
+      return;
+    }
     if ((this._mode === 'raw' || this._mode === 'user') && this._queue) {
       this._queue.push(data);
     }
   }
 
   reset () {
-    if (!this._serialDevice) {
+    if (!this._serialDevice && !this._nativeUart) {
       return;
     }
 
@@ -251,7 +344,11 @@ class BluetoothHciSocket extends EventEmitter {
     cmd.writeUInt8(0x00, 3);
 
     debug(`Reset: ${cmd.toString('hex')}`);
-    this._serialDevice.write(cmd);
+    if (this._nativeUart) {
+      this._nativeUart.write(cmd);
+    } else {
+      this._serialDevice.write(cmd);
+    }
   }
 }
 
@@ -0,0 +1,23 @@
+const events = require('events');
+const { resolve } = require('path');
+
+// Termios transport from the addon; only built where the HCI socket is (Linux, Android, FreeBSD)
+let BluetoothHciUart = null;
+try {
+  BluetoothHciUart = require('node-gyp-build')(resolve(__dirname, '..', '..')).BluetoothHciUart || null;
+} catch (err) {
+  BluetoothHciUart = null;
+}
+
+if (BluetoothHciUart) {
+  inherits(BluetoothHciUart, events.EventEmitter);
+}
+
+// extend prototype
+function inherits (target, source) {
+  for (const k in source.prototype) {
+    target.prototype[k] = source.prototype[k];
+  }
+}
+
+module.exports = BluetoothHciUart;
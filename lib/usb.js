@@ -3,10 +3,20 @@ const util = require('util');
 
 const debug = require('debug')('hci-usb');
 const { usb, findByIds, getDeviceList } = require('usb');
+const { createFramer } = require('./framer');
 
 const HCI_COMMAND_PKT = 0x01;
 const HCI_ACLDATA_PKT = 0x02;
 const HCI_EVENT_PKT = 0x04;
+const HCI_ISODATA_PKT = 0x05;
+
+const EVT_DISCONN_COMPLETE = 0x05;
+const EVT_LE_META_EVENT = 0x3e;
+const EVT_LE_CIS_ESTABLISHED = 0x19;
+const EVT_LE_CREATE_BIG_COMPLETE = 0x1b;
+const EVT_LE_TERMINATE_BIG_COMPLETE = 0x1c;
+const EVT_LE_BIG_SYNC_ESTABLISHED = 0x1d;
+const EVT_LE_BIG_SYNC_LOST = 0x1e;
 
 const OGF_HOST_CTL = 0x03;
 const OCF_RESET = 0x0003;
@@ -33,8 +43,13 @@ const VENDOR_DEVICE_LIST = [
 function BluetoothHciSocket () {
   this._isUp = false;
 
-  this._hciEventEndpointBuffer = Buffer.alloc(0);
-  this._aclDataInEndpointBuffer = Buffer.alloc(0);
+  // USB endpoints carry a single packet type and no H4 type byte
+  this._hciEventFramer = createFramer(HCI_EVENT_PKT);
+  this._aclDataInFramer = createFramer(HCI_ACLDATA_PKT);
+
+  // ISO data shares the bulk endpoints with ACL; handles tell them apart
+  this._isoHandles = new Set();
+  this._bigHandles = new Map();
   
   this._exitHandler = this.reset.bind(this);
 }
@@ -176,6 +191,10 @@ BluetoothHciSocket.prototype.bindControl = function () {
   this._mode = 'control';
 };
 
+BluetoothHciSocket.prototype.bindMonitor = function () {
+  throw new Error('Monitor channel is not supported by the USB driver');
+};
+
 BluetoothHciSocket.prototype.isDevUp = function () {
   return this._isUp;
 };
@@ -233,7 +252,7 @@ BluetoothHciSocket.prototype.write = function (data) {
           }
         }
       );
-    } else if (HCI_ACLDATA_PKT === type) {
+    } else if (HCI_ACLDATA_PKT === type || HCI_ISODATA_PKT === type) {
       this._aclDataOutEndpoint.transfer(data.slice(1), (error) => {
         if (error) {
           debug('ACL data transfer failed: ' + error);
@@ -251,38 +270,25 @@ BluetoothHciSocket.prototype.onHciEventEndpointData = function (data) {
     return;
   }
 
-  // add to buffer
-  this._hciEventEndpointBuffer = Buffer.concat([
-    this._hciEventEndpointBuffer,
-    data
-  ]);
+  // A single transfer may complete several events
+  const packets = this._hciEventFramer.push(data);
 
-  if (this._hciEventEndpointBuffer.length < 2) {
-    return;
-  }
+  for (let i = 0; i < packets.length; i++) {
+    const packet = packets[i];
 
-  // check if desired length
-  const pktLen = this._hciEventEndpointBuffer.readUInt8(1);
-  if (pktLen <= (this._hciEventEndpointBuffer.length - 2)) {
-    const buf = this._hciEventEndpointBuffer.slice(0, pktLen + 2);
+    this._trackIsoHandles(packet);
 
     // Skip first reset even after restart
     if (this._isUp === true) {
       // fire event
-      this.emit('data', Buffer.concat([
-        Buffer.from([HCI_EVENT_PKT]),
-        buf
-      ]));
+      this.emit('data', packet);
     }
 
-    if (this._mode === 'raw' && buf.length === 6 && (buf.toString('hex') === '0e0401030c00' || buf.toString('hex') === '0e0402030c00')) {
+    if (this._mode === 'raw' && packet.length === 7 && (packet.toString('hex') === '040e0401030c00' || packet.toString('hex') === '040e0402030c00')) {
       debug('reset complete');
       this._isUp = true;
       this.emit('state', this._isUp);
     }
-
-    // reset buffer
-    this._hciEventEndpointBuffer = this._hciEventEndpointBuffer.slice(pktLen + 2);
   }
 };
 
@@ -293,29 +299,70 @@ BluetoothHciSocket.prototype.onAclDataInEndpointData = function (data) {
     return;
   }
 
-  // add to buffer
-  this._aclDataInEndpointBuffer = Buffer.concat([
-    this._aclDataInEndpointBuffer,
-    data
-  ]);
+  const packets = this._aclDataInFramer.push(data);
+
+  for (let i = 0; i < packets.length; i++) {
+    const packet = packets[i];
+
+    // ISO and ACL headers share their layout, only the type byte differs
+    if (this._isoHandles.size > 0 && this._isoHandles.has(packet.readUInt16LE(1) & 0x0fff)) {
+      packet[0] = HCI_ISODATA_PKT;
+    }
+
+    // fire event
+    this.emit('data', packet);
+  }
+};
+
+BluetoothHciSocket.prototype._trackIsoHandles = function (packet) {
+  if (packet.length < 5) {
+    return;
+  }
+
+  const eventCode = packet.readUInt8(1);
 
-  if (this._aclDataInEndpointBuffer.length < 4) {
+  if (eventCode === EVT_DISCONN_COMPLETE && packet.length >= 6 && packet.readUInt8(3) === 0) {
+    this._isoHandles.delete(packet.readUInt16LE(4) & 0x0fff);
     return;
   }
 
-  // check if desired length
-  const pktLen = this._aclDataInEndpointBuffer.readUInt16LE(2);
-  if (pktLen <= (this._aclDataInEndpointBuffer.length - 4)) {
-    const buf = this._aclDataInEndpointBuffer.slice(0, pktLen + 4);
+  if (eventCode !== EVT_LE_META_EVENT) {
+    return;
+  }
 
-    // fire event
-    this.emit('data', Buffer.concat([
-      Buffer.from([HCI_ACLDATA_PKT]),
-      buf
-    ]));
+  // Establishment events carry a status first; termination events start with the BIG handle
+  const success = packet.readUInt8(4) === 0;
+
+  const addBis = (bigHandle, numOffset) => {
+    const handles = [];
+    // A truncated event keeps the handles it does carry
+    const count = packet.readUInt8(numOffset);
+    for (let i = 0; i < count && numOffset + 1 + 2 * i + 2 <= packet.length; i++) {
+      handles.push(packet.readUInt16LE(numOffset + 1 + i * 2) & 0x0fff);
+    }
+    handles.forEach((handle) => this._isoHandles.add(handle));
+    this._bigHandles.set(bigHandle, handles);
+  };
+
+  const removeBig = (bigHandle) => {
+    (this._bigHandles.get(bigHandle) || []).forEach((handle) => this._isoHandles.delete(handle));
+    this._bigHandles.delete(bigHandle);
+  };
 
-    // reset buffer
-    this._aclDataInEndpointBuffer = this._aclDataInEndpointBuffer.slice(pktLen + 4);
+  switch (packet.readUInt8(3)) {
+    case EVT_LE_CIS_ESTABLISHED:
+      if (success && packet.length >= 7) this._isoHandles.add(packet.readUInt16LE(5) & 0x0fff);
+      break;
+    case EVT_LE_CREATE_BIG_COMPLETE:
+      if (success && packet.length >= 22) addBis(packet.readUInt8(5), 21);
+      break;
+    case EVT_LE_BIG_SYNC_ESTABLISHED:
+      if (success && packet.length >= 18) addBis(packet.readUInt8(5), 17);
+      break;
+    case EVT_LE_TERMINATE_BIG_COMPLETE:
+    case EVT_LE_BIG_SYNC_LOST:
+      removeBig(packet.readUInt8(4));
+      break;
   }
 };
 
@@ -0,0 +1,351 @@
+#include <algorithm>
+
+#include "BluetoothHciAcceptList.h"
+
+BluetoothHciAcceptList::BluetoothHciAcceptList() :
+  _dirty(false),
+  _syncing(false),
+  _waiting(false),
+  _cursor(0),
+  _nextRotation(0),
+  _blockedUntil(0),
+  _scanning(false),
+  _scanExtended(false),
+  _scanUsesList(false),
+  _paused(false),
+  _initiating(false),
+  _scanMode(Idle),
+  _scanModeSince(0),
+  _filteredTime(0),
+  _unfilteredTime(0),
+  _unfilteredOtherReports(0),
+  _rotations(0),
+  _commandsNaive(0),
+  _deferred(0),
+  _targetReports(0),
+  _otherReports(0)
+{}
+
+void BluetoothHciAcceptList::setTargets(const std::vector<HciAcceptTarget>& targets, const Options& options, uint64_t now) {
+  // Last seen times survive for targets that stay
+  std::unordered_map<uint64_t, uint64_t> lastSeen;
+  for (const Target& target : this->_targets) {
+    lastSeen[target.key] = target.lastSeen;
+  }
+
+  this->_options = options;
+  this->_list.setLimit(options.capacity);
+  this->_targets.clear();
+  this->_index.clear();
+  for (const HciAcceptTarget& target : targets) {
+    uint64_t key = BluetoothHciAcceptListSync::Key(target.type, target.address.b);
+    if (this->_index.count(key)) {
+      continue;
+    }
+    auto seen = lastSeen.find(key);
+    this->_index[key] = this->_targets.size();
+    this->_targets.push_back({ key, target.priority, seen == lastSeen.end() ? 0 : seen->second, false });
+  }
+
+  this->_cursor = 0;
+  this->_nextRotation = now + options.rotateInterval;
+  this->_blockedUntil = 0;
+  this->_dirty = true;
+
+  // Commands are watched all along, but an attempt that ended unseen must not block for good
+  this->_initiating = false;
+}
+
+void BluetoothHciAcceptList::select() {
+  size_t capacity = this->_list.capacity();
+  std::vector<const Target*> ranked;
+  for (const Target& target : this->_targets) {
+    if (!target.rejected) {
+      ranked.push_back(&target);
+    }
+  }
+
+  // Stable, so equal targets keep the order they were set in
+  bool byRecency = this->_options.policy == Recency;
+  std::stable_sort(ranked.begin(), ranked.end(), [byRecency](const Target* a, const Target* b) {
+    if (byRecency && a->lastSeen != b->lastSeen) {
+      return a->lastSeen > b->lastSeen;
+    }
+    if (a->priority != b->priority) {
+      return a->priority > b->priority;
+    }
+    return a->lastSeen > b->lastSeen;
+  });
+
+  std::unordered_set<uint64_t>& wanted = this->_list.wanted();
+  wanted.clear();
+  if (ranked.size() <= capacity) {
+    for (const Target* target : ranked) {
+      wanted.insert(target->key);
+    }
+    return;
+  }
+
+  // A quarter of the entries cycle through the targets that do not fit
+  size_t rotating = std::max<size_t>(1, capacity / 4);
+  size_t pinned = capacity - rotating;
+  size_t rest = ranked.size() - pinned;
+  for (size_t i = 0; i < pinned; i++) {
+    wanted.insert(ranked[i]->key);
+  }
+  for (size_t i = 0; i < rotating; i++) {
+    wanted.insert(ranked[pinned + (this->_cursor + i) % rest]->key);
+  }
+}
+
+void BluetoothHciAcceptList::take(std::vector<std::string>& commands, uint64_t now) {
+  if (this->_list.waiting(now)) {
+    return;
+  }
+  // A completion lost to a restarted socket leaves the list unknown
+  this->_list.drop();
+
+  if (!this->_list.sized()) {
+    this->_list.update(commands, now);
+    this->_commandsNaive++;
+    return;
+  }
+
+  size_t capacity = this->_list.capacity();
+  if (this->_targets.size() > capacity && now >= this->_nextRotation) {
+    this->_cursor += std::max<size_t>(1, capacity / 4);
+    this->_nextRotation = now + this->_options.rotateInterval;
+    this->_rotations++;
+    this->_dirty = true;
+  }
+  if (this->_dirty) {
+    this->select();
+    this->_dirty = false;
+  }
+
+  if (this->_list.synced()) {
+    if (this->_syncing) {
+      // Clearing and adding every wanted entry is what a change costs without the diff
+      this->_commandsNaive += 1 + this->_list.wanted().size();
+      this->_syncing = false;
+    }
+    if (this->_paused) {
+      this->_list.send(commands, this->_scanEnable, now);
+      this->_commandsNaive++;
+    }
+    return;
+  }
+
+  if (now < this->_blockedUntil) {
+    return;
+  }
+
+  // The list may not change under a connection attempt or a scan that uses it
+  bool scanUsesList = this->_scanning && this->_scanUsesList && !this->_paused;
+  if (this->_initiating || (scanUsesList && !this->_options.pauseScan)) {
+    if (!this->_waiting) {
+      this->_deferred++;
+      this->_waiting = true;
+    }
+    return;
+  }
+  this->_waiting = false;
+  this->_syncing = true;
+
+  if (scanUsesList) {
+    uint8_t disable[6] = {};
+    this->_list.send(commands, this->_scanExtended ? BluetoothHciAcceptListSync::Command(HCI_LE_SET_EXT_SCAN_ENABLE, disable, 6) :
+                                                     BluetoothHciAcceptListSync::Command(HCI_LE_SET_SCAN_ENABLE, disable, 2), now);
+    this->_commandsNaive++;
+    return;
+  }
+
+  this->_list.update(commands, now);
+}
+
+void BluetoothHciAcceptList::writeFailed(uint64_t now) {
+  this->_list.drop();
+  this->_blockedUntil = now + kRetryDelay;
+}
+
+void BluetoothHciAcceptList::complete(const BluetoothHciAcceptListSync::Completion& completion, uint64_t now) {
+  if (completion.status == HCI_ERR_COMMAND_DISALLOWED) {
+    // Something the manager did not see is using the list
+    this->_blockedUntil = now + kRetryDelay;
+    this->_deferred++;
+    return;
+  }
+
+  if (completion.resized) {
+    this->_dirty = true;
+  }
+
+  switch (completion.opcode) {
+    case HCI_LE_ADD_TO_ACCEPT_LIST:
+      if (completion.status != HCI_SUCCESS && completion.status != HCI_ERR_MEMORY_EXCEEDED) {
+        auto it = this->_index.find(completion.key);
+        if (it != this->_index.end()) {
+          this->_targets[it->second].rejected = true;
+        }
+        this->_dirty = true;
+      }
+      break;
+    case HCI_LE_SET_SCAN_ENABLE:
+    case HCI_LE_SET_EXT_SCAN_ENABLE:
+      if (completion.status == HCI_SUCCESS) {
+        this->_paused = !this->_paused;
+      }
+      break;
+  }
+}
+
+void BluetoothHciAcceptList::observeCommand(const uint8_t* data, size_t length, uint64_t now) {
+  if (length < 4 || data[0] != HCI_COMMAND_PKT || length < 4u + data[3]) {
+    return;
+  }
+
+  uint16_t opcode = HciLoad<uint16_t>(data + 1);
+  const uint8_t* params = data + 4;
+  size_t paramsLength = data[3];
+  this->_list.observeCommand(data, length);
+
+  switch (opcode) {
+    case HCI_RESET:
+      // The controller also stops scanning
+      this->_scanning = false;
+      this->_paused = false;
+      this->_initiating = false;
+      this->_dirty = true;
+      this->setScanMode(Idle, now);
+      break;
+    case HCI_LE_SET_SCAN_PARAMETERS:
+      if (paramsLength >= 7) {
+        this->_scanUsesList = params[6] & 0x01;
+      }
+      break;
+    case HCI_LE_SET_EXT_SCAN_PARAMETERS:
+      if (paramsLength >= 2) {
+        this->_scanUsesList = params[1] & 0x01;
+      }
+      break;
+    case HCI_LE_SET_SCAN_ENABLE:
+    case HCI_LE_SET_EXT_SCAN_ENABLE:
+      if (paramsLength >= 1) {
+        // The host takes over from a pause
+        this->_scanning = params[0] != 0;
+        this->_scanExtended = opcode == HCI_LE_SET_EXT_SCAN_ENABLE;
+        this->_paused = false;
+        if (this->_scanning) {
+          this->_scanEnable.assign(reinterpret_cast<const char*>(data), 4 + paramsLength);
+        }
+        this->setScanMode(!this->_scanning ? Idle : this->_scanUsesList ? Filtered : Unfiltered, now);
+      }
+      break;
+    case HCI_LE_CREATE_CONN:
+      if (HciView<HciLeCreateConnLayout> view{data, length}) {
+        this->_initiating = view[HciLeCreateConnLayout::filterPolicy] & 0x01;
+      }
+      break;
+    case HCI_LE_EXT_CREATE_CONN:
+      if (HciView<HciLeExtCreateConnLayout> view{data, length}) {
+        this->_initiating = view[HciLeExtCreateConnLayout::filterPolicy] & 0x01;
+      }
+      break;
+  }
+}
+
+bool BluetoothHciAcceptList::observeEvent(const uint8_t* data, size_t length, uint64_t now) {
+  BluetoothHciAcceptListSync::Completion completion;
+  if (this->_list.observeEvent(data, length, completion)) {
+    this->complete(completion, now);
+    return true;
+  }
+
+  if (HciView<HciCmdStatusLayout> view{data, length}) {
+    uint16_t opcode = view[HciCmdStatusLayout::opcode];
+    // A connection attempt that failed to start ends at once
+    if ((opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) && view[HciCmdStatusLayout::status] != HCI_SUCCESS) {
+      this->_initiating = false;
+    }
+    return false;
+  }
+
+  if (length < 5 || data[0] != HCI_EVENT_PKT || data[1] != HCI_EV_LE_META) {
+    return false;
+  }
+  length = std::min<size_t>(length, 3u + data[2]);
+
+  switch (data[3]) {
+    case HCI_EV_LE_CONN_COMPLETE:
+    case HCI_EV_LE_ENH_CONN_COMPLETE:
+      this->_initiating = false;
+      break;
+    case HCI_EV_LE_ADVERTISING_REPORT:
+    case HCI_EV_LE_EXT_ADVERTISING_REPORT:
+    case HCI_EV_LE_DIRECT_ADVERTISING_REPORT: {
+      // Address type and address offsets, header length, and whether the data and RSSI follow
+      bool legacy = data[3] == HCI_EV_LE_ADVERTISING_REPORT;
+      bool extended = data[3] == HCI_EV_LE_EXT_ADVERTISING_REPORT;
+      size_t typeOffset = extended ? 2 : 1;
+      size_t header = legacy ? 9 : extended ? 24 : 16;
+      size_t offset = 5;
+      for (uint8_t i = 0; i < data[4] && offset + header <= length; i++) {
+        const uint8_t* report = data + offset;
+        size_t advLength = legacy || extended ? report[header - 1] : 0;
+        this->observeReport(report[typeOffset], report + typeOffset + 1, now);
+        offset += header + advLength + (legacy ? 1 : 0);
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+void BluetoothHciAcceptList::observeReport(uint8_t type, const uint8_t* address, uint64_t now) {
+  auto it = this->_index.find(BluetoothHciAcceptListSync::Key(type, address));
+  if (it == this->_index.end()) {
+    this->_otherReports++;
+    this->_unfilteredOtherReports += this->_scanMode == Unfiltered;
+    return;
+  }
+
+  this->_targetReports++;
+  this->_targets[it->second].lastSeen = now;
+}
+
+void BluetoothHciAcceptList::setScanMode(ScanMode mode, uint64_t now) {
+  uint64_t elapsed = now - this->_scanModeSince;
+  if (this->_scanMode == Filtered) {
+    this->_filteredTime += elapsed;
+  } else if (this->_scanMode == Unfiltered) {
+    this->_unfilteredTime += elapsed;
+  }
+  this->_scanMode = mode;
+  this->_scanModeSince = now;
+}
+
+HciAcceptListStats BluetoothHciAcceptList::stats(uint64_t now) const {
+  HciAcceptListStats stats = {};
+  stats.targets = this->_targets.size();
+  stats.installed = this->_list.installed().size();
+  stats.capacity = this->_list.capacity();
+  for (const Target& target : this->_targets) {
+    stats.rejected += target.rejected;
+  }
+  stats.rotations = this->_rotations;
+  stats.commands = this->_list.commands();
+  stats.commandsNaive = this->_commandsNaive;
+  stats.deferred = this->_deferred;
+  stats.targetReports = this->_targetReports;
+  stats.otherReports = this->_otherReports;
+
+  uint64_t elapsed = now - this->_scanModeSince;
+  stats.filteredTime = this->_filteredTime + (this->_scanMode == Filtered ? elapsed : 0);
+  stats.unfilteredTime = this->_unfilteredTime + (this->_scanMode == Unfiltered ? elapsed : 0);
+
+  // Reports other devices sent per ms of unfiltered scanning, over the time scanned through the list
+  if (stats.unfilteredTime > 0) {
+    stats.reportsSaved = static_cast<double>(this->_unfilteredOtherReports) * stats.filteredTime / stats.unfilteredTime;
+  }
+  return stats;
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstring>
+
+#include "BluetoothHciAcceptListSync.h"
+
+BluetoothHciAcceptListSync::BluetoothHciAcceptListSync() :
+  _installedKnown(false),
+  _controllerSize(0),
+  _limit(0),
+  _inFlight(0),
+  _inFlightKey(0),
+  _sentAt(0),
+  _commands(0)
+{}
+
+uint64_t BluetoothHciAcceptListSync::Key(uint8_t type, const uint8_t* address) {
+  // Identity addresses the controller resolved (0x02, 0x03) are listed as public or random
+  uint64_t key = static_cast<uint64_t>(type & 0x01) << 48;
+  for (size_t i = 0; i < 6; i++) {
+    key |= static_cast<uint64_t>(address[i]) << (8 * i);
+  }
+  return key;
+}
+
+std::string BluetoothHciAcceptListSync::Command(uint16_t opcode, const uint8_t* params, size_t length) {
+  std::string command(4 + length, '\0');
+  command[0] = HCI_COMMAND_PKT;
+  command[1] = static_cast<char>(opcode & 0xFF);
+  command[2] = static_cast<char>(opcode >> 8);
+  command[3] = static_cast<char>(length);
+  if (length > 0) {
+    memcpy(&command[4], params, length);
+  }
+  return command;
+}
+
+std::string BluetoothHciAcceptListSync::EntryCommand(uint16_t opcode, uint64_t key) {
+  // Address type, then the address
+  uint8_t params[7];
+  params[0] = static_cast<uint8_t>(key >> 48);
+  for (size_t i = 0; i < 6; i++) {
+    params[1 + i] = static_cast<uint8_t>(key >> (8 * i));
+  }
+  return Command(opcode, params, sizeof(params));
+}
+
+size_t BluetoothHciAcceptListSync::capacity() const {
+  return this->_limit > 0 ? std::min(this->_controllerSize, this->_limit) : this->_controllerSize;
+}
+
+bool BluetoothHciAcceptListSync::synced() const {
+  if (!this->_installedKnown || this->_installed.size() != this->_wanted.size()) {
+    return false;
+  }
+  for (uint64_t key : this->_wanted) {
+    if (!this->_installed.count(key)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint16_t BluetoothHciAcceptListSync::drop() {
+  uint16_t opcode = this->_inFlight;
+  if (opcode != 0) {
+    this->_inFlight = 0;
+    this->_installedKnown = false;
+  }
+  return opcode;
+}
+
+void BluetoothHciAcceptListSync::send(std::vector<std::string>& commands, std::string command, uint64_t now) {
+  this->_inFlight = static_cast<uint16_t>(static_cast<uint8_t>(command[1]) | (static_cast<uint8_t>(command[2]) << 8));
+  this->_sentAt = now;
+  this->_commands++;
+  commands.push_back(std::move(command));
+}
+
+void BluetoothHciAcceptListSync::update(std::vector<std::string>& commands, uint64_t now) {
+  if (this->_controllerSize == 0) {
+    this->send(commands, Command(HCI_LE_READ_ACCEPT_LIST_SIZE, nullptr, 0), now);
+    return;
+  }
+
+  size_t removals = 0;
+  uint64_t removal = 0;
+  for (uint64_t key : this->_installed) {
+    if (!this->_wanted.count(key)) {
+      removal = key;
+      removals++;
+    }
+  }
+  size_t additions = 0;
+  uint64_t addition = 0;
+  for (uint64_t key : this->_wanted) {
+    if (!this->_installed.count(key)) {
+      addition = key;
+      additions++;
+    }
+  }
+
+  if (!this->_installedKnown || 1 + this->_wanted.size() < removals + additions) {
+    this->send(commands, Command(HCI_LE_CLEAR_ACCEPT_LIST, nullptr, 0), now);
+  } else if (removals > 0) {
+    // Removals first, so additions find a free entry
+    this->send(commands, EntryCommand(HCI_LE_DEL_FROM_ACCEPT_LIST, removal), now);
+    this->_inFlightKey = removal;
+  } else if (additions > 0) {
+    this->send(commands, EntryCommand(HCI_LE_ADD_TO_ACCEPT_LIST, addition), now);
+    this->_inFlightKey = addition;
+  }
+}
+
+void BluetoothHciAcceptListSync::observeCommand(const uint8_t* data, size_t length) {
+  if (length < 4 || data[0] != HCI_COMMAND_PKT || length < 4u + data[3]) {
+    return;
+  }
+
+  switch (HciLoad<uint16_t>(data + 1)) {
+    case HCI_RESET:
+      // The controller empties its list; commands in flight are dropped
+      this->_installed.clear();
+      this->_installedKnown = true;
+      this->_inFlight = 0;
+      break;
+    case HCI_LE_CLEAR_ACCEPT_LIST:
+    case HCI_LE_ADD_TO_ACCEPT_LIST:
+    case HCI_LE_DEL_FROM_ACCEPT_LIST:
+      // The host changed the list itself; it is cleared and refilled
+      this->_installedKnown = false;
+      break;
+  }
+}
+
+bool BluetoothHciAcceptListSync::observeEvent(const uint8_t* data, size_t length, Completion& completion) {
+  const uint8_t* params = nullptr;
+  size_t paramsLength = 0;
+
+  if (HciView<HciCmdCompleteLayout> view{data, length}) {
+    if (this->_inFlight == 0 || view[HciCmdCompleteLayout::opcode] != this->_inFlight) {
+      return false;
+    }
+    completion.status = view[HciCmdCompleteLayout::status];
+    params = data + HciCmdCompleteLayout::returnParams;
+    paramsLength = 3u + data[2] - HciCmdCompleteLayout::returnParams;
+  } else if (HciView<HciCmdStatusLayout> view{data, length}) {
+    if (this->_inFlight == 0 || view[HciCmdStatusLayout::opcode] != this->_inFlight) {
+      return false;
+    }
+    completion.status = view[HciCmdStatusLayout::status];
+  } else {
+    return false;
+  }
+
+  completion.opcode = this->_inFlight;
+  completion.key = this->_inFlightKey;
+  completion.resized = false;
+  this->_inFlight = 0;
+  if (completion.status != HCI_ERR_COMMAND_DISALLOWED) {
+    this->complete(completion, params, paramsLength);
+  }
+  return true;
+}
+
+void BluetoothHciAcceptListSync::complete(Completion& completion, const uint8_t* params, size_t paramsLength) {
+  switch (completion.opcode) {
+    case HCI_LE_READ_ACCEPT_LIST_SIZE:
+      this->_controllerSize = completion.status == HCI_SUCCESS && paramsLength >= 1 && params[0] > 0 ? params[0] :
+                              std::max<size_t>(1, this->_limit);
+      completion.resized = true;
+      break;
+    case HCI_LE_CLEAR_ACCEPT_LIST:
+      if (completion.status == HCI_SUCCESS) {
+        this->_installed.clear();
+        this->_installedKnown = true;
+      }
+      break;
+    case HCI_LE_ADD_TO_ACCEPT_LIST:
+      if (completion.status == HCI_SUCCESS) {
+        this->_installed.insert(completion.key);
+      } else if (completion.status == HCI_ERR_MEMORY_EXCEEDED) {
+        // Smaller than reported, or entries added behind the owner's back
+        this->_controllerSize = std::max<size_t>(1, this->_installed.size());
+        completion.resized = true;
+      }
+      break;
+    case HCI_LE_DEL_FROM_ACCEPT_LIST:
+      // An entry the controller does not have is as good as removed
+      this->_installed.erase(completion.key);
+      break;
+  }
+}
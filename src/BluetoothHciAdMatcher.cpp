@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+
+#include "BluetoothHciAdMatcher.h"
+
+BluetoothHciAdMatcher::BluetoothHciAdMatcher(const std::vector<HciAdPattern>& patterns) :
+  _patterns(0)
+{
+  std::fill(std::begin(this->_roots), std::end(this->_roots), -1);
+
+  for (int type = 0; type < 256; type++) {
+    // Trie of this type's patterns, in build order; node 0 is the root
+    std::vector<std::map<uint8_t, uint32_t>> children(1);
+    std::vector<std::vector<Output>> outputs(1);
+    size_t limit = 0;
+
+    for (const HciAdPattern& pattern : patterns) {
+      if (pattern.type != type || pattern.value.empty()) {
+        continue;
+      }
+
+      uint32_t node = 0;
+      for (char c : pattern.value) {
+        uint8_t byte = static_cast<uint8_t>(c);
+        auto it = children[node].find(byte);
+        if (it == children[node].end()) {
+          it = children[node].emplace(byte, static_cast<uint32_t>(children.size())).first;
+          children.emplace_back();
+          outputs.emplace_back();
+        }
+        node = it->second;
+      }
+      outputs[node].push_back({ pattern.id, static_cast<uint32_t>(pattern.value.size()), pattern.offset });
+
+      // Anchored patterns bound how far a value is worth scanning
+      limit = pattern.offset < 0 ? std::numeric_limits<size_t>::max() :
+              std::max(limit, static_cast<size_t>(pattern.offset) + pattern.value.size());
+      this->_patterns++;
+    }
+
+    if (children.size() == 1) {
+      continue;
+    }
+
+    // Failure links breadth first, so a node's suffix is linked before the node
+    std::vector<uint32_t> fail(children.size(), 0);
+    std::deque<uint32_t> queue;
+    for (const auto& edge : children[0]) {
+      queue.push_back(edge.second);
+    }
+    while (!queue.empty()) {
+      uint32_t node = queue.front();
+      queue.pop_front();
+
+      for (const auto& edge : children[node]) {
+        uint32_t f = fail[node];
+        while (f != 0 && children[f].find(edge.first) == children[f].end()) {
+          f = fail[f];
+        }
+        auto it = children[f].find(edge.first);
+        fail[edge.second] = (it != children[f].end() && it->second != edge.second) ? it->second : 0;
+
+        // A state reports every pattern ending at it, its suffixes' included
+        const std::vector<Output>& inherited = outputs[fail[edge.second]];
+        outputs[edge.second].insert(outputs[edge.second].end(), inherited.begin(), inherited.end());
+        queue.push_back(edge.second);
+      }
+    }
+
+    // Flatten into the shared tables
+    uint32_t base = static_cast<uint32_t>(this->_states.size());
+    Root root = { base, static_cast<uint32_t>(this->_rootNext.size()), limit };
+    this->_rootNext.resize(this->_rootNext.size() + 256, base);
+    for (const auto& edge : children[0]) {
+      this->_rootNext[root.table + edge.first] = base + edge.second;
+    }
+
+    for (size_t node = 0; node < children.size(); node++) {
+      State state;
+      state.fail = base + fail[node];
+      state.edges = static_cast<uint32_t>(this->_edges.size());
+      state.edgeCount = static_cast<uint32_t>(children[node].size());
+      state.outputs = static_cast<uint32_t>(this->_outputs.size());
+      state.outputCount = static_cast<uint32_t>(outputs[node].size());
+      for (const auto& edge : children[node]) {
+        this->_edges.push_back({ edge.first, base + edge.second });
+      }
+      this->_outputs.insert(this->_outputs.end(), outputs[node].begin(), outputs[node].end());
+      this->_states.push_back(state);
+    }
+
+    this->_roots[type] = static_cast<int16_t>(this->_rootList.size());
+    this->_rootList.push_back(root);
+  }
+}
+
+size_t BluetoothHciAdMatcher::match(const uint8_t* adv, size_t length, std::vector<uint32_t>& ids) const {
+  ids.clear();
+  this->collect(adv, length, ids);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return ids.size();
+}
+
+size_t BluetoothHciAdMatcher::matchReports(const uint8_t* data, size_t length, std::vector<uint32_t>& ids) const {
+  ids.clear();
+
+  // H4 type, event code, parameter length, subevent code, number of reports
+  if (length < 5 || data[0] != HCI_EVENT_PKT || data[1] != HCI_EV_LE_META) {
+    return 0;
+  }
+  length = std::min<size_t>(length, 3u + data[2]);
+
+  uint8_t subEventCode = data[3];
+  uint8_t numReports = data[4];
+  size_t offset = 5;
+  size_t reports = 0;
+
+  for (uint8_t i = 0; i < numReports; i++) {
+    if (subEventCode == HCI_EV_LE_ADVERTISING_REPORT) {
+      // Event type, address type, address, data length, data, RSSI
+      if (offset + 9 > length || offset + 9 + data[offset + 8] + 1 > length) {
+        break;
+      }
+      this->collect(data + offset + 9, data[offset + 8], ids);
+      offset += 9 + data[offset + 8] + 1;
+    } else if (subEventCode == HCI_EV_LE_EXT_ADVERTISING_REPORT) {
+      // 24 byte header ending with the data length, then the data
+      if (offset + 24 > length || offset + 24 + data[offset + 23] > length) {
+        break;
+      }
+      this->collect(data + offset + 24, data[offset + 23], ids);
+      offset += 24 + data[offset + 23];
+    } else {
+      return 0;
+    }
+    reports++;
+  }
+
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return reports;
+}
+
+void BluetoothHciAdMatcher::collect(const uint8_t* adv, size_t length, std::vector<uint32_t>& ids) const {
+  // Length, type, value; a zero length starts the padding
+  size_t i = 0;
+  while (i < length && adv[i] != 0 && i + 1 + adv[i] <= length) {
+    int16_t root = this->_roots[adv[i + 1]];
+    if (root >= 0) {
+      this->scan(this->_rootList[root], adv + i + 2, adv[i] - 1u, ids);
+    }
+    i += 1 + adv[i];
+  }
+}
+
+void BluetoothHciAdMatcher::scan(const Root& root, const uint8_t* value, size_t length, std::vector<uint32_t>& ids) const {
+  size_t end = std::min(length, root.limit);
+  uint32_t s = root.state;
+
+  for (size_t i = 0; i < end; i++) {
+    uint8_t c = value[i];
+
+    // Follow failure links until a state has an edge for the byte; the root always has
+    while (s != root.state) {
+      const State& state = this->_states[s];
+      const Edge* first = this->_edges.data() + state.edges;
+      const Edge* last = first + state.edgeCount;
+      const Edge* edge = std::lower_bound(first, last, c, [](const Edge& e, uint8_t byte) { return e.byte < byte; });
+      if (edge != last && edge->byte == c) {
+        s = edge->next;
+        break;
+      }
+      s = state.fail;
+    }
+    if (s == root.state) {
+      s = this->_rootNext[root.table + c];
+    }
+
+    const State& state = this->_states[s];
+    for (uint32_t o = 0; o < state.outputCount; o++) {
+      const Output& output = this->_outputs[state.outputs + o];
+      if (output.offset < 0 || i + 1 == static_cast<size_t>(output.offset) + output.length) {
+        ids.push_back(output.id);
+      }
+    }
+  }
+}
@@ -0,0 +1,27 @@
+#include <napi.h>
+
+#include "BluetoothHciFramer.h"
+
+#ifdef BLUETOOTH_HCI_SOCKET_NATIVE
+#include "BluetoothHciBrokerConsumer.h"
+#include "BluetoothHciL2Channel.h"
+#include "BluetoothHciSocket.h"
+#include "BluetoothHciUart.h"
+#endif
+
+static Napi::Object InitAddon(Napi::Env env, Napi::Object exports) {
+  // Portable helpers used by the USB and UART drivers
+  BluetoothHciFramer::Init(env, exports);
+
+#ifdef BLUETOOTH_HCI_SOCKET_NATIVE
+  // Kernel HCI sockets, processes sharing one through a broker, L2CAP channels and the termios UART transport (Linux)
+  BluetoothHciSocket::Init(env, exports);
+  BluetoothHciBrokerConsumer::Init(env, exports);
+  BluetoothHciL2Channel::Init(env, exports);
+  BluetoothHciUart::Init(env, exports);
+#endif
+
+  return exports;
+}
+
+NODE_API_MODULE(addon, InitAddon);
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstring>
+
+#include "BluetoothHciAdvertising.h"
+
+namespace Layout = HciAdvertisementLayout;
+
+// Legacy report event types mapped to their extended report equivalents (legacy PDU bit set)
+static const uint16_t kLegacyEventTypes[] = {
+  0x13,  // ADV_IND
+  0x15,  // ADV_DIRECT_IND
+  0x12,  // ADV_SCAN_IND
+  0x10,  // ADV_NONCONN_IND
+  0x1B   // SCAN_RSP to an ADV_IND
+};
+
+BluetoothHciAdvertisingAssembler::BluetoothHciAdvertisingAssembler() :
+  _dropped(0)
+{}
+
+void BluetoothHciAdvertisingAssembler::reset() {
+  this->_chains.clear();
+}
+
+size_t BluetoothHciAdvertisingAssembler::observe(const uint8_t* data, size_t length, const Callback& onAdvertisement) {
+  // H4 type, event code, parameter length, subevent code, number of reports
+  if (length < 5 || data[0] != HCI_EVENT_PKT || data[1] != HCI_EV_LE_META) {
+    return 0;
+  }
+
+  size_t plen = std::min<size_t>(data[2], length - 3);
+  // Subevent code and at least the report count
+  if (plen < 2) {
+    return 0;
+  }
+  uint8_t subEventCode = data[3];
+
+  if (subEventCode == HCI_EV_LE_EXT_ADVERTISING_REPORT) {
+    return this->onExtendedReports(data + 4, plen - 1, onAdvertisement);
+  } else if (subEventCode == HCI_EV_LE_ADVERTISING_REPORT) {
+    return this->onLegacyReports(data + 4, plen - 1, onAdvertisement);
+  }
+  return 0;
+}
+
+size_t BluetoothHciAdvertisingAssembler::onLegacyReports(const uint8_t* data, size_t length, const Callback& onAdvertisement) {
+  if (length < 1) {
+    return 0;
+  }
+
+  uint8_t numReports = data[0];
+  size_t offset = 1;
+  size_t produced = 0;
+
+  // Reports are laid out one after another, as the kernel parses them
+  for (uint8_t i = 0; i < numReports; i++) {
+    // Event type, address type, address, data length, data, RSSI
+    if (offset + 9 > length) {
+      break;
+    }
+    const uint8_t* r = data + offset;
+    uint8_t advLength = r[8];
+    if (offset + 9 + advLength + 1 > length) {
+      break;
+    }
+
+    // Present the report with the extended report header so both encode alike
+    uint8_t report[kExtReportLength] = {};
+    uint16_t eventType = r[0] < 5 ? kLegacyEventTypes[r[0]] : 0x10;
+    report[0] = eventType & 0xFF;
+    report[1] = eventType >> 8;
+    report[2] = r[1];
+    memcpy(report + 3, r + 2, 6);
+    report[9] = 0x01;    // LE 1M
+    report[11] = 0xFF;   // No SID
+    report[12] = 0x7F;   // TX power unavailable
+    report[13] = r[9 + advLength];
+    report[23] = advLength;
+
+    onAdvertisement(encode(report, r + 9, advLength, HCI_ADV_DATA_COMPLETE, 1));
+    produced++;
+
+    offset += 9 + advLength + 1;
+  }
+
+  return produced;
+}
+
+size_t BluetoothHciAdvertisingAssembler::onExtendedReports(const uint8_t* data, size_t length, const Callback& onAdvertisement) {
+  if (length < 1) {
+    return 0;
+  }
+
+  uint8_t numReports = data[0];
+  size_t offset = 1;
+  size_t produced = 0;
+
+  for (uint8_t i = 0; i < numReports; i++) {
+    if (offset + kExtReportLength > length) {
+      break;
+    }
+    const uint8_t* r = data + offset;
+    uint8_t advLength = r[kExtReportLength - 1];
+    if (offset + kExtReportLength + advLength > length) {
+      break;
+    }
+    const uint8_t* adv = r + kExtReportLength;
+    offset += kExtReportLength + advLength;
+
+    uint16_t eventType = r[0] | (r[1] << 8);
+    uint8_t dataStatus = (eventType >> 5) & 0x03;
+
+    // Advertising data and scan response chains of one advertiser are kept apart
+    uint8_t key[9];
+    key[0] = r[2];
+    memcpy(key + 1, r + 3, 6);
+    key[7] = r[11];
+    key[8] = (eventType >> 3) & 0x01;
+
+    auto it = this->find(key);
+
+    if (dataStatus == HCI_ADV_DATA_INCOMPLETE) {
+      if (it == this->_chains.end()) {
+        if (this->_chains.size() >= kMaxChains) {
+          this->_chains.pop_front();
+          this->_dropped++;
+        }
+        Chain chain = {};
+        memcpy(chain.key, key, sizeof(key));
+        chain.data.reserve(HCI_MAX_EXT_ADV_DATA);
+        it = this->_chains.insert(this->_chains.end(), std::move(chain));
+      }
+
+      memcpy(it->report, r, kExtReportLength);
+      it->data.append(reinterpret_cast<const char*>(adv), advLength);
+      it->fragments++;
+
+      // A controller that never completes the chain must not grow it forever
+      if (it->data.length() > HCI_MAX_EXT_ADV_DATA) {
+        this->_chains.erase(it);
+        this->_dropped++;
+      }
+      continue;
+    }
+
+    uint8_t status = dataStatus == HCI_ADV_DATA_TRUNCATED ? HCI_ADV_DATA_TRUNCATED : HCI_ADV_DATA_COMPLETE;
+
+    if (it == this->_chains.end()) {
+      // Single fragment: encoded straight from the event
+      onAdvertisement(encode(r, adv, advLength, status, 1));
+    } else {
+      it->data.append(reinterpret_cast<const char*>(adv), advLength);
+      uint8_t fragments = it->fragments < 0xFF ? it->fragments + 1 : 0xFF;
+      // The last fragment's header carries the most recent RSSI
+      onAdvertisement(encode(r, reinterpret_cast<const uint8_t*>(it->data.data()), it->data.length(), status, fragments));
+      this->_chains.erase(it);
+    }
+    produced++;
+  }
+
+  return produced;
+}
+
+std::list<BluetoothHciAdvertisingAssembler::Chain>::iterator BluetoothHciAdvertisingAssembler::find(const uint8_t* key) {
+  for (auto it = this->_chains.begin(); it != this->_chains.end(); ++it) {
+    if (memcmp(it->key, key, sizeof(it->key)) == 0) {
+      return it;
+    }
+  }
+  return this->_chains.end();
+}
+
+std::string BluetoothHciAdvertisingAssembler::encode(const uint8_t* report, const uint8_t* adv, size_t advLength,
+                                                     uint8_t dataStatus, uint8_t fragments) {
+  uint8_t header[Layout::HeaderLength] = {};
+  uint8_t entries[255 * Layout::EntryLength];
+  size_t count = 0;
+
+  // Report fields share their offsets with the extended report header
+  memcpy(header, report, Layout::DataStatus);
+  header[Layout::EventType] &= ~0x60;  // Data status is reported separately
+  header[Layout::DataStatus] = dataStatus;
+  header[Layout::Fragments] = fragments;
+  header[Layout::DataLength] = advLength & 0xFF;
+  header[Layout::DataLength + 1] = advLength >> 8;
+
+  uint8_t present = 0;
+
+  // Walk the AD structures once: length, type, value
+  size_t i = 0;
+  while (i < advLength && count < 255) {
+    uint8_t adLength = adv[i];
+    if (adLength == 0) {
+      break;  // Remaining data is padding
+    }
+    if (i + 1 + adLength > advLength) {
+      present |= Layout::PresentMalformed;
+      break;
+    }
+
+    uint8_t type = adv[i + 1];
+    uint8_t valueLength = adLength - 1;
+    uint16_t valueOffset = static_cast<uint16_t>(i + 2);
+    const uint8_t* value = adv + valueOffset;
+
+    uint8_t* entry = entries + count * Layout::EntryLength;
+    entry[0] = type;
+    entry[1] = valueLength;
+    entry[2] = valueOffset & 0xFF;
+    entry[3] = valueOffset >> 8;
+    count++;
+
+    switch (type) {
+      case AD_TYPE_FLAGS:
+        if (valueLength >= 1) {
+          header[Layout::Flags] = value[0];
+          present |= Layout::PresentFlags;
+        }
+        break;
+      case AD_TYPE_TX_POWER:
+        if (valueLength >= 1) {
+          header[Layout::TxPowerLevel] = value[0];
+          present |= Layout::PresentTxPowerLevel;
+        }
+        break;
+      case AD_TYPE_NAME_SHORT:
+      case AD_TYPE_NAME_COMPLETE:
+        present |= Layout::PresentName;
+        break;
+      case AD_TYPE_UUID16_SOME:
+      case AD_TYPE_UUID16_ALL:
+      case AD_TYPE_UUID32_SOME:
+      case AD_TYPE_UUID32_ALL:
+      case AD_TYPE_UUID128_SOME:
+      case AD_TYPE_UUID128_ALL:
+        present |= Layout::PresentServices;
+        break;
+      case AD_TYPE_SERVICE_DATA16:
+      case AD_TYPE_SERVICE_DATA32:
+      case AD_TYPE_SERVICE_DATA128:
+        present |= Layout::PresentServiceData;
+        break;
+      case AD_TYPE_MANUFACTURER:
+        present |= Layout::PresentManufacturer;
+        break;
+      default:
+        break;
+    }
+
+    i += 1 + adLength;
+  }
+
+  header[Layout::AdCount] = static_cast<uint8_t>(count);
+  header[Layout::Present] = present;
+
+  std::string encoded;
+  encoded.reserve(Layout::HeaderLength + count * Layout::EntryLength + advLength);
+  encoded.append(reinterpret_cast<const char*>(header), Layout::HeaderLength);
+  encoded.append(reinterpret_cast<const char*>(entries), count * Layout::EntryLength);
+  encoded.append(reinterpret_cast<const char*>(adv), advLength);
+  return encoded;
+}
@@ -0,0 +1,146 @@
+#include <cstring>
+
+#include "BluetoothHciAdvertisingColumns.h"
+#include "BluetoothHciAdvertising.h"
+
+namespace Layout = HciAdvertisementLayout;
+
+static size_t Align(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+HciAdvertisingColumnLayout HciAdvertisingColumnLayout::For(size_t count, size_t dataBytes) {
+  HciAdvertisingColumnLayout l;
+  size_t offset = 0;
+
+  // Wider columns first so they stay aligned without padding
+  l.dataOffset = offset;    offset += count * 4;
+  l.dataLength = offset;    offset += count * 4;
+  l.eventType = offset;     offset += count * 2;
+  l.address = offset;       offset += count * 6;
+  l.addressType = offset;   offset += count;
+  l.rssi = offset;          offset += count;
+  l.txPower = offset;       offset += count;
+  l.sid = offset;           offset += count;
+  l.primaryPhy = offset;    offset += count;
+  l.secondaryPhy = offset;  offset += count;
+  l.data = Align(offset, 8);
+
+  l.count = count;
+  l.dataBytes = dataBytes;
+  l.total = l.data + dataBytes;
+  return l;
+}
+
+BluetoothHciAdvertisingColumns::BluetoothHciAdvertisingColumns() :
+  _dropped(0)
+{}
+
+bool BluetoothHciAdvertisingColumns::append(const std::string& encoded) {
+  if (encoded.length() < Layout::HeaderLength) {
+    return false;
+  }
+
+  const uint8_t* h = reinterpret_cast<const uint8_t*>(encoded.data());
+  size_t dataOffset = Layout::HeaderLength + h[Layout::AdCount] * Layout::EntryLength;
+  size_t dataLength = h[Layout::DataLength] | (h[Layout::DataLength + 1] << 8);
+  if (dataOffset + dataLength > encoded.length()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (this->_lengths.size() >= kMaxRows) {
+    this->_dropped++;
+    return false;
+  }
+
+  bool first = this->_lengths.empty();
+  this->_headers.insert(this->_headers.end(), h, h + Layout::HeaderLength);
+  this->_lengths.push_back(static_cast<uint32_t>(dataLength));
+  this->_data.insert(this->_data.end(), h + dataOffset, h + dataOffset + dataLength);
+  return first;
+}
+
+void BluetoothHciAdvertisingColumns::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  this->_headers.clear();
+  this->_lengths.clear();
+  this->_data.clear();
+}
+
+HciAdvertisingColumnLayout BluetoothHciAdvertisingColumns::take(const std::function<uint8_t*(size_t)>& allocate) {
+  std::vector<uint8_t> headers;
+  std::vector<uint32_t> lengths;
+  std::vector<uint8_t> data;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    headers.swap(this->_headers);
+    lengths.swap(this->_lengths);
+    data.swap(this->_data);
+  }
+
+  size_t count = lengths.size();
+  HciAdvertisingColumnLayout layout = HciAdvertisingColumnLayout::For(count, data.size());
+  uint8_t* out = allocate(layout.total);
+
+  Transpose(headers.data(), count, layout, out);
+
+  // Offsets are a prefix sum of the lengths
+  uint32_t* dataOffset = reinterpret_cast<uint32_t*>(out + layout.dataOffset);
+  uint32_t* dataLength = reinterpret_cast<uint32_t*>(out + layout.dataLength);
+  uint32_t offset = 0;
+  for (size_t i = 0; i < count; i++) {
+    dataOffset[i] = offset;
+    dataLength[i] = lengths[i];
+    offset += lengths[i];
+  }
+  if (!data.empty()) {
+    memcpy(out + layout.data, data.data(), data.size());
+  }
+
+  return layout;
+}
+
+void BluetoothHciAdvertisingColumns::Transpose(const uint8_t* headers, size_t count,
+                                               const HciAdvertisingColumnLayout& layout, uint8_t* out) {
+  const size_t stride = Layout::HeaderLength;
+
+  // One branch-free loop per column; each is a fixed-stride gather the compiler can unroll or vectorize
+  uint8_t* addressType = out + layout.addressType;
+  for (size_t i = 0; i < count; i++) {
+    addressType[i] = headers[i * stride + Layout::AddressType];
+  }
+
+  uint8_t* rssi = out + layout.rssi;
+  for (size_t i = 0; i < count; i++) {
+    rssi[i] = headers[i * stride + Layout::Rssi];
+  }
+
+  uint8_t* txPower = out + layout.txPower;
+  for (size_t i = 0; i < count; i++) {
+    txPower[i] = headers[i * stride + Layout::TxPower];
+  }
+
+  uint8_t* sid = out + layout.sid;
+  for (size_t i = 0; i < count; i++) {
+    sid[i] = headers[i * stride + Layout::Sid];
+  }
+
+  uint8_t* primaryPhy = out + layout.primaryPhy;
+  uint8_t* secondaryPhy = out + layout.secondaryPhy;
+  for (size_t i = 0; i < count; i++) {
+    primaryPhy[i] = headers[i * stride + Layout::PrimaryPhy];
+    secondaryPhy[i] = headers[i * stride + Layout::SecondaryPhy];
+  }
+
+  uint16_t* eventType = reinterpret_cast<uint16_t*>(out + layout.eventType);
+  for (size_t i = 0; i < count; i++) {
+    eventType[i] = headers[i * stride + Layout::EventType] | (headers[i * stride + Layout::EventType + 1] << 8);
+  }
+
+  uint8_t* address = out + layout.address;
+  for (size_t i = 0; i < count; i++) {
+    memcpy(address + i * 6, headers + i * stride + Layout::Address, 6);
+  }
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+
+#include "BluetoothHciAttRouter.h"
+#include "BluetoothStructs.h"
+
+BluetoothHciAttRouter::BluetoothHciAttRouter() :
+  _nextId(1)
+{}
+
+uint32_t BluetoothHciAttRouter::subscribe(uint16_t connHandle, uint16_t attrHandle, bool confirm) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  uint32_t k = key(connHandle & 0x0FFF, attrHandle);
+  if (this->_byKey.count(k)) {
+    return 0;
+  }
+  uint32_t id = this->_nextId++;
+  this->_byKey[k] = id;
+  this->_keys[id] = k;
+  if (confirm) {
+    this->_confirming.insert(id);
+  }
+  return id;
+}
+
+bool BluetoothHciAttRouter::unsubscribe(uint32_t subscription) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = this->_keys.find(subscription);
+  if (it == this->_keys.end()) {
+    return false;
+  }
+  this->_byKey.erase(it->second);
+  this->_keys.erase(it);
+  this->_confirming.erase(subscription);
+  this->_staged.erase(subscription);
+  return true;
+}
+
+std::vector<uint32_t> BluetoothHciAttRouter::removeConnection(uint16_t connHandle) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<uint32_t> removed;
+
+  auto it = this->_byKey.lower_bound(key(connHandle, 0));
+  while (it != this->_byKey.end() && (it->first >> 16) == connHandle) {
+    removed.push_back(it->second);
+    this->_keys.erase(it->second);
+    this->_confirming.erase(it->second);
+    it = this->_byKey.erase(it);
+  }
+  this->_reassembly.erase(connHandle);
+  return removed;
+}
+
+void BluetoothHciAttRouter::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  this->_byKey.clear();
+  this->_keys.clear();
+  this->_confirming.clear();
+  this->_reassembly.clear();
+  this->_staged.clear();
+}
+
+bool BluetoothHciAttRouter::observe(const uint8_t* data, size_t length, std::vector<HciAttValue>& completed) {
+  // H4 type, handle and flags, data length
+  if (length < 5 || data[0] != HCI_ACLDATA_PKT) {
+    return false;
+  }
+
+  uint16_t handleFlags = data[1] | (data[2] << 8);
+  uint16_t connHandle = handleFlags & 0x0FFF;
+  uint8_t pb = (handleFlags >> 12) & 0x03;
+  size_t dlen = std::min<size_t>(data[3] | (data[4] << 8), length - 5);
+  const uint8_t* payload = data + 5;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // Nothing to route; keep the common case to a single lookup
+  if (this->_byKey.empty() && this->_reassembly.empty()) {
+    return false;
+  }
+
+  if (pb == 0x01) {
+    // Continuation fragment
+    auto it = this->_reassembly.find(connHandle);
+    if (it == this->_reassembly.end() || !it->second.active) {
+      return false;
+    }
+    Reassembly& r = it->second;
+    size_t n = std::min(dlen, r.remaining);
+    if (r.consume) {
+      r.value.value.append(reinterpret_cast<const char*>(payload), n);
+    }
+    r.remaining -= n;
+
+    bool consumed = r.consume;
+    if (r.remaining == 0) {
+      if (r.consume) {
+        completed.push_back(std::move(r.value));
+      }
+      this->_reassembly.erase(it);
+    }
+    return consumed;
+  }
+
+  // Start of an L2CAP PDU: length, CID
+  this->_reassembly.erase(connHandle);
+  if (dlen < 4) {
+    return false;
+  }
+  size_t l2len = payload[0] | (payload[1] << 8);
+  uint16_t cid = payload[2] | (payload[3] << 8);
+  if (cid != ATT_CID) {
+    return false;
+  }
+
+  // Opcode and attribute handle must be in the first fragment to decide
+  bool matched = false;
+  HciAttValue value = {};
+  if (l2len >= 3 && dlen >= 7 && (payload[4] == ATT_OP_HANDLE_NOTIFY || payload[4] == ATT_OP_HANDLE_IND)) {
+    uint16_t attrHandle = payload[5] | (payload[6] << 8);
+    auto sub = this->_byKey.find(key(connHandle, attrHandle));
+    // An indication left to the host is confirmed by the host
+    if (sub != this->_byKey.end() && (payload[4] == ATT_OP_HANDLE_NOTIFY || this->_confirming.count(sub->second))) {
+      matched = true;
+      value.subscription = sub->second;
+      value.connHandle = connHandle;
+      value.attrHandle = attrHandle;
+      value.indication = payload[4] == ATT_OP_HANDLE_IND;
+    }
+  }
+
+  size_t have = std::min(dlen - 4, l2len);
+  if (matched) {
+    value.value.assign(reinterpret_cast<const char*>(payload + 7), have - 3);
+  }
+
+  if (have >= l2len) {
+    // Whole PDU in one fragment
+    if (matched) {
+      completed.push_back(std::move(value));
+    }
+    return matched;
+  }
+
+  // Continuations follow; remember whether they are ours
+  Reassembly& r = this->_reassembly[connHandle];
+  r.active = true;
+  r.consume = matched;
+  r.remaining = l2len - have;
+  r.value = std::move(value);
+  if (!matched) {
+    r.value.value.clear();
+  }
+  return matched;
+}
+
+bool BluetoothHciAttRouter::stage(HciAttValue value) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  // The subscription may have gone away while the value was being reassembled
+  if (!this->_keys.count(value.subscription)) {
+    return false;
+  }
+  std::vector<std::string>& staged = this->_staged[value.subscription];
+  staged.push_back(std::move(value.value));
+  return staged.size() == 1;
+}
+
+std::vector<std::string> BluetoothHciAttRouter::take(uint32_t subscription) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<std::string> values;
+  auto it = this->_staged.find(subscription);
+  if (it != this->_staged.end()) {
+    values.swap(it->second);
+    this->_staged.erase(it);
+  }
+  return values;
+}
+
+std::string BluetoothHciAttRouter::Confirmation(uint16_t connHandle) {
+  // ACL start (not automatically flushable), L2CAP length 1 on the ATT channel
+  const char packet[] = {
+    HCI_ACLDATA_PKT,
+    static_cast<char>(connHandle & 0xFF), static_cast<char>((connHandle >> 8) & 0x0F),
+    0x05, 0x00,
+    0x01, 0x00,
+    ATT_CID, 0x00,
+    ATT_OP_HANDLE_CNF
+  };
+  return std::string(packet, sizeof(packet));
+}
@@ -0,0 +1,289 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "BluetoothHciBrokerConsumer.h"
+
+BluetoothHciBrokerConsumer::BluetoothHciBrokerConsumer(const Napi::CallbackInfo& info) :
+  Napi::ObjectWrap<BluetoothHciBrokerConsumer>(info),
+  _slot(-1),
+  _filter(),
+  _hasFilter(false),
+  stopFlag(true)
+{}
+
+BluetoothHciBrokerConsumer::~BluetoothHciBrokerConsumer() {
+  this->StopThread();
+  if (this->_ring && this->_slot >= 0) {
+    this->_ring->leave(this->_slot);
+  }
+}
+
+void BluetoothHciBrokerConsumer::Attach(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  int fd = -1;
+  if (info.Length() > 0 && info[0].IsString()) {
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  } else if (info.Length() > 0 && info[0].IsNumber()) {
+    // The ring keeps its own descriptor, so an inherited one stays usable
+    fd = fcntl(info[0].As<Napi::Number>().Int32Value(), F_DUPFD_CLOEXEC, 0);
+  } else {
+    Napi::TypeError::New(env, "attach: expected a ring path or descriptor").ThrowAsJavaScriptException();
+    return;
+  }
+
+  if (fd < 0) {
+    Napi::Error::New(env, strerror(errno)).ThrowAsJavaScriptException();
+    return;
+  }
+
+  int error = 0;
+  std::unique_ptr<BluetoothHciSharedRing> ring = BluetoothHciSharedRing::Attach(fd, error);
+  if (!ring) {
+    Napi::Error::New(env, strerror(error)).ThrowAsJavaScriptException();
+    return;
+  }
+
+  HciRingCursor cursor;
+  int slot = ring->join(cursor);
+  if (slot < 0) {
+    Napi::Error::New(env, "attach: every consumer slot of the broker is taken").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Replaces a previous attachment
+  this->StopThread();
+  if (this->_ring && this->_slot >= 0) {
+    this->_ring->leave(this->_slot);
+  }
+  this->_ring = std::move(ring);
+  this->_slot = slot;
+  this->_cursor = std::move(cursor);
+}
+
+void BluetoothHciBrokerConsumer::SetFilter(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  std::lock_guard<std::mutex> lock(this->_filterMutex);
+
+  if (info.Length() > 0 && info[0].IsBuffer()) {
+    Napi::Buffer<char> buffer = info[0].As<Napi::Buffer<char>>();
+    if (buffer.Length() > sizeof(this->_filter)) {
+      Napi::TypeError::New(env, "setFilter: data length exceeds expected length").ThrowAsJavaScriptException();
+      return;
+    }
+
+    memset(&this->_filter, 0, sizeof(this->_filter));
+    memcpy(&this->_filter, buffer.Data(), buffer.Length());
+    this->_hasFilter = true;
+  } else {
+    this->_hasFilter = false;
+  }
+}
+
+bool BluetoothHciBrokerConsumer::Passes(const hci_filter& filter, const uint8_t* data, size_t length) {
+  // Same checks, in the same order, as the kernel applies to raw HCI sockets
+  if (length < 1 || !((filter.type_mask >> (data[0] & 31)) & 1)) {
+    return false;
+  }
+
+  if (data[0] != HCI_EVENT_PKT) {
+    return true;
+  }
+
+  if (length < 2) {
+    return false;
+  }
+
+  uint8_t event = data[1] & 63;
+  if (!((filter.event_mask[event >> 5] >> (event & 31)) & 1)) {
+    return false;
+  }
+
+  if (!filter.opcode) {
+    return true;
+  }
+
+  // Command Complete carries the opcode after the credits, Command Status after status and credits
+  if (data[1] == HCI_EV_CMD_COMPLETE) {
+    return length >= 6 && filter.opcode == (data[4] | (data[5] << 8));
+  }
+  if (data[1] == HCI_EV_CMD_STATUS) {
+    return length >= 7 && filter.opcode == (data[5] | (data[6] << 8));
+  }
+  return true;
+}
+
+void BluetoothHciBrokerConsumer::Start(const Napi::CallbackInfo& info) {
+  this->StopThread();
+
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (!this->_ring) {
+    Napi::Error::New(env, "Broker consumer is not attached").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Packets are delivered to the JS object's `emit` function
+  this->_delivery.start(env, info.This().As<Napi::Object>(), "Broker Consumer");
+
+  // Reset stop flag
+  stopFlag = false;
+  // Start the reader thread; it applies its scheduling options to itself first
+  readerThread = std::thread([this, options = this->_threadOptions]() {
+    BluetoothHciThread::Report(this->_delivery, BluetoothHciThread::Apply(options));
+    this->ReadLoop();
+  });
+}
+
+void BluetoothHciBrokerConsumer::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+  this->StopThread();
+}
+
+Napi::Value BluetoothHciBrokerConsumer::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (!this->_ring) {
+    Napi::Error::New(env, "Broker consumer is not attached").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Check if the first argument is provided and is a buffer
+  if (info.Length() > 0 && info[0].IsBuffer()) {
+    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+    return Napi::Boolean::New(env, this->_ring->submit(buffer.Data(), buffer.Length()));
+  }
+
+  return Napi::Boolean::New(env, false);
+}
+
+void BluetoothHciBrokerConsumer::OnPacket(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->_delivery.setHandlers(info.Length() > 0 ? info[0] : env.Undefined());
+}
+
+void BluetoothHciBrokerConsumer::SetThreadOptions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Takes effect when the reader thread is next started
+  HciThreadOptions options;
+  if (BluetoothHciThread::Parse(info.Length() > 0 ? info[0] : env.Undefined(), options)) {
+    this->_threadOptions = options;
+  }
+}
+
+Napi::Value BluetoothHciBrokerConsumer::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (!this->_ring) {
+    return env.Null();
+  }
+
+  for (const HciRingConsumerInfo& c : this->_ring->consumers()) {
+    if (static_cast<int>(c.slot) == this->_slot) {
+      Napi::Object stats = Napi::Object::New(env);
+      stats.Set("slot", Napi::Number::New(env, c.slot));
+      stats.Set("lag", Napi::Number::New(env, static_cast<double>(c.lag)));
+      stats.Set("delivered", Napi::Number::New(env, static_cast<double>(c.delivered)));
+      stats.Set("filtered", Napi::Number::New(env, static_cast<double>(c.filtered)));
+      stats.Set("lost", Napi::Number::New(env, static_cast<double>(c.lost)));
+      stats.Set("closed", Napi::Boolean::New(env, this->_ring->closed()));
+      return stats;
+    }
+  }
+
+  return env.Null();
+}
+
+void BluetoothHciBrokerConsumer::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->StopThread();
+  if (this->_ring && this->_slot >= 0) {
+    this->_ring->leave(this->_slot);
+  }
+  this->_ring.reset();
+  this->_slot = -1;
+}
+
+void BluetoothHciBrokerConsumer::ReadLoop() {
+  bool closed = false;
+
+  while (!stopFlag) {
+    hci_filter filter;
+    bool hasFilter;
+    {
+      std::lock_guard<std::mutex> lock(this->_filterMutex);
+      filter = this->_filter;
+      hasFilter = this->_hasFilter;
+    }
+
+    // Each packet is copied once, out of the ring into the string handed to JS
+    size_t count = this->_ring->read(this->_slot, this->_cursor, [this, &filter, hasFilter](const uint8_t* data, size_t length) {
+      if (hasFilter && !Passes(filter, data, length)) {
+        return false;
+      }
+      this->_delivery.push(std::string(reinterpret_cast<const char*>(data), length));
+      return true;
+    }, 256);
+
+    if (count == 0) {
+      // Packets published before the broker closed have been read by now
+      if (this->_ring->closed()) {
+        closed = true;
+        break;
+      }
+      // Allow the thread to check the stop flag periodically even when no data is incoming
+      this->_ring->waitPackets(this->_cursor, 1000);
+    }
+  }
+
+  if (closed && !stopFlag) {
+    this->_delivery.push([](Napi::Env env, Napi::Object target) {
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "close") });
+    }, BluetoothHciDelivery::Control, BluetoothHciDelivery::Barrier);
+  }
+
+  this->_delivery.stop();  // Release the thread-safe function after stopping the thread
+}
+
+void BluetoothHciBrokerConsumer::StopThread() {
+  stopFlag = true;
+  if (readerThread.joinable()) {
+    readerThread.join();
+  }
+}
+
+Napi::Object BluetoothHciBrokerConsumer::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  // Create the function for the class
+  Napi::Function func = DefineClass(env, "BluetoothHciBrokerConsumer", {
+    InstanceMethod("attach", &BluetoothHciBrokerConsumer::Attach),
+    InstanceMethod("setFilter", &BluetoothHciBrokerConsumer::SetFilter),
+    InstanceMethod("start", &BluetoothHciBrokerConsumer::Start),
+    InstanceMethod("stop", &BluetoothHciBrokerConsumer::Stop),
+    InstanceMethod("write", &BluetoothHciBrokerConsumer::Write),
+    InstanceMethod("onPacket", &BluetoothHciBrokerConsumer::OnPacket),
+    InstanceMethod("setThreadOptions", &BluetoothHciBrokerConsumer::SetThreadOptions),
+    InstanceMethod("getStats", &BluetoothHciBrokerConsumer::GetStats),
+    InstanceMethod("close", &BluetoothHciBrokerConsumer::Close)
+  });
+
+  exports.Set("BluetoothHciBrokerConsumer", func);
+  return exports;
+}
@@ -0,0 +1,457 @@
+#include <algorithm>
+
+#include "BluetoothHciConnectScheduler.h"
+
+BluetoothHciConnectScheduler::BluetoothHciConnectScheduler() :
+  _dirty(false),
+  _order(0),
+  _blockedUntil(0),
+  _initiating(false),
+  _cancelling(false),
+  _hostInitiating(false),
+  _waiting(false),
+  _connected(0),
+  _failed(0),
+  _initiations(0),
+  _cancels(0),
+  _deferred(0),
+  _latencyTotal(0),
+  _latencyMax(0)
+{}
+
+std::string BluetoothHciConnectScheduler::CreateCommand() const {
+  // The peer address is ignored with the accept list filter policy and left zero
+  const Options& o = this->_options;
+  const uint16_t connection[] = { o.connMinInterval, o.connMaxInterval, o.connLatency, o.supervisionTimeout, 0, 0 };
+  uint8_t params[26] = {};
+  size_t length;
+
+  if (o.extended) {
+    params[0] = 0x01;                 // Filter policy: accept list
+    params[1] = o.ownAddressType;
+    params[9] = 0x01;                 // Initiating PHYs: LE 1M
+    params[10] = o.scanInterval & 0xFF;
+    params[11] = o.scanInterval >> 8;
+    params[12] = o.scanWindow & 0xFF;
+    params[13] = o.scanWindow >> 8;
+    for (size_t i = 0; i < 6; i++) {
+      params[14 + 2 * i] = connection[i] & 0xFF;
+      params[15 + 2 * i] = connection[i] >> 8;
+    }
+    length = 26;
+  } else {
+    params[0] = o.scanInterval & 0xFF;
+    params[1] = o.scanInterval >> 8;
+    params[2] = o.scanWindow & 0xFF;
+    params[3] = o.scanWindow >> 8;
+    params[4] = 0x01;                 // Filter policy: accept list
+    params[12] = o.ownAddressType;
+    for (size_t i = 0; i < 6; i++) {
+      params[13 + 2 * i] = connection[i] & 0xFF;
+      params[14 + 2 * i] = connection[i] >> 8;
+    }
+    length = 25;
+  }
+  return BluetoothHciAcceptListSync::Command(o.extended ? HCI_LE_EXT_CREATE_CONN : HCI_LE_CREATE_CONN, params, length);
+}
+
+void BluetoothHciConnectScheduler::connect(const std::vector<HciConnectTarget>& targets, const Options& options, uint64_t now) {
+  this->_options = options;
+  this->_options.attempts = std::max<uint32_t>(1, options.attempts);
+  this->_list.setLimit(options.capacity);
+
+  std::unordered_set<uint64_t> seen;
+  for (const HciConnectTarget& target : targets) {
+    uint64_t key = BluetoothHciAcceptListSync::Key(target.type, target.address.b);
+    if (!seen.insert(key).second) {
+      continue;
+    }
+
+    // A device queued again keeps its attempts and the time it was first queued
+    auto it = this->_targets.find(key);
+    if (it != this->_targets.end()) {
+      it->second.priority = target.priority;
+      it->second.timeout = target.timeout;
+      continue;
+    }
+    this->_targets[key] = { key, target.priority, target.timeout, now, 0, 0, HCI_SUCCESS, this->_order++ };
+  }
+
+  this->_blockedUntil = 0;
+  this->_dirty = true;
+}
+
+void BluetoothHciConnectScheduler::cancel(uint64_t now) {
+  std::vector<uint64_t> keys;
+  for (const auto& entry : this->_targets) {
+    keys.push_back(entry.first);
+  }
+
+  // Reported in queue order
+  std::sort(keys.begin(), keys.end(), [this](uint64_t a, uint64_t b) {
+    return this->_targets[a].order < this->_targets[b].order;
+  });
+  for (uint64_t key : keys) {
+    this->finish(key, HciConnectResult::Cancelled, 0, now);
+  }
+}
+
+void BluetoothHciConnectScheduler::select() {
+  size_t capacity = this->_list.capacity();
+  std::vector<const Target*> ranked;
+  for (const auto& entry : this->_targets) {
+    ranked.push_back(&entry.second);
+  }
+
+  // Devices that timed out wait behind those of the same priority that tried less
+  std::sort(ranked.begin(), ranked.end(), [](const Target* a, const Target* b) {
+    if (a->priority != b->priority) {
+      return a->priority > b->priority;
+    }
+    if (a->attempts != b->attempts) {
+      return a->attempts < b->attempts;
+    }
+    return a->order < b->order;
+  });
+
+  std::unordered_set<uint64_t>& wanted = this->_list.wanted();
+  wanted.clear();
+  for (size_t i = 0; i < ranked.size() && i < capacity; i++) {
+    wanted.insert(ranked[i]->key);
+  }
+}
+
+void BluetoothHciConnectScheduler::finish(uint64_t key, HciConnectResult::Outcome outcome, uint16_t handle, uint64_t now) {
+  auto it = this->_targets.find(key);
+  if (it == this->_targets.end()) {
+    return;
+  }
+  const Target& target = it->second;
+
+  HciConnectResult result;
+  result.type = static_cast<uint8_t>(key >> 48);
+  for (size_t i = 0; i < 6; i++) {
+    result.address.b[i] = static_cast<uint8_t>(key >> (8 * i));
+  }
+  result.outcome = outcome;
+  result.status = target.status;
+  result.handle = handle;
+  result.attempts = target.attempts + (outcome == HciConnectResult::Connected ? 1 : 0);
+  result.latency = now - target.queuedAt;
+  this->_results.push_back(result);
+
+  if (outcome == HciConnectResult::Connected) {
+    this->_connected++;
+    this->_latencyTotal += result.latency;
+    this->_latencyMax = std::max(this->_latencyMax, result.latency);
+  } else {
+    this->_failed++;
+  }
+
+  this->_targets.erase(it);
+  this->_dirty = true;
+}
+
+void BluetoothHciConnectScheduler::endAttempts(uint8_t status, bool expiredOnly, uint64_t now) {
+  std::vector<uint64_t> exhausted;
+  for (uint64_t key : this->_list.installed()) {
+    auto it = this->_targets.find(key);
+    if (it == this->_targets.end() || it->second.attemptAt == 0) {
+      continue;
+    }
+    Target& target = it->second;
+    uint64_t timeout = target.timeout > 0 ? target.timeout : this->_options.timeout;
+    if (expiredOnly && now < target.attemptAt + timeout) {
+      continue;
+    }
+
+    target.attempts++;
+    target.attemptAt = 0;
+    if (!expiredOnly) {
+      target.status = status;
+    }
+    if (target.attempts >= this->_options.attempts) {
+      exhausted.push_back(key);
+    }
+  }
+
+  for (uint64_t key : exhausted) {
+    this->finish(key, expiredOnly ? HciConnectResult::Timeout : HciConnectResult::Failed, 0, now);
+  }
+  this->_dirty = true;
+}
+
+uint64_t BluetoothHciConnectScheduler::deadline() const {
+  uint64_t deadline = UINT64_MAX;
+  for (uint64_t key : this->_list.installed()) {
+    auto it = this->_targets.find(key);
+    if (it != this->_targets.end() && it->second.attemptAt != 0) {
+      uint64_t timeout = it->second.timeout > 0 ? it->second.timeout : this->_options.timeout;
+      deadline = std::min(deadline, it->second.attemptAt + timeout);
+    }
+  }
+  return deadline;
+}
+
+void BluetoothHciConnectScheduler::take(std::vector<std::string>& commands, uint64_t now) {
+  if (this->_list.waiting(now)) {
+    return;
+  }
+  // A completion lost to a restarted socket leaves the list unknown; a lost initiation is cancelled to be sure
+  uint16_t lost = this->_list.drop();
+  if (lost == HCI_LE_CREATE_CONN || lost == HCI_LE_EXT_CREATE_CONN) {
+    this->_initiating = true;
+    this->_cancelling = true;
+    this->_list.send(commands, BluetoothHciAcceptListSync::Command(HCI_LE_CREATE_CONN_CANCEL, nullptr, 0), now);
+    return;
+  }
+
+  if (this->_initiating) {
+    // Emptied queues end the initiation as well as timeouts do
+    if (!this->_cancelling && (this->_targets.empty() || now >= this->deadline())) {
+      this->_cancels += !this->_targets.empty();
+      this->_cancelling = true;
+      this->_list.send(commands, BluetoothHciAcceptListSync::Command(HCI_LE_CREATE_CONN_CANCEL, nullptr, 0), now);
+    }
+    return;
+  }
+
+  // Entries are left installed once the queue is empty; the list is free for others
+  if (this->_targets.empty() || now < this->_blockedUntil) {
+    return;
+  }
+
+  if (!this->_list.sized()) {
+    this->_list.update(commands, now);
+    return;
+  }
+
+  // One attempt is pending at a time; the host's own goes first
+  if (this->_hostInitiating) {
+    if (!this->_waiting) {
+      this->_deferred++;
+      this->_waiting = true;
+    }
+    return;
+  }
+  this->_waiting = false;
+
+  if (this->_dirty) {
+    this->select();
+    this->_dirty = false;
+  }
+
+  if (!this->_list.synced()) {
+    this->_list.update(commands, now);
+  } else if (!this->_list.installed().empty()) {
+    // Devices that stay installed carry on with the attempt they started
+    for (uint64_t key : this->_list.installed()) {
+      Target& target = this->_targets[key];
+      target.attemptAt = target.attemptAt != 0 ? target.attemptAt : now;
+    }
+    this->_list.send(commands, this->CreateCommand(), now);
+    this->_initiating = true;
+    this->_initiations++;
+  }
+}
+
+void BluetoothHciConnectScheduler::writeFailed(uint64_t now) {
+  uint16_t opcode = this->_list.drop();
+  if (opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) {
+    // The controller never started the initiation
+    this->_initiating = false;
+    for (uint64_t key : this->_list.installed()) {
+      auto it = this->_targets.find(key);
+      if (it != this->_targets.end()) {
+        it->second.attemptAt = 0;
+      }
+    }
+  } else if (opcode == HCI_LE_CREATE_CONN_CANCEL) {
+    // Sent again on the next take
+    this->_cancelling = false;
+  }
+  this->_blockedUntil = now + kRetryDelay;
+}
+
+void BluetoothHciConnectScheduler::complete(const BluetoothHciAcceptListSync::Completion& completion, uint64_t now) {
+  uint16_t opcode = completion.opcode;
+  uint8_t status = completion.status;
+
+  if (status == HCI_ERR_COMMAND_DISALLOWED && opcode != HCI_LE_CREATE_CONN_CANCEL) {
+    // Something the scheduler did not see is initiating or using the list
+    if (opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) {
+      this->_initiating = false;
+      for (uint64_t key : this->_list.installed()) {
+        auto it = this->_targets.find(key);
+        if (it != this->_targets.end()) {
+          it->second.attemptAt = 0;
+        }
+      }
+    }
+    this->_blockedUntil = now + kRetryDelay;
+    this->_deferred++;
+    return;
+  }
+
+  if (completion.resized) {
+    this->_dirty = true;
+  }
+
+  switch (opcode) {
+    case HCI_LE_CLEAR_ACCEPT_LIST:
+      if (status == HCI_SUCCESS) {
+        for (auto& entry : this->_targets) {
+          entry.second.attemptAt = 0;
+        }
+      }
+      break;
+    case HCI_LE_ADD_TO_ACCEPT_LIST:
+      if (status != HCI_SUCCESS && status != HCI_ERR_MEMORY_EXCEEDED) {
+        auto it = this->_targets.find(completion.key);
+        if (it != this->_targets.end()) {
+          it->second.status = status;
+        }
+        this->finish(completion.key, HciConnectResult::Rejected, 0, now);
+      }
+      break;
+    case HCI_LE_DEL_FROM_ACCEPT_LIST: {
+      // An attempt ends unfinished
+      auto it = this->_targets.find(completion.key);
+      if (it != this->_targets.end()) {
+        it->second.attemptAt = 0;
+      }
+      break;
+    }
+    case HCI_LE_CREATE_CONN:
+    case HCI_LE_EXT_CREATE_CONN:
+      // Parameters the controller refuses fail every device's attempt alike
+      if (status != HCI_SUCCESS) {
+        this->_initiating = false;
+        this->endAttempts(status, false, now);
+      }
+      break;
+    case HCI_LE_CREATE_CONN_CANCEL:
+      // Refused when the initiation ended first; its connection event has been seen
+      if (status != HCI_SUCCESS && this->_cancelling) {
+        this->_cancelling = false;
+        this->_initiating = false;
+        this->endAttempts(status, true, now);
+      }
+      break;
+  }
+}
+
+void BluetoothHciConnectScheduler::observeCommand(const uint8_t* data, size_t length, uint64_t) {
+  if (length < 4 || data[0] != HCI_COMMAND_PKT || length < 4u + data[3]) {
+    return;
+  }
+
+  this->_list.observeCommand(data, length);
+
+  switch (HciLoad<uint16_t>(data + 1)) {
+    case HCI_RESET:
+      // The controller also drops any attempt
+      this->_initiating = false;
+      this->_cancelling = false;
+      this->_hostInitiating = false;
+      for (auto& entry : this->_targets) {
+        entry.second.attemptAt = 0;
+      }
+      this->_dirty = true;
+      break;
+    case HCI_LE_CREATE_CONN:
+    case HCI_LE_EXT_CREATE_CONN:
+      this->_hostInitiating = true;
+      break;
+  }
+}
+
+bool BluetoothHciConnectScheduler::observeEvent(const uint8_t* data, size_t length, uint64_t now) {
+  BluetoothHciAcceptListSync::Completion completion;
+  if (this->_list.observeEvent(data, length, completion)) {
+    this->complete(completion, now);
+    return true;
+  }
+
+  if (HciView<HciCmdStatusLayout> view{data, length}) {
+    uint16_t opcode = view[HciCmdStatusLayout::opcode];
+    // A host attempt that failed to start ends at once
+    if ((opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) && view[HciCmdStatusLayout::status] != HCI_SUCCESS) {
+      this->_hostInitiating = false;
+    }
+    return false;
+  }
+
+  // Both connection layouts share status, handle, role, peer address type and peer address
+  uint8_t status = 0, role = 0, peerType = 0;
+  uint16_t handle = 0;
+  bdaddr_t peer;
+  bool connection = HciDispatch<HciLeConnCompleteLayout, HciLeEnhConnCompleteLayout>(data, length, [&](auto view) {
+    using Layout = typename decltype(view)::Layout;
+    status = view[Layout::status];
+    handle = view[Layout::handle] & 0x0FFF;
+    role = view[Layout::role];
+    peerType = view[Layout::peerType];
+    peer = view[Layout::peer];
+    return true;
+  });
+  if (!connection || (status == HCI_SUCCESS && role != 0x00)) {
+    return false;
+  }
+
+  // A successful connection to a queued device completes it, whoever initiated it
+  bool ours = this->_initiating;
+  if (ours) {
+    this->_initiating = false;
+    if (this->_cancelling) {
+      // The cancel's own completion, or a connection that beat it; either way the attempt timed out
+      this->_cancelling = false;
+      this->endAttempts(HCI_SUCCESS, true, now);
+    }
+  } else {
+    this->_hostInitiating = false;
+  }
+
+  uint64_t key = BluetoothHciAcceptListSync::Key(peerType, peer.b);
+  if (status == HCI_SUCCESS) {
+    this->finish(key, HciConnectResult::Connected, handle, now);
+    return false;
+  }
+
+  // A failed attempt of the scheduler's own is reported as a result instead
+  auto it = this->_targets.find(key);
+  if (ours && status != HCI_ERR_UNKNOWN_CONN_ID && it != this->_targets.end() && this->_list.installed().count(key)) {
+    Target& target = it->second;
+    target.attempts++;
+    target.attemptAt = 0;
+    target.status = status;
+    if (target.attempts >= this->_options.attempts) {
+      this->finish(key, HciConnectResult::Failed, 0, now);
+    }
+    this->_dirty = true;
+  }
+  return ours;
+}
+
+void BluetoothHciConnectScheduler::results(std::vector<HciConnectResult>& results) {
+  results.insert(results.end(), this->_results.begin(), this->_results.end());
+  this->_results.clear();
+}
+
+HciConnectStats BluetoothHciConnectScheduler::stats() const {
+  HciConnectStats stats = {};
+  stats.queued = this->_targets.size();
+  for (uint64_t key : this->_list.installed()) {
+    stats.installed += this->_targets.count(key);
+  }
+  stats.capacity = this->_list.capacity();
+  stats.connected = this->_connected;
+  stats.failed = this->_failed;
+  stats.initiations = this->_initiations;
+  stats.cancels = this->_cancels;
+  stats.commands = this->_list.commands();
+  stats.deferred = this->_deferred;
+  stats.latencyTotal = this->_latencyTotal;
+  stats.latencyMax = this->_latencyMax;
+  return stats;
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+
+#include "BluetoothHciConnectionRouter.h"
+
+BluetoothHciConnectionRouter::BluetoothHciConnectionRouter() :
+  _roundRobin(0)
+{}
+
+BluetoothHciConnectionRouter::Adapter& BluetoothHciConnectionRouter::adapter(uint16_t devId) {
+  auto it = _adapters.find(devId);
+  if (it == _adapters.end()) {
+    Adapter a = {};
+    a.load.devId = devId;
+    it = _adapters.emplace(devId, a).first;
+  }
+  return it->second;
+}
+
+void BluetoothHciConnectionRouter::observe(uint16_t devId, bool outgoing, const uint8_t* data, size_t length) {
+  if (length < 1) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  uint8_t type = data[0];
+
+  if (outgoing && type == HCI_COMMAND_PKT) {
+    this->onCommand(this->adapter(devId), data, length);
+  } else if (outgoing && type == HCI_ACLDATA_PKT) {
+    this->adapter(devId).load.aclInFlight++;
+  } else if (!outgoing && type == HCI_EVENT_PKT) {
+    this->onEvent(this->adapter(devId), data, length);
+  }
+}
+
+void BluetoothHciConnectionRouter::onCommand(Adapter& a, const uint8_t* data, size_t length) {
+  if (length < 4) {
+    return;
+  }
+
+  uint16_t opcode = data[1] | (data[2] << 8);
+
+  if (opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) {
+    a.load.pending++;
+  } else if (opcode == HCI_RESET) {
+    // The controller drops every link on reset
+    a.connections.clear();
+    a.load.connections = 0;
+    a.load.pending = 0;
+    a.load.aclInFlight = 0;
+  }
+}
+
+void BluetoothHciConnectionRouter::onEvent(Adapter& a, const uint8_t* data, size_t length) {
+  if (length < 3) {
+    return;
+  }
+
+  uint8_t eventCode = data[1];
+  uint8_t plen = data[2];
+  if (length < static_cast<size_t>(plen) + 3) {
+    return;
+  }
+
+  if (eventCode == HCI_EV_CMD_STATUS && plen >= 4) {
+    uint8_t status = data[3];
+    uint16_t opcode = data[5] | (data[6] << 8);
+
+    if ((opcode == HCI_LE_CREATE_CONN || opcode == HCI_LE_EXT_CREATE_CONN) && status != HCI_SUCCESS) {
+      // Rejected outright, no Connection Complete will follow
+      if (a.load.pending > 0) a.load.pending--;
+      a.load.failuresTotal++;
+    }
+  } else if (eventCode == HCI_EV_CMD_COMPLETE && plen >= 4) {
+    uint16_t opcode = data[4] | (data[5] << 8);
+    uint8_t status = data[6];
+
+    if (status != HCI_SUCCESS) {
+      return;
+    }
+
+    if ((opcode == HCI_LE_READ_BUFFER_SIZE || opcode == HCI_LE_READ_BUFFER_SIZE_V2) && plen >= 7) {
+      uint16_t mtu = data[7] | (data[8] << 8);
+      if (mtu != 0) {
+        // Dedicated LE buffers take precedence over the shared BR/EDR ones
+        a.load.aclMtu = mtu;
+        a.load.aclBuffers = data[9];
+      }
+    } else if (opcode == HCI_READ_BUFFER_SIZE && plen >= 11 && a.load.aclMtu == 0) {
+      a.load.aclMtu = data[7] | (data[8] << 8);
+      a.load.aclBuffers = data[10] | (data[11] << 8);
+    }
+  } else if (eventCode == HCI_EV_LE_META && plen >= 1) {
+    uint8_t subEventCode = data[3];
+
+    if ((subEventCode == HCI_EV_LE_CONN_COMPLETE && plen >= 19) ||
+        (subEventCode == HCI_EV_LE_ENH_CONN_COMPLETE && plen >= 31)) {
+      this->onConnectionComplete(a, data[4], data[5] | (data[6] << 8), &data[9]);
+    }
+  } else if (eventCode == HCI_EV_DISCONN_COMPLETE && plen >= 4) {
+    uint8_t status = data[3];
+    uint16_t handle = (data[4] | (data[5] << 8)) & 0x0FFF;
+
+    if (status == HCI_SUCCESS && a.connections.erase(handle) > 0) {
+      a.load.connections = a.connections.size();
+    }
+  } else if (eventCode == HCI_EV_NUM_COMP_PKTS && plen >= 1) {
+    uint8_t numHandles = data[3];
+    uint32_t completed = 0;
+
+    // Handle/count pairs are interleaved
+    for (int i = 0; i < numHandles && 4 + i * 4 + 3 < static_cast<int>(plen) + 3; i++) {
+      completed += data[4 + i * 4 + 2] | (data[4 + i * 4 + 3] << 8);
+    }
+    a.load.aclInFlight -= std::min(a.load.aclInFlight, completed);
+  }
+}
+
+void BluetoothHciConnectionRouter::onConnectionComplete(Adapter& a, uint8_t status, uint16_t handle, const uint8_t* address) {
+  if (a.load.pending > 0) {
+    a.load.pending--;
+  }
+
+  if (status == HCI_SUCCESS) {
+    Connection c = {};
+    memcpy(c.address.b, address, sizeof(c.address.b));
+
+    a.connections[handle & 0x0FFF] = c;
+    a.load.connections = a.connections.size();
+    a.load.connectsTotal++;
+
+    _sticky[c.address] = a.load.devId;
+  } else if (status != HCI_ERR_UNKNOWN_CONN_ID) {
+    // Unknown Connection Identifier is what a cancelled attempt completes with
+    a.load.failuresTotal++;
+
+    if (status == HCI_ERR_CONN_LIMIT_EXCEEDED || status == HCI_ERR_MEMORY_EXCEEDED ||
+        status == HCI_ERR_LIMITED_RESOURCES) {
+      // The controller ran out of link slots; remember where its ceiling is
+      a.load.maxConnections = std::max<uint32_t>(a.load.connections, 1);
+    }
+  }
+}
+
+void BluetoothHciConnectionRouter::reset(uint16_t devId) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _adapters.erase(devId);
+}
+
+bool BluetoothHciConnectionRouter::hasCapacity(const Adapter& a) const {
+  return a.load.maxConnections == 0 || a.load.connections + a.load.pending < a.load.maxConnections;
+}
+
+bool BluetoothHciConnectionRouter::pick(const std::vector<uint16_t>& candidates, Policy policy, const bdaddr_t* address, uint16_t* devId) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // Candidates with capacity left, in the order given
+  std::vector<const Adapter*> usable;
+  usable.reserve(candidates.size());
+  for (uint16_t id : candidates) {
+    const Adapter& a = this->adapter(id);
+    if (this->hasCapacity(a)) {
+      usable.push_back(&a);
+    }
+  }
+
+  if (usable.empty()) {
+    return false;
+  }
+
+  if (policy == Sticky && address != nullptr) {
+    auto it = _sticky.find(*address);
+    if (it != _sticky.end()) {
+      for (const Adapter* a : usable) {
+        if (a->load.devId == it->second) {
+          *devId = it->second;
+          return true;
+        }
+      }
+    }
+    // Unknown or saturated: fall through to least connections
+  }
+
+  if (policy == RoundRobin) {
+    *devId = usable[_roundRobin++ % usable.size()]->load.devId;
+    return true;
+  }
+
+  const Adapter* best = usable[0];
+  for (const Adapter* a : usable) {
+    uint32_t load = a->load.connections + a->load.pending;
+    uint32_t bestLoad = best->load.connections + best->load.pending;
+
+    // Ties go to the adapter with the larger share of free ACL buffers
+    if (load < bestLoad ||
+        (load == bestLoad && a->load.aclBuffers != 0 && best->load.aclBuffers != 0 &&
+         static_cast<uint64_t>(a->load.aclInFlight) * best->load.aclBuffers <
+         static_cast<uint64_t>(best->load.aclInFlight) * a->load.aclBuffers)) {
+      best = a;
+    }
+  }
+
+  *devId = best->load.devId;
+  return true;
+}
+
+std::vector<HciAdapterLoad> BluetoothHciConnectionRouter::load() {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::vector<HciAdapterLoad> loads;
+  loads.reserve(_adapters.size());
+  for (const auto& it : _adapters) {
+    loads.push_back(it.second.load);
+  }
+  return loads;
+}
@@ -0,0 +1,156 @@
+#include "BluetoothHciControllerProbe.h"
+
+// Reads gated by the supported commands bitmask: octet and bit of each command
+struct HciSupportedRead {
+  uint16_t opcode;
+  uint8_t octet;
+  uint8_t bit;
+};
+
+static const HciSupportedRead kSupportedReads[] = {
+  { HCI_LE_READ_ACCEPT_LIST_SIZE, 26, 6 },
+  { HCI_LE_READ_SUPPORTED_STATES, 28, 3 },
+  { HCI_LE_READ_RESOLV_LIST_SIZE, 34, 6 },
+  { HCI_LE_READ_MAX_DATA_LEN, 35, 3 },
+  { HCI_LE_READ_MAX_ADV_DATA_LEN, 36, 6 },
+  { HCI_LE_READ_NUM_ADV_SETS, 36, 7 },
+  { HCI_LE_READ_TX_POWER, 38, 7 },
+};
+
+BluetoothHciControllerProbe::BluetoothHciControllerProbe(bool identityOnly) :
+  _credits(1),
+  _identityOnly(identityOnly)
+{
+  _steps.push_back({ HCI_READ_BD_ADDR, false, false, 0 });
+  _steps.push_back({ HCI_READ_LOCAL_VERSION, false, false, 0 });
+
+  if (!identityOnly) {
+    // Supported commands first, so the gated reads are queued as early as possible
+    _steps.push_back({ HCI_READ_LOCAL_COMMANDS, false, false, 0 });
+    _steps.push_back({ HCI_READ_LOCAL_FEATURES, false, false, 0 });
+    _steps.push_back({ HCI_READ_BUFFER_SIZE, false, false, 0 });
+    _steps.push_back({ HCI_LE_READ_LOCAL_FEATURES, false, false, 0 });
+  }
+}
+
+void BluetoothHciControllerProbe::take(std::vector<std::string>& commands) {
+  for (Step& step : _steps) {
+    if (_credits == 0) {
+      break;
+    }
+    if (!step.sent) {
+      // H4 type, opcode, no parameters
+      char command[4] = { HCI_COMMAND_PKT, static_cast<char>(step.opcode & 0xFF), static_cast<char>(step.opcode >> 8), 0 };
+      commands.emplace_back(command, sizeof(command));
+      step.sent = true;
+      auto host = _hostPending.find(step.opcode);
+      step.hostAhead = host != _hostPending.end() ? host->second : 0;
+      _credits--;
+    }
+  }
+}
+
+bool BluetoothHciControllerProbe::observe(const uint8_t* data, size_t length) {
+  uint16_t opcode;
+  uint8_t credits;
+  uint8_t status;
+  const uint8_t* params = nullptr;
+  size_t paramsLength = 0;
+
+  if (HciView<HciCmdCompleteLayout> complete{data, length}) {
+    credits = complete[HciCmdCompleteLayout::credits];
+    opcode = complete[HciCmdCompleteLayout::opcode];
+    status = complete[HciCmdCompleteLayout::status];
+    params = data + HciCmdCompleteLayout::returnParams;
+    paramsLength = 3u + data[2] - HciCmdCompleteLayout::returnParams;
+  } else if (HciView<HciCmdStatusLayout> commandStatus{data, length}) {
+    // Only sent for the probe's reads when they fail
+    status = commandStatus[HciCmdStatusLayout::status];
+    credits = commandStatus[HciCmdStatusLayout::credits];
+    opcode = commandStatus[HciCmdStatusLayout::opcode];
+  } else {
+    return false;
+  }
+
+  // Credits apply whichever command completed
+  _credits = credits;
+
+  for (Step& step : _steps) {
+    if (step.opcode != opcode || !step.sent || step.complete) {
+      continue;
+    }
+    if (step.hostAhead > 0) {
+      // A host command sent before the probe's completes first
+      step.hostAhead--;
+      break;
+    }
+
+    step.complete = true;
+    if (status == HCI_SUCCESS && params) {
+      _results[opcode].assign(reinterpret_cast<const char*>(params), paramsLength);
+      if (opcode == HCI_READ_LOCAL_COMMANDS && !_identityOnly) {
+        this->queueSupported(_results[opcode]);
+      }
+    }
+    return true;
+  }
+
+  auto host = _hostPending.find(opcode);
+  if (host != _hostPending.end() && --host->second == 0) {
+    _hostPending.erase(host);
+  }
+  return false;
+}
+
+void BluetoothHciControllerProbe::observeCommand(const uint8_t* data, size_t length) {
+  if (length < 4 || data[0] != HCI_COMMAND_PKT) {
+    return;
+  }
+
+  uint16_t opcode = data[1] | (data[2] << 8);
+  if (this->issues(opcode)) {
+    _hostPending[opcode]++;
+  }
+}
+
+bool BluetoothHciControllerProbe::issues(uint16_t opcode) {
+  static const uint16_t kReads[] = {
+    HCI_READ_BD_ADDR, HCI_READ_LOCAL_VERSION, HCI_READ_LOCAL_COMMANDS, HCI_READ_LOCAL_FEATURES,
+    HCI_READ_BUFFER_SIZE, HCI_LE_READ_LOCAL_FEATURES, HCI_LE_READ_BUFFER_SIZE, HCI_LE_READ_BUFFER_SIZE_V2,
+  };
+  for (uint16_t read : kReads) {
+    if (read == opcode) {
+      return true;
+    }
+  }
+  for (const HciSupportedRead& read : kSupportedReads) {
+    if (read.opcode == opcode) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BluetoothHciControllerProbe::queueSupported(const std::string& commands) {
+  auto supported = [&commands](uint8_t octet, uint8_t bit) {
+    return octet < commands.size() && ((static_cast<uint8_t>(commands[octet]) >> bit) & 1);
+  };
+
+  // The v2 buffer size adds the ISO buffers; either one gives the LE ACL buffers
+  _steps.push_back({ static_cast<uint16_t>(supported(41, 5) ? HCI_LE_READ_BUFFER_SIZE_V2 : HCI_LE_READ_BUFFER_SIZE), false, false, 0 });
+
+  for (const HciSupportedRead& read : kSupportedReads) {
+    if (supported(read.octet, read.bit)) {
+      _steps.push_back({ read.opcode, false, false, 0 });
+    }
+  }
+}
+
+bool BluetoothHciControllerProbe::done() const {
+  for (const Step& step : _steps) {
+    if (!step.complete) {
+      return false;
+    }
+  }
+  return true;
+}
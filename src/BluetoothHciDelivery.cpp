@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <chrono>
+
+#include "BluetoothHciDelivery.h"
+#include "BluetoothStructs.h"
+
+const char* const BluetoothHciDelivery::kLaneNames[kLanes] = { "control", "data", "bulk" };
+
+static uint64_t MonotonicNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BluetoothHciDelivery::BluetoothHciDelivery() :
+  _identityGeneration(0),
+  _started(false),
+  _weights{ kMaxBatch, 16, 4 },   // Control drains first, bulk yields to data
+  _limits{ 0, 0, 0 },             // Nothing is dropped unless a limit is set
+  _stats{},
+  _scheduled(false),
+  _bounded(false),
+  _credit(0),
+  _stalls(0),
+  _stalledNanos(0)
+{}
+
+void BluetoothHciDelivery::start(Napi::Env env, Napi::Object target, const char* resourceName) {
+  // Store weak reference to the JS object
+  this->_target = Napi::Reference<Napi::Object>::New(target);
+
+  // Looked up once instead of per batch
+  this->_emit = Napi::Persistent(target.Get("emit").As<Napi::Function>());
+  this->_dataEvent = Napi::Persistent(Napi::String::New(env, "data"));
+
+  // Create a thread-safe function for safely calling JS from a background thread
+  this->_tsfn = Napi::ThreadSafeFunction::New(
+    env,
+    target.Get("emit").As<Napi::Function>(),  // JavaScript `emit` function
+    resourceName,         // Resource name for debugging
+    0,                    // Unlimited queue
+    1                     // Only one thread will use this tsfn
+  );
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    for (const HciDeliveryItem& item : this->_lanes[lane]) {
+      this->grant((item.flags & Counted) ? 1 : 0);
+    }
+    this->_lanes[lane].clear();
+    this->_stats[lane] = HciDeliveryLaneStats{};
+  }
+  this->_scheduled = false;
+  this->_started = true;
+}
+
+void BluetoothHciDelivery::stop() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!this->_started) {
+    return;
+  }
+  this->_started = false;
+
+  // Calls made before the release still run, so the final drain flushes the queue
+  if (this->queued() > 0 && !this->_scheduled) {
+    this->_scheduled = true;
+    this->schedule();
+  }
+  this->_tsfn.Release();  // Release the thread-safe function after stopping the thread
+}
+
+void BluetoothHciDelivery::push(std::string data, uint16_t devId, const char* direction, HciRpaMatch identity,
+                                std::vector<uint32_t> matches) {
+  HciDeliveryItem item;
+  item.data = std::move(data);
+  item.devId = devId;
+  item.direction = direction;
+  item.identity = identity;
+  item.matches = std::move(matches);
+  item.lane = Classify(item.data);
+  item.flags = Droppable;
+  this->enqueue(std::move(item));
+}
+
+void BluetoothHciDelivery::push(std::function<void(Napi::Env, Napi::Object)> emit, Lane lane, uint8_t flags) {
+  HciDeliveryItem item;
+  item.devId = 0xFFFF;
+  item.direction = nullptr;
+  item.emit = std::move(emit);
+  item.lane = lane;
+  item.flags = flags;
+  this->enqueue(std::move(item));
+}
+
+BluetoothHciDelivery::Lane BluetoothHciDelivery::Classify(const std::string& data) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+  if (data.empty()) {
+    return Data;
+  }
+
+  switch (p[0]) {
+    case HCI_COMMAND_PKT:
+      return Control;
+    case HCI_EVENT_PKT:
+      break;
+    default:
+      return Data;
+  }
+
+  if (data.length() < 2) {
+    return Control;
+  }
+
+  // Events that open, secure, credit or close a link share the data lane so they
+  // keep their order against each other and against the link's data
+  switch (p[1]) {
+    case HCI_EV_CONN_COMPLETE:
+    case HCI_EV_DISCONN_COMPLETE:
+    case HCI_EV_ENCRYPT_CHANGE:
+    case HCI_EV_ENCRYPT_KEY_REFRESH:
+    case HCI_EV_ENCRYPT_CHANGE_V2:
+    case HCI_EV_NUM_COMP_PKTS:
+      return Data;
+    case HCI_EV_INQUIRY_RESULT:
+    case HCI_EV_INQUIRY_RESULT_WITH_RSSI:
+    case HCI_EV_EXTENDED_INQUIRY_RESULT:
+      return Bulk;
+    case HCI_EV_LE_META:
+      if (data.length() < 4) {
+        return Control;
+      }
+      switch (p[3]) {
+        case HCI_EV_LE_ADVERTISING_REPORT:
+        case HCI_EV_LE_DIRECT_ADVERTISING_REPORT:
+        case HCI_EV_LE_EXT_ADVERTISING_REPORT:
+        case HCI_EV_LE_PERIODIC_ADVERTISING_REPORT:
+          return Bulk;
+        case HCI_EV_LE_CONN_COMPLETE:
+        case HCI_EV_LE_CONN_UPDATE_COMPLETE:
+        case HCI_EV_LE_REMOTE_FEATURES:
+        case HCI_EV_LE_LTK_REQUEST:
+        case HCI_EV_LE_DATA_LENGTH_CHANGE:
+        case HCI_EV_LE_ENH_CONN_COMPLETE:
+        case HCI_EV_LE_PHY_UPDATE_COMPLETE:
+        case HCI_EV_LE_CIS_ESTABLISHED:
+        case HCI_EV_LE_CREATE_BIG_COMPLETE:
+        case HCI_EV_LE_TERMINATE_BIG_COMPLETE:
+        case HCI_EV_LE_BIG_SYNC_ESTABLISHED:
+        case HCI_EV_LE_BIG_SYNC_LOST:
+        case HCI_EV_LE_ENH_CONN_COMPLETE_V2:
+          return Data;
+        default:
+          return Control;
+      }
+    default:
+      return Control;
+  }
+}
+
+size_t BluetoothHciDelivery::queued() const {
+  size_t total = 0;
+  for (const auto& lane : this->_lanes) {
+    total += lane.size();
+  }
+  return total;
+}
+
+void BluetoothHciDelivery::enqueue(HciDeliveryItem item) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!this->_started) {
+    return;
+  }
+
+  // A full lane sheds new droppable items rather than delaying everything behind it
+  uint8_t lane = item.lane < kLanes ? item.lane : static_cast<uint8_t>(Data);
+  if ((item.flags & Droppable) && this->_limits[lane] > 0 && this->_lanes[lane].size() >= this->_limits[lane]) {
+    this->_stats[lane].dropped++;
+    return;
+  }
+
+  // Packets for "data" events take a credit while bounded
+  if (!item.emit && this->_bounded.load(std::memory_order_relaxed)) {
+    item.flags |= Counted;
+    if (this->_credit.fetch_sub(1, std::memory_order_relaxed) == 1) {
+      this->_stalls.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  item.enqueued = MonotonicNanos();
+  this->_lanes[lane].push_back(std::move(item));
+
+  // A drain is already on its way and will pick this item up
+  if (!this->_scheduled) {
+    this->_scheduled = true;
+    this->schedule();
+  }
+}
+
+void BluetoothHciDelivery::schedule() {
+  this->_tsfn.NonBlockingCall([this](Napi::Env env, Napi::Function) {
+    this->drain(env);
+  });
+}
+
+void BluetoothHciDelivery::drain(Napi::Env env) {
+  Napi::HandleScope scope(env);  // Handle scope for managing lifetime of JS objects
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Once stopped this is the final call, so everything left is delivered
+    size_t budget = this->_started ? kMaxBatch : this->queued();
+    uint64_t now = MonotonicNanos();
+    this->_batch.clear();
+
+    // Weighted rounds over the lanes, highest priority first
+    bool progress = true;
+    while (progress && this->_batch.size() < budget) {
+      progress = false;
+      for (size_t lane = 0; lane < kLanes; lane++) {
+        std::deque<HciDeliveryItem>& queue = this->_lanes[lane];
+        for (size_t quota = this->_weights[lane]; quota > 0 && !queue.empty() && this->_batch.size() < budget; quota--) {
+          // A barrier waits for every other lane to empty, e.g. "close" after the last packet
+          if ((queue.front().flags & Barrier) && this->queued() > queue.size()) {
+            break;
+          }
+
+          HciDeliveryLaneStats& stats = this->_stats[lane];
+          uint64_t delay = now > queue.front().enqueued ? now - queue.front().enqueued : 0;
+          stats.delivered++;
+          stats.delayTotal += delay;
+          stats.delayCount++;
+          stats.delayMax = std::max(stats.delayMax, delay);
+
+          this->_batch.push_back(std::move(queue.front()));
+          queue.pop_front();
+          progress = true;
+        }
+      }
+    }
+
+    // Only barriers left, or the final call: release what remains in lane order
+    for (size_t lane = 0; lane < kLanes && (this->_batch.empty() || !this->_started); lane++) {
+      while (!this->_lanes[lane].empty() && (this->_batch.empty() || !this->_started)) {
+        this->_batch.push_back(std::move(this->_lanes[lane].front()));
+        this->_lanes[lane].pop_front();
+        this->_stats[lane].delivered++;
+      }
+    }
+
+    // Leftovers get their own call so a flood cannot starve the event loop
+    this->_scheduled = this->queued() > 0;
+    if (this->_scheduled) {
+      this->schedule();
+    }
+  }
+
+  if (this->_target.IsEmpty()) {
+    for (const HciDeliveryItem& item : this->_batch) {
+      this->grant((item.flags & Counted) ? 1 : 0);
+    }
+    return;
+  }
+
+  Napi::Object target = this->_target.Value();
+  Napi::Function emit = this->_emit.Value();
+  Napi::String dataEvent = this->_dataEvent.Value();
+
+  for (HciDeliveryItem& item : this->_batch) {
+    if (item.emit) {
+      item.emit(env, target);
+      continue;
+    }
+
+    Napi::Buffer<char> buffer = Napi::Buffer<char>::Copy(env, item.data.data(), item.data.length());
+
+    // Packets of a type with a direct handler bypass EventEmitter dispatch
+    uint8_t type = item.data.empty() ? 0 : static_cast<uint8_t>(item.data[0]);
+    Napi::FunctionReference* handler = type < kHandlerSlots && !this->_handlers[type].IsEmpty() ? &this->_handlers[type] : nullptr;
+
+    // Only "data" events reach the credit's consumer
+    if (handler && (item.flags & Counted)) {
+      this->grant(1);
+    }
+
+    if (item.direction != nullptr || item.identity || !item.matches.empty()) {
+      // Packets read from the monitor channel are tagged with their adapter and direction,
+      // packets from a resolved private address with its identity, and reports with their matches
+      Napi::Object meta = Napi::Object::New(env);
+      if (item.direction != nullptr) {
+        meta.Set("devId", Napi::Number::New(env, item.devId));
+        meta.Set("direction", Napi::String::New(env, item.direction));
+      }
+      if (item.identity) {
+        meta.Set("identity", this->identity(env, item.identity));
+      }
+      if (!item.matches.empty()) {
+        meta.Set("matches", Ids(env, item.matches));
+      }
+      if (handler) {
+        handler->Value().Call(target, { buffer, meta });
+      } else {
+        emit.Call(target, { dataEvent, buffer, meta });
+      }
+    } else if (handler) {
+      handler->Value().Call(target, { buffer });
+    } else {
+      emit.Call(target, { dataEvent, buffer });
+    }
+  }
+  this->_batch.clear();
+}
+
+void BluetoothHciDelivery::setCredit(int64_t credit) {
+  {
+    std::lock_guard<std::mutex> lock(this->_creditMutex);
+    this->_bounded = credit >= 0;
+    this->_credit = credit >= 0 ? credit : 0;
+  }
+  this->_creditCondition.notify_all();
+}
+
+void BluetoothHciDelivery::grant(int64_t packets) {
+  if (packets <= 0) {
+    return;
+  }
+  // Taken under the lock so the waiter cannot miss the notification between its check and its wait
+  {
+    std::lock_guard<std::mutex> lock(this->_creditMutex);
+    this->_credit.fetch_add(packets, std::memory_order_relaxed);
+  }
+  this->_creditCondition.notify_all();
+}
+
+void BluetoothHciDelivery::waitCredit(int timeoutMs) {
+  std::unique_lock<std::mutex> lock(this->_creditMutex);
+  if (this->hasCredit()) {
+    return;
+  }
+
+  uint64_t start = MonotonicNanos();
+  this->_creditCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return this->hasCredit(); });
+  this->_stalledNanos.fetch_add(MonotonicNanos() - start, std::memory_order_relaxed);
+}
+
+void BluetoothHciDelivery::creditStats(Napi::Env env, Napi::Object stats) {
+  if (this->_bounded) {
+    stats.Set("credit", Napi::Number::New(env, static_cast<double>(this->_credit.load())));
+  } else {
+    stats.Set("credit", env.Null());
+  }
+  stats.Set("stalls", Napi::Number::New(env, static_cast<double>(this->_stalls.load())));
+  stats.Set("stalledTime", Napi::Number::New(env, this->_stalledNanos.load() / 1e6));
+}
+
+void BluetoothHciDelivery::setIdentities(Napi::Value identities, uint32_t generation) {
+  if (identities.IsArray()) {
+    this->_identities = Napi::Persistent(identities.As<Napi::Array>());
+  } else {
+    this->_identities.Reset();
+  }
+  this->_identityGeneration = generation;
+}
+
+Napi::Value BluetoothHciDelivery::identity(Napi::Env env, HciRpaMatch match) {
+  // Matches queued before the list was replaced refer to the old indices
+  if (!match || match.generation != this->_identityGeneration || this->_identities.IsEmpty()) {
+    return env.Undefined();
+  }
+  return this->_identities.Value().Get(static_cast<uint32_t>(match.index));
+}
+
+Napi::Array BluetoothHciDelivery::Ids(Napi::Env env, const std::vector<uint32_t>& ids) {
+  Napi::Array array = Napi::Array::New(env, ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    array.Set(static_cast<uint32_t>(i), Napi::Number::New(env, ids[i]));
+  }
+  return array;
+}
+
+void BluetoothHciDelivery::setHandlers(Napi::Value handlers) {
+  for (Napi::FunctionReference& handler : this->_handlers) {
+    handler.Reset();
+  }
+
+  if (!handlers.IsObject()) {
+    return;
+  }
+
+  Napi::Object object = handlers.As<Napi::Object>();
+  const struct { const char* name; uint8_t type; } slots[] = {
+    { "command", 0x01 },  // HCI_COMMAND_PKT
+    { "acl", 0x02 },      // HCI_ACLDATA_PKT
+    { "event", 0x04 },    // HCI_EVENT_PKT
+    { "iso", 0x05 }       // HCI_ISODATA_PKT
+  };
+
+  for (const auto& slot : slots) {
+    Napi::Value value = object.Get(slot.name);
+    if (value.IsFunction()) {
+      this->_handlers[slot.type] = Napi::Persistent(value.As<Napi::Function>());
+    }
+  }
+}
+
+void BluetoothHciDelivery::setLanes(Napi::Object options) {
+  Napi::Env env = options.Env();
+
+  // Validate everything before applying anything
+  size_t weights[kLanes];
+  size_t limits[kLanes];
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::copy(std::begin(this->_weights), std::end(this->_weights), weights);
+    std::copy(std::begin(this->_limits), std::end(this->_limits), limits);
+  }
+
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    Napi::Value entry = options.Get(kLaneNames[lane]);
+    if (entry.IsUndefined()) {
+      continue;
+    }
+    if (!entry.IsObject()) {
+      Napi::TypeError::New(env, std::string(kLaneNames[lane]) + " must be an object").ThrowAsJavaScriptException();
+      return;
+    }
+
+    Napi::Object settings = entry.As<Napi::Object>();
+    Napi::Value weight = settings.Get("weight");
+    if (!weight.IsUndefined()) {
+      if (!weight.IsNumber() || weight.As<Napi::Number>().DoubleValue() < 1) {
+        Napi::TypeError::New(env, std::string(kLaneNames[lane]) + ".weight must be a positive number").ThrowAsJavaScriptException();
+        return;
+      }
+      weights[lane] = std::min<size_t>(weight.As<Napi::Number>().Uint32Value(), kMaxBatch);
+    }
+
+    Napi::Value limit = settings.Get("limit");
+    if (!limit.IsUndefined()) {
+      if (!limit.IsNumber() || limit.As<Napi::Number>().DoubleValue() < 0) {
+        Napi::TypeError::New(env, std::string(kLaneNames[lane]) + ".limit must be a non-negative number").ThrowAsJavaScriptException();
+        return;
+      }
+      limits[lane] = limit.As<Napi::Number>().Uint32Value();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::copy(std::begin(weights), std::end(weights), this->_weights);
+  std::copy(std::begin(limits), std::end(limits), this->_limits);
+}
+
+Napi::Object BluetoothHciDelivery::stats(Napi::Env env) {
+  Napi::Object result = Napi::Object::New(env);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    HciDeliveryLaneStats& stats = this->_stats[lane];
+
+    // Delays are reported in microseconds
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("depth", Napi::Number::New(env, this->_lanes[lane].size()));
+    entry.Set("weight", Napi::Number::New(env, this->_weights[lane]));
+    entry.Set("limit", Napi::Number::New(env, this->_limits[lane]));
+    entry.Set("delivered", Napi::Number::New(env, static_cast<double>(stats.delivered)));
+    entry.Set("dropped", Napi::Number::New(env, static_cast<double>(stats.dropped)));
+    entry.Set("averageDelay", Napi::Number::New(env, stats.delayCount ? stats.delayTotal / 1000.0 / stats.delayCount : 0));
+    entry.Set("maxDelay", Napi::Number::New(env, stats.delayMax / 1000.0));
+    result.Set(kLaneNames[lane], entry);
+
+    stats.delayTotal = 0;
+    stats.delayCount = 0;
+    stats.delayMax = 0;
+  }
+  return result;
+}
+
+void BluetoothHciDelivery::Emit(Napi::Object target, const std::initializer_list<napi_value>& args) {
+  target.Get("emit").As<Napi::Function>().Call(target, args);
+}
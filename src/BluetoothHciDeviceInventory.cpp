@@ -0,0 +1,143 @@
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "BluetoothHciDeviceInventory.h"
+
+BluetoothHciDeviceInventory::BluetoothHciDeviceInventory() :
+  _socket(-1),
+  _loaded(false),
+  _live(false)
+{}
+
+BluetoothHciDeviceInventory::~BluetoothHciDeviceInventory() {
+  if (this->_socket >= 0) {
+    close(this->_socket);
+    this->_socket = -1;
+  }
+}
+
+bool BluetoothHciDeviceInventory::ensureLoaded() {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // Without index notifications the cached list could be stale, so it is read again
+  if (_loaded && _live) {
+    return true;
+  }
+
+  if (this->_socket < 0) {
+    this->_socket = socket(AF_BLUETOOTH, SOCK_RAW | SOCK_CLOEXEC, BTPROTO_HCI);
+    if (this->_socket < 0) {
+      return false;
+    }
+  }
+
+  // The list is bounded by HCI_MAX_DEV so the request fits on the stack
+  struct {
+    struct hci_dev_list_req dl;
+    struct hci_dev_req dr[HCI_MAX_DEV];
+  } req = {};
+
+  req.dl.dev_num = HCI_MAX_DEV;
+
+  if (ioctl(this->_socket, HCIGETDEVLIST, &req) < 0) {
+    return false;
+  }
+
+  _devices.clear();
+  for (int i = 0; i < req.dl.dev_num && i < HCI_MAX_DEV; i++) {
+    HciDeviceEntry entry;
+    if (this->readDeviceInfo(req.dr[i].dev_id, &entry)) {
+      _devices[entry.devId] = entry;
+    }
+  }
+
+  _loaded = true;
+  return true;
+}
+
+void BluetoothHciDeviceInventory::setLive(bool live) {
+  this->_live = live;
+}
+
+BluetoothHciDeviceInventory::Change BluetoothHciDeviceInventory::update(uint16_t devId, HciDeviceEntry* entry) {
+  if (!this->ensureLoaded()) {
+    return None;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (!this->readDeviceInfo(devId, entry)) {
+    // The device vanished before we could query it
+    return _devices.erase(devId) > 0 ? Removed : None;
+  }
+
+  auto it = _devices.find(devId);
+  if (it == _devices.end()) {
+    _devices[devId] = *entry;
+    return Added;
+  }
+
+  if (it->second != *entry) {
+    it->second = *entry;
+    return Changed;
+  }
+
+  return None;
+}
+
+BluetoothHciDeviceInventory::Change BluetoothHciDeviceInventory::remove(uint16_t devId) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _devices.erase(devId) > 0 ? Removed : None;
+}
+
+std::vector<HciDeviceEntry> BluetoothHciDeviceInventory::list() {
+  this->ensureLoaded();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::vector<HciDeviceEntry> devices;
+  devices.reserve(_devices.size());
+  for (const auto& it : _devices) {
+    devices.push_back(it.second);
+  }
+  return devices;
+}
+
+bool BluetoothHciDeviceInventory::firstMatching(bool isUp, uint16_t* devId) {
+  this->ensureLoaded();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  for (const auto& it : _devices) {
+    if (it.second.isUp() == isUp) {
+      *devId = it.first;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BluetoothHciDeviceInventory::readDeviceInfo(uint16_t devId, HciDeviceEntry* entry) {
+  struct hci_dev_info di = {};
+  di.dev_id = devId;
+
+  if (this->_socket < 0 || ioctl(this->_socket, HCIGETDEVINFO, (void *)&di) < 0) {
+    return false;
+  }
+
+  memset(entry, 0, sizeof(*entry));
+  entry->devId = di.dev_id;
+  memcpy(entry->name, di.name, sizeof(di.name));
+  entry->address = di.bdaddr;
+  entry->bus = di.type & 0x0f;
+  entry->type = (di.type >> 4) & 0x03;
+  entry->flags = di.flags;
+  entry->aclMtu = di.acl_mtu;
+  entry->aclPkts = di.acl_pkts;
+  entry->scoMtu = di.sco_mtu;
+  entry->scoPkts = di.sco_pkts;
+  return true;
+}
@@ -0,0 +1,68 @@
+#include "BluetoothHciFramer.h"
+
+static uint8_t FixedPacketType(const Napi::CallbackInfo& info) {
+  if (info.Length() == 0 || info[0].IsUndefined()) {
+    return 0;
+  }
+  uint32_t type = info[0].IsNumber() ? info[0].As<Napi::Number>().Uint32Value() : UINT32_MAX;
+  if (type > BluetoothHciPacketFramer::IsoData) {
+    // Thrown rather than set pending: the framer member is built from the result
+    throw Napi::TypeError::New(info.Env(), "packetType must be 0 (H4 stream) or an HCI packet type 1-5");
+  }
+  return static_cast<uint8_t>(type);
+}
+
+BluetoothHciFramer::BluetoothHciFramer(const Napi::CallbackInfo& info) :
+  Napi::ObjectWrap<BluetoothHciFramer>(info),
+  _framer(FixedPacketType(info))
+{}
+
+Napi::Value BluetoothHciFramer::Push(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    Napi::TypeError::New(env, "push: expected a Buffer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Buffer<uint8_t> chunk = info[0].As<Napi::Buffer<uint8_t>>();
+  Napi::Array packets = Napi::Array::New(env);
+  uint32_t index = 0;
+
+  // Each packet is copied exactly once, straight into its own Buffer
+  this->_framer.push(chunk.Data(), chunk.Length(), [&](uint8_t type, const uint8_t* body, size_t length) {
+    Napi::Buffer<uint8_t> packet = Napi::Buffer<uint8_t>::New(env, length + 1);
+    packet.Data()[0] = type;
+    memcpy(packet.Data() + 1, body, length);
+    packets.Set(index++, packet);
+  });
+
+  return packets;
+}
+
+void BluetoothHciFramer::Reset(const Napi::CallbackInfo& info) {
+  this->_framer.reset();
+}
+
+Napi::Value BluetoothHciFramer::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("buffered", Napi::Number::New(env, this->_framer.buffered()));
+  stats.Set("desyncs", Napi::Number::New(env, this->_framer.desyncs()));
+  return stats;
+}
+
+Napi::Object BluetoothHciFramer::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  // Create the function for the class
+  Napi::Function func = DefineClass(env, "BluetoothHciFramer", {
+    InstanceMethod("push", &BluetoothHciFramer::Push),
+    InstanceMethod("reset", &BluetoothHciFramer::Reset),
+    InstanceMethod("getStats", &BluetoothHciFramer::GetStats)
+  });
+
+  exports.Set("BluetoothHciFramer", func);
+  return exports;
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include "BluetoothHciIso.h"
+#include "BluetoothStructs.h"
+
+// ISO data packet boundary flags
+#define ISO_PB_FIRST     0x00
+#define ISO_PB_CONTINUE  0x01
+#define ISO_PB_COMPLETE  0x02
+#define ISO_PB_LAST      0x03
+
+BluetoothHciIsoAssembler::BluetoothHciIsoAssembler() :
+  _mtu(0),
+  _dropped(0)
+{}
+
+void BluetoothHciIsoAssembler::reset() {
+  for (auto& entry : this->_partial) {
+    this->release(std::move(entry.second.sdu.data));
+  }
+  this->_partial.clear();
+}
+
+std::string BluetoothHciIsoAssembler::acquire() {
+  std::lock_guard<std::mutex> lock(_poolMutex);
+  if (this->_pool.empty()) {
+    std::string buffer;
+    buffer.reserve(HCI_MAX_FRAME_SIZE);
+    return buffer;
+  }
+  std::string buffer = std::move(this->_pool.back());
+  this->_pool.pop_back();
+  buffer.clear();
+  return buffer;
+}
+
+void BluetoothHciIsoAssembler::release(std::string buffer) {
+  std::lock_guard<std::mutex> lock(_poolMutex);
+  if (this->_pool.size() < kPoolSize && buffer.capacity() > 0) {
+    this->_pool.push_back(std::move(buffer));
+  }
+}
+
+void BluetoothHciIsoAssembler::learnMtu(const uint8_t* data, size_t length) {
+  // Command Complete: ncmd, opcode, status, parameters
+  if (length < 7 || data[1] != HCI_EV_CMD_COMPLETE) {
+    return;
+  }
+  uint16_t opcode = data[4] | (data[5] << 8);
+  if (opcode == HCI_LE_READ_BUFFER_SIZE_V2 && length >= 13 && data[6] == HCI_SUCCESS) {
+    // ACL length (2), ACL count (1), ISO length (2), ISO count (1)
+    this->_mtu = data[10] | (data[11] << 8);
+  }
+}
+
+bool BluetoothHciIsoAssembler::observe(const uint8_t* data, size_t length, const Callback& onSdu) {
+  if (length >= 1 && data[0] == HCI_EVENT_PKT) {
+    this->learnMtu(data, length);
+    return false;
+  }
+
+  // H4 type, handle and flags, data total length
+  if (length < 5 || data[0] != HCI_ISODATA_PKT) {
+    return false;
+  }
+
+  uint16_t handleFlags = data[1] | (data[2] << 8);
+  uint16_t connHandle = handleFlags & 0x0FFF;
+  uint8_t pb = (handleFlags >> 12) & 0x03;
+  bool ts = (handleFlags >> 14) & 0x01;
+  size_t dlen = std::min<size_t>((data[3] | (data[4] << 8)) & 0x3FFF, length - 5);
+  const uint8_t* payload = data + 5;
+
+  if (pb == ISO_PB_FIRST || pb == ISO_PB_COMPLETE) {
+    // A new SDU abandons whatever was in progress
+    auto stale = this->_partial.find(connHandle);
+    if (stale != this->_partial.end()) {
+      this->release(std::move(stale->second.sdu.data));
+      this->_dropped += !stale->second.overrun;
+      this->_partial.erase(stale);
+    }
+
+    // Optional time stamp, sequence number, SDU length and packet status
+    size_t header = (ts ? 4 : 0) + 4;
+    if (dlen < header) {
+      return true;
+    }
+
+    Partial partial;
+    partial.sdu.connHandle = connHandle;
+    partial.sdu.hasTimestamp = ts;
+    partial.sdu.timestamp = ts ? (payload[0] | (payload[1] << 8) | (payload[2] << 16) | (static_cast<uint32_t>(payload[3]) << 24)) : 0;
+    const uint8_t* load = payload + (ts ? 4 : 0);
+    partial.sdu.sequenceNumber = load[0] | (load[1] << 8);
+    uint16_t sduLength = load[2] | (load[3] << 8);
+    partial.sdu.status = (sduLength >> 14) & 0x03;
+    partial.expected = sduLength & 0x0FFF;
+    partial.overrun = false;
+    partial.sdu.data = this->acquire();
+    partial.sdu.data.append(reinterpret_cast<const char*>(payload + header), dlen - header);
+
+    if (pb == ISO_PB_COMPLETE) {
+      onSdu(partial.sdu);
+      this->release(std::move(partial.sdu.data));
+    } else {
+      if (partial.sdu.data.length() > partial.expected) {
+        // Longer than announced from the start
+        this->release(std::move(partial.sdu.data));
+        partial.sdu.data.clear();
+        partial.overrun = true;
+        this->_dropped++;
+      }
+      this->_partial.emplace(connHandle, std::move(partial));
+    }
+    return true;
+  }
+
+  auto it = this->_partial.find(connHandle);
+  if (it == this->_partial.end()) {
+    // Continuation of an SDU whose start was lost
+    if (pb == ISO_PB_LAST) {
+      this->_dropped++;
+    }
+    return true;
+  }
+
+  Partial& partial = it->second;
+  if (!partial.overrun && partial.sdu.data.length() + dlen > partial.expected) {
+    // Fragments beyond the announced length would grow the SDU without bound
+    this->release(std::move(partial.sdu.data));
+    partial.sdu.data.clear();
+    partial.overrun = true;
+    this->_dropped++;
+  }
+  if (partial.overrun) {
+    if (pb == ISO_PB_LAST) {
+      this->_partial.erase(it);
+    }
+    return true;
+  }
+
+  partial.sdu.data.append(reinterpret_cast<const char*>(payload), dlen);
+
+  if (pb == ISO_PB_LAST) {
+    if (partial.sdu.data.length() != partial.expected && partial.sdu.status == 0) {
+      partial.sdu.status = 1;  // Length mismatch: possibly invalid
+    }
+    onSdu(partial.sdu);
+    this->release(std::move(partial.sdu.data));
+    this->_partial.erase(it);
+  }
+  return true;
+}
+
+std::vector<std::string> BluetoothHciIsoAssembler::Fragment(uint16_t connHandle, const uint8_t* sdu, size_t length,
+                                                            uint16_t sequenceNumber, bool hasTimestamp, uint32_t timestamp,
+                                                            uint16_t mtu) {
+  std::vector<std::string> packets;
+  size_t header = (hasTimestamp ? 4 : 0) + 4;
+  if (mtu <= header) {
+    return packets;
+  }
+
+  size_t offset = 0;
+  bool first = true;
+
+  do {
+    size_t room = first ? mtu - header : mtu;
+    size_t n = std::min(room, length - offset);
+    bool last = offset + n >= length;
+
+    uint8_t pb = first ? (last ? ISO_PB_COMPLETE : ISO_PB_FIRST) : (last ? ISO_PB_LAST : ISO_PB_CONTINUE);
+    uint16_t handleFlags = (connHandle & 0x0FFF) | (pb << 12) | ((first && hasTimestamp) ? (1 << 14) : 0);
+    size_t dlen = n + (first ? header : 0);
+
+    std::string packet;
+    packet.reserve(5 + dlen);
+    packet.push_back(static_cast<char>(HCI_ISODATA_PKT));
+    packet.push_back(static_cast<char>(handleFlags & 0xFF));
+    packet.push_back(static_cast<char>(handleFlags >> 8));
+    packet.push_back(static_cast<char>(dlen & 0xFF));
+    packet.push_back(static_cast<char>((dlen >> 8) & 0x3F));
+
+    if (first) {
+      if (hasTimestamp) {
+        for (int i = 0; i < 4; i++) {
+          packet.push_back(static_cast<char>((timestamp >> (8 * i)) & 0xFF));
+        }
+      }
+      packet.push_back(static_cast<char>(sequenceNumber & 0xFF));
+      packet.push_back(static_cast<char>(sequenceNumber >> 8));
+      packet.push_back(static_cast<char>(length & 0xFF));
+      packet.push_back(static_cast<char>((length >> 8) & 0x0F));
+    }
+
+    packet.append(reinterpret_cast<const char*>(sdu + offset), n);
+    packets.push_back(std::move(packet));
+
+    offset += n;
+    first = false;
+  } while (offset < length);
+
+  return packets;
+}
@@ -0,0 +1,792 @@
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "BluetoothHciL2Channel.h"
+
+// SDUs read or sent per system call
+static constexpr unsigned int kSduBatch = 32;
+
+// Queued bytes at which write() asks the caller to wait for "drain"
+static constexpr size_t kDefaultHighWaterMark = 64 * 1024;
+
+static uint64_t MicrosSince(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point now) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(now - since).count();
+}
+
+BluetoothHciL2SduPool::Block* BluetoothHciL2SduPool::take() {
+  std::unique_ptr<Block> block;
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    if (!this->_free.empty()) {
+      block = std::move(this->_free.back());
+      this->_free.pop_back();
+    }
+  }
+
+  if (!block) {
+    block = std::make_unique<Block>();
+    block->data.reset(new char[this->_size]);
+  }
+
+  block->length = 0;
+  block->owner = this->shared_from_this();
+  return block.release();
+}
+
+void BluetoothHciL2SduPool::give(Block* block) {
+  // Keeps the pool alive until the block is back in it, or freed
+  std::shared_ptr<BluetoothHciL2SduPool> owner = std::move(block->owner);
+  std::unique_ptr<Block> held(block);
+
+  std::lock_guard<std::mutex> lock(owner->_mutex);
+  if (owner->_free.size() < kPoolSize) {
+    owner->_free.push_back(std::move(held));
+  }
+}
+
+BluetoothHciL2Channel::BluetoothHciL2Channel(const Napi::CallbackInfo& info) :
+  Napi::ObjectWrap<BluetoothHciL2Channel>(info),
+  _socket(-1),
+  _wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+  _state(Idle),
+  _peer(),
+  _rxMtu(0),
+  _txMtu(0),
+  _queuedBytes(0),
+  _highWaterMark(kDefaultHighWaterMark),
+  _needDrain(false),
+  _statsSince(std::chrono::steady_clock::now()),
+  _acceptSequence(0),
+  stopFlag(true)
+{}
+
+BluetoothHciL2Channel::~BluetoothHciL2Channel() {
+  this->StopThread();
+  if (this->_wake >= 0) {
+    close(this->_wake);
+  }
+}
+
+int BluetoothHciL2Channel::OpenSocket(Napi::Env env, Napi::Object options, uint16_t psm) {
+  sockaddr_l2 source = {};
+  source.l2_family = AF_BLUETOOTH;
+  source.l2_psm = htole16(psm);
+  source.l2_bdaddr_type = BDADDR_LE_PUBLIC;  // Any adapter; an LE type makes it an LE channel
+
+  if (options.Has("source") && options.Get("source").IsObject()) {
+    Napi::Object src = options.Get("source").As<Napi::Object>();
+    if (src.Has("address") && (!src.Get("address").IsString() || !ParseAddress(src.Get("address").As<Napi::String>().Utf8Value(), &source.l2_bdaddr))) {
+      Napi::TypeError::New(env, "source.address must be an address string").ThrowAsJavaScriptException();
+      return -1;
+    }
+    if (src.Has("addressType") && src.Get("addressType").IsString() && src.Get("addressType").As<Napi::String>().Utf8Value() == "random") {
+      source.l2_bdaddr_type = BDADDR_LE_RANDOM;
+    }
+  }
+
+  uint16_t mtu = 0;
+  if (options.Has("mtu") && !options.Get("mtu").IsUndefined()) {
+    int32_t value = options.Get("mtu").IsNumber() ? options.Get("mtu").As<Napi::Number>().Int32Value() : -1;
+    if (value < L2CAP_LE_MIN_MTU || value > 0xFFFF) {
+      Napi::TypeError::New(env, "mtu must be 23 to 65535").ThrowAsJavaScriptException();
+      return -1;
+    }
+    mtu = static_cast<uint16_t>(value);
+  }
+
+  uint8_t level = 0;
+  if (options.Has("security") && options.Get("security").IsString()) {
+    std::string security = options.Get("security").As<Napi::String>().Utf8Value();
+    level = security == "low" ? BT_SECURITY_LOW :
+            security == "medium" ? BT_SECURITY_MEDIUM :
+            security == "high" ? BT_SECURITY_HIGH :
+            security == "fips" ? BT_SECURITY_FIPS : 0;
+    if (level == 0) {
+      Napi::TypeError::New(env, "security must be 'low', 'medium', 'high' or 'fips'").ThrowAsJavaScriptException();
+      return -1;
+    }
+  }
+
+  int fd = socket(PF_BLUETOOTH, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, BTPROTO_L2CAP);
+  const char* syscall = "socket";
+
+  if (fd >= 0) {
+    syscall = "bind";
+    if (bind(fd, reinterpret_cast<sockaddr*>(&source), sizeof(source)) == 0) {
+      syscall = "setsockopt";
+      bt_security sec = { level, 0 };
+      // The receive MTU is only settable once bound to an LE address
+      if ((mtu == 0 || setsockopt(fd, SOL_BLUETOOTH, BT_RCVMTU, &mtu, sizeof(mtu)) == 0) &&
+          (level == 0 || setsockopt(fd, SOL_BLUETOOTH, BT_SECURITY, &sec, sizeof(sec)) == 0)) {
+        return fd;
+      }
+    }
+  }
+
+  Napi::Error error = Napi::Error::New(env, strerror(errno));
+  error.Set("syscall", Napi::String::New(env, syscall));
+  error.Set("errno", Napi::Number::New(env, errno));
+  if (fd >= 0) {
+    close(fd);
+  }
+  error.ThrowAsJavaScriptException();
+  return -1;
+}
+
+void BluetoothHciL2Channel::Connect(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "connect: expected { address, psm }").ThrowAsJavaScriptException();
+    return;
+  }
+  Napi::Object options = info[0].As<Napi::Object>();
+
+  sockaddr_l2 peer = {};
+  peer.l2_family = AF_BLUETOOTH;
+  peer.l2_bdaddr_type = BDADDR_LE_PUBLIC;
+  if (!options.Get("address").IsString() || !ParseAddress(options.Get("address").As<Napi::String>().Utf8Value(), &peer.l2_bdaddr)) {
+    Napi::TypeError::New(env, "connect: address must be an address string").ThrowAsJavaScriptException();
+    return;
+  }
+  if (options.Get("addressType").IsString() && options.Get("addressType").As<Napi::String>().Utf8Value() == "random") {
+    peer.l2_bdaddr_type = BDADDR_LE_RANDOM;
+  }
+
+  // LE PSMs are one octet: 0x01-0x7F fixed by the SIG, 0x80-0xFF dynamic
+  int32_t psm = options.Get("psm").IsNumber() ? options.Get("psm").As<Napi::Number>().Int32Value() : 0;
+  if (psm < 0x01 || psm > 0xFF) {
+    Napi::TypeError::New(env, "connect: psm must be 1 to 255").ThrowAsJavaScriptException();
+    return;
+  }
+  peer.l2_psm = htole16(static_cast<uint16_t>(psm));
+
+  size_t highWaterMark = kDefaultHighWaterMark;
+  if (options.Get("highWaterMark").IsNumber()) {
+    highWaterMark = options.Get("highWaterMark").As<Napi::Number>().Uint32Value();
+  }
+
+  this->StopThread();
+
+  int fd = this->OpenSocket(env, options, 0);
+  if (fd < 0) {
+    return;
+  }
+
+  // Completes in the channel's thread, which emits "connect" or "error"
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&peer), sizeof(peer)) < 0 && errno != EINPROGRESS) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    error.Set("syscall", Napi::String::New(env, "connect"));
+    error.Set("errno", Napi::Number::New(env, errno));
+    close(fd);
+    error.ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->_socket = fd;
+  this->_peer = peer;
+  this->_highWaterMark = highWaterMark;
+  this->StartThread(info, Connecting);
+}
+
+Napi::Value BluetoothHciL2Channel::Listen(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  Napi::Object options = info.Length() > 0 && info[0].IsObject() ? info[0].As<Napi::Object>() : Napi::Object::New(env);
+
+  // 0 lets the kernel pick a free dynamic PSM
+  int32_t psm = options.Get("psm").IsNumber() ? options.Get("psm").As<Napi::Number>().Int32Value() : 0;
+  if (psm < 0 || psm > 0xFF) {
+    Napi::TypeError::New(env, "listen: psm must be 0 to 255").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  int backlog = options.Get("backlog").IsNumber() ? options.Get("backlog").As<Napi::Number>().Int32Value() : 5;
+
+  this->StopThread();
+
+  int fd = this->OpenSocket(env, options, static_cast<uint16_t>(psm));
+  if (fd < 0) {
+    return env.Undefined();
+  }
+
+  sockaddr_l2 local = {};
+  socklen_t length = sizeof(local);
+  if (listen(fd, backlog) < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) < 0) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    error.Set("syscall", Napi::String::New(env, "listen"));
+    error.Set("errno", Napi::Number::New(env, errno));
+    close(fd);
+    error.ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  this->_socket = fd;
+  this->StartThread(info, Listening);
+  return Napi::Number::New(env, le16toh(local.l2_psm));
+}
+
+void BluetoothHciL2Channel::Adopt(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "adopt: expected a descriptor").ThrowAsJavaScriptException();
+    return;
+  }
+  int fd = info[0].As<Napi::Number>().Int32Value();
+
+  size_t highWaterMark = kDefaultHighWaterMark;
+  if (info.Length() > 1 && info[1].IsObject() && info[1].As<Napi::Object>().Get("highWaterMark").IsNumber()) {
+    highWaterMark = info[1].As<Napi::Object>().Get("highWaterMark").As<Napi::Number>().Uint32Value();
+  }
+
+  sockaddr_l2 peer = {};
+  socklen_t length = sizeof(peer);
+  if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0 || getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &length) < 0) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    error.Set("syscall", Napi::String::New(env, "adopt"));
+    error.Set("errno", Napi::Number::New(env, errno));
+    error.ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->StopThread();
+
+  this->_socket = fd;
+  this->_peer = peer;
+  this->_highWaterMark = highWaterMark;
+  this->StartThread(info, Open);
+}
+
+Napi::Value BluetoothHciL2Channel::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    Napi::TypeError::New(env, "write: expected a buffer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Buffer<char> buffer = info[0].As<Napi::Buffer<char>>();
+
+  // The kernel rejects SDUs over the peer's MTU; before the channel is open it is not known yet
+  uint16_t txMtu = this->_txMtu;
+  if (txMtu != 0 && buffer.Length() > txMtu) {
+    Napi::RangeError::New(env, "write: SDU exceeds the channel's MTU").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool below;
+  {
+    std::lock_guard<std::mutex> lock(this->_queueMutex);
+    this->_queue.push_back({ std::string(buffer.Data(), buffer.Length()), std::chrono::steady_clock::now() });
+    this->_queuedBytes += buffer.Length();
+    below = this->_queuedBytes < this->_highWaterMark;
+    if (!below) {
+      this->_needDrain = true;
+    }
+  }
+
+  this->Wake();
+  return Napi::Boolean::New(env, below);
+}
+
+void BluetoothHciL2Channel::SetThreadOptions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Takes effect when the channel's thread is next started
+  HciThreadOptions options;
+  if (BluetoothHciThread::Parse(info.Length() > 0 ? info[0] : env.Undefined(), options)) {
+    this->_threadOptions = options;
+  }
+}
+
+Napi::Value BluetoothHciL2Channel::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  Napi::Object stats = Napi::Object::New(env);
+  {
+    std::lock_guard<std::mutex> lock(this->_statsMutex);
+    Counters& c = this->_counters;
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - this->_statsSince).count();
+
+    stats.Set("rxBytes", Napi::Number::New(env, static_cast<double>(c.rxBytes)));
+    stats.Set("rxSdus", Napi::Number::New(env, static_cast<double>(c.rxSdus)));
+    stats.Set("txBytes", Napi::Number::New(env, static_cast<double>(c.txBytes)));
+    stats.Set("txSdus", Napi::Number::New(env, static_cast<double>(c.txSdus)));
+    stats.Set("rxThroughput", Napi::Number::New(env, seconds > 0 ? c.intervalRx / seconds : 0));
+    stats.Set("txThroughput", Napi::Number::New(env, seconds > 0 ? c.intervalTx / seconds : 0));
+    stats.Set("averageWriteLatency", Napi::Number::New(env, c.writes ? static_cast<double>(c.writeLatency) / c.writes : 0));
+    stats.Set("maxWriteLatency", Napi::Number::New(env, static_cast<double>(c.maxWriteLatency)));
+    stats.Set("averageDeliveryLatency", Napi::Number::New(env, c.deliveries ? static_cast<double>(c.deliveryLatency) / c.deliveries : 0));
+    stats.Set("maxDeliveryLatency", Napi::Number::New(env, static_cast<double>(c.maxDeliveryLatency)));
+
+    // Rates and latencies cover the interval since the previous call
+    c.intervalRx = c.intervalTx = 0;
+    c.writes = c.writeLatency = c.maxWriteLatency = 0;
+    c.deliveries = c.deliveryLatency = c.maxDeliveryLatency = 0;
+    this->_statsSince = now;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->_queueMutex);
+    stats.Set("queuedSdus", Napi::Number::New(env, static_cast<double>(this->_queue.size())));
+    stats.Set("queuedBytes", Napi::Number::New(env, static_cast<double>(this->_queuedBytes)));
+  }
+  stats.Set("rxMtu", Napi::Number::New(env, this->_rxMtu));
+  stats.Set("txMtu", Napi::Number::New(env, this->_txMtu));
+  return stats;
+}
+
+void BluetoothHciL2Channel::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+  this->StopThread();
+}
+
+void BluetoothHciL2Channel::StartThread(const Napi::CallbackInfo& info, State state) {
+  // SDUs and events are delivered to the JS object's `emit` function
+  this->_delivery.start(info.Env(), info.This().As<Napi::Object>(), "L2CAP Channel");
+
+  this->_state = state;
+  this->_rxMtu = 0;
+  this->_txMtu = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->_statsMutex);
+    this->_counters = Counters{};
+    this->_statsSince = std::chrono::steady_clock::now();
+  }
+
+  // Reset stop flag
+  stopFlag = false;
+  // Start the channel's thread; it applies its scheduling options to itself first
+  pollingThread = std::thread([this, options = this->_threadOptions]() {
+    BluetoothHciThread::Report(this->_delivery, BluetoothHciThread::Apply(options));
+    this->PollLoop();
+  });
+}
+
+void BluetoothHciL2Channel::StopThread() {
+  stopFlag = true;
+  this->Wake();
+  if (pollingThread.joinable()) {
+    pollingThread.join();
+  }
+
+  if (this->_socket >= 0) {
+    close(this->_socket);
+    this->_socket = -1;
+  }
+  this->_state = Idle;
+
+  // Accepted channels still queued for "accept" will not be adopted now
+  {
+    std::lock_guard<std::mutex> lock(this->_acceptedMutex);
+    for (const auto& entry : this->_accepted) {
+      close(entry.second);
+    }
+    this->_accepted.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(this->_queueMutex);
+  this->_queue.clear();
+  this->_queuedBytes = 0;
+  this->_needDrain = false;
+}
+
+void BluetoothHciL2Channel::Wake() {
+  if (this->_wake >= 0) {
+    uint64_t one = 1;
+    ssize_t ignored = write(this->_wake, &one, sizeof(one));
+    (void)ignored;
+  }
+}
+
+void BluetoothHciL2Channel::PollLoop() {
+  bool closed = false;
+  bool blocked = false;
+
+  // Adopted channels are open from the start
+  if (this->_state == Open) {
+    this->ReadMtus();
+  }
+
+  while (!stopFlag) {
+    bool pending;
+    {
+      std::lock_guard<std::mutex> lock(this->_queueMutex);
+      pending = !this->_queue.empty();
+    }
+
+    pollfd fds[2] = {};
+    fds[0].fd = this->_socket;
+    fds[0].events = this->_state == Connecting ? POLLOUT :
+                    this->_state == Listening ? POLLIN :
+                    POLLIN | (pending && blocked ? POLLOUT : 0);
+    fds[1].fd = this->_wake;
+    fds[1].events = POLLIN;
+
+    // Writes are tried as soon as they are queued, so only a full send buffer waits for POLLOUT
+    if (this->_state != Open || !pending || blocked) {
+      if (poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        this->PushError("poll", errno);
+        closed = true;
+        break;
+      }
+    } else {
+      poll(fds, 2, 0);
+    }
+
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      ssize_t ignored = read(this->_wake, &count, sizeof(count));
+      (void)ignored;
+    }
+    if (stopFlag) {
+      break;
+    }
+
+    short revents = fds[0].revents;
+    if (this->_state == Connecting) {
+      if (revents && !this->FinishConnect()) {
+        closed = true;
+        break;
+      }
+      continue;
+    }
+
+    if (this->_state == Listening) {
+      if (revents & POLLIN) {
+        this->AcceptChannels();
+      } else if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        closed = true;
+        break;
+      }
+      continue;
+    }
+
+    if (revents & POLLIN) {
+      if (!this->ReadSdus()) {
+        closed = true;
+        break;
+      }
+    } else if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      if (getsockopt(this->_socket, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error != 0) {
+        this->PushError("recv", error);
+      }
+      closed = true;
+      break;
+    }
+
+    if (revents & POLLOUT) {
+      blocked = false;
+    }
+    if (pending && !blocked && !this->SendQueued(blocked)) {
+      closed = true;
+      break;
+    }
+  }
+
+  if (closed && !stopFlag) {
+    this->_delivery.push([](Napi::Env env, Napi::Object target) {
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "close") });
+    }, BluetoothHciDelivery::Control, BluetoothHciDelivery::Barrier);
+  }
+
+  this->_delivery.stop();  // Release the thread-safe function after stopping the thread
+}
+
+bool BluetoothHciL2Channel::FinishConnect() {
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(this->_socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+    error = errno;
+  }
+  if (error != 0) {
+    this->PushError("connect", error);
+    return false;
+  }
+
+  this->_state = Open;
+  this->ReadMtus();
+
+  uint16_t rxMtu = this->_rxMtu;
+  uint16_t txMtu = this->_txMtu;
+  this->_delivery.push([rxMtu, txMtu](Napi::Env env, Napi::Object target) {
+    Napi::Object mtu = Napi::Object::New(env);
+    mtu.Set("rxMtu", Napi::Number::New(env, rxMtu));
+    mtu.Set("txMtu", Napi::Number::New(env, txMtu));
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "connect"), mtu });
+  }, BluetoothHciDelivery::Control);
+  return true;
+}
+
+void BluetoothHciL2Channel::ReadMtus() {
+  uint16_t rxMtu = 0;
+  uint16_t txMtu = 0;
+  socklen_t length = sizeof(rxMtu);
+  if (getsockopt(this->_socket, SOL_BLUETOOTH, BT_RCVMTU, &rxMtu, &length) < 0 || rxMtu == 0) {
+    rxMtu = L2CAP_LE_DEFAULT_MTU;
+  }
+  length = sizeof(txMtu);
+  if (getsockopt(this->_socket, SOL_BLUETOOTH, BT_SNDMTU, &txMtu, &length) < 0) {
+    txMtu = 0;
+  }
+
+  this->_rxMtu = rxMtu;
+  this->_txMtu = txMtu;
+  // Buffers still held by JS keep the previous pool alive
+  this->_pool = std::make_shared<BluetoothHciL2SduPool>(rxMtu);
+}
+
+void BluetoothHciL2Channel::AcceptChannels() {
+  for (;;) {
+    sockaddr_l2 peer = {};
+    socklen_t length = sizeof(peer);
+    int fd = accept4(this->_socket, reinterpret_cast<sockaddr*>(&peer), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        this->PushError("accept", errno);
+      }
+      return;
+    }
+
+    // Tagged with a sequence: once closed on stop, the descriptor number may be reused by a later accept
+    uint64_t sequence;
+    {
+      std::lock_guard<std::mutex> lock(this->_acceptedMutex);
+      sequence = this->_acceptSequence++;
+      this->_accepted[sequence] = fd;
+    }
+
+    // The JS side adopts the descriptor into a channel object of its own
+    std::string address = FormatAddress(peer.l2_bdaddr);
+    bool random = peer.l2_bdaddr_type == BDADDR_LE_RANDOM;
+    this->_delivery.push([this, sequence, fd, address, random](Napi::Env env, Napi::Object target) {
+      // Closed already if the channel was stopped while this was queued
+      {
+        std::lock_guard<std::mutex> lock(this->_acceptedMutex);
+        auto it = this->_accepted.find(sequence);
+        if (it == this->_accepted.end()) {
+          return;
+        }
+        this->_accepted.erase(it);
+      }
+
+      Napi::Object from = Napi::Object::New(env);
+      from.Set("address", Napi::String::New(env, address));
+      from.Set("addressType", Napi::String::New(env, random ? "random" : "public"));
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "accept"), Napi::Number::New(env, fd), from });
+    }, BluetoothHciDelivery::Control);
+  }
+}
+
+bool BluetoothHciL2Channel::ReadSdus() {
+  BluetoothHciL2SduPool::Block* blocks[kSduBatch];
+  mmsghdr messages[kSduBatch];
+  iovec vectors[kSduBatch];
+
+  for (unsigned int i = 0; i < kSduBatch; i++) {
+    blocks[i] = this->_pool->take();
+    vectors[i].iov_base = blocks[i]->data.get();
+    vectors[i].iov_len = this->_pool->size();
+    memset(&messages[i], 0, sizeof(messages[i]));
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // One SDU per message on a SOCK_SEQPACKET socket
+  int count = recvmmsg(this->_socket, messages, kSduBatch, MSG_DONTWAIT, nullptr);
+  int error = errno;
+  auto read = std::chrono::steady_clock::now();
+
+  bool open = true;
+  std::vector<BluetoothHciL2SduPool::Block*> batch;
+  uint64_t bytes = 0;
+  for (int i = 0; i < count; i++) {
+    // A zero length read is the end of the channel
+    if (messages[i].msg_len == 0) {
+      open = false;
+      break;
+    }
+    blocks[i]->length = messages[i].msg_len;
+    bytes += messages[i].msg_len;
+    batch.push_back(blocks[i]);
+  }
+  for (unsigned int i = batch.size(); i < kSduBatch; i++) {
+    BluetoothHciL2SduPool::give(blocks[i]);
+  }
+
+  if (count < 0 && error != EAGAIN && error != EWOULDBLOCK && error != EINTR) {
+    this->PushError("recvmmsg", error);
+    return false;
+  }
+
+  if (!batch.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(this->_statsMutex);
+      this->_counters.rxBytes += bytes;
+      this->_counters.rxSdus += batch.size();
+      this->_counters.intervalRx += bytes;
+    }
+
+    // The whole batch is one delivery item; each SDU's buffer wraps its pooled block
+    this->_delivery.push([this, batch = std::move(batch), read](Napi::Env env, Napi::Object target) {
+      uint64_t latency = MicrosSince(read, std::chrono::steady_clock::now());
+      {
+        std::lock_guard<std::mutex> lock(this->_statsMutex);
+        this->_counters.deliveries++;
+        this->_counters.deliveryLatency += latency;
+        this->_counters.maxDeliveryLatency = std::max(this->_counters.maxDeliveryLatency, latency);
+      }
+
+      Napi::String event = Napi::String::New(env, "data");
+      for (BluetoothHciL2SduPool::Block* block : batch) {
+        Napi::Buffer<char> sdu = Napi::Buffer<char>::NewOrCopy(env, block->data.get(), block->length,
+          [](Napi::Env, char*, BluetoothHciL2SduPool::Block* hint) { BluetoothHciL2SduPool::give(hint); }, block);
+        BluetoothHciDelivery::Emit(target, { event, sdu });
+      }
+    }, BluetoothHciDelivery::Data);
+  }
+
+  return open;
+}
+
+bool BluetoothHciL2Channel::SendQueued(bool& blocked) {
+  for (;;) {
+    mmsghdr messages[kSduBatch];
+    iovec vectors[kSduBatch];
+    unsigned int count = 0;
+    {
+      // Only this thread pops, and push_back keeps the references of a deque valid
+      std::lock_guard<std::mutex> lock(this->_queueMutex);
+      for (auto it = this->_queue.begin(); it != this->_queue.end() && count < kSduBatch; ++it, count++) {
+        vectors[count].iov_base = it->data.data();
+        vectors[count].iov_len = it->data.size();
+        memset(&messages[count], 0, sizeof(messages[count]));
+        messages[count].msg_hdr.msg_iov = &vectors[count];
+        messages[count].msg_hdr.msg_iovlen = 1;
+      }
+    }
+    if (count == 0) {
+      return true;
+    }
+
+    // EAGAIN when out of credits or send buffer; POLLOUT follows once the peer grants more
+    int sent = sendmmsg(this->_socket, messages, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        blocked = true;
+        return true;
+      }
+      this->PushError("sendmmsg", errno);
+      return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+    uint64_t latency = 0;
+    uint64_t maxLatency = 0;
+    bool drained = false;
+    {
+      std::lock_guard<std::mutex> lock(this->_queueMutex);
+      for (int i = 0; i < sent; i++) {
+        PendingSdu& sdu = this->_queue.front();
+        uint64_t micros = MicrosSince(sdu.queued, now);
+        latency += micros;
+        maxLatency = std::max(maxLatency, micros);
+        bytes += sdu.data.size();
+        this->_queuedBytes -= sdu.data.size();
+        this->_queue.pop_front();
+      }
+      if (this->_queue.empty() && this->_needDrain) {
+        this->_needDrain = false;
+        drained = true;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->_statsMutex);
+      this->_counters.txBytes += bytes;
+      this->_counters.txSdus += sent;
+      this->_counters.intervalTx += bytes;
+      this->_counters.writes += sent;
+      this->_counters.writeLatency += latency;
+      this->_counters.maxWriteLatency = std::max(this->_counters.maxWriteLatency, maxLatency);
+    }
+
+    if (drained) {
+      this->_delivery.push([](Napi::Env env, Napi::Object target) {
+        BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "drain") });
+      }, BluetoothHciDelivery::Data);
+    }
+  }
+}
+
+void BluetoothHciL2Channel::PushError(const char* syscall, int error) {
+  std::string name(syscall);
+  this->_delivery.push([name, error](Napi::Env env, Napi::Object target) {
+    Napi::Error err = Napi::Error::New(env, strerror(error));
+    err.Set("syscall", Napi::String::New(env, name));
+    err.Set("errno", Napi::Number::New(env, error));
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "error"), err.Value() });
+  }, BluetoothHciDelivery::Control);
+}
+
+bool BluetoothHciL2Channel::ParseAddress(const std::string& str, bdaddr_t* address) {
+  unsigned int b[6];
+  if (sscanf(str.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &b[5], &b[4], &b[3], &b[2], &b[1], &b[0]) != 6) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    address->b[i] = static_cast<uint8_t>(b[i]);
+  }
+  return true;
+}
+
+std::string BluetoothHciL2Channel::FormatAddress(const bdaddr_t& address) {
+  const uint8_t* a = address.b;
+  char str[18];
+  snprintf(str, sizeof(str), "%02x:%02x:%02x:%02x:%02x:%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+  return str;
+}
+
+Napi::Object BluetoothHciL2Channel::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  // Create the function for the class
+  Napi::Function func = DefineClass(env, "BluetoothHciL2Channel", {
+    InstanceMethod("connect", &BluetoothHciL2Channel::Connect),
+    InstanceMethod("listen", &BluetoothHciL2Channel::Listen),
+    InstanceMethod("adopt", &BluetoothHciL2Channel::Adopt),
+    InstanceMethod("write", &BluetoothHciL2Channel::Write),
+    InstanceMethod("setThreadOptions", &BluetoothHciL2Channel::SetThreadOptions),
+    InstanceMethod("getStats", &BluetoothHciL2Channel::GetStats),
+    InstanceMethod("close", &BluetoothHciL2Channel::Close)
+  });
+
+  exports.Set("BluetoothHciL2Channel", func);
+  return exports;
+}
@@ -0,0 +1,40 @@
+#include "BluetoothHciLinkParser.h"
+
+bool BluetoothHciLinkParser::ParseLinkEvent(const uint8_t* data, size_t length, HciLinkEvent& event) {
+  // Both connection layouts share handle, role, peer address type and peer address
+  return HciDispatch<HciLeConnCompleteLayout, HciLeEnhConnCompleteLayout, HciDisconnCompleteLayout>(data, length, [&event](auto view) {
+    using Layout = typename decltype(view)::Layout;
+
+    if (view[Layout::status] != HCI_SUCCESS) {
+      return false;
+    }
+
+    event.handle = view[Layout::handle] & 0x0FFF;
+    if constexpr (std::is_same_v<Layout, HciDisconnCompleteLayout>) {
+      event.type = HciLinkEvent::Disconnected;
+      event.peerType = 0;
+      memset(event.peer.b, 0, sizeof(event.peer.b));
+    } else {
+      event.type = HciLinkEvent::Connected;
+      event.peerType = view[Layout::peerType];
+      event.peer = view[Layout::peer];
+    }
+    return true;
+  });
+}
+
+bool BluetoothHciLinkParser::ParseCreateConnection(const uint8_t* data, size_t length, HciCreateConnection& command) {
+  // The extended command's parameters are those of the first initiating PHY
+  return HciDispatch<HciLeCreateConnLayout, HciLeExtCreateConnLayout>(data, length, [&command](auto view) {
+    using Layout = typename decltype(view)::Layout;
+
+    command.peerType = view[Layout::peerType];
+    command.peer = view[Layout::peer];
+    command.filterPolicy = view[Layout::filterPolicy];
+    command.connMinInterval = view[Layout::connMinInterval];
+    command.connMaxInterval = view[Layout::connMaxInterval];
+    command.connLatency = view[Layout::connLatency];
+    command.supervisionTimeout = view[Layout::supervisionTimeout];
+    return true;
+  });
+}
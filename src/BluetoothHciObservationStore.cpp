@@ -0,0 +1,571 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "BluetoothHciAdvertising.h"
+#include "BluetoothHciObservationStore.h"
+
+#define HCI_OBSERVATION_MAGIC   0x4F494348  ///< "HCIO"
+#define HCI_OBSERVATION_VERSION 1
+
+struct BluetoothHciObservationStore::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t start;             ///< Partition start, ms since the epoch
+  uint64_t end;               ///< Time of the last record
+  uint32_t records;           ///< Records written
+  uint32_t recordCapacity;    ///< Records the record area holds
+  uint32_t payloadOffset;     ///< File offset of the payload area
+  uint32_t payloadBytes;      ///< Payload bytes written
+  uint32_t payloadCapacity;   ///< Payload bytes the area holds
+  uint32_t indexOffset;       ///< File offset of the address index, 0 until sealed
+  uint32_t addresses;         ///< Index entries
+  uint32_t reserved[3];
+};
+
+struct BluetoothHciObservationStore::Record {
+  uint32_t time;              ///< Ms since the partition start
+  uint32_t payload;           ///< Offset in the payload area
+  uint16_t length;            ///< Payload length
+  uint16_t eventType;
+  uint8_t addressType;
+  uint8_t address[6];
+  int8_t rssi;
+};
+
+struct BluetoothHciObservationStore::IndexEntry {
+  uint64_t key;               ///< Key(address)
+  uint32_t first;             ///< First of its record numbers, after the entries
+  uint32_t count;             ///< Record numbers, in time order
+};
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+BluetoothHciObservationStore::BluetoothHciObservationStore() :
+  _isOpen(false),
+  _failing(false),
+  _retryAt(0),
+  _appended(0),
+  _deduplicated(0),
+  _dropped(0),
+  _pruned(0)
+{}
+
+BluetoothHciObservationStore::~BluetoothHciObservationStore() {
+  this->close();
+}
+
+uint64_t BluetoothHciObservationStore::Key(const uint8_t* address) {
+  uint64_t key = 0;
+  memcpy(&key, address, 6);
+  return key;
+}
+
+const BluetoothHciObservationStore::Header* BluetoothHciObservationStore::Validate(const uint8_t* base, size_t length) {
+  static_assert(sizeof(Header) == 64, "segment header layout");
+  static_assert(sizeof(Record) == 20, "segment record layout");
+  static_assert(sizeof(IndexEntry) == 16, "segment index layout");
+
+  if (length < sizeof(Header)) {
+    return nullptr;
+  }
+
+  const Header* h = reinterpret_cast<const Header*>(base);
+  if (h->magic != HCI_OBSERVATION_MAGIC || h->version != HCI_OBSERVATION_VERSION ||
+      h->records > h->recordCapacity || h->payloadBytes > h->payloadCapacity ||
+      sizeof(Header) + static_cast<uint64_t>(h->recordCapacity) * sizeof(Record) > h->payloadOffset ||
+      static_cast<uint64_t>(h->payloadOffset) + h->payloadCapacity > length) {
+    return nullptr;
+  }
+  if (h->indexOffset != 0 &&
+      (h->indexOffset < static_cast<uint64_t>(h->payloadOffset) + h->payloadBytes ||
+       h->indexOffset + static_cast<uint64_t>(h->addresses) * sizeof(IndexEntry) + static_cast<uint64_t>(h->records) * 4 > length)) {
+    return nullptr;
+  }
+  return h;
+}
+
+int BluetoothHciObservationStore::open(const std::string& directory, const Options& options, uint64_t now) {
+  this->close();
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+    return errno;
+  }
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return errno;
+  }
+
+  // Sealed segments are listed; segments left open by a crash are sealed first
+  std::vector<Segment> segments;
+  for (struct dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    Segment segment;
+    int consumed = 0;
+    if (sscanf(entry->d_name, "%" SCNu64 "-%" SCNu32 ".hcio%n", &segment.start, &segment.part, &consumed) != 2 ||
+        entry->d_name[consumed] != '\0') {
+      continue;
+    }
+    segment.path = directory + "/" + entry->d_name;
+
+    int fd = ::open(segment.path.c_str(), O_RDWR | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0) {
+      continue;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+      ::close(fd);
+      continue;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      ::close(fd);
+      continue;
+    }
+
+    const Header* h = Validate(static_cast<uint8_t*>(base), st.st_size);
+    if (h == nullptr || h->start != segment.start) {
+      munmap(base, st.st_size);
+      ::close(fd);
+    } else if (h->indexOffset == 0) {
+      if (Seal(fd, static_cast<uint8_t*>(base), st.st_size, segment) == 0) {
+        segments.push_back(segment);
+      }
+    } else {
+      segment.end = h->end;
+      segment.records = h->records;
+      segment.bytes = st.st_size;
+      munmap(base, st.st_size);
+      ::close(fd);
+      segments.push_back(segment);
+    }
+  }
+  closedir(dir);
+
+  std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+    return a.start != b.start ? a.start < b.start : a.part < b.part;
+  });
+
+  this->_directory = directory;
+  this->_options = options;
+  this->_options.segmentDuration = std::min<uint64_t>(std::max<uint64_t>(options.segmentDuration, 1000), 7 * 86400000ULL);
+  this->_options.segmentSize = std::min<size_t>(std::max<size_t>(options.segmentSize, 64 << 10), 1 << 30);
+  this->_segments = std::move(segments);
+  this->_failing = false;
+  this->_retryAt = 0;
+  this->_appended = 0;
+  this->_deduplicated = 0;
+  this->_dropped = 0;
+  this->_pruned = 0;
+  this->prune(now);
+  this->_isOpen = true;
+  return 0;
+}
+
+void BluetoothHciObservationStore::close() {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  this->seal();
+  this->_segments.clear();
+  this->_isOpen = false;
+}
+
+int BluetoothHciObservationStore::append(const std::string& encoded, uint64_t now) {
+  namespace L = HciAdvertisementLayout;
+
+  if (encoded.length() < L::HeaderLength) {
+    return 0;
+  }
+  const uint8_t* e = reinterpret_cast<const uint8_t*>(encoded.data());
+  size_t dataOffset = L::HeaderLength + e[L::AdCount] * L::EntryLength;
+  size_t dataLength = e[L::DataLength] | (e[L::DataLength + 1] << 8);
+  if (dataOffset + dataLength > encoded.length()) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  if (!this->_isOpen) {
+    return 0;
+  }
+
+  OpenSegment& open = this->_open;
+  std::string_view payload(encoded.data() + dataOffset, dataLength);
+  uint64_t time = now;
+  if (open.fd >= 0) {
+    Header* h = reinterpret_cast<Header*>(open.base);
+    time = std::max(time, h->end);
+
+    // A new partition, or a full segment, continues in a new file
+    bool stored = dataLength == 0 || open.payloads.count(payload) != 0;
+    if (time >= h->start + this->_options.segmentDuration || h->records == h->recordCapacity ||
+        (!stored && h->payloadBytes + dataLength > h->payloadCapacity)) {
+      this->seal();
+    }
+  }
+
+  if (open.fd < 0) {
+    if (this->_failing && now < this->_retryAt) {
+      this->_dropped++;
+      return 0;
+    }
+
+    int error = this->create(time);
+    if (error != 0) {
+      // Reported once per failure streak, retried at most once a second
+      bool first = !this->_failing;
+      this->_failing = true;
+      this->_retryAt = now + 1000;
+      this->_dropped++;
+      return first ? error : 0;
+    }
+    this->_failing = false;
+    this->prune(now);
+  }
+
+  Header* h = reinterpret_cast<Header*>(open.base);
+  Record* record = reinterpret_cast<Record*>(open.base + sizeof(Header)) + h->records;
+
+  // Identical advertising data is stored once per segment
+  uint32_t offset = 0;
+  if (dataLength > 0) {
+    auto it = open.payloads.find(payload);
+    if (it != open.payloads.end()) {
+      offset = it->second;
+      this->_deduplicated++;
+    } else {
+      offset = h->payloadBytes;
+      uint8_t* stored = open.base + h->payloadOffset + offset;
+      memcpy(stored, payload.data(), dataLength);
+      open.payloads.emplace(std::string_view(reinterpret_cast<char*>(stored), dataLength), offset);
+      h->payloadBytes += dataLength;
+    }
+  }
+
+  record->time = static_cast<uint32_t>(time - h->start);
+  record->payload = offset;
+  record->length = static_cast<uint16_t>(dataLength);
+  record->eventType = static_cast<uint16_t>(e[L::EventType] | (e[L::EventType + 1] << 8));
+  record->addressType = e[L::AddressType];
+  memcpy(record->address, e + L::Address, 6);
+  record->rssi = static_cast<int8_t>(e[L::Rssi]);
+
+  open.index[Key(record->address)].push_back(h->records);
+  h->end = time;
+  h->records++;
+  this->_appended++;
+  return 0;
+}
+
+int BluetoothHciObservationStore::create(uint64_t time) {
+  OpenSegment& open = this->_open;
+  uint64_t start = time - time % this->_options.segmentDuration;
+  uint32_t part = 0;
+  if (!this->_segments.empty() && this->_segments.back().start == start) {
+    part = this->_segments.back().part + 1;
+  }
+
+  // Parts left by another process are skipped
+  std::string path;
+  int fd = -1;
+  for (int attempts = 0; attempts < 1000; attempts++) {
+    char name[64];
+    snprintf(name, sizeof(name), "/%" PRIu64 "-%" PRIu32 ".hcio", start, part);
+    path = this->_directory + name;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+      break;
+    }
+    if (errno != EEXIST) {
+      return errno;
+    }
+    part++;
+  }
+  if (fd < 0) {
+    return EEXIST;
+  }
+
+  // Blocks are allocated up front: a store to a mapped hole on a full disk is a SIGBUS
+  size_t size = this->_options.segmentSize;
+#ifdef __linux__
+  int error = posix_fallocate(fd, 0, size);
+#else
+  int error = ftruncate(fd, size) < 0 ? errno : 0;
+#endif
+  void* base = error == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  if (base == MAP_FAILED) {
+    error = error != 0 ? error : errno;
+    ::close(fd);
+    unlink(path.c_str());
+    return error;
+  }
+
+  // Records take half of the file, payloads the rest
+  Header* h = static_cast<Header*>(base);
+  memset(h, 0, sizeof(Header));
+  h->magic = HCI_OBSERVATION_MAGIC;
+  h->version = HCI_OBSERVATION_VERSION;
+  h->start = start;
+  h->end = start;
+  h->recordCapacity = static_cast<uint32_t>((size - sizeof(Header)) / 2 / sizeof(Record));
+  h->payloadOffset = static_cast<uint32_t>(sizeof(Header) + h->recordCapacity * sizeof(Record));
+  h->payloadCapacity = static_cast<uint32_t>(size - h->payloadOffset);
+
+  open.fd = fd;
+  open.base = static_cast<uint8_t*>(base);
+  open.mapped = size;
+  open.info = { path, start, part, start, 0, 0 };
+  return 0;
+}
+
+void BluetoothHciObservationStore::seal() {
+  OpenSegment& open = this->_open;
+  if (open.fd < 0) {
+    return;
+  }
+
+  // A segment that failed to seal is left for the next open() to recover
+  if (Seal(open.fd, open.base, open.mapped, open.info) == 0) {
+    this->_segments.push_back(open.info);
+  }
+  open.fd = -1;
+  open.base = nullptr;
+  open.mapped = 0;
+  open.payloads.clear();
+  open.index.clear();
+}
+
+int BluetoothHciObservationStore::Seal(int fd, uint8_t* base, size_t mapped, Segment& info) {
+  Header* h = reinterpret_cast<Header*>(base);
+  const Record* records = reinterpret_cast<const Record*>(base + sizeof(Header));
+  uint32_t count = h->records;
+
+  // Record numbers grouped by address, in time order within each
+  std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+  for (uint32_t i = 0; i < count; i++) {
+    keys[i] = { Key(records[i].address), i };
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<IndexEntry> entries;
+  std::vector<uint32_t> postings(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (entries.empty() || entries.back().key != keys[i].first) {
+      entries.push_back({ keys[i].first, i, 0 });
+    }
+    entries.back().count++;
+    postings[i] = keys[i].second;
+  }
+
+  // Payloads move down against the records, then the index follows them
+  uint32_t payloadOffset = static_cast<uint32_t>(sizeof(Header) + count * sizeof(Record));
+  memmove(base + payloadOffset, base + h->payloadOffset, h->payloadBytes);
+  h->payloadOffset = payloadOffset;
+  h->recordCapacity = count;
+  h->payloadCapacity = h->payloadBytes;
+
+  uint64_t indexOffset = AlignUp(payloadOffset + h->payloadBytes, 8);
+  uint64_t size = indexOffset + entries.size() * sizeof(IndexEntry) + postings.size() * sizeof(uint32_t);
+  uint32_t sealed[2] = { static_cast<uint32_t>(indexOffset), static_cast<uint32_t>(entries.size()) };
+  info.end = h->end;
+  info.records = count;
+  info.bytes = size;
+  munmap(base, mapped);
+
+  // The index offset is written last: a segment without it is recovered on the next open
+  int error = 0;
+  size_t entryBytes = entries.size() * sizeof(IndexEntry);
+  size_t postingBytes = postings.size() * sizeof(uint32_t);
+  if (ftruncate(fd, size) < 0 ||
+      pwrite(fd, entries.data(), entryBytes, indexOffset) != static_cast<ssize_t>(entryBytes) ||
+      pwrite(fd, postings.data(), postingBytes, indexOffset + entryBytes) != static_cast<ssize_t>(postingBytes) ||
+      pwrite(fd, sealed, sizeof(sealed), offsetof(Header, indexOffset)) != static_cast<ssize_t>(sizeof(sealed))) {
+    error = errno != 0 ? errno : EIO;
+  }
+  ::close(fd);
+  return error;
+}
+
+void BluetoothHciObservationStore::prune(uint64_t now) {
+  uint64_t total = 0;
+  for (const Segment& segment : this->_segments) {
+    total += segment.bytes;
+  }
+  if (this->_open.fd >= 0) {
+    const Header* h = reinterpret_cast<const Header*>(this->_open.base);
+    total += sizeof(Header) + static_cast<uint64_t>(h->records) * sizeof(Record) + h->payloadBytes;
+  }
+
+  // Oldest first; the open segment is never deleted
+  while (!this->_segments.empty()) {
+    const Segment& oldest = this->_segments.front();
+    bool expired = this->_options.maxAge != 0 && oldest.end + this->_options.maxAge <= now;
+    bool over = this->_options.maxBytes != 0 && total > this->_options.maxBytes;
+    if (!expired && !over) {
+      break;
+    }
+    unlink(oldest.path.c_str());
+    total -= oldest.bytes;
+    this->_segments.erase(this->_segments.begin());
+    this->_pruned++;
+  }
+}
+
+size_t BluetoothHciObservationStore::query(const HciObservationQuery& query, std::vector<HciObservation>& observations) {
+  observations.clear();
+
+  auto querySealed = [&query, &observations](const Segment& segment) {
+    if (observations.size() >= query.limit || segment.end < query.from || segment.start >= query.to) {
+      return;
+    }
+
+    // Deleted by the retention limits in the meantime
+    int fd = ::open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0) {
+      return;
+    }
+    void* base = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      return;
+    }
+    const Header* h = Validate(static_cast<uint8_t*>(base), st.st_size);
+    if (h != nullptr && h->indexOffset != 0) {
+      Query(static_cast<uint8_t*>(base), nullptr, query, observations);
+    }
+    munmap(base, st.st_size);
+  };
+
+  // Sealed segments never change, so they are read outside the lock, oldest first
+  std::vector<Segment> segments;
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    segments = this->_segments;
+  }
+  for (const Segment& segment : segments) {
+    querySealed(segment);
+  }
+
+  // The open segment is read under the lock, only for what the limit leaves; segments sealed meanwhile come before it
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  for (const Segment& segment : this->_segments) {
+    bool seen = std::any_of(segments.begin(), segments.end(), [&segment](const Segment& s) { return s.path == segment.path; });
+    if (!seen) {
+      querySealed(segment);
+    }
+  }
+  if (this->_open.fd >= 0 && observations.size() < query.limit) {
+    Query(this->_open.base, &this->_open.index, query, observations);
+  }
+  return observations.size();
+}
+
+void BluetoothHciObservationStore::Query(const uint8_t* base, const std::unordered_map<uint64_t, std::vector<uint32_t>>* index,
+                                         const HciObservationQuery& query, std::vector<HciObservation>& observations) {
+  const Header* h = reinterpret_cast<const Header*>(base);
+  const Record* records = reinterpret_cast<const Record*>(base + sizeof(Header));
+  const uint8_t* payloads = base + h->payloadOffset;
+  if (query.to <= h->start || query.from > h->end) {
+    return;
+  }
+  uint64_t from = query.from > h->start ? query.from - h->start : 0;
+  uint64_t to = query.to - h->start;
+
+  // Record numbers to walk: the device's from the index, or all of them
+  const uint32_t* postings = nullptr;
+  uint32_t count = h->records;
+  if (query.byAddress) {
+    uint64_t key = Key(query.address);
+    count = 0;
+    if (index != nullptr) {
+      auto it = index->find(key);
+      if (it != index->end()) {
+        postings = it->second.data();
+        count = static_cast<uint32_t>(it->second.size());
+      }
+    } else {
+      const IndexEntry* entries = reinterpret_cast<const IndexEntry*>(base + h->indexOffset);
+      const IndexEntry* last = entries + h->addresses;
+      const IndexEntry* entry = std::lower_bound(entries, last, key, [](const IndexEntry& e, uint64_t k) { return e.key < k; });
+      const uint32_t* all = reinterpret_cast<const uint32_t*>(last);
+      if (entry != last && entry->key == key && static_cast<uint64_t>(entry->first) + entry->count <= h->records) {
+        postings = all + entry->first;
+        count = entry->count;
+      }
+    }
+  }
+  auto recordAt = [&](uint32_t i) -> uint32_t { return postings != nullptr ? postings[i] : i; };
+
+  // Records are in time order, so the range starts at a binary search
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t r = recordAt(mid);
+    if (r < h->records && records[r].time < from) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for (uint32_t i = lo; i < count && observations.size() < query.limit; i++) {
+    uint32_t r = recordAt(i);
+    if (r >= h->records) {
+      continue;
+    }
+    const Record& record = records[r];
+    if (record.time >= to) {
+      break;
+    }
+    if (query.byAddress && ((query.addressType >= 0 && record.addressType != query.addressType) ||
+                            memcmp(record.address, query.address, 6) != 0)) {
+      continue;
+    }
+    if (static_cast<uint64_t>(record.payload) + record.length > h->payloadBytes) {
+      continue;
+    }
+
+    HciObservation observation;
+    observation.time = h->start + record.time;
+    observation.addressType = record.addressType;
+    memcpy(observation.address, record.address, 6);
+    observation.rssi = record.rssi;
+    observation.eventType = record.eventType;
+    observation.data.assign(reinterpret_cast<const char*>(payloads + record.payload), record.length);
+    observations.push_back(std::move(observation));
+  }
+}
+
+HciObservationStoreStats BluetoothHciObservationStore::stats() {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  HciObservationStoreStats stats = {};
+  for (const Segment& segment : this->_segments) {
+    stats.bytes += segment.bytes;
+    stats.records += segment.records;
+  }
+  stats.segments = this->_segments.size();
+  if (this->_open.fd >= 0) {
+    const Header* h = reinterpret_cast<const Header*>(this->_open.base);
+    stats.segments++;
+    stats.bytes += sizeof(Header) + static_cast<uint64_t>(h->records) * sizeof(Record) + h->payloadBytes;
+    stats.records += h->records;
+  }
+  stats.appended = this->_appended;
+  stats.deduplicated = this->_deduplicated;
+  stats.dropped = this->_dropped;
+  stats.pruned = this->_pruned;
+  return stats;
+}
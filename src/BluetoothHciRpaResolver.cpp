@@ -0,0 +1,260 @@
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define BLUETOOTH_HCI_AESNI 1
+#endif
+
+#include "BluetoothHciRpaResolver.h"
+
+// AES S-box (FIPS-197 5.1.1)
+static const uint8_t kSbox[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+/**
+ * @brief Round tables of the portable AES: SubBytes and MixColumns of one byte
+ * per table, rotated for each row. Words are big endian column words.
+ */
+struct AesTables {
+  uint32_t te[4][256];
+
+  AesTables() {
+    for (int i = 0; i < 256; i++) {
+      uint8_t s = kSbox[i];
+      uint8_t s2 = static_cast<uint8_t>((s << 1) ^ ((s & 0x80) ? 0x1B : 0));
+      uint8_t s3 = s2 ^ s;
+      uint32_t word = (static_cast<uint32_t>(s2) << 24) | (s << 16) | (s << 8) | s3;
+      for (int t = 0; t < 4; t++) {
+        te[t][i] = word;
+        word = (word >> 8) | (word << 24);
+      }
+    }
+  }
+};
+
+static const AesTables kTables;
+
+static inline uint32_t LoadBe32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void ExpandKey(const BluetoothHciRpaResolver::Key& key, BluetoothHciRpaResolver::RoundKeys& rk) {
+  uint8_t* w = rk.bytes;
+  memcpy(w, key.data(), 16);
+
+  uint8_t rcon = 0x01;
+  for (int i = 16; i < 176; i += 4) {
+    uint8_t t[4] = { w[i - 4], w[i - 3], w[i - 2], w[i - 1] };
+    if (i % 16 == 0) {
+      // RotWord, SubWord, Rcon
+      uint8_t first = t[0];
+      t[0] = kSbox[t[1]] ^ rcon;
+      t[1] = kSbox[t[2]];
+      t[2] = kSbox[t[3]];
+      t[3] = kSbox[first];
+      rcon = static_cast<uint8_t>((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0));
+    }
+    for (int j = 0; j < 4; j++) {
+      w[i + j] = w[i + j - 16] ^ t[j];
+    }
+  }
+}
+
+// Last 24 bits of AES-128(key, 0^104 || prand), the only ones ah keeps
+static uint32_t HashPortable(const BluetoothHciRpaResolver::RoundKeys& rk, uint32_t prand) {
+  const uint8_t* k = rk.bytes;
+  const uint32_t (&te)[4][256] = kTables.te;
+
+  // The first 13 plaintext bytes are zero, so three columns start as the key
+  uint32_t s0 = LoadBe32(k);
+  uint32_t s1 = LoadBe32(k + 4);
+  uint32_t s2 = LoadBe32(k + 8);
+  uint32_t s3 = LoadBe32(k + 12) ^ prand;
+
+  for (int round = 1; round < 10; round++) {
+    const uint8_t* r = k + round * 16;
+    uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ LoadBe32(r);
+    uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ LoadBe32(r + 4);
+    uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ LoadBe32(r + 8);
+    uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ LoadBe32(r + 12);
+    s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+  }
+
+  // Final round (no MixColumns), last column only
+  uint32_t last = (static_cast<uint32_t>(kSbox[(s0 >> 16) & 0xFF]) << 16) |
+                  (static_cast<uint32_t>(kSbox[(s1 >> 8) & 0xFF]) << 8) |
+                  kSbox[s2 & 0xFF];
+  return (last ^ LoadBe32(k + 172)) & 0xFFFFFF;
+}
+
+#ifdef BLUETOOTH_HCI_AESNI
+__attribute__((target("aes,sse2")))
+static int32_t ScanAesNi(const BluetoothHciRpaResolver::RoundKeys* keys, size_t count, const bdaddr_t& address) {
+  // Plaintext 0^104 || prand and the expected hash, both most significant octet first
+  const __m128i block = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      static_cast<char>(address.b[5]), static_cast<char>(address.b[4]), static_cast<char>(address.b[3]));
+  const __m128i hash = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                     static_cast<char>(address.b[2]), static_cast<char>(address.b[1]), static_cast<char>(address.b[0]));
+  constexpr int kHashBytes = 0xE000;
+
+  // Eight independent encryptions keep the AES unit's pipeline full
+  constexpr size_t kLanes = 8;
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    __m128i m[kLanes];
+    for (size_t l = 0; l < kLanes; l++) {
+      m[l] = _mm_xor_si128(block, _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i + l].bytes)));
+    }
+    for (int round = 1; round < 10; round++) {
+      for (size_t l = 0; l < kLanes; l++) {
+        m[l] = _mm_aesenc_si128(m[l], _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i + l].bytes + round * 16)));
+      }
+    }
+    for (size_t l = 0; l < kLanes; l++) {
+      m[l] = _mm_aesenclast_si128(m[l], _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i + l].bytes + 160)));
+      if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m[l], hash)) & kHashBytes) == kHashBytes) {
+        return static_cast<int32_t>(i + l);
+      }
+    }
+  }
+
+  for (; i < count; i++) {
+    __m128i m = _mm_xor_si128(block, _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i].bytes)));
+    for (int round = 1; round < 10; round++) {
+      m = _mm_aesenc_si128(m, _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i].bytes + round * 16)));
+    }
+    m = _mm_aesenclast_si128(m, _mm_load_si128(reinterpret_cast<const __m128i*>(keys[i].bytes + 160)));
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, hash)) & kHashBytes) == kHashBytes) {
+      return static_cast<int32_t>(i);
+    }
+  }
+  return -1;
+}
+#endif
+
+BluetoothHciRpaResolver::BluetoothHciRpaResolver(bool accelerate) :
+  _accelerated(false),
+  _count(0),
+  _generation(0),
+  _cacheSize(0),
+  _cacheTtl(0),
+  _hits(0),
+  _misses(0),
+  _resolved(0)
+{
+#ifdef BLUETOOTH_HCI_AESNI
+  _accelerated = accelerate && __builtin_cpu_supports("aes");
+#else
+  (void)accelerate;
+#endif
+}
+
+uint32_t BluetoothHciRpaResolver::setKeys(const std::vector<Key>& keys, size_t cacheSize, uint64_t cacheTtl) {
+  // Expanded before taking the lock, so resolution only waits for the swap
+  std::vector<RoundKeys> expanded(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ExpandKey(keys[i], expanded[i]);
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  this->_keys.swap(expanded);
+  this->_count.store(this->_keys.size(), std::memory_order_relaxed);
+  this->_cacheSize = cacheSize;
+  this->_cacheTtl = cacheTtl;
+  this->_cache.clear();
+  this->_lru.clear();
+  this->_hits = this->_misses = this->_resolved = 0;
+  return ++this->_generation;
+}
+
+HciRpaMatch BluetoothHciRpaResolver::resolve(const bdaddr_t& address, uint64_t now) {
+  HciRpaMatch match;
+  if (!IsResolvable(address)) {
+    return match;
+  }
+
+  uint64_t key = 0;
+  memcpy(&key, address.b, sizeof(address.b));
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  match.generation = this->_generation;
+  if (this->_keys.empty()) {
+    return match;
+  }
+
+  auto it = this->_cache.find(key);
+  if (it != this->_cache.end()) {
+    if (it->second.expires > now) {
+      this->_hits++;
+      this->_lru.splice(this->_lru.begin(), this->_lru, it->second.lru);
+      match.index = it->second.index;
+      return match;
+    }
+    this->_lru.erase(it->second.lru);
+    this->_cache.erase(it);
+  }
+
+  this->_misses++;
+  match.index = this->scan(address);
+  if (match.index >= 0) {
+    this->_resolved++;
+  }
+
+  if (this->_cacheSize > 0) {
+    if (this->_cache.size() >= this->_cacheSize) {
+      this->_cache.erase(this->_lru.back());
+      this->_lru.pop_back();
+    }
+    this->_lru.push_front(key);
+    this->_cache[key] = { match.index, now + this->_cacheTtl, this->_lru.begin() };
+  }
+  return match;
+}
+
+int32_t BluetoothHciRpaResolver::scan(const bdaddr_t& address) const {
+#ifdef BLUETOOTH_HCI_AESNI
+  if (this->_accelerated) {
+    return ScanAesNi(this->_keys.data(), this->_keys.size(), address);
+  }
+#endif
+
+  uint32_t prand = (address.b[5] << 16) | (address.b[4] << 8) | address.b[3];
+  uint32_t hash = (address.b[2] << 16) | (address.b[1] << 8) | address.b[0];
+  for (size_t i = 0; i < this->_keys.size(); i++) {
+    if (HashPortable(this->_keys[i], prand) == hash) {
+      return static_cast<int32_t>(i);
+    }
+  }
+  return -1;
+}
+
+HciRpaResolverStats BluetoothHciRpaResolver::stats() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return { this->_keys.size(), this->_cache.size(), this->_hits, this->_misses, this->_resolved };
+}
+
+const char* BluetoothHciRpaResolver::backend() const {
+  return this->_accelerated ? "aes-ni" : "portable";
+}
+
+uint32_t BluetoothHciRpaResolver::Ah(const Key& irk, uint32_t prand) {
+  RoundKeys rk;
+  ExpandKey(irk, rk);
+  return HashPortable(rk, prand & 0xFFFFFF);
+}
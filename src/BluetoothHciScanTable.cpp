@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BluetoothHciScanTable.h"
+#include "BluetoothHciAdvertising.h"
+
+namespace Layout = HciAdvertisementLayout;
+
+BluetoothHciScanTable::BluetoothHciScanTable() :
+  _enabled(false)
+{}
+
+void BluetoothHciScanTable::enable(const Options& options) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  this->_options = options;
+  this->_options.capacity = std::max<size_t>(this->_options.capacity, 1);
+  this->_options.medianWindow = std::min(std::max<size_t>(this->_options.medianWindow, 1), kMaxMedianWindow);
+  this->_options.alpha = std::min(std::max(this->_options.alpha, 0.01f), 1.0f);
+  this->_entries.clear();
+  this->_index.clear();
+  this->_evicted.clear();
+  this->_enabled = true;
+}
+
+void BluetoothHciScanTable::disable() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  this->_enabled = false;
+  this->_entries.clear();
+  this->_index.clear();
+  this->_evicted.clear();
+}
+
+uint64_t BluetoothHciScanTable::key(uint8_t addressType, const uint8_t* address) {
+  uint64_t k = addressType;
+  for (int i = 0; i < 6; i++) {
+    k = (k << 8) | address[i];
+  }
+  return k;
+}
+
+void BluetoothHciScanTable::observe(const std::string& encoded) {
+  if (encoded.length() < Layout::HeaderLength) {
+    return;
+  }
+
+  const uint8_t* h = reinterpret_cast<const uint8_t*>(encoded.data());
+  uint8_t addressType = h[Layout::AddressType];
+  const uint8_t* address = h + Layout::Address;
+  int8_t rssi = static_cast<int8_t>(h[Layout::Rssi]);
+  size_t dataOffset = Layout::HeaderLength + h[Layout::AdCount] * Layout::EntryLength;
+  size_t dataLength = h[Layout::DataLength] | (h[Layout::DataLength + 1] << 8);
+  if (dataOffset + dataLength > encoded.length()) {
+    return;
+  }
+  const char* data = encoded.data() + dataOffset;
+
+  Clock::time_point now = Clock::now();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!this->_enabled) {
+    return;
+  }
+
+  uint64_t k = key(addressType, address);
+  auto found = this->_index.find(k);
+
+  if (found == this->_index.end()) {
+    // Make room by evicting the least recently seen device
+    if (this->_entries.size() >= this->_options.capacity) {
+      Entry& oldest = this->_entries.back();
+      if (!oldest.added) {
+        this->_evicted.push_back(oldest.device);
+      }
+      this->_index.erase(key(oldest.device.addressType, oldest.device.address));
+      this->_entries.pop_back();
+    }
+
+    Entry entry = {};
+    entry.device.addressType = addressType;
+    memcpy(entry.device.address, address, 6);
+    entry.device.rssiSmoothed = rssi;
+    entry.device.rssiMedian = rssi;
+    entry.device.firstSeen = 0;  // Resolved to wall clock at snapshot time
+    entry.reportedRssi = rssi;
+    entry.added = true;
+    this->_entries.push_front(std::move(entry));
+    found = this->_index.emplace(k, this->_entries.begin()).first;
+  } else if (found->second != this->_entries.begin()) {
+    // Most recently seen first
+    this->_entries.splice(this->_entries.begin(), this->_entries, found->second);
+  }
+
+  Entry& e = *found->second;
+  HciScanDevice& d = e.device;
+
+  if (d.count == 0) {
+    d.firstSeen = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  } else {
+    d.rssiSmoothed += this->_options.alpha * (rssi - d.rssiSmoothed);
+  }
+  d.count++;
+  d.rssi = rssi;
+  e.seen = now;
+
+  // Median of the recent samples rejects single-packet outliers
+  e.samples[e.sampleNext] = rssi;
+  e.sampleNext = (e.sampleNext + 1) % this->_options.medianWindow;
+  e.sampleCount = std::min(e.sampleCount + 1, this->_options.medianWindow);
+  int8_t sorted[kMaxMedianWindow];
+  memcpy(sorted, e.samples, e.sampleCount);
+  std::nth_element(sorted, sorted + e.sampleCount / 2, sorted + e.sampleCount);
+  d.rssiMedian = sorted[e.sampleCount / 2];
+
+  if (d.data.length() != dataLength || memcmp(d.data.data(), data, dataLength) != 0) {
+    d.data.assign(data, dataLength);
+    e.dirty = true;
+  }
+  if (std::fabs(d.rssiSmoothed - e.reportedRssi) >= this->_options.rssiThreshold) {
+    e.dirty = true;
+  }
+}
+
+uint64_t BluetoothHciScanTable::wallClock(Clock::time_point t, Clock::time_point now, uint64_t epochNow) const {
+  uint64_t age = std::chrono::duration_cast<std::chrono::milliseconds>(now - t).count();
+  return epochNow > age ? epochNow - age : 0;
+}
+
+HciScanSnapshot BluetoothHciScanTable::snapshot() {
+  HciScanSnapshot result;
+  Clock::time_point now = Clock::now();
+  uint64_t epochNow = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  result.lost.swap(this->_evicted);
+
+  // Entries are ordered by last seen, so expired ones are all at the back
+  Clock::duration timeout = std::chrono::milliseconds(this->_options.lostTimeout);
+  while (!this->_entries.empty() && now - this->_entries.back().seen > timeout) {
+    Entry& oldest = this->_entries.back();
+    if (!oldest.added) {
+      result.lost.push_back(oldest.device);
+    }
+    this->_index.erase(key(oldest.device.addressType, oldest.device.address));
+    this->_entries.pop_back();
+  }
+
+  for (Entry& e : this->_entries) {
+    if (!e.added && !e.dirty) {
+      continue;
+    }
+    e.device.lastSeen = this->wallClock(e.seen, now, epochNow);
+    if (e.added) {
+      result.added.push_back(e.device);
+    } else {
+      result.changed.push_back(e.device);
+    }
+    e.reportedRssi = e.device.rssiSmoothed;
+    e.added = false;
+    e.dirty = false;
+  }
+
+  return result;
+}
+
+size_t BluetoothHciScanTable::size() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return this->_entries.size();
+}
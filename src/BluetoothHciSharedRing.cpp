@@ -0,0 +1,494 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "BluetoothHciSharedRing.h"
+#include "BluetoothStructs.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC       0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS    (1024 + 9)
+#define F_SEAL_SHRINK  0x0002
+#define F_SEAL_GROW    0x0004
+#endif
+
+#define HCI_RING_MAGIC   0x52494348  ///< "HCIR"
+#define HCI_RING_VERSION 1
+
+#define HCI_RING_WRAP    0x0001      ///< Record flag: skip to the start of the ring
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics must be lock free");
+
+struct BluetoothHciSharedRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;                          ///< Packet ring bytes
+  uint64_t dataOffset;                    ///< Packet ring offset in the mapping
+  uint32_t ownerPid;                      ///< Broker process
+
+  alignas(64) std::atomic<uint64_t> head; ///< Position of the next record
+  std::atomic<uint64_t> tail;             ///< Position of the oldest intact record
+  std::atomic<uint64_t> sequence;         ///< Sequence number of the next record
+  std::atomic<uint32_t> headFutex;        ///< Bumped per publish
+  std::atomic<uint32_t> headWaiters;      ///< Consumers sleeping on headFutex
+  std::atomic<uint32_t> closed;           ///< Set when the broker stops
+
+  alignas(64) std::atomic<uint64_t> commandEnqueue; ///< Next command slot to fill
+  alignas(64) std::atomic<uint64_t> commandDequeue; ///< Next command slot to take
+  std::atomic<uint32_t> commandFutex;     ///< Bumped per queued command
+  std::atomic<uint32_t> commandWaiters;   ///< Broker sleeping on commandFutex
+};
+
+struct BluetoothHciSharedRing::ConsumerSlot {
+  alignas(64) std::atomic<uint32_t> pid;  ///< Owner, 0 when free
+  std::atomic<uint64_t> sequence;         ///< Sequence number expected next
+  std::atomic<uint64_t> delivered;
+  std::atomic<uint64_t> filtered;
+  std::atomic<uint64_t> lost;
+};
+
+struct BluetoothHciSharedRing::CommandSlot {
+  std::atomic<uint64_t> sequence;         ///< Bounded queue turn
+  uint32_t length;
+  uint8_t data[HCI_MAX_FRAME_SIZE];
+};
+
+struct BluetoothHciSharedRing::Record {
+  uint32_t length;
+  uint32_t flags;
+  uint64_t sequence;
+};
+
+static inline size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static inline size_t RecordSize(size_t length) {
+  return AlignUp(16 + length, 16);
+}
+
+static void FutexWait(std::atomic<uint32_t>* word, uint32_t value, int timeoutMs) {
+  struct timespec timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+  // Not FUTEX_PRIVATE_FLAG: the word is shared with other processes
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+BluetoothHciSharedRing::BluetoothHciSharedRing(int fd, uint8_t* base, size_t mapped) :
+  _fd(fd),
+  _base(base),
+  _mapped(mapped),
+  _size(0),
+  _dataOffset(0),
+  _head(0),
+  _tail(0)
+{}
+
+BluetoothHciSharedRing::~BluetoothHciSharedRing() {
+  munmap(this->_base, this->_mapped);
+  ::close(this->_fd);
+}
+
+size_t BluetoothHciSharedRing::Layout(size_t size, size_t& dataOffset) {
+  size_t offset = AlignUp(sizeof(Header), 64);
+  offset += kMaxConsumers * sizeof(ConsumerSlot);
+  offset += kCommandSlots * AlignUp(sizeof(CommandSlot), 64);
+  dataOffset = AlignUp(offset, 4096);
+  return dataOffset + size;
+}
+
+BluetoothHciSharedRing::Header* BluetoothHciSharedRing::header() const {
+  return reinterpret_cast<Header*>(this->_base);
+}
+
+BluetoothHciSharedRing::ConsumerSlot* BluetoothHciSharedRing::slot(size_t index) const {
+  return reinterpret_cast<ConsumerSlot*>(this->_base + AlignUp(sizeof(Header), 64)) + index;
+}
+
+BluetoothHciSharedRing::CommandSlot* BluetoothHciSharedRing::command(size_t index) const {
+  uint8_t* first = this->_base + AlignUp(sizeof(Header), 64) + kMaxConsumers * sizeof(ConsumerSlot);
+  return reinterpret_cast<CommandSlot*>(first + index * AlignUp(sizeof(CommandSlot), 64));
+}
+
+uint8_t* BluetoothHciSharedRing::data() const {
+  return this->_base + this->_dataOffset;
+}
+
+std::unique_ptr<BluetoothHciSharedRing> BluetoothHciSharedRing::Create(size_t size, int& error) {
+  size = AlignUp(std::max(size, kMinSize), 4096);
+  size_t dataOffset;
+  size_t mapped = Layout(size, dataOffset);
+
+  int fd = static_cast<int>(syscall(SYS_memfd_create, "bluetooth-hci-broker", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+  if (fd < 0) {
+    error = errno;
+    return nullptr;
+  }
+
+  // Sealed so a consumer cannot truncate the mapping under everyone else
+  if (ftruncate(fd, mapped) < 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0) {
+    error = errno;
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    error = errno;
+    ::close(fd);
+    return nullptr;
+  }
+
+  // The memfd starts zeroed, so only non-zero fields need setting
+  std::unique_ptr<BluetoothHciSharedRing> ring(new BluetoothHciSharedRing(fd, static_cast<uint8_t*>(base), mapped));
+  ring->_size = size;
+  ring->_dataOffset = dataOffset;
+  Header* h = ring->header();
+  h->size = size;
+  h->dataOffset = dataOffset;
+  h->ownerPid = getpid();
+  for (size_t i = 0; i < kCommandSlots; i++) {
+    ring->command(i)->sequence.store(i, std::memory_order_relaxed);
+  }
+  h->version = HCI_RING_VERSION;
+  std::atomic_thread_fence(std::memory_order_release);
+  h->magic = HCI_RING_MAGIC;
+  return ring;
+}
+
+std::unique_ptr<BluetoothHciSharedRing> BluetoothHciSharedRing::Attach(int fd, int& error) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    error = errno;
+    ::close(fd);
+    return nullptr;
+  }
+
+  size_t mapped = static_cast<size_t>(st.st_size);
+  if (mapped < sizeof(Header)) {
+    error = EINVAL;
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    error = errno;
+    ::close(fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<BluetoothHciSharedRing> ring(new BluetoothHciSharedRing(fd, static_cast<uint8_t*>(base), mapped));
+  Header* h = ring->header();
+  // Read once: the header stays writable by every process mapping it
+  size_t size = static_cast<size_t>(h->size);
+  size_t dataOffset;
+  if (h->magic != HCI_RING_MAGIC || h->version != HCI_RING_VERSION || size == 0 ||
+      Layout(size, dataOffset) != mapped || dataOffset != h->dataOffset) {
+    error = EINVAL;
+    return nullptr;
+  }
+  ring->_size = size;
+  ring->_dataOffset = dataOffset;
+  return ring;
+}
+
+bool BluetoothHciSharedRing::publish(const uint8_t* packet, size_t length) {
+  Header* h = this->header();
+  size_t size = this->_size;
+  size_t need = RecordSize(length);
+  if (length > HCI_MAX_FRAME_SIZE || need > size / 2) {
+    return false;
+  }
+
+  uint64_t head = this->_head;
+  size_t offset = head % size;
+  size_t gap = offset + need > size ? size - offset : 0;
+
+  // Readers must see the oldest records retired before they are overwritten
+  uint64_t tail = this->_tail;
+  uint64_t end = head + gap + need;
+  while (end - tail > size) {
+    // Any consumer can write the ring, so a record that cannot be ours retires everything
+    size_t at = tail % size;
+    const Record* oldest = reinterpret_cast<const Record*>(this->data() + at);
+    uint32_t flags = oldest->flags;
+    uint32_t oldestLength = oldest->length;
+    if (flags & HCI_RING_WRAP) {
+      tail += size - at;
+    } else if (oldestLength > HCI_MAX_FRAME_SIZE || at + RecordSize(oldestLength) > size) {
+      tail = head;
+      break;
+    } else {
+      tail += RecordSize(oldestLength);
+    }
+  }
+  this->_tail = tail;
+  h->tail.store(tail, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // A record never straddles the end; the rest of the lap is skipped instead
+  if (gap > 0) {
+    Record* wrap = reinterpret_cast<Record*>(this->data() + offset);
+    wrap->length = 0;
+    wrap->flags = HCI_RING_WRAP;
+    wrap->sequence = 0;
+    head += gap;
+    offset = 0;
+  }
+
+  Record* record = reinterpret_cast<Record*>(this->data() + offset);
+  record->length = static_cast<uint32_t>(length);
+  record->flags = 0;
+  record->sequence = h->sequence.load(std::memory_order_relaxed);
+  memcpy(this->data() + offset + sizeof(Record), packet, length);
+
+  h->sequence.store(record->sequence + 1, std::memory_order_relaxed);
+  this->_head = head + need;
+  h->head.store(this->_head, std::memory_order_release);
+
+  h->headFutex.fetch_add(1, std::memory_order_release);
+  if (h->headWaiters.load(std::memory_order_acquire) > 0) {
+    FutexWake(&h->headFutex);
+  }
+  return true;
+}
+
+bool BluetoothHciSharedRing::takeCommand(std::string& out) {
+  Header* h = this->header();
+  uint64_t position = h->commandDequeue.load(std::memory_order_relaxed);
+  CommandSlot* slot = this->command(position % kCommandSlots);
+  if (slot->sequence.load(std::memory_order_acquire) != position + 1) {
+    return false;
+  }
+
+  out.assign(reinterpret_cast<const char*>(slot->data), std::min<size_t>(slot->length, sizeof(slot->data)));
+  slot->sequence.store(position + kCommandSlots, std::memory_order_release);
+  h->commandDequeue.store(position + 1, std::memory_order_relaxed);
+  return true;
+}
+
+void BluetoothHciSharedRing::waitCommand(int timeoutMs) {
+  Header* h = this->header();
+  uint32_t value = h->commandFutex.load(std::memory_order_acquire);
+  uint64_t position = h->commandDequeue.load(std::memory_order_relaxed);
+  if (this->command(position % kCommandSlots)->sequence.load(std::memory_order_acquire) == position + 1 ||
+      h->closed.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  h->commandWaiters.fetch_add(1, std::memory_order_acq_rel);
+  FutexWait(&h->commandFutex, value, timeoutMs);
+  h->commandWaiters.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void BluetoothHciSharedRing::close() {
+  Header* h = this->header();
+  h->closed.store(1, std::memory_order_release);
+  h->headFutex.fetch_add(1, std::memory_order_release);
+  h->commandFutex.fetch_add(1, std::memory_order_release);
+  FutexWake(&h->headFutex);
+  FutexWake(&h->commandFutex);
+}
+
+std::vector<HciRingConsumerInfo> BluetoothHciSharedRing::consumers() {
+  std::vector<HciRingConsumerInfo> result;
+  uint64_t published = this->published();
+
+  for (size_t i = 0; i < kMaxConsumers; i++) {
+    ConsumerSlot* s = this->slot(i);
+    uint32_t pid = s->pid.load(std::memory_order_acquire);
+    if (pid == 0) {
+      continue;
+    }
+
+    // A consumer that crashed never leaves; its slot is reclaimed here
+    if (kill(static_cast<pid_t>(pid), 0) < 0 && errno == ESRCH) {
+      s->pid.compare_exchange_strong(pid, 0);
+      continue;
+    }
+
+    HciRingConsumerInfo info;
+    info.slot = static_cast<uint32_t>(i);
+    info.pid = pid;
+    uint64_t sequence = s->sequence.load(std::memory_order_relaxed);
+    info.lag = published > sequence ? published - sequence : 0;
+    info.delivered = s->delivered.load(std::memory_order_relaxed);
+    info.filtered = s->filtered.load(std::memory_order_relaxed);
+    info.lost = s->lost.load(std::memory_order_relaxed);
+    result.push_back(info);
+  }
+  return result;
+}
+
+uint64_t BluetoothHciSharedRing::published() const {
+  return this->header()->sequence.load(std::memory_order_relaxed);
+}
+
+int BluetoothHciSharedRing::join(HciRingCursor& cursor) {
+  Header* h = this->header();
+  uint32_t pid = static_cast<uint32_t>(getpid());
+
+  for (size_t i = 0; i < kMaxConsumers; i++) {
+    ConsumerSlot* s = this->slot(i);
+    uint32_t expected = 0;
+    if (!s->pid.compare_exchange_strong(expected, pid)) {
+      continue;
+    }
+
+    // Start at the newest packet; history is not replayed
+    cursor.position = h->head.load(std::memory_order_acquire);
+    cursor.sequence = h->sequence.load(std::memory_order_relaxed);
+    cursor.buffer.reserve(HCI_MAX_FRAME_SIZE);
+    s->sequence.store(cursor.sequence, std::memory_order_relaxed);
+    s->delivered.store(0, std::memory_order_relaxed);
+    s->filtered.store(0, std::memory_order_relaxed);
+    s->lost.store(0, std::memory_order_relaxed);
+    return static_cast<int>(i);
+  }
+  return -1;
+}
+
+void BluetoothHciSharedRing::leave(int index) {
+  if (index >= 0 && static_cast<size_t>(index) < kMaxConsumers) {
+    this->slot(index)->pid.store(0, std::memory_order_release);
+  }
+}
+
+size_t BluetoothHciSharedRing::read(int index, HciRingCursor& cursor, const std::function<bool(const uint8_t*, size_t)>& onPacket, size_t maxPackets) {
+  Header* h = this->header();
+  ConsumerSlot* s = this->slot(index);
+  size_t count = 0;
+  uint64_t delivered = 0;
+  uint64_t filtered = 0;
+  uint64_t lost = 0;
+
+  while (count < maxPackets) {
+    uint64_t head = h->head.load(std::memory_order_acquire);
+    if (cursor.position >= head) {
+      break;
+    }
+
+    // Overwritten while this consumer was behind: resume at the oldest intact record
+    uint64_t tail = h->tail.load(std::memory_order_acquire);
+    if (cursor.position < tail) {
+      cursor.position = tail;
+    }
+
+    size_t offset = cursor.position % this->_size;
+    Record record;
+    memcpy(&record, this->data() + offset, sizeof(record));
+    bool sane = (record.flags & HCI_RING_WRAP) ||
+                (record.length <= HCI_MAX_FRAME_SIZE && offset + RecordSize(record.length) <= this->_size);
+    if (sane && !(record.flags & HCI_RING_WRAP)) {
+      cursor.buffer.resize(record.length);
+      memcpy(cursor.buffer.data(), this->data() + offset + sizeof(Record), record.length);
+    }
+
+    // Torn if the broker retired the record while it was being copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (h->tail.load(std::memory_order_relaxed) > cursor.position) {
+      continue;
+    }
+    if (!sane) {
+      // Cannot happen for an intact record; give up on everything up to head
+      lost += h->sequence.load(std::memory_order_relaxed) - cursor.sequence;
+      cursor.sequence = h->sequence.load(std::memory_order_relaxed);
+      cursor.position = head;
+      break;
+    }
+
+    if (record.flags & HCI_RING_WRAP) {
+      cursor.position += this->_size - offset;
+      continue;
+    }
+
+    if (record.sequence > cursor.sequence) {
+      lost += record.sequence - cursor.sequence;
+    }
+    cursor.sequence = record.sequence + 1;
+    cursor.position += RecordSize(record.length);
+    count++;
+
+    if (onPacket(cursor.buffer.data(), cursor.buffer.size())) {
+      delivered++;
+    } else {
+      filtered++;
+    }
+  }
+
+  s->sequence.store(cursor.sequence, std::memory_order_relaxed);
+  s->delivered.fetch_add(delivered, std::memory_order_relaxed);
+  s->filtered.fetch_add(filtered, std::memory_order_relaxed);
+  s->lost.fetch_add(lost, std::memory_order_relaxed);
+  return count;
+}
+
+void BluetoothHciSharedRing::waitPackets(const HciRingCursor& cursor, int timeoutMs) {
+  Header* h = this->header();
+  uint32_t value = h->headFutex.load(std::memory_order_acquire);
+  if (h->head.load(std::memory_order_acquire) > cursor.position || h->closed.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  h->headWaiters.fetch_add(1, std::memory_order_acq_rel);
+  FutexWait(&h->headFutex, value, timeoutMs);
+  h->headWaiters.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool BluetoothHciSharedRing::submit(const uint8_t* packet, size_t length) {
+  Header* h = this->header();
+  if (length > HCI_MAX_FRAME_SIZE) {
+    return false;
+  }
+
+  // Bounded multi-producer queue: each slot's sequence says whose turn it is
+  uint64_t position = h->commandEnqueue.load(std::memory_order_relaxed);
+  CommandSlot* slot;
+  while (true) {
+    slot = this->command(position % kCommandSlots);
+    int64_t diff = static_cast<int64_t>(slot->sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(position);
+    if (diff == 0) {
+      if (h->commandEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      position = h->commandEnqueue.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->length = static_cast<uint32_t>(length);
+  memcpy(slot->data, packet, length);
+  slot->sequence.store(position + 1, std::memory_order_release);
+
+  h->commandFutex.fetch_add(1, std::memory_order_release);
+  if (h->commandWaiters.load(std::memory_order_acquire) > 0) {
+    FutexWake(&h->commandFutex);
+  }
+  return true;
+}
+
+bool BluetoothHciSharedRing::closed() const {
+  return this->header()->closed.load(std::memory_order_acquire) != 0;
+}
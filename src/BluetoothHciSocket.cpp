@@ -1,24 +1,61 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <linux/sock_diag.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include <uv.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <stdexcept>
 
 #include "BluetoothHciSocket.h"
 
+// Monotonic time in milliseconds, for the resolver cache and the accept list manager
+static uint64_t MonotonicMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Wall clock time in milliseconds since the epoch, for the observation store
+static uint64_t WallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 BluetoothHciSocket::BluetoothHciSocket(const Napi::CallbackInfo& info) :
   Napi::ObjectWrap<BluetoothHciSocket>(info), 
   stopFlag(false),
+  _reads(0),
+  _readLatencyCount(0),
+  _readLatencyTotal(0),
+  _readLatencyMax(0),
+  _rxqOverflow(false),
+  _rxqDrops(0),
+  _brokerActive(false),
+  _brokerStop(false),
+  _probeActive(false),
   _mode(0),
   _socket(-1),
   _devId(0),
   _address(),
-  _addressType(0)
+  _addressType(0),
+  _decodeAdvertisements(false),
+  _batchAdvertisements(false),
+  _adMatcherActive(false),
+  _adFilter(false),
+  _adMatched(0),
+  _adDropped(0),
+  _acceptListActive(false),
+  _connectActive(false),
+  _reassembleIso(false),
+  _connectionParameters(),
+  _connectionParametersSet(false)
 {}
 
 BluetoothHciSocket::~BluetoothHciSocket() {
+  this->stopBroker();
   if (!stopFlag && pollingThread.joinable()) {
     stopFlag = true;
     pollingThread.join();  // Wait for the polling thread to finishf
@@ -30,46 +67,552 @@ BluetoothHciSocket::~BluetoothHciSocket() {
 }
 
 void BluetoothHciSocket::PollSocket() {
-    char buffer[1024];
+    char buffer[HCI_MAX_FRAME_SIZE];
+    char control[128];  // Room for a time stamp and a drop counter control message
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = sizeof(buffer);
 
     while (!stopFlag) {
-        int length = read(_socket, buffer, sizeof(buffer));
+        // Without credit nothing is read, so the backlog builds up in the kernel's receive buffer
+        if (!this->_delivery.hasCredit()) {
+          this->_delivery.waitCredit(100);
+          continue;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        int length = recvmsg(_socket, &msg, 0);
         if (length > 0) {
+            this->recordReadLatency(&msg);
+            if (this->_rxqOverflow.load(std::memory_order_relaxed)) {
+              this->recordKernelDrops(&msg);
+            }
+
+            // Broker consumers see every packet, before native routing consumes any
+            if (this->_brokerActive.load(std::memory_order_relaxed) &&
+                (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER)) {
+              std::lock_guard<std::mutex> lock(this->_brokerMutex);
+              if (this->_broker) {
+                this->_broker->publish(reinterpret_cast<uint8_t*>(buffer), length);
+              }
+            }
+
             // Handle HCI_CHANNEL_RAW if necessary
             if (this->_mode == HCI_CHANNEL_RAW) {
               this->kernelDisconnectWorkArounds(buffer, length);  // Perform any required workarounds
             }
-            
-            if (thisObj.IsEmpty()) {
-                stopFlag = true;
-                break;
+
+            // Monitor frames carry their own header and are unwrapped before delivery
+            if (this->_mode == HCI_CHANNEL_MONITOR) {
+              this->handleMonitorFrame(buffer, length);
+              continue;
+            }
+
+            // Management index events keep the device inventory current
+            if (this->_mode == HCI_CHANNEL_CONTROL) {
+              this->handleManagementFrame(buffer, length);
+            }
+
+            if (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER) {
+              this->_router.observe(this->_devId, false, reinterpret_cast<uint8_t*>(buffer), length);
+
+              // Subscribed notifications skip the data path
+              if (this->routeAtt(buffer, length)) {
+                continue;
+              }
+
+              // Events are always seen so the ISO buffer size is learned; ISO data only when reassembling
+              if (buffer[0] == HCI_EVENT_PKT || (buffer[0] == HCI_ISODATA_PKT && this->_reassembleIso)) {
+                if (this->_iso.observe(reinterpret_cast<uint8_t*>(buffer), length, [this](HciIsoSdu& sdu) {
+                  this->emitIsoSdu(sdu);
+                })) {
+                  continue;
+                }
+              }
+            }
+
+            // Completions of the accept list manager's commands are answered natively
+            if (buffer[0] == HCI_EVENT_PKT && this->_acceptListActive.load(std::memory_order_relaxed) &&
+                this->syncAcceptList(buffer, length)) {
+              continue;
+            }
+
+            // The connect scheduler answers its own completions and checks its attempts for timeouts
+            if (this->_connectActive.load(std::memory_order_relaxed) && this->syncConnect(buffer, length)) {
+              continue;
+            }
+
+            // Completions of a running controller probe are answered natively
+            if (buffer[0] == HCI_EVENT_PKT && this->_probeActive && this->observeProbe(buffer, length)) {
+              continue;
             }
 
-            // If we received data, we need to send it to the main JS thread using the ThreadSafeFunction
-            std::string message(buffer, length);
+            // Advertising and connection events from private addresses carry the identity they resolve to
+            HciRpaMatch identity;
+            if (!this->_rpa.empty() && (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER)) {
+              identity = this->resolvePacket(reinterpret_cast<uint8_t*>(buffer), length);
+            }
 
-            // Use ThreadSafeFunction to safely call the JS function from the background thread
-            tsfn.BlockingCall([message, this](Napi::Env env, Napi::Function jsCallback) {
-                Napi::HandleScope scope(env);  // Handle scope for managing lifetime of JS objects
+            // Advertising reports are tagged with the catalog patterns they match, or dropped if filtering
+            std::shared_ptr<const BluetoothHciAdMatcher> matcher;
+            std::vector<uint32_t> matches;
+            bool filter = false;
+            if (this->_adMatcherActive.load(std::memory_order_relaxed) && buffer[0] == HCI_EVENT_PKT &&
+                (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER)) {
+              matcher = this->adMatcher();
+              filter = this->_adFilter.load(std::memory_order_relaxed);
+            }
+            bool drop = false;
+            if (matcher && matcher->matchReports(reinterpret_cast<uint8_t*>(buffer), length, matches) > 0) {
+              if (!matches.empty()) {
+                this->_adMatched.fetch_add(1, std::memory_order_relaxed);
+              } else if (filter) {
+                this->_adDropped.fetch_add(1, std::memory_order_relaxed);
+                drop = true;
+              }
+            }
 
-                // Prepare arguments for emit event: "data" and the message buffer
-                std::vector<napi_value> arguments = {
-                    Napi::String::New(env, "data"),  // The event name
-                    Napi::Buffer<char>::Copy(env, message.c_str(), message.length())  // The data buffer
-                };
+            if (!drop) {
+              this->emitPacket(std::string(buffer, length), HCI_DEV_NONE, nullptr, identity, std::move(matches));
+            }
 
-                // Call the emit function in JavaScript
-                jsCallback.Call(this->thisObj.Value(), arguments);
-            });
+            // Advertising reports are reassembled and indexed once, after the raw event
+            bool decode = this->_decodeAdvertisements;
+            bool batch = this->_batchAdvertisements;
+            bool track = this->_scanTable.enabled();
+            bool store = this->_observations.isOpen();
+            if ((decode || batch || track || store) && (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER)) {
+              this->_advertising.observe(reinterpret_cast<uint8_t*>(buffer), length, [this, decode, batch, track, store, &matcher, filter](std::string encoded) {
+                // Reassembled data is matched whole, so fragments of a chain match together
+                std::vector<uint32_t> matches;
+                if (matcher) {
+                  size_t adCount = static_cast<uint8_t>(encoded[HciAdvertisementLayout::AdCount]);
+                  size_t dataOffset = HciAdvertisementLayout::HeaderLength + adCount * HciAdvertisementLayout::EntryLength;
+                  if (!matcher->match(reinterpret_cast<const uint8_t*>(encoded.data()) + dataOffset, encoded.length() - dataOffset, matches) && filter) {
+                    return;
+                  }
+                }
+
+                if (store) {
+                  int error = this->_observations.append(encoded, WallClockMs());
+                  if (error != 0) {
+                    this->_delivery.push([error](Napi::Env env, Napi::Object target) {
+                      Napi::Error err = Napi::Error::New(env, strerror(error));
+                      err.Set("syscall", Napi::String::New(env, "open"));
+                      err.Set("errno", Napi::Number::New(env, error));
+                      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "error"), err.Value() });
+                    });
+                  }
+                }
+                if (track) {
+                  this->_scanTable.observe(encoded);
+                }
+                // The first row of a batch schedules its delivery; later rows join it until then
+                if (batch && this->_advertisingColumns.append(encoded)) {
+                  this->_delivery.push([this](Napi::Env env, Napi::Object target) {
+                    this->emitAdvertisementBatch(env, target);
+                  }, BluetoothHciDelivery::Bulk);
+                }
+                if (decode) {
+                  // Each report of a multi-report event resolves on its own
+                  HciRpaMatch identity;
+                  if (!this->_rpa.empty()) {
+                    bdaddr_t address;
+                    memcpy(address.b, encoded.data() + HciAdvertisementLayout::Address, sizeof(address.b));
+                    identity = this->resolveAddress(static_cast<uint8_t>(encoded[HciAdvertisementLayout::AddressType]), address);
+                  }
+                  this->emitAdvertisement(std::move(encoded), identity, matcher != nullptr, std::move(matches));
+                }
+              });
+            }
         } else if (length == 0) {
           continue;
         } else if (stopFlag) {
           break;
+        } else {
+          // Rotations and connection timeouts fall due without any traffic
+          if (this->_acceptListActive.load(std::memory_order_relaxed)) {
+            this->syncAcceptList(nullptr, 0);
+          }
+          if (this->_connectActive.load(std::memory_order_relaxed)) {
+            this->syncConnect(nullptr, 0);
+          }
         }
     }
 
+    // Index events stop with the thread; the inventory is queried again from now on
+    this->_inventory.setLive(false);
+
     close(_socket);  // Close the socket when done
-    tsfn.Release();  // Release the thread-safe function after stopping the thread
+    _delivery.stop();  // Release the thread-safe function after stopping the thread
+}
+
+void BluetoothHciSocket::enableReadTimestamps() {
+  int on = 1;
+
+  // The raw channel has its own time stamp option; the others use the socket one
+  if (this->_mode == HCI_CHANNEL_RAW) {
+    setsockopt(this->_socket, SOL_HCI, HCI_TIME_STAMP, &on, sizeof(on));
+  } else {
+    setsockopt(this->_socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+  }
+}
+
+void BluetoothHciSocket::recordReadLatency(struct msghdr* msg) {
+  this->_reads.fetch_add(1, std::memory_order_relaxed);
+
+  struct timespec received;
+  bool stamped = false;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_HCI && cmsg->cmsg_type == HCI_CMSG_TSTAMP && cmsg->cmsg_len >= CMSG_LEN(2 * sizeof(long))) {
+      // Always the kernel's native { long sec; long usec; }, whatever the libc's timeval is
+      long tv[2];
+      memcpy(tv, CMSG_DATA(cmsg), sizeof(tv));
+      received.tv_sec = tv[0];
+      received.tv_nsec = tv[1] * 1000;
+      stamped = true;
+    } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS && cmsg->cmsg_len >= CMSG_LEN(sizeof(received))) {
+      memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+      stamped = true;
+    }
+  }
+  if (!stamped) {
+    return;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  int64_t latency = (static_cast<int64_t>(now.tv_sec) - received.tv_sec) * 1000000000LL + (now.tv_nsec - received.tv_nsec);
+  if (latency < 0) {
+    return;  // Wall clock stepped back
+  }
+
+  this->_readLatencyCount.fetch_add(1, std::memory_order_relaxed);
+  this->_readLatencyTotal.fetch_add(latency, std::memory_order_relaxed);
+  if (static_cast<uint64_t>(latency) > this->_readLatencyMax.load(std::memory_order_relaxed)) {
+    this->_readLatencyMax.store(latency, std::memory_order_relaxed);
+  }
+}
+
+void BluetoothHciSocket::recordKernelDrops(struct msghdr* msg) {
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL && cmsg->cmsg_len >= CMSG_LEN(sizeof(uint32_t))) {
+      uint32_t drops;
+      memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+      this->_rxqDrops.store(drops, std::memory_order_relaxed);
+    }
+  }
+}
+
+void BluetoothHciSocket::emitPacket(std::string message, uint16_t devId, const char* direction, HciRpaMatch identity,
+                                    std::vector<uint32_t> matches) {
+    // Delivered in batches on the JS thread as "data" events
+    this->_delivery.push(std::move(message), devId, direction, identity, std::move(matches));
+}
+
+void BluetoothHciSocket::emitAdvertisement(std::string encoded, HciRpaMatch identity, bool matched, std::vector<uint32_t> matches) {
+  this->_delivery.push([this, encoded = std::move(encoded), identity, matched, matches = std::move(matches)](Napi::Env env, Napi::Object target) {
+    // Decoding may have been turned off while this advertisement was queued
+    if (this->_advertisementView.IsEmpty()) {
+      return;
+    }
+    Napi::Buffer<char> buffer = Napi::Buffer<char>::Copy(env, encoded.data(), encoded.length());
+    Napi::Value ids = matched ? BluetoothHciDelivery::Ids(env, matches) : env.Null();
+    Napi::Object advertisement = this->_advertisementView.New({ buffer, this->_delivery.identity(env, identity), ids });
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "advertisement"), advertisement });
+  }, BluetoothHciDelivery::Bulk, BluetoothHciDelivery::Droppable);
+}
+
+void BluetoothHciSocket::emitAdvertisementBatch(Napi::Env env, Napi::Object target) {
+  Napi::ArrayBuffer arrayBuffer;
+  HciAdvertisingColumnLayout l = this->_advertisingColumns.take([&](size_t size) {
+    arrayBuffer = Napi::ArrayBuffer::New(env, size);
+    return static_cast<uint8_t*>(arrayBuffer.Data());
+  });
+
+  // Batching may have been turned off while this batch was queued
+  if (l.count == 0 || !this->_batchAdvertisements) {
+    return;
+  }
+
+  // Every column is a view over the same ArrayBuffer
+  Napi::Object batch = Napi::Object::New(env);
+  batch.Set("count", Napi::Number::New(env, l.count));
+  batch.Set("address", Napi::Uint8Array::New(env, l.count * 6, arrayBuffer, l.address));
+  batch.Set("addressType", Napi::Uint8Array::New(env, l.count, arrayBuffer, l.addressType));
+  batch.Set("eventType", Napi::Uint16Array::New(env, l.count, arrayBuffer, l.eventType));
+  batch.Set("rssi", Napi::Int8Array::New(env, l.count, arrayBuffer, l.rssi));
+  batch.Set("txPower", Napi::Int8Array::New(env, l.count, arrayBuffer, l.txPower));
+  batch.Set("sid", Napi::Uint8Array::New(env, l.count, arrayBuffer, l.sid));
+  batch.Set("primaryPhy", Napi::Uint8Array::New(env, l.count, arrayBuffer, l.primaryPhy));
+  batch.Set("secondaryPhy", Napi::Uint8Array::New(env, l.count, arrayBuffer, l.secondaryPhy));
+  batch.Set("dataOffset", Napi::Uint32Array::New(env, l.count, arrayBuffer, l.dataOffset));
+  batch.Set("dataLength", Napi::Uint32Array::New(env, l.count, arrayBuffer, l.dataLength));
+  batch.Set("data", Napi::Uint8Array::New(env, l.dataBytes, arrayBuffer, l.data));
+
+  BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "advertisementBatch"), batch });
+}
+
+void BluetoothHciSocket::emitIsoSdu(HciIsoSdu& sdu) {
+  this->_delivery.push([this, connHandle = sdu.connHandle, hasTimestamp = sdu.hasTimestamp, timestamp = sdu.timestamp,
+                        sequenceNumber = sdu.sequenceNumber, status = sdu.status, data = std::move(sdu.data)]
+                       (Napi::Env env, Napi::Object target) mutable {
+    Napi::Buffer<char> buffer = Napi::Buffer<char>::Copy(env, data.data(), data.length());
+    this->_iso.release(std::move(data));
+
+    Napi::Object meta = Napi::Object::New(env);
+    meta.Set("connHandle", Napi::Number::New(env, connHandle));
+    meta.Set("sequenceNumber", Napi::Number::New(env, sequenceNumber));
+    meta.Set("timestamp", hasTimestamp ? Napi::Number::New(env, timestamp) : env.Null());
+    meta.Set("status", Napi::Number::New(env, status));
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "isoSdu"), buffer, meta });
+  }, BluetoothHciDelivery::Data);
+}
+
+HciRpaMatch BluetoothHciSocket::resolvePacket(const uint8_t* data, size_t length) {
+  HciRpaMatch match;
+  // Multi-report legacy events are annotated with the first report's identity
+  HciDispatch<HciLeAdvReportLayout, HciLeExtAdvReportLayout, HciLeDirectAdvReportLayout,
+              HciLeConnCompleteLayout, HciLeEnhConnCompleteLayout>(data, length, [this, &match](auto view) {
+    using Layout = typename decltype(view)::Layout;
+    match = this->resolveAddress(view[Layout::peerType], view[Layout::peer]);
+    return true;
+  });
+  return match;
+}
+
+HciRpaMatch BluetoothHciSocket::resolveAddress(uint8_t type, const bdaddr_t& address) {
+  // Only random addresses; types 0x02 and 0x03 were already resolved by the controller
+  if (type != 0x01) {
+    return HciRpaMatch();
+  }
+
+  return this->_rpa.resolve(address, MonotonicMs());
+}
+
+bool BluetoothHciSocket::routeAtt(const char* data, int length) {
+  const uint8_t* packet = reinterpret_cast<const uint8_t*>(data);
+
+  // A disconnected handle may be reused, so its subscriptions end with it
+  if (length >= 7 && packet[0] == HCI_EVENT_PKT && packet[1] == HCI_EV_DISCONN_COMPLETE && packet[3] == HCI_SUCCESS) {
+    uint16_t connHandle = (packet[4] | (packet[5] << 8)) & 0x0FFF;
+    std::vector<uint32_t> removed = this->_attRouter.removeConnection(connHandle);
+    if (!removed.empty()) {
+      this->_delivery.push([this, removed](Napi::Env, Napi::Object) {
+        for (uint32_t id : removed) {
+          this->_attCallbacks.erase(id);
+        }
+      }, BluetoothHciDelivery::Data);
+    }
+    return false;
+  }
+
+  std::vector<HciAttValue> completed;
+  if (!this->_attRouter.observe(packet, length, completed)) {
+    return false;
+  }
+
+  for (HciAttValue& value : completed) {
+    // Only consumed for subscriptions that opted in; the indication never reaches JS
+    if (value.indication) {
+      std::string confirmation = BluetoothHciAttRouter::Confirmation(value.connHandle);
+      if (write(this->_socket, confirmation.data(), confirmation.length()) >= 0) {
+        this->_router.observe(this->_devId, true, reinterpret_cast<const uint8_t*>(confirmation.data()), confirmation.length());
+      }
+    }
+
+    // One delivery per subscription and batch; later values join the staged ones
+    uint32_t id = value.subscription;
+    if (this->_attRouter.stage(std::move(value))) {
+      this->_delivery.push([this, id](Napi::Env env, Napi::Object) {
+        std::vector<std::string> values = this->_attRouter.take(id);
+        auto callback = this->_attCallbacks.find(id);
+        if (values.empty() || callback == this->_attCallbacks.end()) {
+          return;
+        }
+        Napi::Array array = Napi::Array::New(env, values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+          array.Set(i, Napi::Buffer<char>::Copy(env, values[i].data(), values[i].length()));
+        }
+        callback->second.Call({ array });
+      }, BluetoothHciDelivery::Data);
+    }
+  }
+
+  return true;
+}
+
+void BluetoothHciSocket::handleMonitorFrame(const char* data, int length) {
+  if (length < static_cast<int>(sizeof(hci_mon_hdr))) {
+    return;
+  }
+
+  struct hci_mon_hdr hdr;
+  memcpy(&hdr, data, sizeof(hdr));
+
+  const char* payload = data + sizeof(hdr);
+  int plen = std::min<int>(hdr.len, length - sizeof(hdr));
+
+  uint8_t packetType = 0;
+  const char* direction = nullptr;
+
+  switch (hdr.opcode) {
+    case HCI_MON_COMMAND_PKT: packetType = HCI_COMMAND_PKT; direction = "tx"; break;
+    case HCI_MON_EVENT_PKT:   packetType = HCI_EVENT_PKT;   direction = "rx"; break;
+    case HCI_MON_ACL_TX_PKT:  packetType = HCI_ACLDATA_PKT; direction = "tx"; break;
+    case HCI_MON_ACL_RX_PKT:  packetType = HCI_ACLDATA_PKT; direction = "rx"; break;
+    case HCI_MON_SCO_TX_PKT:  packetType = HCI_SCODATA_PKT; direction = "tx"; break;
+    case HCI_MON_SCO_RX_PKT:  packetType = HCI_SCODATA_PKT; direction = "rx"; break;
+    case HCI_MON_ISO_TX_PKT:  packetType = HCI_ISODATA_PKT; direction = "tx"; break;
+    case HCI_MON_ISO_RX_PKT:  packetType = HCI_ISODATA_PKT; direction = "rx"; break;
+    case HCI_MON_NEW_INDEX:
+    case HCI_MON_DEL_INDEX:
+    case HCI_MON_OPEN_INDEX:
+    case HCI_MON_CLOSE_INDEX:
+    case HCI_MON_INDEX_INFO:
+      this->emitIndexEvent(hdr.opcode, hdr.index, std::string(payload, plen));
+      this->updateInventory(hdr.index, hdr.opcode == HCI_MON_DEL_INDEX);
+      if (hdr.opcode == HCI_MON_DEL_INDEX || hdr.opcode == HCI_MON_CLOSE_INDEX) {
+        this->_router.reset(hdr.index);
+      }
+      return;
+    default:
+      // Vendor diagnostics, system notes and control channel traces are not forwarded
+      return;
+  }
+
+  // Re-frame the payload as an H4 packet so it parses like any other channel
+  std::string message;
+  message.reserve(plen + 1);
+  message.push_back(static_cast<char>(packetType));
+  message.append(payload, plen);
+
+  this->_router.observe(hdr.index, direction[0] == 't', reinterpret_cast<const uint8_t*>(message.data()), message.length());
+
+  this->emitPacket(std::move(message), hdr.index, direction);
+}
+
+void BluetoothHciSocket::emitIndexEvent(uint16_t opcode, uint16_t devId, std::string payload) {
+  this->_delivery.push([opcode, devId, payload](Napi::Env env, Napi::Object target) {
+    Napi::Object event = Napi::Object::New(env);
+    event.Set("devId", Napi::Number::New(env, devId));
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(payload.data());
+
+    switch (opcode) {
+      case HCI_MON_NEW_INDEX:
+        event.Set("type", Napi::String::New(env, "new"));
+        // type (1), bus (1), bdaddr (6), name (8)
+        if (payload.length() >= 16) {
+          event.Set("busType", Napi::Number::New(env, p[1]));
+          event.Set("address", Napi::Buffer<uint8_t>::Copy(env, p + 2, 6));
+          event.Set("name", Napi::String::New(env, payload.c_str() + 8, strnlen(payload.c_str() + 8, 8)));
+        }
+        break;
+      case HCI_MON_DEL_INDEX:
+        event.Set("type", Napi::String::New(env, "del"));
+        break;
+      case HCI_MON_OPEN_INDEX:
+        event.Set("type", Napi::String::New(env, "open"));
+        break;
+      case HCI_MON_CLOSE_INDEX:
+        event.Set("type", Napi::String::New(env, "close"));
+        break;
+      case HCI_MON_INDEX_INFO:
+        event.Set("type", Napi::String::New(env, "info"));
+        // bdaddr (6), manufacturer (2)
+        if (payload.length() >= 8) {
+          event.Set("address", Napi::Buffer<uint8_t>::Copy(env, p, 6));
+          event.Set("manufacturer", Napi::Number::New(env, p[6] | (p[7] << 8)));
+        }
+        break;
+    }
+
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "index"), event });
+  });
+}
+
+void BluetoothHciSocket::handleManagementFrame(const char* data, int length) {
+  if (length < static_cast<int>(sizeof(mgmt_hdr))) {
+    return;
+  }
+
+  struct mgmt_hdr hdr;
+  memcpy(&hdr, data, sizeof(hdr));
+
+  switch (hdr.opcode) {
+    case MGMT_EV_INDEX_ADDED:
+    case MGMT_EV_EXT_INDEX_ADDED:
+    case MGMT_EV_NEW_SETTINGS:
+      this->updateInventory(hdr.index, false);
+      break;
+    case MGMT_EV_INDEX_REMOVED:
+    case MGMT_EV_EXT_INDEX_REMOVED:
+      this->updateInventory(hdr.index, true);
+      break;
+  }
+}
+
+void BluetoothHciSocket::updateInventory(uint16_t devId, bool removed) {
+  if (devId == HCI_DEV_NONE) {
+    return;
+  }
+
+  HciDeviceEntry entry = {};
+  entry.devId = devId;
+
+  BluetoothHciDeviceInventory::Change change = removed
+    ? this->_inventory.remove(devId)
+    : this->_inventory.update(devId, &entry);
+
+  const char* eventName = nullptr;
+  switch (change) {
+    case BluetoothHciDeviceInventory::Added:   eventName = "deviceAdded"; break;
+    case BluetoothHciDeviceInventory::Removed: eventName = "deviceRemoved"; break;
+    case BluetoothHciDeviceInventory::Changed: eventName = "deviceChanged"; break;
+    case BluetoothHciDeviceInventory::None:    return;
+  }
+
+  this->_delivery.push([eventName, entry, change](Napi::Env env, Napi::Object target) {
+    Napi::Object device = change == BluetoothHciDeviceInventory::Removed
+      ? Napi::Object::New(env)
+      : DeviceToObject(env, entry);
+    device.Set("devId", Napi::Number::New(env, entry.devId));
+
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, eventName), device });
+  });
+}
+
+Napi::Object BluetoothHciSocket::DeviceToObject(Napi::Env env, const HciDeviceEntry& entry) {
+  char address[18];
+  snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x",
+    entry.address.b[5], entry.address.b[4], entry.address.b[3],
+    entry.address.b[2], entry.address.b[1], entry.address.b[0]);
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("devId", Napi::Number::New(env, entry.devId));
+  obj.Set("devUp", Napi::Boolean::New(env, entry.isUp()));
+  obj.Set("idVendor", env.Null());
+  obj.Set("idProduct", env.Null());
+  obj.Set("busNumber", env.Null());
+  obj.Set("deviceAddress", env.Null());
+  obj.Set("name", Napi::String::New(env, entry.name));
+  obj.Set("address", Napi::String::New(env, address));
+  obj.Set("bus", Napi::Number::New(env, entry.bus));
+  obj.Set("type", Napi::Number::New(env, entry.type));
+  obj.Set("flags", Napi::Number::New(env, entry.flags));
+  obj.Set("aclMtu", Napi::Number::New(env, entry.aclMtu));
+  obj.Set("aclPackets", Napi::Number::New(env, entry.aclPkts));
+  obj.Set("scoMtu", Napi::Number::New(env, entry.scoMtu));
+  obj.Set("scoPackets", Napi::Number::New(env, entry.scoPkts));
+  return obj;
 }
 
 void BluetoothHciSocket::EmitError(const Napi::CallbackInfo& info, const char *syscall) {
@@ -109,33 +652,26 @@ void BluetoothHciSocket::EmitError(const Napi::CallbackInfo& info, const char *s
   }
 }
 
+void BluetoothHciSocket::PushError(const char* syscall, int error) {
+  std::string name(syscall);
+  this->_delivery.push([name, error](Napi::Env env, Napi::Object target) {
+    Napi::Error err = Napi::Error::New(env, strerror(error));
+    err.Set("syscall", Napi::String::New(env, name));
+    err.Set("errno", Napi::Number::New(env, error));
+    BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "error"), err.Value() });
+  });
+}
+
 int BluetoothHciSocket::devIdFor(const int* pDevId, bool isUp) {
   int devId = 0; // default
 
   if (pDevId == nullptr) {
-    struct hci_dev_list_req *dl;
-    struct hci_dev_req *dr;
-
-    dl = (hci_dev_list_req*)calloc(HCI_MAX_DEV * sizeof(*dr) + sizeof(*dl), 1);
-    dr = dl->dev_req;
-
-    dl->dev_num = HCI_MAX_DEV;
-
-    if (ioctl(this->_socket, HCIGETDEVLIST, dl) > -1) {
-      for (int i = 0; i < dl->dev_num; i++, dr++) {
-        bool devUp = dr->dev_opt & (1 << HCI_UP);
-        bool match = (isUp == devUp);
-
-        if (match) {
-          // choose the first device that is match
-          // later on, it would be good to also HCIGETDEVINFO and check the HCI_RAW flag
-          devId = dr->dev_id;
-          break;
-        }
-      }
+    // choose the first device that is match
+    // later on, it would be good to also check the HCI_RAW flag
+    uint16_t match = 0;
+    if (this->_inventory.firstMatching(isUp, &match)) {
+      devId = match;
     }
-
-    free(dl);
   } else {
     devId = *pDevId;
   }
@@ -144,96 +680,65 @@ int BluetoothHciSocket::devIdFor(const int* pDevId, bool isUp) {
 }
 
 void BluetoothHciSocket::kernelDisconnectWorkArounds(char * data, int length) {
-  // Check if it's an HCI Event Packet
-  if (length < 4 || static_cast<uint8_t> (data[0]) != HCI_EVENT_PKT) {
-    // Not an HCI event packet; nothing to do
+  // Parsed before locking so packets that are not link events stay cheap
+  HciLinkEvent event;
+  if (!BluetoothHciLinkParser::ParseLinkEvent(reinterpret_cast<const uint8_t*>(data), length, event)) {
     return;
   }
 
-  // 
   std::lock_guard<std::mutex> lock(_mapMutex);
 
-  uint8_t eventCode = static_cast<uint8_t> (data[1]);
-  uint8_t plen = static_cast<uint8_t> (data[2]);
-
-  if (eventCode == HCI_EV_LE_META) {
-    // Handle LE Meta Events
-    if (plen >= 3) {
-      uint8_t subEventCode = static_cast<uint8_t> (data[3]);
-      uint8_t status = static_cast<uint8_t> (data[4]);
-
-      if ((subEventCode == HCI_EV_LE_CONN_COMPLETE && plen >= 19 && status == HCI_SUCCESS) ||
-        (subEventCode == HCI_EV_LE_ENH_CONN_COMPLETE && plen >= 31 && status == HCI_SUCCESS)) {
-        // Connection Complete Event
-        uint16_t handle = data[5] | (data[6] << 8);
-        uint8_t role = static_cast<uint8_t> (data[7]);
-        (void)(role);
-        
-        // Extract the Bluetooth address
-        bdaddr_t bdaddr_dst = {};
-        if (subEventCode == HCI_EV_LE_CONN_COMPLETE) {
-          memcpy(bdaddr_dst.b, & data[9], sizeof(bdaddr_dst.b));
-        } else if (subEventCode == HCI_EV_LE_ENH_CONN_COMPLETE) {
-          memcpy(bdaddr_dst.b, & data[9], sizeof(bdaddr_dst.b));
-        }
+  if (event.type == HciLinkEvent::Connected) {
+    // Connection Complete Event
+    bdaddr_t bdaddr_dst = event.peer;
 
-        // Process the connection
-        std::shared_ptr<BluetoothHciL2Socket> l2socket_ptr;
-        auto it_connected = _l2sockets_connected.find(bdaddr_dst);
-        if (it_connected != _l2sockets_connected.end()) {
-          l2socket_ptr = it_connected->second.lock();
-        } else {
-          auto it_connecting = _l2sockets_connecting.find(bdaddr_dst);
-          if (it_connecting != _l2sockets_connecting.end()) {
-            // Successful connection (we have a handle for the socket)
-            l2socket_ptr = it_connecting->second;
-            l2socket_ptr->setExpires(0);
-            _l2sockets_connecting.erase(it_connecting);
-
-            // Move to connected sockets map
-            _l2sockets_connected[bdaddr_dst] = std::weak_ptr<BluetoothHciL2Socket> (l2socket_ptr);
-          } else {
-            // Create bdaddr_t for source address
-            bdaddr_t bdaddr_src = {};
-            memcpy(bdaddr_src.b, _address, sizeof(bdaddr_src.b));
-
-            // Correct the dst_type calculation
-            uint8_t dst_type = static_cast<uint8_t> (data[8] + 1);
-
-            // Create a new L2CAP socket and connect
-            l2socket_ptr = std::make_shared<BluetoothHciL2Socket> (
-              this, & bdaddr_src, _addressType, & bdaddr_dst, dst_type, 0);
-
-            l2socket_ptr->connect();
-
-            if (!l2socket_ptr->isConnected()) {
-              return;
-            }
+    // Process the connection
+    std::shared_ptr<BluetoothHciL2Socket> l2socket_ptr;
+    auto it_connected = _l2sockets_connected.find(bdaddr_dst);
+    if (it_connected != _l2sockets_connected.end()) {
+      l2socket_ptr = it_connected->second.lock();
+    } else {
+      auto it_connecting = _l2sockets_connecting.find(bdaddr_dst);
+      if (it_connecting != _l2sockets_connecting.end()) {
+        // Successful connection (we have a handle for the socket)
+        l2socket_ptr = it_connecting->second;
+        l2socket_ptr->setExpires(0);
+        _l2sockets_connecting.erase(it_connecting);
 
-            // Add to connected sockets map
-            _l2sockets_connected[bdaddr_dst] = std::weak_ptr<BluetoothHciL2Socket> (l2socket_ptr);
-          }
-        }
+        // Move to connected sockets map
+        _l2sockets_connected[bdaddr_dst] = std::weak_ptr<BluetoothHciL2Socket> (l2socket_ptr);
+      } else {
+        // Create bdaddr_t for source address
+        bdaddr_t bdaddr_src = {};
+        memcpy(bdaddr_src.b, _address, sizeof(bdaddr_src.b));
+
+        // Correct the dst_type calculation
+        uint8_t dst_type = static_cast<uint8_t> (event.peerType + 1);
+
+        // Create a new L2CAP socket and connect
+        l2socket_ptr = std::make_shared<BluetoothHciL2Socket> (
+          this, & bdaddr_src, _addressType, & bdaddr_dst, dst_type, 0);
+
+        l2socket_ptr->connect();
 
-        if (!l2socket_ptr || !l2socket_ptr->isConnected()) {
+        if (!l2socket_ptr->isConnected()) {
           return;
         }
 
-        // Map the handle to the L2CAP socket
-        handle = handle % 256;
-        _l2sockets_handles[handle] = l2socket_ptr;
+        // Add to connected sockets map
+        _l2sockets_connected[bdaddr_dst] = std::weak_ptr<BluetoothHciL2Socket> (l2socket_ptr);
       }
     }
-  } else if (eventCode == HCI_EV_DISCONN_COMPLETE && plen >= 4) {
-    uint8_t status = static_cast<uint8_t> (data[3]);
-    if (status == HCI_SUCCESS) {
-      // Disconnection Complete Event
-      uint16_t handle = data[4] | (data[5] << 8);
-      handle = handle % 256;
 
-      // Remove the socket associated with the handle
-      _l2sockets_handles.erase(handle);
+    if (!l2socket_ptr || !l2socket_ptr->isConnected()) {
+      return;
     }
+
+    // Map the handle to the L2CAP socket
+    _l2sockets_handles[event.handle % 256] = l2socket_ptr;
+  } else {
+    // Disconnection Complete Event: remove the socket associated with the handle
+    _l2sockets_handles.erase(event.handle % 256);
   }
 }
 
@@ -243,129 +748,103 @@ void BluetoothHciSocket::setConnectionParameters(
     unsigned short connLatency,
     unsigned short supervisionTimeout
 ){
-  char command[128];
+  static const char* const names[] = { "conn_min_interval", "conn_max_interval", "conn_latency", "supervision_timeout" };
+  const uint16_t values[] = { connMinInterval, connMaxInterval, connLatency, supervisionTimeout };
+
+  // Reconnecting with the same parameters leaves debugfs as it is
+  if (this->_connectionParametersSet && !memcmp(values, this->_connectionParameters, sizeof(values))) {
+    return;
+  }
 
-  // override the HCI devices connection parameters using debugfs
-  sprintf(command, "echo %u > /sys/kernel/debug/bluetooth/hci%d/conn_min_interval", connMinInterval, this->_devId);
-  system(command);
-  sprintf(command, "echo %u > /sys/kernel/debug/bluetooth/hci%d/conn_max_interval", connMaxInterval, this->_devId);
-  system(command);
-  sprintf(command, "echo %u > /sys/kernel/debug/bluetooth/hci%d/conn_latency", connLatency, this->_devId);
-  system(command);
-  sprintf(command, "echo %u > /sys/kernel/debug/bluetooth/hci%d/supervision_timeout", supervisionTimeout, this->_devId);
-  system(command);
+  // override the HCI devices connection parameters using debugfs, written directly rather than through a shell
+  char path[128];
+  char value[16];
+  bool written = true;
+  for (size_t i = 0; i < 4; i++) {
+    snprintf(path, sizeof(path), "/sys/kernel/debug/bluetooth/hci%d/%s", this->_devId, names[i]);
+    int length = snprintf(value, sizeof(value), "%u\n", values[i]);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+      written = false;
+      continue;
+    }
+    written = write(fd, value, length) == length && written;
+    close(fd);
+  }
+
+  // Failed writes are tried again on the next attempt
+  memcpy(this->_connectionParameters, values, sizeof(values));
+  this->_connectionParametersSet = written;
 }
 
 bool BluetoothHciSocket::kernelConnectWorkArounds(char * data, int length) {
-  // Check if the packet is an HCI command packet
-  if (length < 4 || data[0] != HCI_COMMAND_PKT) {
-    // Not an HCI command packet; nothing to do
+  // LE Create Connection or LE Extended Create Connection; anything else proceeds normally
+  HciCreateConnection command;
+  if (!BluetoothHciLinkParser::ParseCreateConnection(reinterpret_cast<const uint8_t*>(data), length, command)) {
+    return false;
+  }
+
+  // Initiating through the accept list names no peer to open an L2CAP socket to; the controller does it
+  if (command.filterPolicy & 0x01) {
     return false;
   }
 
   //
   std::lock_guard<std::mutex> lock(_mapMutex);
 
-  // Extract the opcode and parameter length
-  uint16_t opcode = data[1] | (data[2] << 8);
-  uint8_t plen = data[3];
-
-  // Variables to hold connection parameters
-  uint16_t connMinInterval = 0;
-  uint16_t connMaxInterval = 0;
-  uint16_t connLatency = 0;
-  uint16_t supervisionTimeout = 0;
-  bdaddr_t bdaddr_dst = {};
-  uint8_t dst_type = 0;
-  bool handled = false;
-
-  // Parse the command based on the opcode
-  if (opcode == HCI_LE_CREATE_CONN && plen == 0x19) {
-    // LE Create Connection command
-    // Extract bdaddr and address type
-    memcpy(bdaddr_dst.b, & data[10], sizeof(bdaddr_dst.b));
-    dst_type = static_cast<uint8_t> (data[9] + 1);
-
-    // Extract connection parameters
-    connMinInterval = data[17] | (data[18] << 8);
-    connMaxInterval = data[19] | (data[20] << 8);
-    connLatency = data[21] | (data[22] << 8);
-    supervisionTimeout = data[23] | (data[24] << 8);
-
-    handled = true;
-  } else if (opcode == HCI_LE_EXT_CREATE_CONN) {
-    // LE Extended Create Connection command
-    // Ensure we have enough data
-    if (plen >= 0x2A && length >= plen + 4) {
-      // Extract bdaddr and address type
-      memcpy(bdaddr_dst.b, & data[7], sizeof(bdaddr_dst.b));
-      dst_type = static_cast<uint8_t> (data[6] + 1);
-
-      // Extract connection parameters
-      connMinInterval = data[18] | (data[19] << 8);
-      connMaxInterval = data[20] | (data[21] << 8);
-      connLatency = data[22] | (data[23] << 8);
-      supervisionTimeout = data[24] | (data[25] << 8);
-
-      handled = true;
-    }
-  }
-
-  if (handled) {
-    // Set the connection parameters
-    this->setConnectionParameters(connMinInterval, connMaxInterval, connLatency, supervisionTimeout);
+  bdaddr_t bdaddr_dst = command.peer;
+  uint8_t dst_type = static_cast<uint8_t> (command.peerType + 1);
 
-    std::shared_ptr<BluetoothHciL2Socket> l2socket_ptr;
+  // Set the connection parameters
+  this->setConnectionParameters(command.connMinInterval, command.connMaxInterval, command.connLatency, command.supervisionTimeout);
 
-    // Check if the device is already connected
-    auto it_connected = this->_l2sockets_connected.find(bdaddr_dst);
-    if (it_connected != this->_l2sockets_connected.end()) {
-      // Refresh the existing connection
-      l2socket_ptr = it_connected->second.lock();
-      if (l2socket_ptr) {
-        l2socket_ptr->disconnect();
-        l2socket_ptr->connect();
-        // No expiration needed as we're maintaining the connection
-      }
+  std::shared_ptr<BluetoothHciL2Socket> l2socket_ptr;
+
+  // Check if the device is already connected
+  auto it_connected = this->_l2sockets_connected.find(bdaddr_dst);
+  if (it_connected != this->_l2sockets_connected.end()) {
+    // Refresh the existing connection
+    l2socket_ptr = it_connected->second.lock();
+    if (l2socket_ptr) {
+      l2socket_ptr->disconnect();
+      l2socket_ptr->connect();
+      // No expiration needed as we're maintaining the connection
+    }
+  } else {
+    // Check if the device is currently connecting
+    auto it_connecting = this->_l2sockets_connecting.find(bdaddr_dst);
+    if (it_connecting != this->_l2sockets_connecting.end()) {
+      // Reattempt the connection
+      l2socket_ptr = it_connecting->second;
+      l2socket_ptr->disconnect();
+      l2socket_ptr->connect();
+      l2socket_ptr->setExpires(uv_hrtime() + L2_CONNECT_TIMEOUT);
     } else {
-      // Check if the device is currently connecting
-      auto it_connecting = this->_l2sockets_connecting.find(bdaddr_dst);
-      if (it_connecting != this->_l2sockets_connecting.end()) {
-        // Reattempt the connection
-        l2socket_ptr = it_connecting->second;
-        l2socket_ptr->disconnect();
-        l2socket_ptr->connect();
-        l2socket_ptr->setExpires(uv_hrtime() + L2_CONNECT_TIMEOUT);
-      } else {
-        // Create a new L2CAP socket and initiate connection
-        bdaddr_t bdaddr_src = {};
-        memcpy(bdaddr_src.b, _address, sizeof(bdaddr_src.b));
+      // Create a new L2CAP socket and initiate connection
+      bdaddr_t bdaddr_src = {};
+      memcpy(bdaddr_src.b, _address, sizeof(bdaddr_src.b));
 
-        uint64_t expires = uv_hrtime() + L2_CONNECT_TIMEOUT;
+      uint64_t expires = uv_hrtime() + L2_CONNECT_TIMEOUT;
 
-        l2socket_ptr = std::make_shared<BluetoothHciL2Socket> (
-          this, & bdaddr_src, _addressType, & bdaddr_dst, dst_type, expires);
+      l2socket_ptr = std::make_shared<BluetoothHciL2Socket> (
+        this, & bdaddr_src, _addressType, & bdaddr_dst, dst_type, expires);
 
-        // Insert into the connecting sockets map
-        this->_l2sockets_connecting[bdaddr_dst] = l2socket_ptr;
+      // Insert into the connecting sockets map
+      this->_l2sockets_connecting[bdaddr_dst] = l2socket_ptr;
 
-        // Attempt to connect
-        l2socket_ptr->connect();
+      // Attempt to connect
+      l2socket_ptr->connect();
 
-        // Check if connected successfully
-        if (!l2socket_ptr->isConnected()) {
-          this->_l2sockets_connecting.erase(bdaddr_dst);
-          return false;
-        }
+      // Check if connected successfully
+      if (!l2socket_ptr->isConnected()) {
+        this->_l2sockets_connecting.erase(bdaddr_dst);
+        return false;
       }
     }
-
-    // Skip sending the command to the kernel; handled by connect()
-    return true;
   }
 
-  // Command not handled; proceed normally
-  return false;
+  // Skip sending the command to the kernel; handled by connect()
+  return true;
 }
 
 Napi::Value BluetoothHciSocket::BindRaw(const Napi::CallbackInfo& info) {
@@ -483,6 +962,37 @@ void BluetoothHciSocket::BindControl(const Napi::CallbackInfo& info) {
   // Set the mode to control channel
   this->_mode = HCI_CHANNEL_CONTROL;
 
+  // Take the baseline before index events start updating it
+  this->_inventory.ensureLoaded();
+
+  // Perform the bind operation
+  if (bind(this->_socket, (struct sockaddr *)&a, sizeof(a)) < 0) {
+    // Use Napi for error handling and throw a JS exception
+    Napi::Error::New(env, strerror(errno)).ThrowAsJavaScriptException();
+  }
+}
+
+void BluetoothHciSocket::BindMonitor(const Napi::CallbackInfo& info) {
+  if (!this->EnsureSocket(info)) {
+    return;
+  }
+
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  struct sockaddr_hci a = {};
+
+  // Set the family, device ID, and channel
+  a.hci_family = AF_BLUETOOTH;
+  a.hci_dev = HCI_DEV_NONE;
+  a.hci_channel = HCI_CHANNEL_MONITOR;
+
+  // Set the mode to monitor channel
+  this->_mode = HCI_CHANNEL_MONITOR;
+
+  // Take the baseline before index events start updating it
+  this->_inventory.ensureLoaded();
+
   // Perform the bind operation
   if (bind(this->_socket, (struct sockaddr *)&a, sizeof(a)) < 0) {
     // Use Napi for error handling and throw a JS exception
@@ -512,44 +1022,17 @@ Napi::Value BluetoothHciSocket::IsDevUp(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value BluetoothHciSocket::GetDeviceList(const Napi::CallbackInfo& info) {
-  if (!this->EnsureSocket(info)) {
-    return Napi::Array::New(info.Env());
-  }
-
   Napi::Env env = info.Env();  // Get the environment
   Napi::HandleScope scope(env);  // Create a scope for memory management
 
-  struct hci_dev_list_req *dl;
-  struct hci_dev_req *dr;
-
-  dl = (hci_dev_list_req*)calloc(HCI_MAX_DEV * sizeof(*dr) + sizeof(*dl), 1);
-  dr = dl->dev_req;
+  // Served from the cached inventory; it is refreshed by index events, not by polling
+  std::vector<HciDeviceEntry> devices = this->_inventory.list();
 
-  dl->dev_num = HCI_MAX_DEV;
-
-  Napi::Array deviceList = Napi::Array::New(env);
-
-  if (ioctl(this->_socket, HCIGETDEVLIST, dl) > -1) {
-    int di = 0;
-    for (int i = 0; i < dl->dev_num; i++, dr++) {
-      uint16_t devId = dr->dev_id;
-      bool devUp = dr->dev_opt & (1 << HCI_UP);
-      // TODO: smells like there's a bug here (but dr isn't read so...)
-      if (dr != nullptr) {
-        Napi::Object obj = Napi::Object::New(env);
-        obj.Set(Napi::String::New(env, "devId"), Napi::Number::New(env, devId));
-        obj.Set(Napi::String::New(env, "devUp"), Napi::Boolean::New(env, devUp));
-        obj.Set(Napi::String::New(env, "idVendor"), env.Null());
-        obj.Set(Napi::String::New(env, "idProduct"), env.Null());
-        obj.Set(Napi::String::New(env, "busNumber"), env.Null());
-        obj.Set(Napi::String::New(env, "deviceAddress"), env.Null());
-        deviceList.Set(di++, obj);
-      }
-    }
+  Napi::Array deviceList = Napi::Array::New(env, devices.size());
+  for (size_t i = 0; i < devices.size(); i++) {
+    deviceList.Set(i, DeviceToObject(env, devices[i]));
   }
 
-  free(dl);
-
   return deviceList;
 }
 
@@ -594,27 +1077,44 @@ void BluetoothHciSocket::Start(const Napi::CallbackInfo& info) {
 
   Napi::Env env = info.Env();  // Get the environment
   Napi::HandleScope scope(env);  // Create a scope for memory management
-  // Store weak reference to the JS object (`info.This()`)
-  this->thisObj = Reference<Napi::Object>::New(info.This().As<Napi::Object>());
+  // Packets are delivered to the JS object's `emit` function
+  this->_delivery.start(env, info.This().As<Napi::Object>(), "Socket Polling");
+
+  // Chains left over from a previous run can never complete
+  this->_advertising.reset();
+  this->_advertisingColumns.clear();
+  this->_iso.reset();
 
-  // Create a thread-safe function for safely calling JS from a background thread
-  this->tsfn = Napi::ThreadSafeFunction::New(
-    env,
-    thisObj.Value().Get("emit").As<Napi::Function>(),  // JavaScript `emit` function
-    "Socket Polling",     // Resource name for debugging
-    0,                    // Unlimited queue
-    1                     // Only one thread will use this tsfn
-  );
+  // Packets are time stamped so the wakeup-to-read latency can be reported
+  this->enableReadTimestamps();
+  this->_reads = 0;
+  this->_readLatencyCount = 0;
+  this->_readLatencyTotal = 0;
+  this->_readLatencyMax = 0;
+
+  // Index events from the monitor and control channels keep the inventory current while polled
+  this->_inventory.setLive(this->_mode == HCI_CHANNEL_MONITOR || this->_mode == HCI_CHANNEL_CONTROL);
 
   // Reset stop flag
   stopFlag = false;
-  // Start the polling thread
-  pollingThread = std::thread(&BluetoothHciSocket::PollSocket, this);
+  // Start the polling thread; it applies its scheduling options to itself first
+  pollingThread = std::thread([this, options = this->_threadOptions]() {
+    BluetoothHciThread::Report(this->_delivery, BluetoothHciThread::Apply(options));
+    this->PollSocket();
+  });
 }
 
 void BluetoothHciSocket::Stop(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();  // Get the environment
   Napi::HandleScope scope(env);  // Create a scope for memory management
+  // The socket is closed with the polling thread, so consumers are detached first
+  this->stopBroker();
+  {
+    // A running probe can no longer complete; its caller times out
+    std::lock_guard<std::mutex> lock(this->_probeMutex);
+    this->_probeActive = false;
+    this->_probe.reset();
+  }
   if (!stopFlag && pollingThread.joinable()) {
     stopFlag = true;
     pollingThread.join();  // Wait for the polling thread to finishf
@@ -640,8 +1140,1329 @@ void BluetoothHciSocket::Write(const Napi::CallbackInfo& info) {
 
     if (write(this->_socket, buffer.Data(), buffer.Length()) < 0) {
       this->EmitError(info, "write");
+    } else if (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER) {
+      this->observeWrite(buffer.Data(), buffer.Length());
+    }
+  }
+}
+
+void BluetoothHciSocket::observeWrite(const char* data, int length) {
+  const uint8_t* packet = reinterpret_cast<const uint8_t*>(data);
+  this->_router.observe(this->_devId, true, packet, length);
+
+  // Scan and connection commands tell the accept list manager when the list is in use
+  {
+    std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+    this->_acceptList.observeCommand(packet, length, MonotonicMs());
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->_connectMutex);
+    this->_connect.observeCommand(packet, length, MonotonicMs());
+  }
+  // The host's reads complete ahead of a running probe's, and stay with the host
+  if (this->_probeActive) {
+    std::lock_guard<std::mutex> lock(this->_probeMutex);
+    if (this->_probe) {
+      this->_probe->observeCommand(packet, length);
     }
   }
+  if (this->_acceptListActive) {
+    this->syncAcceptList(nullptr, 0);
+  }
+}
+
+void BluetoothHciSocket::OnPacket(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->_delivery.setHandlers(info.Length() > 0 ? info[0] : env.Undefined());
+}
+
+void BluetoothHciSocket::SetDeliveryLanes(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Lane options object expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->_delivery.setLanes(info[0].As<Napi::Object>());
+}
+
+Napi::Value BluetoothHciSocket::GetDeliveryStats(const Napi::CallbackInfo& info) {
+  return this->_delivery.stats(info.Env());
+}
+
+Napi::Value BluetoothHciSocket::PickAdapter(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  BluetoothHciConnectionRouter::Policy policy = BluetoothHciConnectionRouter::LeastConnections;
+  if (info.Length() > 0 && info[0].IsString()) {
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    if (name == "round-robin") {
+      policy = BluetoothHciConnectionRouter::RoundRobin;
+    } else if (name == "sticky") {
+      policy = BluetoothHciConnectionRouter::Sticky;
+    } else if (name != "least-connections") {
+      Napi::TypeError::New(env, "Unknown adapter policy: " + name).ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+
+  bdaddr_t address = {};
+  bool hasAddress = info.Length() > 1 && info[1].IsString() &&
+    ParseAddress(info[1].As<Napi::String>().Utf8Value(), &address);
+
+  std::vector<uint16_t> candidates;
+  for (const HciDeviceEntry& entry : this->_inventory.list()) {
+    if (entry.isUp()) {
+      candidates.push_back(entry.devId);
+    }
+  }
+
+  uint16_t devId = 0;
+  if (!this->_router.pick(candidates, policy, hasAddress ? &address : nullptr, &devId)) {
+    return env.Null();
+  }
+
+  return Napi::Number::New(env, devId);
+}
+
+void BluetoothHciSocket::SetThreadOptions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Takes effect when the polling thread is next started
+  HciThreadOptions options;
+  if (BluetoothHciThread::Parse(info.Length() > 0 ? info[0] : env.Undefined(), options)) {
+    this->_threadOptions = options;
+  }
+}
+
+Napi::Value BluetoothHciSocket::GetReadStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  uint64_t count = this->_readLatencyCount.exchange(0);
+  uint64_t total = this->_readLatencyTotal.exchange(0);
+  uint64_t max = this->_readLatencyMax.exchange(0);
+
+  // Latency is reported in microseconds, over the reads since the previous call
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(this->_reads.load())));
+  stats.Set("timestamped", Napi::Number::New(env, static_cast<double>(count)));
+  stats.Set("averageLatency", Napi::Number::New(env, count ? total / 1000.0 / count : 0));
+  stats.Set("maxLatency", Napi::Number::New(env, max / 1000.0));
+  return stats;
+}
+
+void BluetoothHciSocket::SetFlowControl(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    this->_delivery.setCredit(-1);
+    return;
+  }
+
+  int64_t credit = info[0].As<Napi::Number>().Int64Value();
+  if (credit < 1) {
+    Napi::RangeError::New(env, "setFlowControl: credit must be at least 1").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Kernel drops are reported with every read from now on, where the kernel supports it for the socket
+  int on = 1;
+  if (this->_socket >= 0 && !this->_rxqOverflow && setsockopt(this->_socket, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0) {
+    this->_rxqOverflow = true;
+  }
+  this->_delivery.setCredit(credit);
+}
+
+void BluetoothHciSocket::GrantCredit(const Napi::CallbackInfo& info) {
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    this->_delivery.grant(info[0].As<Napi::Number>().Int64Value());
+  }
+}
+
+Napi::Value BluetoothHciSocket::SetReceiveBuffer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().Int64Value() < 1) {
+    Napi::TypeError::New(env, "setReceiveBuffer: size in bytes expected").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!this->EnsureSocket(info)) {
+    return env.Undefined();
+  }
+
+  // The kernel doubles the value for its bookkeeping; SO_RCVBUF is capped at net.core.rmem_max
+  int size = static_cast<int>(std::min<int64_t>(info[0].As<Napi::Number>().Int64Value(), INT32_MAX / 2));
+  if (setsockopt(this->_socket, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0 &&
+      setsockopt(this->_socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+    Napi::Error::New(env, strerror(errno)).ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int applied = 0;
+  socklen_t length = sizeof(applied);
+  getsockopt(this->_socket, SOL_SOCKET, SO_RCVBUF, &applied, &length);
+  return Napi::Number::New(env, applied);
+}
+
+Napi::Value BluetoothHciSocket::GetReceiveQueueStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  // SO_MEMINFO counts drops whatever the protocol; SO_RXQ_OVFL only where recvmsg reports it
+  uint32_t meminfo[SK_MEMINFO_VARS] = {};
+  socklen_t length = sizeof(meminfo);
+  if (this->_socket < 0 || getsockopt(this->_socket, SOL_SOCKET, SO_MEMINFO, meminfo, &length) < 0) {
+    length = 0;
+  }
+  uint32_t drops = this->_rxqDrops.load();
+  if (length > SK_MEMINFO_DROPS * sizeof(uint32_t)) {
+    drops = std::max(drops, meminfo[SK_MEMINFO_DROPS]);
+  }
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("receiveBuffer", Napi::Number::New(env, length > 0 ? meminfo[SK_MEMINFO_RCVBUF] : 0));
+  stats.Set("queued", Napi::Number::New(env, length > 0 ? meminfo[SK_MEMINFO_RMEM_ALLOC] : 0));
+  stats.Set("drops", Napi::Number::New(env, drops));
+  this->_delivery.creditStats(env, stats);
+  return stats;
+}
+
+void BluetoothHciSocket::SetIrks(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  std::vector<BluetoothHciRpaResolver::Key> keys;
+  Napi::Value list = info.Length() > 0 ? info[0] : env.Undefined();
+  if (list.IsArray()) {
+    Napi::Array array = list.As<Napi::Array>();
+    keys.resize(array.Length());
+
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value entry = array.Get(i);
+      Napi::Value irk = entry.IsObject() && !entry.IsBuffer() ? entry.As<Napi::Object>().Get("irk") : entry;
+
+      bool valid = false;
+      if (irk.IsBuffer() && irk.As<Napi::Buffer<uint8_t>>().Length() == 16) {
+        memcpy(keys[i].data(), irk.As<Napi::Buffer<uint8_t>>().Data(), 16);
+        valid = true;
+      } else if (irk.IsString()) {
+        std::string hex = irk.As<Napi::String>().Utf8Value();
+        valid = hex.size() == 32;
+        for (size_t j = 0; valid && j < 16; j++) {
+          unsigned int octet;
+          valid = isxdigit(hex[j * 2]) && isxdigit(hex[j * 2 + 1]) && sscanf(hex.c_str() + j * 2, "%2x", &octet) == 1;
+          keys[i][j] = static_cast<uint8_t>(octet);
+        }
+      }
+
+      if (!valid) {
+        Napi::TypeError::New(env, "setIrks: irk " + std::to_string(i) + " must be 16 bytes, most significant first").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+  }
+
+  size_t cacheSize = 4096;
+  uint64_t cacheTtl = 15 * 60 * 1000;  // The default RPA rotation period
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    if (options.Get("cacheSize").IsNumber()) {
+      cacheSize = options.Get("cacheSize").As<Napi::Number>().Uint32Value();
+    }
+    if (options.Get("cacheTtl").IsNumber()) {
+      cacheTtl = static_cast<uint64_t>(options.Get("cacheTtl").As<Napi::Number>().Int64Value());
+    }
+  }
+
+  // Annotations carry the caller's own entries, looked up by the index the resolver returns
+  uint32_t generation = this->_rpa.setKeys(keys, cacheSize, cacheTtl);
+  this->_delivery.setIdentities(list.IsArray() ? list : env.Undefined(), generation);
+}
+
+Napi::Value BluetoothHciSocket::GetResolverStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  HciRpaResolverStats counters = this->_rpa.stats();
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("irks", Napi::Number::New(env, static_cast<double>(counters.keys)));
+  stats.Set("backend", Napi::String::New(env, this->_rpa.backend()));
+  stats.Set("cached", Napi::Number::New(env, static_cast<double>(counters.cached)));
+  stats.Set("hits", Napi::Number::New(env, static_cast<double>(counters.hits)));
+  stats.Set("misses", Napi::Number::New(env, static_cast<double>(counters.misses)));
+  stats.Set("resolved", Napi::Number::New(env, static_cast<double>(counters.resolved)));
+  return stats;
+}
+
+void BluetoothHciSocket::SetAdPatterns(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  std::vector<HciAdPattern> patterns;
+  Napi::Value list = info.Length() > 0 ? info[0] : env.Undefined();
+  if (list.IsArray()) {
+    Napi::Array array = list.As<Napi::Array>();
+    patterns.resize(array.Length());
+
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value entry = array.Get(i);
+      Napi::Object object = entry.IsObject() ? entry.As<Napi::Object>() : Napi::Object::New(env);
+      Napi::Value type = object.Get("type");
+      Napi::Value data = object.Get("data");
+      Napi::Value id = object.Get("id");
+      Napi::Value offset = object.Get("offset");
+      HciAdPattern& pattern = patterns[i];
+
+      bool valid = type.IsNumber() && type.As<Napi::Number>().Int32Value() >= 0 && type.As<Napi::Number>().Int32Value() <= 0xFF;
+      if (valid && data.IsBuffer()) {
+        Napi::Buffer<char> bytes = data.As<Napi::Buffer<char>>();
+        pattern.value.assign(bytes.Data(), bytes.Length());
+      } else if (valid && data.IsString()) {
+        std::string hex = data.As<Napi::String>().Utf8Value();
+        valid = hex.size() % 2 == 0;
+        for (size_t j = 0; valid && j < hex.size(); j += 2) {
+          unsigned int octet;
+          valid = isxdigit(hex[j]) && isxdigit(hex[j + 1]) && sscanf(hex.c_str() + j, "%2x", &octet) == 1;
+          pattern.value.push_back(static_cast<char>(octet));
+        }
+      } else {
+        valid = false;
+      }
+
+      if (!valid || pattern.value.empty()) {
+        Napi::TypeError::New(env, "setAdPatterns: pattern " + std::to_string(i) + " needs an AD type and data").ThrowAsJavaScriptException();
+        return;
+      }
+
+      pattern.type = static_cast<uint8_t>(type.As<Napi::Number>().Uint32Value());
+      pattern.id = id.IsNumber() ? id.As<Napi::Number>().Uint32Value() : i;
+      pattern.offset = offset.IsNumber() ? std::max(-1, std::min(offset.As<Napi::Number>().Int32Value(), 0xFF)) : 0;
+    }
+  }
+
+  bool filter = false;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    filter = info[1].As<Napi::Object>().Get("filter").ToBoolean().Value();
+  }
+
+  // Built on the JS thread; the polling thread picks the new catalog up with its next packet
+  std::shared_ptr<const BluetoothHciAdMatcher> matcher;
+  if (list.IsArray()) {
+    matcher = std::make_shared<const BluetoothHciAdMatcher>(patterns);
+  }
+
+  std::lock_guard<std::mutex> lock(this->_adMatcherMutex);
+  this->_adMatcher = std::move(matcher);
+  this->_adFilter = filter;
+  this->_adMatcherActive = this->_adMatcher != nullptr;
+}
+
+Napi::Value BluetoothHciSocket::GetAdPatternStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  std::shared_ptr<const BluetoothHciAdMatcher> matcher = this->adMatcher();
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("patterns", Napi::Number::New(env, matcher ? static_cast<double>(matcher->patterns()) : 0));
+  stats.Set("states", Napi::Number::New(env, matcher ? static_cast<double>(matcher->states()) : 0));
+  stats.Set("matched", Napi::Number::New(env, static_cast<double>(this->_adMatched.load())));
+  stats.Set("dropped", Napi::Number::New(env, static_cast<double>(this->_adDropped.load())));
+  return stats;
+}
+
+void BluetoothHciSocket::SetAcceptList(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (this->_mode != HCI_CHANNEL_RAW && this->_mode != HCI_CHANNEL_USER) {
+    Napi::TypeError::New(env, "setAcceptList: the socket must be bound in raw or user mode").ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::vector<HciAcceptTarget> targets;
+  Napi::Value list = info.Length() > 0 ? info[0] : env.Undefined();
+  if (list.IsArray()) {
+    Napi::Array array = list.As<Napi::Array>();
+    targets.resize(array.Length());
+
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value entry = array.Get(i);
+      Napi::Object object = entry.IsObject() ? entry.As<Napi::Object>() : Napi::Object::New(env);
+      Napi::Value address = object.Get("address");
+      Napi::Value addressType = object.Get("addressType");
+      Napi::Value priority = object.Get("priority");
+      HciAcceptTarget& target = targets[i];
+
+      if (!address.IsString() || !ParseAddress(address.As<Napi::String>().Utf8Value(), &target.address)) {
+        Napi::TypeError::New(env, "setAcceptList: target " + std::to_string(i) + " needs an address").ThrowAsJavaScriptException();
+        return;
+      }
+      if (addressType.IsString()) {
+        target.type = addressType.As<Napi::String>().Utf8Value() == "random" ? 0x01 : 0x00;
+      } else {
+        target.type = addressType.IsNumber() ? addressType.As<Napi::Number>().Uint32Value() & 0x01 : 0x00;
+      }
+      target.priority = priority.IsNumber() ? priority.As<Napi::Number>().Int32Value() : 0;
+    }
+  }
+
+  BluetoothHciAcceptList::Options options;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object object = info[1].As<Napi::Object>();
+    Napi::Value policy = object.Get("policy");
+    if (policy.IsString()) {
+      std::string name = policy.As<Napi::String>().Utf8Value();
+      if (name != "priority" && name != "recency") {
+        Napi::TypeError::New(env, "setAcceptList: policy must be 'priority' or 'recency'").ThrowAsJavaScriptException();
+        return;
+      }
+      options.policy = name == "recency" ? BluetoothHciAcceptList::Recency : BluetoothHciAcceptList::Priority;
+    }
+    if (object.Get("capacity").IsNumber()) {
+      options.capacity = object.Get("capacity").As<Napi::Number>().Uint32Value();
+    }
+    if (object.Get("rotateInterval").IsNumber()) {
+      options.rotateInterval = std::max<int64_t>(100, object.Get("rotateInterval").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("pauseScan").IsBoolean()) {
+      options.pauseScan = object.Get("pauseScan").As<Napi::Boolean>().Value();
+    }
+  }
+
+  // The first commands go out now; the polling thread sends the rest as they complete
+  {
+    std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+    this->_acceptList.setTargets(targets, options, MonotonicMs());
+    this->_acceptListActive = true;
+  }
+  this->syncAcceptList(nullptr, 0);
+}
+
+Napi::Value BluetoothHciSocket::GetAcceptListStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  HciAcceptListStats counters;
+  {
+    std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+    counters = this->_acceptList.stats(MonotonicMs());
+  }
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("targets", Napi::Number::New(env, static_cast<double>(counters.targets)));
+  stats.Set("installed", Napi::Number::New(env, static_cast<double>(counters.installed)));
+  stats.Set("capacity", Napi::Number::New(env, static_cast<double>(counters.capacity)));
+  stats.Set("rejected", Napi::Number::New(env, static_cast<double>(counters.rejected)));
+  stats.Set("rotations", Napi::Number::New(env, static_cast<double>(counters.rotations)));
+  stats.Set("commands", Napi::Number::New(env, static_cast<double>(counters.commands)));
+  stats.Set("commandsSaved", Napi::Number::New(env, counters.commandsNaive > counters.commands ?
+                                                    static_cast<double>(counters.commandsNaive - counters.commands) : 0));
+  stats.Set("deferred", Napi::Number::New(env, static_cast<double>(counters.deferred)));
+  stats.Set("targetReports", Napi::Number::New(env, static_cast<double>(counters.targetReports)));
+  stats.Set("otherReports", Napi::Number::New(env, static_cast<double>(counters.otherReports)));
+  stats.Set("filteredTime", Napi::Number::New(env, static_cast<double>(counters.filteredTime)));
+  stats.Set("unfilteredTime", Napi::Number::New(env, static_cast<double>(counters.unfilteredTime)));
+  stats.Set("reportsSaved", Napi::Number::New(env, counters.reportsSaved));
+  return stats;
+}
+
+bool BluetoothHciSocket::syncAcceptList(const char* data, int length) {
+  uint64_t now = MonotonicMs();
+  std::vector<std::string> commands;
+  bool consumed = false;
+  {
+    std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+    if (data != nullptr) {
+      consumed = this->_acceptList.observeEvent(reinterpret_cast<const uint8_t*>(data), length, now);
+    }
+    // The connect scheduler has the list while devices are queued; changes resume once it is done
+    if (!this->_connectActive.load(std::memory_order_relaxed)) {
+      this->_acceptList.take(commands, now);
+    }
+    this->_acceptListActive = this->_acceptList.active();
+  }
+
+  for (const std::string& command : commands) {
+    if (write(this->_socket, command.data(), command.size()) < 0) {
+      int error = errno;
+      {
+        std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+        this->_acceptList.writeFailed(now);
+      }
+      this->PushError("write", error);
+      break;
+    }
+  }
+  return consumed;
+}
+
+void BluetoothHciSocket::ConnectDevices(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (this->_mode != HCI_CHANNEL_RAW && this->_mode != HCI_CHANNEL_USER) {
+    Napi::TypeError::New(env, "connectDevices: the socket must be bound in raw or user mode").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Null cancels the queue; every device still queued is reported cancelled
+  Napi::Value list = info.Length() > 0 ? info[0] : env.Undefined();
+  if (!list.IsArray()) {
+    {
+      std::lock_guard<std::mutex> lock(this->_connectMutex);
+      this->_connect.cancel(MonotonicMs());
+    }
+    this->syncConnect(nullptr, 0);
+    return;
+  }
+
+  Napi::Array array = list.As<Napi::Array>();
+  std::vector<HciConnectTarget> targets(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value entry = array.Get(i);
+    Napi::Object object = entry.IsObject() ? entry.As<Napi::Object>() : Napi::Object::New(env);
+    Napi::Value address = object.Get("address");
+    Napi::Value addressType = object.Get("addressType");
+    Napi::Value priority = object.Get("priority");
+    Napi::Value timeout = object.Get("timeout");
+    HciConnectTarget& target = targets[i];
+
+    if (!address.IsString() || !ParseAddress(address.As<Napi::String>().Utf8Value(), &target.address)) {
+      Napi::TypeError::New(env, "connectDevices: target " + std::to_string(i) + " needs an address").ThrowAsJavaScriptException();
+      return;
+    }
+    if (addressType.IsString()) {
+      target.type = addressType.As<Napi::String>().Utf8Value() == "random" ? 0x01 : 0x00;
+    } else {
+      target.type = addressType.IsNumber() ? addressType.As<Napi::Number>().Uint32Value() & 0x01 : 0x00;
+    }
+    target.priority = priority.IsNumber() ? priority.As<Napi::Number>().Int32Value() : 0;
+    target.timeout = timeout.IsNumber() ? std::max<int64_t>(0, timeout.As<Napi::Number>().Int64Value()) : 0;
+  }
+
+  BluetoothHciConnectScheduler::Options options;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object object = info[1].As<Napi::Object>();
+    if (object.Get("capacity").IsNumber()) {
+      options.capacity = object.Get("capacity").As<Napi::Number>().Uint32Value();
+    }
+    if (object.Get("timeout").IsNumber()) {
+      options.timeout = std::max<int64_t>(100, object.Get("timeout").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("attempts").IsNumber()) {
+      int64_t attempts = object.Get("attempts").As<Napi::Number>().Int64Value();
+      if (attempts < 1) {
+        Napi::RangeError::New(env, "connectDevices: attempts must be at least 1").ThrowAsJavaScriptException();
+        return;
+      }
+      options.attempts = static_cast<uint32_t>(std::min<int64_t>(attempts, UINT32_MAX));
+    }
+    if (object.Get("extended").IsBoolean()) {
+      options.extended = object.Get("extended").As<Napi::Boolean>().Value();
+    }
+    if (object.Get("ownAddressType").IsNumber()) {
+      options.ownAddressType = object.Get("ownAddressType").As<Napi::Number>().Uint32Value() & 0xFF;
+    }
+
+    // Connection parameters in the controller's units, as in LE Create Connection
+    std::pair<const char*, uint16_t*> parameters[] = {
+      { "scanInterval", &options.scanInterval },
+      { "scanWindow", &options.scanWindow },
+      { "connMinInterval", &options.connMinInterval },
+      { "connMaxInterval", &options.connMaxInterval },
+      { "connLatency", &options.connLatency },
+      { "supervisionTimeout", &options.supervisionTimeout }
+    };
+    for (auto& parameter : parameters) {
+      if (object.Get(parameter.first).IsNumber()) {
+        *parameter.second = object.Get(parameter.first).As<Napi::Number>().Uint32Value() & 0xFFFF;
+      }
+    }
+  }
+
+  // The first commands go out now; the polling thread sends the rest as they complete
+  {
+    std::lock_guard<std::mutex> lock(this->_connectMutex);
+    this->_connect.connect(targets, options, MonotonicMs());
+    this->_connectActive = this->_connect.active();
+  }
+  this->syncConnect(nullptr, 0);
+}
+
+Napi::Value BluetoothHciSocket::GetConnectStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  HciConnectStats counters;
+  {
+    std::lock_guard<std::mutex> lock(this->_connectMutex);
+    counters = this->_connect.stats();
+  }
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("queued", Napi::Number::New(env, static_cast<double>(counters.queued)));
+  stats.Set("installed", Napi::Number::New(env, static_cast<double>(counters.installed)));
+  stats.Set("capacity", Napi::Number::New(env, static_cast<double>(counters.capacity)));
+  stats.Set("connected", Napi::Number::New(env, static_cast<double>(counters.connected)));
+  stats.Set("failed", Napi::Number::New(env, static_cast<double>(counters.failed)));
+  stats.Set("initiations", Napi::Number::New(env, static_cast<double>(counters.initiations)));
+  stats.Set("cancels", Napi::Number::New(env, static_cast<double>(counters.cancels)));
+  stats.Set("commands", Napi::Number::New(env, static_cast<double>(counters.commands)));
+  stats.Set("deferred", Napi::Number::New(env, static_cast<double>(counters.deferred)));
+  stats.Set("latencyMean", Napi::Number::New(env, counters.connected > 0 ?
+                                                  static_cast<double>(counters.latencyTotal) / counters.connected : 0));
+  stats.Set("latencyMax", Napi::Number::New(env, static_cast<double>(counters.latencyMax)));
+  return stats;
+}
+
+bool BluetoothHciSocket::syncConnect(const char* data, int length) {
+  uint64_t now = MonotonicMs();
+  std::vector<std::string> commands;
+  std::vector<HciConnectResult> results;
+  bool consumed = false;
+  bool wasActive;
+  bool active;
+  {
+    std::lock_guard<std::mutex> lock(this->_connectMutex);
+    if (data != nullptr) {
+      consumed = this->_connect.observeEvent(reinterpret_cast<const uint8_t*>(data), length, now);
+    }
+    this->_connect.take(commands, now);
+    this->_connect.results(results);
+    wasActive = this->_connectActive;
+    active = this->_connect.active();
+    this->_connectActive = active;
+  }
+
+  // The accept list manager sees the scheduler's commands as the host's, so it refills the list afterwards
+  if (!commands.empty()) {
+    std::lock_guard<std::mutex> lock(this->_acceptListMutex);
+    for (const std::string& command : commands) {
+      this->_acceptList.observeCommand(reinterpret_cast<const uint8_t*>(command.data()), command.size(), now);
+    }
+  }
+  for (const std::string& command : commands) {
+    if (write(this->_socket, command.data(), command.size()) < 0) {
+      int error = errno;
+      {
+        std::lock_guard<std::mutex> lock(this->_connectMutex);
+        this->_connect.writeFailed(now);
+        active = this->_connect.active();
+        this->_connectActive = active;
+      }
+      this->PushError("write", error);
+      break;
+    }
+  }
+
+  for (const HciConnectResult& result : results) {
+    this->_delivery.push([result](Napi::Env env, Napi::Object target) {
+      static const char* const outcomes[] = { "connected", "timeout", "rejected", "failed", "cancelled" };
+      char address[18];
+      const uint8_t* a = result.address.b;
+      snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+
+      Napi::Object obj = Napi::Object::New(env);
+      obj.Set("address", Napi::String::New(env, address));
+      obj.Set("addressType", Napi::String::New(env, result.type & 0x01 ? "random" : "public"));
+      obj.Set("outcome", Napi::String::New(env, outcomes[result.outcome]));
+      obj.Set("status", Napi::Number::New(env, result.status));
+      if (result.outcome == HciConnectResult::Connected) {
+        obj.Set("handle", Napi::Number::New(env, result.handle));
+      }
+      obj.Set("attempts", Napi::Number::New(env, result.attempts));
+      obj.Set("latency", Napi::Number::New(env, static_cast<double>(result.latency)));
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "connectResult"), obj });
+    }, BluetoothHciDelivery::Data);
+  }
+
+  // Changes the accept list manager held back go out once the queue is done
+  if (wasActive && !active && this->_acceptListActive.load(std::memory_order_relaxed)) {
+    this->syncAcceptList(nullptr, 0);
+  }
+  return consumed;
+}
+
+void BluetoothHciSocket::SetObservationStore(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    this->_observations.close();
+    return;
+  }
+
+  BluetoothHciObservationStore::Options options;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object object = info[1].As<Napi::Object>();
+    if (object.Get("segmentDuration").IsNumber()) {
+      options.segmentDuration = std::max<int64_t>(0, object.Get("segmentDuration").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("segmentSize").IsNumber()) {
+      options.segmentSize = std::max<int64_t>(0, object.Get("segmentSize").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("maxBytes").IsNumber()) {
+      options.maxBytes = std::max<int64_t>(0, object.Get("maxBytes").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("maxAge").IsNumber()) {
+      options.maxAge = std::max<int64_t>(0, object.Get("maxAge").As<Napi::Number>().Int64Value());
+    }
+  }
+
+  std::string directory = info[0].As<Napi::String>().Utf8Value();
+  int error = this->_observations.open(directory, options, WallClockMs());
+  if (error != 0) {
+    Napi::Error err = Napi::Error::New(env, strerror(error));
+    err.Set("syscall", Napi::String::New(env, "open"));
+    err.Set("errno", Napi::Number::New(env, error));
+    err.Set("path", Napi::String::New(env, directory));
+    err.ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value BluetoothHciSocket::QueryObservations(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Every observation becomes a JS object: a query without a limit is still bounded
+  HciObservationQuery query;
+  query.limit = 10000;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object object = info[0].As<Napi::Object>();
+    Napi::Value address = object.Get("address");
+    Napi::Value addressType = object.Get("addressType");
+    if (object.Get("from").IsNumber()) {
+      query.from = std::max<int64_t>(0, object.Get("from").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("to").IsNumber()) {
+      query.to = std::max<int64_t>(0, object.Get("to").As<Napi::Number>().Int64Value());
+    }
+    if (object.Get("limit").IsNumber()) {
+      query.limit = std::max<int64_t>(0, object.Get("limit").As<Napi::Number>().Int64Value());
+    }
+    if (address.IsString()) {
+      bdaddr_t parsed;
+      if (!ParseAddress(address.As<Napi::String>().Utf8Value(), &parsed)) {
+        Napi::TypeError::New(env, "queryObservations: address must be aa:bb:cc:dd:ee:ff").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+      query.byAddress = true;
+      memcpy(query.address, parsed.b, sizeof(query.address));
+    }
+    if (addressType.IsString()) {
+      query.addressType = addressType.As<Napi::String>().Utf8Value() == "random" ? 0x01 : 0x00;
+    } else if (addressType.IsNumber()) {
+      query.addressType = addressType.As<Napi::Number>().Uint32Value() & 0xFF;
+    }
+  }
+
+  std::vector<HciObservation> observations;
+  this->_observations.query(query, observations);
+
+  Napi::Array result = Napi::Array::New(env, observations.size());
+  for (size_t i = 0; i < observations.size(); i++) {
+    const HciObservation& observation = observations[i];
+    char address[18];
+    const uint8_t* a = observation.address;
+    snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("time", Napi::Number::New(env, static_cast<double>(observation.time)));
+    obj.Set("address", Napi::String::New(env, address));
+    obj.Set("addressType", Napi::String::New(env, observation.addressType & 0x01 ? "random" : "public"));
+    obj.Set("rssi", Napi::Number::New(env, observation.rssi));
+    obj.Set("eventType", Napi::Number::New(env, observation.eventType));
+    obj.Set("data", Napi::Buffer<char>::Copy(env, observation.data.data(), observation.data.length()));
+    result.Set(i, obj);
+  }
+  return result;
+}
+
+Napi::Value BluetoothHciSocket::GetObservationStoreStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+
+  HciObservationStoreStats counters = this->_observations.stats();
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("open", Napi::Boolean::New(env, this->_observations.isOpen()));
+  stats.Set("segments", Napi::Number::New(env, static_cast<double>(counters.segments)));
+  stats.Set("bytes", Napi::Number::New(env, static_cast<double>(counters.bytes)));
+  stats.Set("records", Napi::Number::New(env, static_cast<double>(counters.records)));
+  stats.Set("appended", Napi::Number::New(env, static_cast<double>(counters.appended)));
+  stats.Set("deduplicated", Napi::Number::New(env, static_cast<double>(counters.deduplicated)));
+  stats.Set("dropped", Napi::Number::New(env, static_cast<double>(counters.dropped)));
+  stats.Set("pruned", Napi::Number::New(env, static_cast<double>(counters.pruned)));
+  return stats;
+}
+
+std::shared_ptr<const BluetoothHciAdMatcher> BluetoothHciSocket::adMatcher() {
+  std::lock_guard<std::mutex> lock(this->_adMatcherMutex);
+  return this->_adMatcher;
+}
+
+Napi::Value BluetoothHciSocket::StartBroker(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (this->_mode != HCI_CHANNEL_RAW && this->_mode != HCI_CHANNEL_USER) {
+    Napi::TypeError::New(env, "startBroker: the socket must be bound in raw or user mode").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  size_t size = BluetoothHciSharedRing::kDefaultSize;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Value value = info[0].As<Napi::Object>().Get("size");
+    if (!value.IsUndefined()) {
+      if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < BluetoothHciSharedRing::kMinSize ||
+          value.As<Napi::Number>().DoubleValue() > (1u << 30)) {
+        Napi::TypeError::New(env, "startBroker: size must be between 64 KiB and 1 GiB").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+      size = static_cast<size_t>(value.As<Napi::Number>().DoubleValue());
+    }
+  }
+
+  if (!this->_broker) {
+    int error = 0;
+    std::unique_ptr<BluetoothHciSharedRing> ring = BluetoothHciSharedRing::Create(size, error);
+    if (!ring) {
+      errno = error;
+      this->EmitError(info, "memfd_create");
+      return env.Null();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->_brokerMutex);
+      this->_broker = std::move(ring);
+    }
+    this->_brokerActive = true;
+    this->_brokerStop = false;
+    this->_brokerThread = std::thread(&BluetoothHciSocket::RunBroker, this);
+  }
+
+  // Other processes map the ring through the path, or an inherited descriptor
+  int fd = this->_broker->fd();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("fd", Napi::Number::New(env, fd));
+  result.Set("path", Napi::String::New(env, "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(fd)));
+  return result;
+}
+
+void BluetoothHciSocket::StopBroker(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->stopBroker();
+}
+
+Napi::Value BluetoothHciSocket::GetBrokerConsumers(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  std::vector<HciRingConsumerInfo> consumers;
+  if (this->_broker) {
+    consumers = this->_broker->consumers();
+  }
+
+  Napi::Array result = Napi::Array::New(env, consumers.size());
+  for (size_t i = 0; i < consumers.size(); i++) {
+    const HciRingConsumerInfo& c = consumers[i];
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("slot", Napi::Number::New(env, c.slot));
+    obj.Set("pid", Napi::Number::New(env, c.pid));
+    obj.Set("lag", Napi::Number::New(env, static_cast<double>(c.lag)));
+    obj.Set("delivered", Napi::Number::New(env, static_cast<double>(c.delivered)));
+    obj.Set("filtered", Napi::Number::New(env, static_cast<double>(c.filtered)));
+    obj.Set("lost", Napi::Number::New(env, static_cast<double>(c.lost)));
+    result.Set(i, obj);
+  }
+  return result;
+}
+
+void BluetoothHciSocket::RunBroker() {
+  std::string command;
+
+  while (!this->_brokerStop) {
+    this->_broker->waitCommand(100);
+
+    while (this->_broker->takeCommand(command)) {
+      char* data = command.data();
+      int length = static_cast<int>(command.size());
+
+      // Consumer commands get the same treatment as local writes
+      if (this->_mode == HCI_CHANNEL_RAW && this->kernelConnectWorkArounds(data, length)) {
+        continue;
+      }
+
+      if (write(this->_socket, data, length) < 0) {
+        this->PushError("write", errno);
+      } else if (this->_mode == HCI_CHANNEL_RAW || this->_mode == HCI_CHANNEL_USER) {
+        this->observeWrite(data, length);
+      }
+    }
+  }
+}
+
+void BluetoothHciSocket::stopBroker() {
+  if (!this->_broker) {
+    return;
+  }
+
+  // Consumers see the ring closed; their mappings stay valid until they detach
+  this->_brokerActive = false;
+  this->_brokerStop = true;
+  this->_broker->close();
+  if (this->_brokerThread.joinable()) {
+    this->_brokerThread.join();
+  }
+
+  std::lock_guard<std::mutex> lock(this->_brokerMutex);
+  this->_broker.reset();
+}
+
+void BluetoothHciSocket::ProbeController(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Null cancels a running probe without calling back
+  if (info.Length() > 0 && info[0].IsNull()) {
+    std::lock_guard<std::mutex> lock(this->_probeMutex);
+    this->_probeActive = false;
+    this->_probe.reset();
+    this->_probeCallback.Reset();
+    return;
+  }
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "probeController: expected options and a callback").ThrowAsJavaScriptException();
+    return;
+  }
+
+  if ((this->_mode != HCI_CHANNEL_RAW && this->_mode != HCI_CHANNEL_USER) || stopFlag || !pollingThread.joinable()) {
+    Napi::TypeError::New(env, "probeController: the socket must be bound in raw or user mode and started").ThrowAsJavaScriptException();
+    return;
+  }
+
+  Napi::Value identityOnly = info[0].As<Napi::Object>().Get("identityOnly");
+  std::vector<std::string> commands;
+  {
+    std::lock_guard<std::mutex> lock(this->_probeMutex);
+    if (this->_probe) {
+      Napi::TypeError::New(env, "probeController: a probe is already running").ThrowAsJavaScriptException();
+      return;
+    }
+    this->_probe = std::make_unique<BluetoothHciControllerProbe>(identityOnly.IsBoolean() && identityOnly.As<Napi::Boolean>().Value());
+    this->_probeCallback = Napi::Persistent(info[1].As<Napi::Function>());
+    this->_probeActive = true;
+    this->_probe->take(commands);
+  }
+
+  // Later commands are sent by the polling thread as completions arrive
+  for (const std::string& command : commands) {
+    if (write(this->_socket, command.data(), command.size()) < 0) {
+      {
+        std::lock_guard<std::mutex> lock(this->_probeMutex);
+        this->_probeActive = false;
+        this->_probe.reset();
+      }
+      Napi::Function callback = this->_probeCallback.Value();
+      this->_probeCallback.Reset();
+
+      Napi::Error error = Napi::Error::New(env, strerror(errno));
+      error.Set("syscall", Napi::String::New(env, "write"));
+      error.Set("errno", Napi::Number::New(env, errno));
+      callback.Call({ error.Value() });
+      return;
+    }
+  }
+}
+
+bool BluetoothHciSocket::observeProbe(const char* data, int length) {
+  std::vector<std::string> commands;
+  std::map<uint16_t, std::string> results;
+  bool done = false;
+  {
+    std::lock_guard<std::mutex> lock(this->_probeMutex);
+    if (!this->_probe || !this->_probe->observe(reinterpret_cast<const uint8_t*>(data), length)) {
+      return false;
+    }
+
+    this->_probe->take(commands);
+    if (this->_probe->done()) {
+      results = this->_probe->results();
+      this->_probe.reset();
+      this->_probeActive = false;
+      done = true;
+    }
+  }
+
+  for (const std::string& command : commands) {
+    if (write(this->_socket, command.data(), command.size()) < 0) {
+      int error = errno;
+      {
+        std::lock_guard<std::mutex> lock(this->_probeMutex);
+        this->_probe.reset();
+        this->_probeActive = false;
+      }
+      // The probe ends with the error, like a first write that fails
+      this->_delivery.push([this, error](Napi::Env env, Napi::Object target) {
+        if (this->_probeCallback.IsEmpty()) {
+          return;
+        }
+        Napi::Function callback = this->_probeCallback.Value();
+        this->_probeCallback.Reset();
+
+        Napi::Error err = Napi::Error::New(env, strerror(error));
+        err.Set("syscall", Napi::String::New(env, "write"));
+        err.Set("errno", Napi::Number::New(env, error));
+        callback.Call({ err.Value() });
+      });
+      return true;
+    }
+  }
+
+  if (done) {
+    this->_delivery.push([this, results = std::move(results)](Napi::Env env, Napi::Object target) {
+      // Cancelled while the results were queued
+      if (this->_probeCallback.IsEmpty()) {
+        return;
+      }
+      Napi::Function callback = this->_probeCallback.Value();
+      this->_probeCallback.Reset();
+      callback.Call({ env.Null(), CapabilitiesToObject(env, results) });
+    });
+  }
+  return true;
+}
+
+Napi::Object BluetoothHciSocket::CapabilitiesToObject(Napi::Env env, const std::map<uint16_t, std::string>& results) {
+  Napi::Object capabilities = Napi::Object::New(env);
+
+  // Return parameters of a command, if it succeeded with at least `length` bytes
+  auto result = [&results](uint16_t opcode, size_t length) -> const uint8_t* {
+    auto it = results.find(opcode);
+    if (it == results.end() || it->second.size() < length) {
+      return nullptr;
+    }
+    return reinterpret_cast<const uint8_t*>(it->second.data());
+  };
+  auto bytes = [env](const uint8_t* p, size_t length) {
+    return Napi::Buffer<uint8_t>::Copy(env, p, length);
+  };
+
+  if (const uint8_t* p = result(HCI_READ_BD_ADDR, 6)) {
+    char address[18];
+    snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x", p[5], p[4], p[3], p[2], p[1], p[0]);
+    capabilities.Set("address", Napi::String::New(env, address));
+  }
+  if (const uint8_t* p = result(HCI_READ_LOCAL_VERSION, 8)) {
+    Napi::Object version = Napi::Object::New(env);
+    version.Set("hci", Napi::Number::New(env, p[0]));
+    version.Set("hciRevision", Napi::Number::New(env, p[1] | (p[2] << 8)));
+    version.Set("lmp", Napi::Number::New(env, p[3]));
+    version.Set("manufacturer", Napi::Number::New(env, p[4] | (p[5] << 8)));
+    version.Set("lmpSubversion", Napi::Number::New(env, p[6] | (p[7] << 8)));
+    capabilities.Set("version", version);
+  }
+  if (const uint8_t* p = result(HCI_READ_LOCAL_COMMANDS, 64)) {
+    capabilities.Set("commands", bytes(p, 64));
+  }
+  if (const uint8_t* p = result(HCI_READ_LOCAL_FEATURES, 8)) {
+    capabilities.Set("features", bytes(p, 8));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_LOCAL_FEATURES, 8)) {
+    capabilities.Set("leFeatures", bytes(p, 8));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_SUPPORTED_STATES, 8)) {
+    capabilities.Set("leStates", bytes(p, 8));
+  }
+  if (const uint8_t* p = result(HCI_READ_BUFFER_SIZE, 7)) {
+    capabilities.Set("aclMtu", Napi::Number::New(env, p[0] | (p[1] << 8)));
+    capabilities.Set("scoMtu", Napi::Number::New(env, p[2]));
+    capabilities.Set("aclPackets", Napi::Number::New(env, p[3] | (p[4] << 8)));
+    capabilities.Set("scoPackets", Napi::Number::New(env, p[5] | (p[6] << 8)));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_BUFFER_SIZE_V2, 6)) {
+    capabilities.Set("leAclMtu", Napi::Number::New(env, p[0] | (p[1] << 8)));
+    capabilities.Set("leAclPackets", Napi::Number::New(env, p[2]));
+    capabilities.Set("isoMtu", Napi::Number::New(env, p[3] | (p[4] << 8)));
+    capabilities.Set("isoPackets", Napi::Number::New(env, p[5]));
+  } else if (const uint8_t* p = result(HCI_LE_READ_BUFFER_SIZE, 3)) {
+    capabilities.Set("leAclMtu", Napi::Number::New(env, p[0] | (p[1] << 8)));
+    capabilities.Set("leAclPackets", Napi::Number::New(env, p[2]));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_MAX_DATA_LEN, 8)) {
+    Napi::Object dataLength = Napi::Object::New(env);
+    dataLength.Set("txOctets", Napi::Number::New(env, p[0] | (p[1] << 8)));
+    dataLength.Set("txTime", Napi::Number::New(env, p[2] | (p[3] << 8)));
+    dataLength.Set("rxOctets", Napi::Number::New(env, p[4] | (p[5] << 8)));
+    dataLength.Set("rxTime", Napi::Number::New(env, p[6] | (p[7] << 8)));
+    capabilities.Set("maxDataLength", dataLength);
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_MAX_ADV_DATA_LEN, 2)) {
+    capabilities.Set("maxAdvertisingDataLength", Napi::Number::New(env, p[0] | (p[1] << 8)));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_NUM_ADV_SETS, 1)) {
+    capabilities.Set("advertisingSets", Napi::Number::New(env, p[0]));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_ACCEPT_LIST_SIZE, 1)) {
+    capabilities.Set("acceptListSize", Napi::Number::New(env, p[0]));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_RESOLV_LIST_SIZE, 1)) {
+    capabilities.Set("resolvingListSize", Napi::Number::New(env, p[0]));
+  }
+  if (const uint8_t* p = result(HCI_LE_READ_TX_POWER, 2)) {
+    Napi::Object txPower = Napi::Object::New(env);
+    txPower.Set("min", Napi::Number::New(env, static_cast<int8_t>(p[0])));
+    txPower.Set("max", Napi::Number::New(env, static_cast<int8_t>(p[1])));
+    capabilities.Set("txPower", txPower);
+  }
+
+  return capabilities;
+}
+
+Napi::Value BluetoothHciSocket::GetAdapterLoad(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  std::vector<HciAdapterLoad> loads = this->_router.load();
+
+  Napi::Array result = Napi::Array::New(env, loads.size());
+  for (size_t i = 0; i < loads.size(); i++) {
+    const HciAdapterLoad& l = loads[i];
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("devId", Napi::Number::New(env, l.devId));
+    obj.Set("connections", Napi::Number::New(env, l.connections));
+    obj.Set("pending", Napi::Number::New(env, l.pending));
+    obj.Set("maxConnections", Napi::Number::New(env, l.maxConnections));
+    obj.Set("aclMtu", Napi::Number::New(env, l.aclMtu));
+    obj.Set("aclBuffers", Napi::Number::New(env, l.aclBuffers));
+    obj.Set("aclInFlight", Napi::Number::New(env, l.aclInFlight));
+    obj.Set("connectsTotal", Napi::Number::New(env, l.connectsTotal));
+    obj.Set("failuresTotal", Napi::Number::New(env, l.failuresTotal));
+    result.Set(i, obj);
+  }
+
+  return result;
+}
+
+void BluetoothHciSocket::DecodeAdvertisements(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() > 0 && info[0].IsFunction()) {
+    this->_advertisementView = Napi::Persistent(info[0].As<Napi::Function>());
+    this->_decodeAdvertisements = true;
+  } else {
+    this->_decodeAdvertisements = false;
+    this->_advertisementView.Reset();
+  }
+}
+
+void BluetoothHciSocket::BatchAdvertisements(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  bool enabled = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+  this->_batchAdvertisements = enabled;
+  if (!enabled) {
+    this->_advertisingColumns.clear();
+  }
+}
+
+void BluetoothHciSocket::ConfigureScanTable(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    this->_scanTable.disable();
+    return;
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  BluetoothHciScanTable::Options tableOptions;
+  if (options.Get("capacity").IsNumber()) {
+    tableOptions.capacity = options.Get("capacity").As<Napi::Number>().Uint32Value();
+  }
+  if (options.Get("lostTimeout").IsNumber()) {
+    tableOptions.lostTimeout = options.Get("lostTimeout").As<Napi::Number>().Uint32Value();
+  }
+  if (options.Get("alpha").IsNumber()) {
+    tableOptions.alpha = options.Get("alpha").As<Napi::Number>().FloatValue();
+  }
+  if (options.Get("medianWindow").IsNumber()) {
+    tableOptions.medianWindow = options.Get("medianWindow").As<Napi::Number>().Uint32Value();
+  }
+  if (options.Get("rssiThreshold").IsNumber()) {
+    tableOptions.rssiThreshold = options.Get("rssiThreshold").As<Napi::Number>().FloatValue();
+  }
+
+  this->_scanTable.enable(tableOptions);
+}
+
+Napi::Value BluetoothHciSocket::TakeScanSnapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  HciScanSnapshot snapshot = this->_scanTable.snapshot();
+
+  Napi::Array added = Napi::Array::New(env, snapshot.added.size());
+  for (size_t i = 0; i < snapshot.added.size(); i++) {
+    added.Set(i, ScanDeviceToObject(env, snapshot.added[i], true));
+  }
+  Napi::Array changed = Napi::Array::New(env, snapshot.changed.size());
+  for (size_t i = 0; i < snapshot.changed.size(); i++) {
+    changed.Set(i, ScanDeviceToObject(env, snapshot.changed[i], true));
+  }
+  Napi::Array lost = Napi::Array::New(env, snapshot.lost.size());
+  for (size_t i = 0; i < snapshot.lost.size(); i++) {
+    lost.Set(i, ScanDeviceToObject(env, snapshot.lost[i], false));
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("added", added);
+  result.Set("changed", changed);
+  result.Set("lost", lost);
+  return result;
+}
+
+Napi::Object BluetoothHciSocket::ScanDeviceToObject(Napi::Env env, const HciScanDevice& device, bool full) {
+  char address[18];
+  const uint8_t* a = device.address;
+  snprintf(address, sizeof(address), "%02x:%02x:%02x:%02x:%02x:%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("address", Napi::String::New(env, address));
+  obj.Set("addressType", Napi::String::New(env, device.addressType & 0x01 ? "random" : "public"));
+  if (!full) {
+    return obj;
+  }
+  obj.Set("rssi", Napi::Number::New(env, device.rssi));
+  obj.Set("rssiSmoothed", Napi::Number::New(env, device.rssiSmoothed));
+  obj.Set("rssiMedian", Napi::Number::New(env, device.rssiMedian));
+  obj.Set("firstSeen", Napi::Number::New(env, static_cast<double>(device.firstSeen)));
+  obj.Set("lastSeen", Napi::Number::New(env, static_cast<double>(device.lastSeen)));
+  obj.Set("count", Napi::Number::New(env, static_cast<double>(device.count)));
+  obj.Set("data", Napi::Buffer<char>::Copy(env, device.data.data(), device.data.length()));
+  return obj;
+}
+
+Napi::Value BluetoothHciSocket::SubscribeAtt(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsFunction()) {
+    Napi::TypeError::New(env, "subscribeAtt: expected (connHandle, attrHandle, callback)").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  uint16_t connHandle = info[0].As<Napi::Number>().Uint32Value();
+  uint16_t attrHandle = info[1].As<Napi::Number>().Uint32Value();
+
+  // Confirming natively bypasses the host's ACL accounting, so it is opt-in
+  bool confirm = false;
+  if (info.Length() > 3 && info[3].IsObject()) {
+    Napi::Value value = info[3].As<Napi::Object>().Get("confirm");
+    confirm = value.IsBoolean() && value.As<Napi::Boolean>().Value();
+  }
+
+  uint32_t id = this->_attRouter.subscribe(connHandle, attrHandle, confirm);
+  if (id == 0) {
+    Napi::Error::New(env, "Attribute is already subscribed").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  this->_attCallbacks[id] = Napi::Persistent(info[2].As<Napi::Function>());
+  return Napi::Number::New(env, id);
+}
+
+Napi::Value BluetoothHciSocket::UnsubscribeAtt(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+  this->_attCallbacks.erase(id);
+  return Napi::Boolean::New(env, this->_attRouter.unsubscribe(id));
+}
+
+void BluetoothHciSocket::ReassembleIso(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->_reassembleIso = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+}
+
+void BluetoothHciSocket::WriteIsoSdu(const Napi::CallbackInfo& info) {
+  if (!this->EnsureSocket(info)) {
+    return;
+  }
+
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBuffer()) {
+    Napi::TypeError::New(env, "writeIsoSdu: expected (connHandle, sdu, options)").ThrowAsJavaScriptException();
+    return;
+  }
+
+  uint16_t connHandle = info[0].As<Napi::Number>().Uint32Value();
+  Napi::Buffer<uint8_t> sdu = info[1].As<Napi::Buffer<uint8_t>>();
+
+  uint16_t sequenceNumber = 0;
+  bool hasTimestamp = false;
+  uint32_t timestamp = 0;
+  uint16_t mtu = this->_iso.mtu();
+
+  if (info.Length() > 2 && info[2].IsObject()) {
+    Napi::Object options = info[2].As<Napi::Object>();
+    if (options.Get("sequenceNumber").IsNumber()) {
+      sequenceNumber = options.Get("sequenceNumber").As<Napi::Number>().Uint32Value();
+    }
+    if (options.Get("timestamp").IsNumber()) {
+      hasTimestamp = true;
+      timestamp = options.Get("timestamp").As<Napi::Number>().Uint32Value();
+    }
+    if (options.Get("mtu").IsNumber()) {
+      mtu = options.Get("mtu").As<Napi::Number>().Uint32Value();
+    }
+  }
+
+  if (mtu == 0) {
+    Napi::Error::New(env, "ISO buffer size unknown: read it with LE Read Buffer Size [v2] or pass options.mtu").ThrowAsJavaScriptException();
+    return;
+  }
+  if (sdu.Length() > 0x0FFF) {
+    Napi::RangeError::New(env, "ISO SDU longer than 4095 bytes").ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::vector<std::string> packets = BluetoothHciIsoAssembler::Fragment(
+    connHandle, sdu.Data(), sdu.Length(), sequenceNumber, hasTimestamp, timestamp, mtu);
+
+  for (const std::string& packet : packets) {
+    if (write(this->_socket, packet.data(), packet.length()) < 0) {
+      this->EmitError(info, "write");
+      return;
+    }
+  }
+}
+
+bool BluetoothHciSocket::ParseAddress(const std::string& str, bdaddr_t* address) {
+  unsigned int b[6];
+  if (sscanf(str.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &b[5], &b[4], &b[3], &b[2], &b[1], &b[0]) != 6) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    address->b[i] = static_cast<uint8_t>(b[i]);
+  }
+  return true;
 }
 
 void BluetoothHciSocket::Cleanup(const Napi::CallbackInfo& info) {
@@ -697,12 +2518,47 @@ Napi::Object BluetoothHciSocket::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("bindRaw", &BluetoothHciSocket::BindRaw),
     InstanceMethod("bindUser", &BluetoothHciSocket::BindUser),
     InstanceMethod("bindControl", &BluetoothHciSocket::BindControl),
+    InstanceMethod("bindMonitor", &BluetoothHciSocket::BindMonitor),
     InstanceMethod("isDevUp", &BluetoothHciSocket::IsDevUp),
     InstanceMethod("getDeviceList", &BluetoothHciSocket::GetDeviceList),
     InstanceMethod("setFilter", &BluetoothHciSocket::SetFilter),
     InstanceMethod("stop", &BluetoothHciSocket::Stop),
     InstanceMethod("write", &BluetoothHciSocket::Write),
-    InstanceMethod("cleanup", &BluetoothHciSocket::Cleanup)
+    InstanceMethod("onPacket", &BluetoothHciSocket::OnPacket),
+    InstanceMethod("setDeliveryLanes", &BluetoothHciSocket::SetDeliveryLanes),
+    InstanceMethod("getDeliveryStats", &BluetoothHciSocket::GetDeliveryStats),
+    InstanceMethod("cleanup", &BluetoothHciSocket::Cleanup),
+    InstanceMethod("pickAdapter", &BluetoothHciSocket::PickAdapter),
+    InstanceMethod("getAdapterLoad", &BluetoothHciSocket::GetAdapterLoad),
+    InstanceMethod("probeController", &BluetoothHciSocket::ProbeController),
+    InstanceMethod("setThreadOptions", &BluetoothHciSocket::SetThreadOptions),
+    InstanceMethod("getReadStats", &BluetoothHciSocket::GetReadStats),
+    InstanceMethod("setFlowControl", &BluetoothHciSocket::SetFlowControl),
+    InstanceMethod("grantCredit", &BluetoothHciSocket::GrantCredit),
+    InstanceMethod("setReceiveBuffer", &BluetoothHciSocket::SetReceiveBuffer),
+    InstanceMethod("getReceiveQueueStats", &BluetoothHciSocket::GetReceiveQueueStats),
+    InstanceMethod("setIrks", &BluetoothHciSocket::SetIrks),
+    InstanceMethod("getResolverStats", &BluetoothHciSocket::GetResolverStats),
+    InstanceMethod("setAdPatterns", &BluetoothHciSocket::SetAdPatterns),
+    InstanceMethod("getAdPatternStats", &BluetoothHciSocket::GetAdPatternStats),
+    InstanceMethod("setAcceptList", &BluetoothHciSocket::SetAcceptList),
+    InstanceMethod("getAcceptListStats", &BluetoothHciSocket::GetAcceptListStats),
+    InstanceMethod("connectDevices", &BluetoothHciSocket::ConnectDevices),
+    InstanceMethod("getConnectStats", &BluetoothHciSocket::GetConnectStats),
+    InstanceMethod("setObservationStore", &BluetoothHciSocket::SetObservationStore),
+    InstanceMethod("queryObservations", &BluetoothHciSocket::QueryObservations),
+    InstanceMethod("getObservationStoreStats", &BluetoothHciSocket::GetObservationStoreStats),
+    InstanceMethod("startBroker", &BluetoothHciSocket::StartBroker),
+    InstanceMethod("stopBroker", &BluetoothHciSocket::StopBroker),
+    InstanceMethod("getBrokerConsumers", &BluetoothHciSocket::GetBrokerConsumers),
+    InstanceMethod("decodeAdvertisements", &BluetoothHciSocket::DecodeAdvertisements),
+    InstanceMethod("batchAdvertisements", &BluetoothHciSocket::BatchAdvertisements),
+    InstanceMethod("configureScanTable", &BluetoothHciSocket::ConfigureScanTable),
+    InstanceMethod("subscribeAtt", &BluetoothHciSocket::SubscribeAtt),
+    InstanceMethod("reassembleIso", &BluetoothHciSocket::ReassembleIso),
+    InstanceMethod("writeIsoSdu", &BluetoothHciSocket::WriteIsoSdu),
+    InstanceMethod("unsubscribeAtt", &BluetoothHciSocket::UnsubscribeAtt),
+    InstanceMethod("takeScanSnapshot", &BluetoothHciSocket::TakeScanSnapshot)
   });
 
   Napi::FunctionReference* constructor = new Napi::FunctionReference();
@@ -713,4 +2569,3 @@ Napi::Object BluetoothHciSocket::Init(Napi::Env env, Napi::Object exports) {
   return exports;
 }
 
-NODE_API_NAMED_ADDON(addon, BluetoothHciSocket);
@@ -0,0 +1,137 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "BluetoothHciThread.h"
+
+// Linux limits thread names to 15 characters plus the terminator
+#define HCI_THREAD_NAME_MAX 15
+
+bool BluetoothHciThread::Parse(Napi::Value value, HciThreadOptions& options) {
+  Napi::Env env = value.Env();
+  options = HciThreadOptions();
+
+  if (value.IsUndefined() || value.IsNull()) {
+    return true;
+  }
+  if (!value.IsObject()) {
+    Napi::TypeError::New(env, "Thread options object expected").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+
+  Napi::Value cpus = object.Get("cpus");
+  if (!cpus.IsUndefined()) {
+    if (!cpus.IsArray()) {
+      Napi::TypeError::New(env, "cpus must be an array of CPU numbers").ThrowAsJavaScriptException();
+      return false;
+    }
+    Napi::Array array = cpus.As<Napi::Array>();
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value cpu = array.Get(i);
+      if (!cpu.IsNumber() || cpu.As<Napi::Number>().Int32Value() < 0 || cpu.As<Napi::Number>().Int32Value() >= CPU_SETSIZE) {
+        Napi::TypeError::New(env, "cpus must be an array of CPU numbers").ThrowAsJavaScriptException();
+        return false;
+      }
+      options.cpus.push_back(cpu.As<Napi::Number>().Int32Value());
+    }
+  }
+
+  Napi::Value nice = object.Get("nice");
+  if (!nice.IsUndefined()) {
+    if (!nice.IsNumber() || nice.As<Napi::Number>().Int32Value() < -20 || nice.As<Napi::Number>().Int32Value() > 19) {
+      Napi::TypeError::New(env, "nice must be a number from -20 to 19").ThrowAsJavaScriptException();
+      return false;
+    }
+    options.hasNice = true;
+    options.nice = nice.As<Napi::Number>().Int32Value();
+  }
+
+  Napi::Value priority = object.Get("priority");
+  if (!priority.IsUndefined()) {
+    if (!priority.IsNumber() || priority.As<Napi::Number>().Int32Value() < 0 || priority.As<Napi::Number>().Int32Value() > 99) {
+      Napi::TypeError::New(env, "priority must be a SCHED_FIFO priority from 1 to 99, or 0").ThrowAsJavaScriptException();
+      return false;
+    }
+    options.priority = priority.As<Napi::Number>().Int32Value();
+  }
+
+  Napi::Value name = object.Get("name");
+  if (!name.IsUndefined()) {
+    if (!name.IsString()) {
+      Napi::TypeError::New(env, "name must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    options.name = name.As<Napi::String>().Utf8Value();
+  }
+
+  return true;
+}
+
+std::vector<HciThreadFailure> BluetoothHciThread::Apply(const HciThreadOptions& options, const char* suffix) {
+  std::vector<HciThreadFailure> failures;
+
+  if (!options.cpus.empty()) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : options.cpus) {
+      CPU_SET(cpu, &set);
+    }
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+      failures.push_back({ "pthread_setaffinity_np", error });
+    }
+#else
+    failures.push_back({ "pthread_setaffinity_np", ENOSYS });
+#endif
+  }
+
+  // SCHED_FIFO ignores nice, so only one of them matters
+  if (options.priority > 0) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = options.priority;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+      failures.push_back({ "pthread_setschedparam", error });
+    }
+  } else if (options.hasNice) {
+#ifdef __linux__
+    // On Linux the nice value is per thread when addressed by thread id
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice) < 0) {
+      failures.push_back({ "setpriority", errno });
+    }
+#else
+    failures.push_back({ "setpriority", ENOSYS });
+#endif
+  }
+
+  if (!options.name.empty()) {
+    std::string name = (options.name + suffix).substr(0, HCI_THREAD_NAME_MAX);
+#ifdef __linux__
+    int error = pthread_setname_np(pthread_self(), name.c_str());
+    if (error != 0) {
+      failures.push_back({ "pthread_setname_np", error });
+    }
+#endif
+  }
+
+  return failures;
+}
+
+void BluetoothHciThread::Report(BluetoothHciDelivery& delivery, const std::vector<HciThreadFailure>& failures) {
+  for (const HciThreadFailure& failure : failures) {
+    delivery.push([failure](Napi::Env env, Napi::Object target) {
+      Napi::Error error = Napi::Error::New(env, strerror(failure.error));
+      error.Set("syscall", Napi::String::New(env, failure.syscall));
+      error.Set("errno", Napi::Number::New(env, failure.error));
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "warning"), error.Value() });
+    });
+  }
+}
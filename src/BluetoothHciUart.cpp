@@ -0,0 +1,422 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "BluetoothHciUart.h"
+#include "BluetoothStructs.h"
+
+#ifdef __linux__
+// termios2 from <asm/termbits.h>, which cannot be included next to <termios.h>.
+// Layout of the generic architectures (x86, arm, arm64, riscv).
+struct hci_termios2 {
+  tcflag_t c_iflag;
+  tcflag_t c_oflag;
+  tcflag_t c_cflag;
+  tcflag_t c_lflag;
+  cc_t     c_line;
+  cc_t     c_cc[19];
+  speed_t  c_ispeed;
+  speed_t  c_ospeed;
+};
+#define HCI_TCGETS2 _IOR('T', 0x2A, struct hci_termios2)
+#define HCI_TCSETS2 _IOW('T', 0x2B, struct hci_termios2)
+#define HCI_BOTHER  0010000
+#endif
+
+// Baud rates with a termios constant; anything else goes through termios2
+static speed_t StandardSpeed(uint32_t baudRate) {
+  switch (baudRate) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+#ifdef B460800
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+#endif
+    default:      return 0;
+  }
+}
+
+BluetoothHciUart::BluetoothHciUart(const Napi::CallbackInfo& info) :
+  Napi::ObjectWrap<BluetoothHciUart>(info),
+  _fd(-1),
+  stopFlag(true)
+{}
+
+BluetoothHciUart::~BluetoothHciUart() {
+  this->StopThreads();
+  if (this->_fd >= 0) {
+    close(this->_fd);
+    this->_fd = -1;
+  }
+}
+
+void BluetoothHciUart::Open(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "open: expected a tty path").ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  uint32_t baudRate = 1000000;
+  bool flowControl = true;
+
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    if (options.Get("baudRate").IsNumber()) {
+      baudRate = options.Get("baudRate").As<Napi::Number>().Uint32Value();
+    }
+    if (options.Get("flowControl").IsBoolean()) {
+      flowControl = options.Get("flowControl").As<Napi::Boolean>().Value();
+    }
+  }
+
+  if (this->_fd >= 0) {
+    this->StopThreads();
+    close(this->_fd);
+    this->_fd = -1;
+  }
+
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    Napi::Error::New(env, strerror(errno)).ThrowAsJavaScriptException();
+    return;
+  }
+  this->_fd = fd;
+
+  if (!this->Configure(baudRate, flowControl)) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    close(this->_fd);
+    this->_fd = -1;
+    error.ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->_framer.reset();
+}
+
+bool BluetoothHciUart::Configure(uint32_t baudRate, bool flowControl) {
+  struct termios tio = {};
+  if (tcgetattr(this->_fd, &tio) < 0) {
+    return false;
+  }
+
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  if (flowControl) {
+    tio.c_cflag |= CRTSCTS;
+  } else {
+    tio.c_cflag &= ~CRTSCTS;
+  }
+
+  // Reads never block in the kernel; the reader thread polls instead
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+
+  speed_t speed = StandardSpeed(baudRate);
+#ifdef __linux__
+  cfsetspeed(&tio, speed ? speed : B38400);
+#else
+  // BSD speed_t values are the baud rate itself
+  cfsetspeed(&tio, speed ? speed : baudRate);
+#endif
+
+  if (tcsetattr(this->_fd, TCSANOW, &tio) < 0) {
+    return false;
+  }
+
+#ifdef __linux__
+  if (speed == 0) {
+    // Custom rates (e.g. 1.8432 Mbaud modules) need BOTHER
+    struct hci_termios2 tio2 = {};
+    if (ioctl(this->_fd, HCI_TCGETS2, &tio2) < 0) {
+      return false;
+    }
+    tio2.c_cflag &= ~CBAUD;
+    tio2.c_cflag |= HCI_BOTHER;
+    tio2.c_ispeed = baudRate;
+    tio2.c_ospeed = baudRate;
+    if (ioctl(this->_fd, HCI_TCSETS2, &tio2) < 0) {
+      return false;
+    }
+  }
+#endif
+
+  tcflush(this->_fd, TCIOFLUSH);
+  return true;
+}
+
+void BluetoothHciUart::Start(const Napi::CallbackInfo& info) {
+  this->StopThreads();
+
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (this->_fd < 0) {
+    Napi::Error::New(env, "UART is not open").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Packets are delivered to the JS object's `emit` function
+  this->_delivery.start(env, info.This().As<Napi::Object>(), "UART Polling");
+
+  // Reset stop flag
+  stopFlag = false;
+  // Start the reader and writer threads; each applies its scheduling options to itself first
+  readerThread = std::thread([this, options = this->_threadOptions]() {
+    BluetoothHciThread::Report(this->_delivery, BluetoothHciThread::Apply(options));
+    this->ReadLoop();
+  });
+  writerThread = std::thread([this, options = this->_threadOptions]() {
+    BluetoothHciThread::Report(this->_delivery, BluetoothHciThread::Apply(options, "-w"));
+    this->WriteLoop();
+  });
+}
+
+void BluetoothHciUart::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+  this->StopThreads();
+}
+
+void BluetoothHciUart::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->StopThreads();
+  if (this->_fd >= 0) {
+    close(this->_fd);
+    this->_fd = -1;
+  }
+}
+
+void BluetoothHciUart::StopThreads() {
+  {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    stopFlag = true;
+    _writeQueue.clear();
+  }
+  _writeCond.notify_all();
+
+  // The writer goes first so nothing is pushed after the reader releases delivery
+  if (writerThread.joinable()) {
+    writerThread.join();
+  }
+  if (readerThread.joinable()) {
+    readerThread.join();
+  }
+}
+
+void BluetoothHciUart::OnPacket(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  this->_delivery.setHandlers(info.Length() > 0 ? info[0] : env.Undefined());
+}
+
+void BluetoothHciUart::SetDeliveryLanes(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Lane options object expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->_delivery.setLanes(info[0].As<Napi::Object>());
+}
+
+Napi::Value BluetoothHciUart::GetDeliveryStats(const Napi::CallbackInfo& info) {
+  return this->_delivery.stats(info.Env());
+}
+
+void BluetoothHciUart::SetThreadOptions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Takes effect when the threads are next started
+  HciThreadOptions options;
+  if (BluetoothHciThread::Parse(info.Length() > 0 ? info[0] : env.Undefined(), options)) {
+    this->_threadOptions = options;
+  }
+}
+
+void BluetoothHciUart::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  // Check if the first argument is provided and is a buffer
+  if (info.Length() > 0 && info[0].IsBuffer()) {
+    Napi::Buffer<char> buffer = info[0].As<Napi::Buffer<char>>();
+
+    {
+      std::lock_guard<std::mutex> lock(_writeMutex);
+      _writeQueue.emplace_back(buffer.Data(), buffer.Length());
+    }
+    _writeCond.notify_one();
+  }
+}
+
+void BluetoothHciUart::ReadLoop() {
+  char buffer[HCI_MAX_FRAME_SIZE];
+  bool closed = false;
+
+  struct pollfd pfd = {};
+  pfd.fd = this->_fd;
+  pfd.events = POLLIN;
+
+  while (!stopFlag) {
+    // Allow the thread to check the stop flag periodically even when no data is incoming
+    int ready = poll(&pfd, 1, 1000);
+    if (ready <= 0) {
+      continue;
+    }
+
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+      closed = true;
+      break;
+    }
+
+    ssize_t length = read(this->_fd, buffer, sizeof(buffer));
+    if (length > 0) {
+      this->_framer.push(reinterpret_cast<uint8_t*>(buffer), length, [this](uint8_t type, const uint8_t* body, size_t bodyLength) {
+        std::string packet;
+        packet.reserve(bodyLength + 1);
+        packet.push_back(static_cast<char>(type));
+        packet.append(reinterpret_cast<const char*>(body), bodyLength);
+        this->_delivery.push(std::move(packet));
+      });
+    } else if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+      // The device went away (unplugged USB serial adapter, closed pty)
+      closed = true;
+      break;
+    }
+  }
+
+  if (closed && !stopFlag) {
+    this->_delivery.push([](Napi::Env env, Napi::Object target) {
+      BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "close") });
+    }, BluetoothHciDelivery::Control, BluetoothHciDelivery::Barrier);
+  }
+
+  this->_delivery.stop();  // Release the thread-safe function after stopping the thread
+}
+
+void BluetoothHciUart::WriteLoop() {
+  while (true) {
+    std::string data;
+    {
+      std::unique_lock<std::mutex> lock(_writeMutex);
+      _writeCond.wait(lock, [this] { return stopFlag || !_writeQueue.empty(); });
+      if (stopFlag) {
+        break;
+      }
+      data = std::move(_writeQueue.front());
+      _writeQueue.pop_front();
+    }
+
+    if (!this->WriteAll(data)) {
+      int error = errno;
+      this->_delivery.push([error](Napi::Env env, Napi::Object target) {
+        Napi::Error err = Napi::Error::New(env, strerror(error));
+        err.Set("syscall", Napi::String::New(env, "write"));
+        err.Set("errno", Napi::Number::New(env, error));
+        BluetoothHciDelivery::Emit(target, { Napi::String::New(env, "error"), err.Value() });
+      });
+    }
+  }
+}
+
+bool BluetoothHciUart::WriteAll(const std::string& data) {
+  size_t offset = 0;
+
+  while (offset < data.length() && !stopFlag) {
+    ssize_t n = write(this->_fd, data.data() + offset, data.length() - offset);
+    if (n > 0) {
+      offset += n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      // Output buffer full (or RTS/CTS holding us off); wait until the tty drains
+      struct pollfd pfd = {};
+      pfd.fd = this->_fd;
+      pfd.events = POLLOUT;
+      poll(&pfd, 1, 100);
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Napi::Value BluetoothHciUart::OpenPseudoTerminal(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();  // Get the environment
+  Napi::HandleScope scope(env);  // Create a scope for memory management
+
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    if (fd >= 0) close(fd);
+    error.ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  char path[128];
+  if (ptsname_r(fd, path, sizeof(path)) != 0) {
+    Napi::Error error = Napi::Error::New(env, strerror(errno));
+    close(fd);
+    error.ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // The master side stays raw too so test traffic is passed through untouched
+  struct termios tio = {};
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+
+  // Non-blocking, so a test reading it never stalls the event loop
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("fd", Napi::Number::New(env, fd));
+  result.Set("path", Napi::String::New(env, path));
+  return result;
+}
+
+Napi::Object BluetoothHciUart::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  // Create the function for the class
+  Napi::Function func = DefineClass(env, "BluetoothHciUart", {
+    InstanceMethod("open", &BluetoothHciUart::Open),
+    InstanceMethod("start", &BluetoothHciUart::Start),
+    InstanceMethod("stop", &BluetoothHciUart::Stop),
+    InstanceMethod("write", &BluetoothHciUart::Write),
+    InstanceMethod("onPacket", &BluetoothHciUart::OnPacket),
+    InstanceMethod("setDeliveryLanes", &BluetoothHciUart::SetDeliveryLanes),
+    InstanceMethod("getDeliveryStats", &BluetoothHciUart::GetDeliveryStats),
+    InstanceMethod("setThreadOptions", &BluetoothHciUart::SetThreadOptions),
+    InstanceMethod("close", &BluetoothHciUart::Close),
+    StaticMethod("openPseudoTerminal", &BluetoothHciUart::OpenPseudoTerminal)
+  });
+
+  exports.Set("BluetoothHciUart", func);
+  return exports;
+}
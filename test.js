@@ -6,3 +6,79 @@ try {
 } catch (err) {
   console.error(err);
 }
+
+// The shared H4 framer must split a chunk holding several packets and join straddling ones.
+const assert = require('assert');
+const { createFramer } = require('./lib/framer');
+
+const framer = createFramer();
+const stream = Buffer.from('040e0401030c00' + '0201200300aabbcc' + '040e0401030c00', 'hex');
+const packets = [];
+for (let offset = 0; offset < stream.length; offset += 5) {
+  packets.push(...framer.push(stream.subarray(offset, offset + 5)));
+}
+assert.deepStrictEqual(packets.map((p) => p.toString('hex')), ['040e0401030c00', '0201200300aabbcc', '040e0401030c00']);
+
+// Native UART transport end to end over a pseudo-terminal, where the addon provides it.
+const NativeUart = require('./lib/uart/native-uart');
+if (NativeUart) {
+  const fs = require('fs');
+  const { fd, path } = NativeUart.openPseudoTerminal();
+  const uart = new NativeUart();
+  const received = [];
+  const written = Buffer.alloc(4);
+  let writtenLength = 0;
+  const timeout = setTimeout(() => {
+    uart.close();
+    fs.closeSync(fd);
+    assert.fail(`UART test timed out with ${received.length} of 3 packets and ${writtenLength} of 4 command bytes`);
+  }, 5000);
+
+  // The master is non-blocking: the command is polled for once the packets are in
+  const readCommand = () => {
+    try {
+      writtenLength += fs.readSync(fd, written, writtenLength, written.length - writtenLength, null);
+    } catch (err) {
+      if (err.code !== 'EAGAIN') {
+        throw err;
+      }
+    }
+    if (writtenLength < written.length) {
+      setTimeout(readCommand, 10);
+      return;
+    }
+    clearTimeout(timeout);
+    uart.close();
+    fs.closeSync(fd);
+    assert.strictEqual(written.toString('hex'), '01030c00');
+    assert.deepStrictEqual(received, ['040e0401030c00', '0201200300aabbcc', '040e0401030c00']);
+  };
+
+  uart.open(path, { baudRate: 115200, flowControl: false });
+  uart.on('data', (data) => {
+    received.push(data.toString('hex'));
+    if (received.length === 3) {
+      setImmediate(readCommand);
+    }
+  });
+  uart.start();
+  uart.write(Buffer.from('01030c00', 'hex'));
+  fs.writeSync(fd, stream);
+}
+
+// UART thread options must reach the native transport.
+if (NativeUart) {
+  const UartHciSocket = require('./lib/uart');
+  const { open, setThreadOptions } = NativeUart.prototype;
+  let applied;
+  NativeUart.prototype.open = function () {};
+  NativeUart.prototype.setThreadOptions = function (options) { applied = options; };
+  try {
+    const threads = { cpus: [0], name: 'hci-uart' };
+    new UartHciSocket().bindUser(null, { uart: { port: '/dev/null', baudRate: 115200, native: true, threads } });
+    assert.deepStrictEqual(applied, threads);
+  } finally {
+    NativeUart.prototype.open = open;
+    NativeUart.prototype.setThreadOptions = setThreadOptions;
+  }
+}